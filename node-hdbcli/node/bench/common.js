@@ -0,0 +1,202 @@
+'use strict';
+
+// Helpers shared by the benchmarks: loading the driver against the mock
+// libdbcapiHDB and measuring a case.
+
+var fs = require('fs');
+var path = require('path');
+
+var perf_hooks = null;
+try {
+    perf_hooks = require('perf_hooks');
+} catch (ex) {
+    // Node versions before 8.5 have no perf_hooks
+}
+
+var modpath = path.dirname(__dirname);
+
+// Locations of the library built with node-gyp rebuild --hana_mock=1
+var mockPaths = [
+    path.join(modpath, 'build', 'Release', 'libdbcapiHDB.so'),
+    path.join(modpath, 'build', 'Release', 'lib.target', 'libdbcapiHDB.so'),
+    path.join(modpath, 'build', 'Release', 'libdbcapiHDB.dylib'),
+    path.join(modpath, 'build', 'Release', 'dbcapiHDB.dll')
+];
+
+// Loads the driver. Unless DBCAPI_API_DLL is already set the mock library is
+// used, so the benchmarks run without a server.
+function loadDriver() {
+    if (!process.env['DBCAPI_API_DLL']) {
+        var found = mockPaths.filter(function (p) {
+            try {
+                fs.statSync(p);
+                return true;
+            } catch (ex) {
+                return false;
+            }
+        });
+        if (found.length === 0) {
+            throw new Error('The mock libdbcapiHDB was not found; build it with ' +
+                            '`node-gyp rebuild --hana_mock=1` or set DBCAPI_API_DLL.');
+        }
+        process.env['DBCAPI_API_DLL'] = found[0];
+    }
+    return require(path.join(modpath, 'lib', 'index'));
+}
+
+// Connection parameters; settings are passed to the mock in the connection
+// string (see mock/mock.h)
+function connParams(settings) {
+    var params = {
+        serverNode: process.env['HANA_BENCH_SERVER'] || 'mock:30015',
+        uid: process.env['HANA_BENCH_USER'] || 'SYSTEM',
+        pwd: process.env['HANA_BENCH_PASSWORD'] || 'manager'
+    };
+    Object.keys(settings || {}).forEach(function (key) {
+        params[key] = String(settings[key]);
+    });
+    return params;
+}
+
+// Collects the garbage collections of the process while a case runs
+function GcCounter() {
+    this.count = 0;
+    this.ms = 0;
+    this.observer = null;
+
+    if (perf_hooks !== null && perf_hooks.PerformanceObserver !== undefined) {
+        var counter = this;
+        try {
+            this.observer = new perf_hooks.PerformanceObserver(function (list) {
+                list.getEntries().forEach(function (entry) {
+                    counter.count++;
+                    counter.ms += entry.duration;
+                });
+            });
+            this.observer.observe({ entryTypes: ['gc'] });
+        } catch (ex) {
+            this.observer = null;
+        }
+    }
+}
+
+GcCounter.prototype.stop = function () {
+    if (this.observer !== null) {
+        this.observer.disconnect();
+    }
+    return this.observer !== null;
+};
+
+function eventLoopUtilization(previous) {
+    if (perf_hooks === null || perf_hooks.performance === undefined ||
+        typeof perf_hooks.performance.eventLoopUtilization !== 'function') {
+        return null;
+    }
+    return previous ? perf_hooks.performance.eventLoopUtilization(previous)
+                    : perf_hooks.performance.eventLoopUtilization();
+}
+
+// Runs fn(done) iterations times after one warm up run. fn reports the number
+// of rows it processed with done(err, rows). The result holds rows per second,
+// the time the main thread was busy and the allocation activity.
+function measure(name, iterations, fn, callback) {
+    fn(function (err) {
+        if (err) {
+            return callback(err);
+        }
+        if (global.gc) {
+            global.gc();
+        }
+
+        var gc = new GcCounter();
+        var mem = process.memoryUsage();
+        var elu = eventLoopUtilization();
+        var start = process.hrtime();
+        var rows = 0;
+        var i = 0;
+
+        function next(err, count) {
+            if (err) {
+                gc.stop();
+                return callback(err);
+            }
+            rows += count || 0;
+            if (i++ < iterations) {
+                return fn(next);
+            }
+
+            var elapsed = process.hrtime(start);
+            var ms = elapsed[0] * 1e3 + elapsed[1] / 1e6;
+            var busy = elu !== null ? eventLoopUtilization(elu) : null;
+            var memAfter = process.memoryUsage();
+
+            // Let the observer deliver the last entries
+            setImmediate(function () {
+                var hasGc = gc.stop();
+                callback(null, {
+                    name: name,
+                    ms: ms,
+                    rows: rows,
+                    rowsPerSec: ms > 0 ? rows * 1000 / ms : 0,
+                    mainMs: busy !== null ? busy.active : null,
+                    gcCount: hasGc ? gc.count : null,
+                    gcMs: hasGc ? gc.ms : null,
+                    heapDelta: memAfter.heapUsed - mem.heapUsed,
+                    externalDelta: (memAfter.external || 0) - (mem.external || 0),
+                    rssDelta: memAfter.rss - mem.rss
+                });
+            });
+        }
+        next(null, 0);
+    });
+}
+
+function pad(text, width, left) {
+    text = String(text);
+    while (text.length < width) {
+        text = left ? text + ' ' : ' ' + text;
+    }
+    return text;
+}
+
+function fixed(value, digits) {
+    return (value === null || value === undefined) ? 'n/a' : value.toFixed(digits);
+}
+
+function kb(bytes) {
+    return (bytes / 1024).toFixed(0);
+}
+
+var columns = [
+    ['case', 28, function (r) { return r.name; }],
+    ['rows/s', 12, function (r) { return fixed(r.rowsPerSec, 0); }],
+    ['total ms', 10, function (r) { return fixed(r.ms, 1); }],
+    ['main ms', 10, function (r) { return fixed(r.mainMs, 1); }],
+    ['gc', 6, function (r) { return r.gcCount === null ? 'n/a' : r.gcCount; }],
+    ['gc ms', 8, function (r) { return fixed(r.gcMs, 1); }],
+    ['heap KB', 10, function (r) { return kb(r.heapDelta); }],
+    ['ext KB', 10, function (r) { return kb(r.externalDelta); }],
+    ['rss KB', 10, function (r) { return kb(r.rssDelta); }]
+];
+
+function printHeader() {
+    console.log(columns.map(function (c, i) {
+        return pad(c[0], c[1], i === 0);
+    }).join(' '));
+}
+
+function printResult(result) {
+    console.log(columns.map(function (c, i) {
+        return pad(c[2](result), c[1], i === 0);
+    }).join(' '));
+}
+
+module.exports = {
+    loadDriver: loadDriver,
+    connParams: connParams,
+    measure: measure,
+    printHeader: printHeader,
+    printResult: printResult,
+    pad: pad,
+    fixed: fixed
+};
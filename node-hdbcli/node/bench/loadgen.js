@@ -0,0 +1,607 @@
+'use strict';
+
+// Load generator: N workers, each with its own connection, run a mix of
+// operations for a while and the throughput, latency percentiles, the use
+// of the database thread pool and the event loop lag are reported. It is
+// the counterpart of odbc_test/lg.c and jdbc_test/lg.java.
+//
+//   node bench/loadgen.js [--workers N] [--duration S] [--warmup S]
+//                         [--mix exec=4,prepare=2,batch=1,cursor=1]
+//                         [--rows N] [--batch-size N] [--threads N]
+//                         [--irr] [--json]
+//
+// The operations are
+//   exec      conn.exec of a query
+//   prepare   conn.prepare, stmt.exec and stmt.drop of the same query
+//   batch     stmt.execBatch of --batch-size rows into a prepared insert
+//   cursor    stmt.execQuery and ResultSet next/getValues over the rows
+//
+// Against the mock the queries carry the mock settings. Against a server set
+// DBCAPI_API_DLL and HANA_BENCH_SERVER, HANA_BENCH_USER and
+// HANA_BENCH_PASSWORD, and either --irr for the IRR workload of the ODBC and
+// JDBC tests or --query-sql and --insert-sql; an insert needs as many
+// parameters as --insert-params lists.
+
+var common = require('./common');
+var hana = common.loadDriver();
+
+var perf_hooks = null;
+try {
+    perf_hooks = require('perf_hooks');
+} catch (ex) {
+    // Node versions before 8.5 have no perf_hooks
+}
+
+var options = {
+    workers: 8,
+    duration: 10,
+    warmup: 2,
+    mix: null,
+    rows: 100,
+    batchSize: 100,
+    threads: 0,
+    irr: false,
+    json: false,
+    querySql: null,
+    insertSql: null,
+    insertParams: 'int,varchar:32,double'
+};
+
+var numberOptions = {
+    '--workers': 'workers',
+    '--duration': 'duration',
+    '--warmup': 'warmup',
+    '--rows': 'rows',
+    '--batch-size': 'batchSize',
+    '--threads': 'threads'
+};
+
+// 0 keeps the default thread pool size or skips the warm-up
+var zeroAllowed = { warmup: true, threads: true };
+
+function parseNumber(arg, text) {
+    var value = parseFloat(text);
+    var name = numberOptions[arg];
+    if (!isFinite(value) || value < 0 || (value === 0 && !zeroAllowed[name])) {
+        console.error((text === undefined ? 'Missing value' : 'Invalid value ' + text) + ' for ' + arg + '; expected a ' +
+                      (zeroAllowed[name] ? 'non-negative' : 'positive') + ' number');
+        process.exit(2);
+    }
+    return value;
+}
+
+for (var a = 2; a < process.argv.length; a++) {
+    var arg = process.argv[a];
+    if (numberOptions[arg] !== undefined) {
+        options[numberOptions[arg]] = parseNumber(arg, process.argv[++a]);
+    } else if (arg === '--mix') {
+        options.mix = process.argv[++a];
+    } else if (arg === '--query-sql') {
+        options.querySql = process.argv[++a];
+    } else if (arg === '--insert-sql') {
+        options.insertSql = process.argv[++a];
+    } else if (arg === '--insert-params') {
+        options.insertParams = process.argv[++a];
+    } else if (arg === '--irr') {
+        options.irr = true;
+    } else if (arg === '--json') {
+        options.json = true;
+    } else {
+        console.error('Unknown argument ' + arg);
+        process.exit(2);
+    }
+}
+
+var opNames = ['exec', 'prepare', 'batch', 'cursor'];
+
+// Parses --mix into a list to draw the operations from by weight
+function parseMix(text) {
+    var mix = [];
+    var total = 0;
+    text.split(',').forEach(function (item) {
+        var parts = item.split('=');
+        var weight = parts.length > 1 ? parseFloat(parts[1]) : 1;
+        if (opNames.indexOf(parts[0]) < 0 || !(weight >= 0)) {
+            console.error('Invalid --mix entry ' + item + '; the operations are ' + opNames.join(', '));
+            process.exit(2);
+        }
+        if (weight > 0) {
+            total += weight;
+            mix.push({ op: parts[0], upTo: total });
+        }
+    });
+    if (total === 0) {
+        console.error('--mix selects no operation');
+        process.exit(2);
+    }
+    mix.total = total;
+    return mix;
+}
+
+function pickOp(mix) {
+    var r = Math.random() * mix.total;
+    for (var i = 0; i < mix.length - 1; i++) {
+        if (r < mix[i].upTo) {
+            return mix[i].op;
+        }
+    }
+    return mix[mix.length - 1].op;
+}
+
+// Settings of the mock for a query, see mock/mock.h
+function mockSql(sql, settings) {
+    return sql + ' /* mock ' + settings + ' */';
+}
+
+var irrContractsSql = 'SELECT "CONTRACT_ID", count(*) "PAY_COUNT" ' +
+    'FROM IRT."irt.cfkernel.tables::CF.CashFlowSimple" GROUP BY "CONTRACT_ID"';
+var irrCashflowSql = 'SELECT days_between("PAYMENT_DATE", to_date(\'1990-01-01\')) "PAYMENT_DATE", ' +
+    '"AMOUNT_PRINCIPAL" FROM IRT."irt.cfkernel.tables::CF.CashFlowSimple" WHERE "CONTRACT_ID" = ?';
+
+// The internal rate of return of a cash flow by the secant method, as in
+// IrrCalc of jdbc_test/lg.java
+function irr(cashflow) {
+    function npv(rate) {
+        var sum = 0;
+        for (var i = 0; i < cashflow.length; i++) {
+            var years = (cashflow[i][0] - cashflow[0][0]) / 365;
+            sum += cashflow[i][1] / Math.pow(1 + rate, years);
+        }
+        return sum;
+    }
+    var r1 = 0.2, r2 = 0.25, v1 = 0, v2 = 0, rate = 0;
+    for (var i = 0; i < 100; i++) {
+        rate = i === 0 ? 0.25 : i === 1 ? 0.2 : r1 - v1 * ((r1 - r2) / (v1 - v2));
+        var v = npv(rate);
+        r2 = r1;
+        r1 = rate;
+        v2 = v1;
+        v1 = v;
+        if (v < 0.01 && v > -0.01) {
+            break;
+        }
+    }
+    return rate;
+}
+
+function rowValues(row) {
+    return Object.keys(row).map(function (key) {
+        return row[key];
+    });
+}
+
+// The SQL and parameters of each operation
+function Workload(contracts) {
+    var mock = !options.irr && options.querySql === null;
+    this.contracts = contracts;
+    this.querySql = options.irr ? irrCashflowSql :
+        options.querySql !== null ? options.querySql :
+        mockSql('SELECT * FROM T', 'rows=' + options.rows + ' cols=int,varchar:32,double');
+    this.insertSql = options.insertSql !== null ? options.insertSql :
+        mock ? mockSql('INSERT INTO T VALUES(?, ?, ?)', 'params=' + options.insertParams) : null;
+    this.insertParams = options.insertParams.split(',');
+    this.next = 0;
+}
+
+Workload.prototype.queryParams = function () {
+    if (!this.contracts) {
+        return [];
+    }
+    return [this.contracts[this.next++ % this.contracts.length]];
+};
+
+// Rows of made-up values for the insert
+Workload.prototype.batchRows = function () {
+    var types = this.insertParams;
+    var rows = [];
+    for (var i = 0; i < options.batchSize; i++) {
+        rows.push(types.map(function (type) {
+            if (type.indexOf('char') >= 0 || type.indexOf('text') >= 0) {
+                return 'row ' + i;
+            }
+            if (type === 'double' || type === 'real' || type === 'decimal') {
+                return i / 2;
+            }
+            return i;
+        }));
+    }
+    return rows;
+};
+
+// Processes the rows of a query: the IRR workload computes the rate
+Workload.prototype.consume = function (rows) {
+    if (options.irr && rows.length > 0) {
+        irr(rows.map(rowValues));
+    }
+    return rows.length;
+};
+
+// Latencies of one operation in milliseconds
+function OpStats() {
+    this.count = 0;
+    this.rows = 0;
+    this.errors = 0;
+    this.latencies = [];
+    this.lastError = null;
+}
+
+OpStats.prototype.add = function (ms, rows) {
+    this.count++;
+    this.rows += rows;
+    this.latencies.push(ms);
+};
+
+function percentile(sorted, p) {
+    if (sorted.length === 0) {
+        return null;
+    }
+    var index = Math.min(sorted.length - 1, Math.ceil(p / 100 * sorted.length) - 1);
+    return sorted[Math.max(0, index)];
+}
+
+OpStats.prototype.summary = function (seconds) {
+    var sorted = this.latencies.slice().sort(function (x, y) {
+        return x - y;
+    });
+    var sum = 0;
+    for (var i = 0; i < sorted.length; i++) {
+        sum += sorted[i];
+    }
+    return {
+        ops: this.count,
+        errors: this.errors,
+        rows: this.rows,
+        opsPerSec: seconds > 0 ? this.count / seconds : 0,
+        rowsPerSec: seconds > 0 ? this.rows / seconds : 0,
+        meanMs: sorted.length > 0 ? sum / sorted.length : null,
+        p50Ms: percentile(sorted, 50),
+        p90Ms: percentile(sorted, 90),
+        p99Ms: percentile(sorted, 99),
+        p999Ms: percentile(sorted, 99.9),
+        maxMs: sorted.length > 0 ? sorted[sorted.length - 1] : null,
+        lastError: this.lastError
+    };
+};
+
+// Samples the database thread pool every 100 ms
+function PoolSampler() {
+    var sampler = this;
+    this.samples = 0;
+    this.busySum = 0;
+    this.saturated = 0;
+    this.queuedSum = 0;
+    this.maxQueued = 0;
+    this.start = hana.getThreadPoolStats();
+    this.timer = setInterval(function () {
+        var stats = hana.getThreadPoolStats();
+        sampler.samples++;
+        sampler.busySum += stats.threads > 0 ? stats.busy / stats.threads : 0;
+        sampler.queuedSum += stats.queued;
+        sampler.maxQueued = Math.max(sampler.maxQueued, stats.queued);
+        if (stats.busy >= stats.threads && stats.queued > 0) {
+            sampler.saturated++;
+        }
+    }, 100);
+}
+
+PoolSampler.prototype.stop = function () {
+    clearInterval(this.timer);
+    var end = hana.getThreadPoolStats();
+    var n = Math.max(1, this.samples);
+    return {
+        threads: end.threads,
+        busyPct: this.busySum * 100 / n,
+        saturatedPct: this.saturated * 100 / n,
+        meanQueued: this.queuedSum / n,
+        maxQueued: this.maxQueued,
+        avgWaitMs: end.avgWaitMs,
+        maxWaitMs: end.maxWaitMs,
+        completed: end.completed - this.start.completed
+    };
+};
+
+// Measures how late timers fire; monitorEventLoopDelay needs Node 11.10
+var lagResolution = 10;
+
+function LagSampler() {
+    this.histogram = null;
+    this.delays = [];
+    this.timer = null;
+
+    if (perf_hooks !== null && typeof perf_hooks.monitorEventLoopDelay === 'function') {
+        this.histogram = perf_hooks.monitorEventLoopDelay({ resolution: lagResolution });
+        this.histogram.enable();
+        return;
+    }
+    var sampler = this;
+    var expected = Date.now() + lagResolution;
+    this.timer = setInterval(function () {
+        var now = Date.now();
+        sampler.delays.push(Math.max(0, now - expected));
+        expected = now + lagResolution;
+    }, lagResolution);
+}
+
+LagSampler.prototype.stop = function () {
+    if (this.histogram !== null) {
+        this.histogram.disable();
+        var h = this.histogram;
+        // The histogram holds the time between the ticks of its timer
+        var lagMs = function (ns) {
+            return Math.max(0, ns / 1e6 - lagResolution);
+        };
+        return {
+            meanMs: lagMs(h.mean),
+            p50Ms: lagMs(h.percentile(50)),
+            p99Ms: lagMs(h.percentile(99)),
+            maxMs: lagMs(h.max)
+        };
+    }
+    clearInterval(this.timer);
+    var sorted = this.delays.sort(function (x, y) {
+        return x - y;
+    });
+    var sum = sorted.reduce(function (s, d) {
+        return s + d;
+    }, 0);
+    return {
+        meanMs: sorted.length > 0 ? sum / sorted.length : null,
+        p50Ms: percentile(sorted, 50),
+        p99Ms: percentile(sorted, 99),
+        maxMs: sorted.length > 0 ? sorted[sorted.length - 1] : null
+    };
+};
+
+function elapsedMs(start) {
+    var t = process.hrtime(start);
+    return t[0] * 1e3 + t[1] / 1e6;
+}
+
+// One worker: a connection running operations back to back until stopped
+function Worker(conn, workload, mix) {
+    this.conn = conn;
+    this.workload = workload;
+    this.mix = mix;
+    this.insertStmt = null;
+}
+
+Worker.prototype.runOp = function (op, done) {
+    var conn = this.conn;
+    var workload = this.workload;
+
+    switch (op) {
+        case 'exec':
+            return conn.exec(workload.querySql, workload.queryParams(), function (err, rows) {
+                done(err, err ? 0 : workload.consume(rows || []));
+            });
+        case 'prepare':
+            return conn.prepare(workload.querySql, function (err, stmt) {
+                if (err) {
+                    return done(err);
+                }
+                stmt.exec(workload.queryParams(), function (err, rows) {
+                    var count = err ? 0 : workload.consume(rows || []);
+                    stmt.drop(function () {
+                        done(err, count);
+                    });
+                });
+            });
+        case 'batch':
+            if (workload.insertSql === null) {
+                return done(new Error('batch needs --insert-sql against a server'));
+            }
+            var worker = this;
+            var rows = workload.batchRows();
+            var run = function () {
+                worker.insertStmt.execBatch(rows, function (err) {
+                    done(err, err ? 0 : rows.length);
+                });
+            };
+            if (this.insertStmt !== null) {
+                return run();
+            }
+            return conn.prepare(workload.insertSql, function (err, stmt) {
+                if (err) {
+                    return done(err);
+                }
+                worker.insertStmt = stmt;
+                run();
+            });
+        case 'cursor':
+            return conn.prepare(workload.querySql, function (err, stmt) {
+                if (err) {
+                    return done(err);
+                }
+                stmt.execQuery(workload.queryParams(), function (err, rs) {
+                    if (err) {
+                        return stmt.drop(function () {
+                            done(err);
+                        });
+                    }
+                    var rows = [];
+                    while (rs.next()) {
+                        rows.push(rs.getValues());
+                    }
+                    rs.close();
+                    stmt.drop(function () {
+                        done(null, workload.consume(rows));
+                    });
+                });
+            });
+    }
+};
+
+Worker.prototype.close = function () {
+    var conn = this.conn;
+    if (this.insertStmt === null) {
+        return conn.disconnect();
+    }
+    this.insertStmt.drop(function () {
+        conn.disconnect();
+    });
+    this.insertStmt = null;
+};
+
+// Runs operations until Date.now() passes endAt, adding them to stats once
+// measureFrom has passed
+Worker.prototype.run = function (stats, measureFrom, endAt, callback) {
+    var worker = this;
+
+    (function next() {
+        if (Date.now() >= endAt) {
+            return callback();
+        }
+        var op = pickOp(worker.mix);
+        var start = process.hrtime();
+        var startedAt = Date.now();
+        worker.runOp(op, function (err, rows) {
+            var ms = elapsedMs(start);
+            if (startedAt >= measureFrom) {
+                if (err) {
+                    stats[op].errors++;
+                    stats[op].lastError = err.message;
+                } else {
+                    stats[op].add(ms, rows || 0);
+                }
+            }
+            // Let timers and the samplers run between operations
+            setImmediate(next);
+        });
+    })();
+};
+
+function connect(count, callback) {
+    var conns = [];
+    var pending = count;
+    var failed = null;
+    for (var i = 0; i < count; i++) {
+        var conn = hana.createConnection();
+        conns.push(conn);
+        conn.connect(common.connParams(), function (err) {
+            failed = failed || err;
+            if (--pending === 0) {
+                callback(failed, conns);
+            }
+        });
+    }
+}
+
+// Reads the contracts for the IRR workload, like the main of lg.java
+function loadContracts(conn, callback) {
+    if (!options.irr) {
+        return callback(null, null);
+    }
+    conn.exec(irrContractsSql, function (err, rows) {
+        if (err) {
+            return callback(err);
+        }
+        callback(null, rows.map(function (row) {
+            return row.CONTRACT_ID;
+        }));
+    });
+}
+
+function printReport(report) {
+    if (options.json) {
+        console.log(JSON.stringify(report));
+        return;
+    }
+    var pad = common.pad;
+    var fixed = common.fixed;
+
+    console.log(report.workers + ' workers, ' + report.seconds.toFixed(1) + ' s, mix ' + options.mix +
+                (options.irr ? ', IRR workload' : ''));
+    console.log([pad('op', 8, true), pad('ops/s', 10), pad('rows/s', 12), pad('errors', 7),
+                 pad('mean', 8), pad('p50', 8), pad('p90', 8), pad('p99', 8), pad('p99.9', 8),
+                 pad('max', 8)].join(' '));
+    Object.keys(report.ops).forEach(function (op) {
+        var s = report.ops[op];
+        console.log([pad(op, 8, true), pad(fixed(s.opsPerSec, 1), 10), pad(fixed(s.rowsPerSec, 0), 12),
+                     pad(s.errors, 7), pad(fixed(s.meanMs, 2), 8), pad(fixed(s.p50Ms, 2), 8),
+                     pad(fixed(s.p90Ms, 2), 8), pad(fixed(s.p99Ms, 2), 8), pad(fixed(s.p999Ms, 2), 8),
+                     pad(fixed(s.maxMs, 2), 8)].join(' '));
+        if (s.lastError !== null) {
+            console.log('         last error: ' + s.lastError);
+        }
+    });
+    var p = report.threadPool;
+    console.log('thread pool: ' + p.threads + ' threads, ' + fixed(p.busyPct, 1) + '% busy, saturated ' +
+                fixed(p.saturatedPct, 1) + '% of the time, queued mean ' + fixed(p.meanQueued, 1) +
+                ' max ' + p.maxQueued + ', wait avg ' + fixed(p.avgWaitMs, 2) + ' ms max ' +
+                fixed(p.maxWaitMs, 2) + ' ms');
+    var l = report.eventLoopLag;
+    console.log('event loop lag: mean ' + fixed(l.meanMs, 2) + ' ms, p50 ' + fixed(l.p50Ms, 2) +
+                ' ms, p99 ' + fixed(l.p99Ms, 2) + ' ms, max ' + fixed(l.maxMs, 2) + ' ms');
+}
+
+// The IRR workload reads cash flows, as the ODBC and JDBC tests do
+if (options.mix === null) {
+    options.mix = options.irr ? 'cursor=1' : 'exec=4,prepare=2,batch=1,cursor=1';
+}
+var mix = parseMix(options.mix);
+if (options.threads > 0) {
+    hana.setThreadPoolSize(options.threads);
+}
+
+connect(options.workers, function (err, conns) {
+    if (err) {
+        console.error('connect: ' + err.message);
+        process.exit(1);
+    }
+    loadContracts(conns[0], function (err, contracts) {
+        if (err) {
+            console.error('reading the contracts: ' + err.message);
+            process.exit(1);
+        }
+        if (contracts !== null && contracts.length === 0) {
+            console.error('there are no contracts');
+            process.exit(1);
+        }
+
+        var workload = new Workload(contracts);
+        var stats = {};
+        mix.forEach(function (m) {
+            stats[m.op] = new OpStats();
+        });
+
+        var now = Date.now();
+        var measureFrom = now + options.warmup * 1000;
+        var endAt = measureFrom + options.duration * 1000;
+        var pool = null;
+        var lag = null;
+
+        // The samplers only cover the measured part of the run
+        var warmupTimer = setTimeout(function () {
+            pool = new PoolSampler();
+            lag = new LagSampler();
+        }, options.warmup * 1000);
+
+        var pending = conns.length;
+        var workers = conns.map(function (conn) {
+            return new Worker(conn, workload, mix);
+        });
+        workers.forEach(function (worker) {
+            worker.run(stats, measureFrom, endAt, function () {
+                if (--pending > 0) {
+                    return;
+                }
+                clearTimeout(warmupTimer);
+                var seconds = (Math.min(Date.now(), endAt) - measureFrom) / 1000;
+                var report = {
+                    workers: conns.length,
+                    seconds: seconds,
+                    ops: {},
+                    threadPool: pool !== null ? pool.stop() : new PoolSampler().stop(),
+                    eventLoopLag: lag !== null ? lag.stop() : new LagSampler().stop()
+                };
+                Object.keys(stats).forEach(function (op) {
+                    report.ops[op] = stats[op].summary(seconds);
+                });
+                printReport(report);
+                workers.forEach(function (worker) {
+                    worker.close();
+                });
+            });
+        });
+    });
+});
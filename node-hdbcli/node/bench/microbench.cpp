@@ -0,0 +1,506 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+// Micro benchmark of the value conversion code of the driver.
+//
+// Runs fetchResultSet, getResultSet, getBindParameter, the convertTo*
+// functions and the packing of execBatch parameters on synthetic data in an
+// embedded V8 isolate, against the mock libdbcapiHDB, and reports the time
+// and the number of native allocations per cell for each column type. Built with
+//
+//     node-gyp rebuild --hana_mock=1 --hana_microbench=1
+//         --node_shared_library=/path/to/libnode.so
+//
+// and run with DBCAPI_API_DLL set to the mock library:
+//
+//     hana-microbench [--rows n] [--repeat n] [--filter text] [--json]
+//
+// Native allocations are the calls of operator new and new[] in the whole
+// process. Objects that V8 allocates on its own heap are not counted, so
+// the getResultSet figures leave out the JavaScript values of every cell.
+// The fetchResultSet figures include the time the mock takes to
+// generate the values.
+#include "hana_utils.h"
+#include "libplatform/libplatform.h"
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace v8;
+
+static std::atomic<uint64_t> allocations( 0 );
+
+void *operator new( size_t size )
+{
+    allocations++;
+    void *p = malloc( size > 0 ? size : 1 );
+    if( p == NULL ) {
+	throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[]( size_t size )
+{
+    return operator new( size );
+}
+
+void *operator new( size_t size, const std::nothrow_t & ) noexcept
+{
+    allocations++;
+    return malloc( size > 0 ? size : 1 );
+}
+
+void *operator new[]( size_t size, const std::nothrow_t &tag ) noexcept
+{
+    return operator new( size, tag );
+}
+
+void operator delete( void *p ) noexcept
+{
+    free( p );
+}
+
+void operator delete[]( void *p ) noexcept
+{
+    free( p );
+}
+
+struct benchOptions
+{
+    benchOptions() : rows( 100000 ), repeat( 5 ), filter( NULL ), json( false ) {}
+
+    int64_t	rows;
+    int		repeat;
+    const char	*filter;
+    bool	json;
+};
+
+static benchOptions options;
+
+/** Time and allocations of one run of a kernel over cells values. */
+class benchRun
+{
+  public:
+    benchRun() : ns( 0 ), allocs( 0 ), cells( 0 ) {}
+
+    void start()
+    {
+	started_allocs = allocations.load();
+	started_at = std::chrono::steady_clock::now();
+    }
+
+    void stop( uint64_t count )
+    {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	ns += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( now - started_at ).count();
+	allocs += allocations.load() - started_allocs;
+	cells += count;
+    }
+
+    uint64_t	ns;
+    uint64_t	allocs;
+    uint64_t	cells;
+
+  private:
+    std::chrono::steady_clock::time_point	started_at;
+    uint64_t					started_allocs;
+};
+
+static bool selected( const char *kernel, const char *type )
+/**********************************************************/
+{
+    if( options.filter == NULL ) {
+	return true;
+    }
+    std::string name = std::string( kernel ) + " " + type;
+    return name.find( options.filter ) != std::string::npos;
+}
+
+static void report( const char *kernel, const char *type, const benchRun &best )
+/*****************************************************************************/
+{
+    double cells = best.cells > 0 ? (double)best.cells : 1;
+
+    if( options.json ) {
+	printf( "{\"kernel\":\"%s\",\"type\":\"%s\",\"nsPerCell\":%.2f,\"nativeAllocsPerCell\":%.3f,\"cells\":%llu}\n",
+		kernel, type, best.ns / cells, best.allocs / cells, (unsigned long long)best.cells );
+    } else {
+	printf( "%-22s %-14s %10.1f %12.2f\n", kernel, type, best.ns / cells, best.allocs / cells );
+    }
+    fflush( stdout );
+}
+
+// Keeps the fastest of the repeated runs
+static void keepBest( benchRun &best, const benchRun &run )
+/*********************************************************/
+{
+    if( best.cells == 0 || run.ns * best.cells < best.ns * run.cells ) {
+	best = run;
+    }
+}
+
+// Column types of the mock, see mock/mock.h
+static const char *columnTypes[] = {
+    "tinyint", "int", "bigint", "double", "boolean", "decimal", "timestamp",
+    "varchar:32", "nvarchar:32", "varchar:1024", "varbinary:16"
+};
+
+#define FETCH_COLUMNS	4
+
+static void benchFetch( Isolate *isolate, dbcapi_connection *conn, const char *type )
+/***********************************************************************************/
+{
+    bool fetch = selected( "fetchResultSet", type );
+    // Binaries are converted to node::Buffer objects, which need a Node.js
+    // environment
+    bool convert = selected( "getResultSet", type ) && strncmp( type, "varbinary", 9 ) != 0;
+    benchRun best_fetch, best_convert;
+
+    if( !fetch && !convert ) {
+	return;
+    }
+
+    char sql[256];
+    snprintf( sql, sizeof( sql ), "SELECT * FROM BENCH /* mock rows=%lld cols=%s,%s,%s,%s */",
+	      (long long)options.rows, type, type, type, type );
+
+    for( int i = 0; i < options.repeat; i++ ) {
+	HandleScope scope( isolate );
+	dbcapi_stmt *stmt = api.dbcapi_prepare( conn, sql );
+	if( stmt == NULL || !api.dbcapi_execute( stmt ) ) {
+	    fprintf( stderr, "Could not execute %s\n", sql );
+	    exit( 1 );
+	}
+
+	int				rows_affected;
+	std::vector<char *>		col_names;
+	std::vector<char *>		string_vals;
+	std::vector<double *>		num_vals;
+	std::vector<int *>		int_vals;
+	std::vector<size_t *>		string_len;
+	std::vector<dbcapi_data_type>	col_types;
+	std::vector<dbcapi_native_type>	col_native_types;
+	benchRun			run;
+
+	run.start();
+	fetchResultSet( stmt, rows_affected, col_names, string_vals, num_vals, int_vals,
+			string_len, col_types, col_native_types );
+	run.stop( col_types.size() );
+	keepBest( best_fetch, run );
+
+	if( convert ) {
+	    Persistent<Value> result;
+	    benchRun convert_run;
+	    convert_run.start();
+	    getResultSet( result, rows_affected, col_names, string_vals, num_vals, int_vals,
+			  string_len, col_types, col_native_types );
+	    convert_run.stop( col_types.size() );
+	    keepBest( best_convert, convert_run );
+	    result.Reset();
+	}
+
+	clearVector( col_names );
+	clearVector( string_vals );
+	clearVector( num_vals );
+	clearVector( int_vals );
+	clearVector( string_len );
+	api.dbcapi_free_stmt( stmt );
+	isolate->LowMemoryNotification();
+    }
+
+    if( fetch ) {
+	report( "fetchResultSet", type, best_fetch );
+    }
+    if( convert ) {
+	report( "getResultSet", type, best_convert );
+    }
+}
+
+static Local<Value> sampleValue( Isolate *isolate, const char *type, int64_t row )
+/********************************************************************************/
+{
+    if( strcmp( type, "int" ) == 0 ) {
+	return Integer::New( isolate, (int)row );
+    } else if( strcmp( type, "double" ) == 0 ) {
+	return Number::New( isolate, row + 0.5 );
+    } else if( strcmp( type, "boolean" ) == 0 ) {
+	return Boolean::New( isolate, ( row & 1 ) != 0 );
+    } else if( strcmp( type, "null" ) == 0 ) {
+	return Null( isolate );
+    }
+    char text[1100];
+    size_t length = strcmp( type, "string:1024" ) == 0 ? 1024 : 32;
+    for( size_t i = 0; i < length; i++ ) {
+	text[i] = (char)( 'a' + ( row + i ) % 26 );
+    }
+    return String::NewFromUtf8( isolate, text, NewStringType::kNormal, (int)length ).ToLocalChecked();
+}
+
+static const char *paramTypes[] = {
+    "int", "double", "boolean", "null", "string:32", "string:1024"
+};
+
+static void benchBindParameter( Isolate *isolate, const char *type )
+/******************************************************************/
+{
+    if( !selected( "getBindParameter", type ) ) {
+	return;
+    }
+
+    HandleScope scope( isolate );
+    // A small set of values, so that creating them is not measured
+    std::vector<Local<Value>> values;
+    for( int64_t i = 0; i < 64; i++ ) {
+	values.push_back( sampleValue( isolate, type, i ) );
+    }
+
+    benchRun best;
+    for( int i = 0; i < options.repeat; i++ ) {
+	benchRun run;
+	run.start();
+	for( int64_t row = 0; row < options.rows; row++ ) {
+	    dbcapi_bind_data *param = getBindParameter( values[row & 63] );
+	    clearParameter( param, true );
+	}
+	run.stop( options.rows );
+	keepBest( best, run );
+    }
+    report( "getBindParameter", type, best );
+}
+
+static void benchBatch( Isolate *isolate, const char *type )
+/**********************************************************/
+{
+    bool convert = selected( "getBindParameters", type );
+    bool pack = selected( "packBatchParameters", type );
+
+    if( !convert && !pack ) {
+	return;
+    }
+
+    HandleScope scope( isolate );
+    // execBatch is called with rows of parameters
+    Local<Array> batch = Array::New( isolate );
+    for( int64_t row = 0; row < options.rows; row++ ) {
+	Local<Array> values = Array::New( isolate );
+	for( int col = 0; col < FETCH_COLUMNS; col++ ) {
+	    values->Set( col, sampleValue( isolate, type, row + col ) );
+	}
+	batch->Set( (uint32_t)row, values );
+    }
+
+    benchRun best_convert, best_pack;
+    for( int i = 0; i < options.repeat; i++ ) {
+	std::vector<dbcapi_bind_data*>	rows;
+	std::vector<dbcapi_bind_data*>	packed;
+	std::vector<size_t>		buffer_size;
+	benchRun			run, pack_run;
+
+	run.start();
+	getBindParameters( batch, FETCH_COLUMNS, rows, buffer_size );
+	run.stop( rows.size() );
+	keepBest( best_convert, run );
+
+	pack_run.start();
+	packBatchParameters( rows, FETCH_COLUMNS, (int)options.rows, buffer_size, packed );
+	pack_run.stop( rows.size() );
+	keepBest( best_pack, pack_run );
+
+	clearParameters( rows );
+	clearParameters( packed );
+    }
+
+    if( convert ) {
+	report( "getBindParameters", type, best_convert );
+    }
+    if( pack ) {
+	report( "packBatchParameters", type, best_pack );
+    }
+}
+
+// A value as returned by dbcapi_get_column
+struct sampleColumn
+{
+    const char		*name;
+    dbcapi_data_type	type;
+    char		buffer[32];
+    size_t		length;
+};
+
+enum convertKernel
+{
+    CONVERT_TO_STRING,
+    CONVERT_TO_DOUBLE,
+    CONVERT_TO_INT
+};
+
+static const char *convertKernelNames[] = {
+    "convertToString", "convertToDouble", "convertToInt"
+};
+
+static void benchConvert( convertKernel kernel, sampleColumn &col )
+/*****************************************************************/
+{
+    if( !selected( convertKernelNames[kernel], col.name ) ) {
+	return;
+    }
+
+    dbcapi_data_value value;
+    dbcapi_bool is_null = false;
+    memset( &value, 0, sizeof( value ) );
+    value.buffer = col.buffer;
+    value.buffer_size = sizeof( col.buffer );
+    value.length = &col.length;
+    value.is_null = &is_null;
+    value.type = col.type;
+
+    std::ostringstream out;
+    double number = 0;
+    int integer = 0;
+    bool ok = true;
+    benchRun best;
+
+    for( int i = 0; i < options.repeat; i++ ) {
+	benchRun run;
+	run.start();
+	for( int64_t row = 0; row < options.rows; row++ ) {
+	    switch( kernel ) {
+		case CONVERT_TO_STRING:
+		    out.str( std::string() );
+		    ok = convertToString( value, out, false );
+		    break;
+		case CONVERT_TO_DOUBLE:
+		    ok = convertToDouble( value, number, false );
+		    break;
+		case CONVERT_TO_INT:
+		    ok = convertToInt( value, integer, false );
+		    break;
+	    }
+	}
+	run.stop( options.rows );
+	keepBest( best, run );
+    }
+    // Conversions a type does not support are not reported
+    if( ok ) {
+	report( convertKernelNames[kernel], col.name, best );
+    }
+}
+
+static void benchConverts()
+/*************************/
+{
+    sampleColumn cols[4];
+    int32_t int_value = 123456;
+    double double_value = 12345.678;
+    int64_t bigint_value = 1234567890123LL;
+
+    cols[0].name = "int";
+    cols[0].type = A_VAL32;
+    memcpy( cols[0].buffer, &int_value, sizeof( int_value ) );
+    cols[0].length = sizeof( int_value );
+    cols[1].name = "bigint";
+    cols[1].type = A_VAL64;
+    memcpy( cols[1].buffer, &bigint_value, sizeof( bigint_value ) );
+    cols[1].length = sizeof( bigint_value );
+    cols[2].name = "double";
+    cols[2].type = A_DOUBLE;
+    memcpy( cols[2].buffer, &double_value, sizeof( double_value ) );
+    cols[2].length = sizeof( double_value );
+    cols[3].name = "varchar";
+    cols[3].type = A_STRING;
+    strcpy( cols[3].buffer, "98765.4321" );
+    cols[3].length = strlen( cols[3].buffer );
+
+    for( int k = CONVERT_TO_STRING; k <= CONVERT_TO_INT; k++ ) {
+	for( size_t i = 0; i < sizeof( cols ) / sizeof( cols[0] ); i++ ) {
+	    benchConvert( (convertKernel)k, cols[i] );
+	}
+    }
+}
+
+static void usage()
+/*****************/
+{
+    fprintf( stderr, "usage: hana-microbench [--rows n] [--repeat n] [--filter text] [--json]\n" );
+    exit( 2 );
+}
+
+int main( int argc, char *argv[] )
+/********************************/
+{
+    for( int i = 1; i < argc; i++ ) {
+	if( strcmp( argv[i], "--rows" ) == 0 && i + 1 < argc ) {
+	    options.rows = strtoll( argv[++i], NULL, 10 );
+	} else if( strcmp( argv[i], "--repeat" ) == 0 && i + 1 < argc ) {
+	    options.repeat = atoi( argv[++i] );
+	} else if( strcmp( argv[i], "--filter" ) == 0 && i + 1 < argc ) {
+	    options.filter = argv[++i];
+	} else if( strcmp( argv[i], "--json" ) == 0 ) {
+	    options.json = true;
+	} else {
+	    usage();
+	}
+    }
+    if( options.rows < 1 || options.repeat < 1 ) {
+	usage();
+    }
+
+    unsigned int max_api_ver;
+    char *env = getenv( "DBCAPI_API_DLL" );
+    if( env == NULL ) {
+	fprintf( stderr, "Set DBCAPI_API_DLL to the mock libdbcapiHDB.\n" );
+	return 1;
+    }
+    if( !dbcapi_initialize_interface( &api, env ) ||
+	!api.dbcapi_init( "microbench", _DBCAPI_VERSION, &max_api_ver ) ) {
+	fprintf( stderr, "Failed to load %s.\n", env );
+	return 1;
+    }
+    dbcapi_connection *conn = api.dbcapi_new_connection();
+    if( !api.dbcapi_connect( conn, "serverNode=mock:30015;uid=SYSTEM;pwd=manager" ) ) {
+	fprintf( stderr, "Failed to connect to the mock.\n" );
+	return 1;
+    }
+
+    Platform *platform = platform::CreateDefaultPlatform();
+    V8::InitializePlatform( platform );
+    V8::Initialize();
+    Isolate::CreateParams create_params;
+    create_params.array_buffer_allocator = ArrayBuffer::Allocator::NewDefaultAllocator();
+    Isolate *isolate = Isolate::New( create_params );
+
+    if( !options.json ) {
+	printf( "native allocs: operator new calls only; V8 heap objects are not counted\n" );
+	printf( "%-22s %-14s %10s %12s\n", "kernel", "type", "ns/cell", "native/cell" );
+    }
+    {
+	Isolate::Scope isolate_scope( isolate );
+	HandleScope scope( isolate );
+	Local<Context> context = Context::New( isolate );
+	Context::Scope context_scope( context );
+
+	for( size_t i = 0; i < sizeof( columnTypes ) / sizeof( columnTypes[0] ); i++ ) {
+	    benchFetch( isolate, conn, columnTypes[i] );
+	}
+	for( size_t i = 0; i < sizeof( paramTypes ) / sizeof( paramTypes[0] ); i++ ) {
+	    benchBindParameter( isolate, paramTypes[i] );
+	}
+	for( size_t i = 0; i < sizeof( paramTypes ) / sizeof( paramTypes[0] ); i++ ) {
+	    benchBatch( isolate, paramTypes[i] );
+	}
+	benchConverts();
+    }
+
+    isolate->Dispose();
+    V8::Dispose();
+    V8::ShutdownPlatform();
+    delete platform;
+    delete create_params.array_buffer_allocator;
+
+    api.dbcapi_disconnect( conn );
+    api.dbcapi_free_connection( conn );
+    api.dbcapi_fini();
+    return 0;
+}
@@ -0,0 +1,210 @@
+'use strict';
+
+// End to end benchmarks of the driver against the mock libdbcapiHDB.
+//
+//   node bench/suite.js [--rows N] [--iterations N] [--connections N] [case ...]
+//
+// Run node with --expose-gc for steadier memory figures.
+
+var common = require('./common');
+var hana = common.loadDriver();
+var Stream = require('../extension/Stream');
+
+var options = {
+    rows: 10000,
+    iterations: 20,
+    connections: 4,
+    cases: []
+};
+
+for (var a = 2; a < process.argv.length; a++) {
+    var arg = process.argv[a];
+    if (arg === '--rows' || arg === '--iterations' || arg === '--connections') {
+        options[arg.substring(2)] = parseInt(process.argv[++a], 10);
+    } else {
+        options.cases.push(arg);
+    }
+}
+
+// Settings of the mock for a query, see mock/mock.h
+function mockSql(sql, settings) {
+    return sql + ' /* mock ' + settings + ' */';
+}
+
+var narrowCols = 'int,varchar:32,double';
+var wideCols = 'int,bigint,double,decimal,timestamp,nvarchar:64,varbinary:16,varchar:256';
+
+function execSelect(conn, cols) {
+    var sql = mockSql('SELECT * FROM T', 'rows=' + options.rows + ' cols=' + cols);
+    return function (done) {
+        conn.exec(sql, function (err, rows) {
+            done(err, rows ? rows.length : 0);
+        });
+    };
+}
+
+var cases = [
+    {
+        name: 'exec select narrow',
+        run: function (conn) {
+            return execSelect(conn, narrowCols);
+        }
+    },
+    {
+        name: 'exec select wide',
+        run: function (conn) {
+            return execSelect(conn, wideCols);
+        }
+    },
+    {
+        name: 'exec insert',
+        iterations: 2000,
+        run: function (conn) {
+            var sql = mockSql('INSERT INTO T VALUES(?, ?, ?)', 'params=int,varchar:32,double');
+            var n = 0;
+            return function (done) {
+                n++;
+                conn.exec(sql, [n, 'name ' + n, n / 2], function (err, affected) {
+                    done(err, err ? 0 : 1);
+                });
+            };
+        }
+    },
+    {
+        name: 'execBatch 1000 rows',
+        run: function (conn) {
+            var stmt = conn.prepare(mockSql('INSERT INTO T VALUES(?, ?, ?)', 'params=int,varchar:32,double'));
+            var batch = [];
+            for (var i = 0; i < 1000; i++) {
+                batch.push([i, 'name ' + i, i / 2]);
+            }
+            return function (done) {
+                stmt.execBatch(batch, function (err, affected) {
+                    done(err, err ? 0 : batch.length);
+                });
+            };
+        }
+    },
+    {
+        name: 'ResultSet next/getValues',
+        run: function (conn) {
+            var stmt = conn.prepare(mockSql('SELECT * FROM T', 'rows=' + options.rows + ' cols=' + narrowCols));
+            return function (done) {
+                stmt.execQuery([], function (err, rs) {
+                    if (err) {
+                        return done(err);
+                    }
+                    var count = 0;
+                    while (rs.next()) {
+                        rs.getValues();
+                        count++;
+                    }
+                    rs.close();
+                    done(null, count);
+                });
+            };
+        }
+    },
+    {
+        name: 'LOB stream 1MB',
+        iterations: 5,
+        run: function (conn) {
+            var stmt = conn.prepare(mockSql('SELECT * FROM T', 'rows=10 cols=int,blob:1048576'));
+            return function (done) {
+                stmt.execQuery([], function (err, rs) {
+                    if (err) {
+                        return done(err);
+                    }
+                    var count = 0;
+                    (function nextRow() {
+                        if (!rs.next()) {
+                            rs.close();
+                            return done(null, count);
+                        }
+                        var stream = Stream.createLobStream(rs, 1, { readSize: 65536 });
+                        stream.on('data', function () {});
+                        stream.on('error', done);
+                        stream.on('end', function () {
+                            count++;
+                            nextRow();
+                        });
+                    })();
+                });
+            };
+        }
+    },
+    {
+        name: 'concurrent exec',
+        connections: true,
+        run: function (conns) {
+            var sql = mockSql('SELECT * FROM T', 'rows=' + Math.ceil(options.rows / 10) +
+                              ' cols=' + narrowCols + ' latency_us=200');
+            return function (done) {
+                var pending = conns.length * 10;
+                var rows = 0;
+                var failed = null;
+                conns.forEach(function (conn) {
+                    for (var i = 0; i < 10; i++) {
+                        conn.exec(sql, function (err, result) {
+                            failed = failed || err;
+                            rows += result ? result.length : 0;
+                            if (--pending === 0) {
+                                done(failed, rows);
+                            }
+                        });
+                    }
+                });
+            };
+        }
+    }
+];
+
+function connect(count, callback) {
+    var conns = [];
+    var pending = count;
+    var failed = null;
+    for (var i = 0; i < count; i++) {
+        var conn = hana.createConnection();
+        conns.push(conn);
+        conn.connect(common.connParams(), function (err) {
+            failed = failed || err;
+            if (--pending === 0) {
+                callback(failed, conns);
+            }
+        });
+    }
+}
+
+var selected = cases.filter(function (c) {
+    return options.cases.length === 0 || options.cases.some(function (name) {
+        return c.name.indexOf(name) >= 0;
+    });
+});
+
+common.printHeader();
+
+(function runCase(index) {
+    if (index >= selected.length) {
+        return;
+    }
+    var c = selected[index];
+    connect(c.connections ? options.connections : 1, function (err, conns) {
+        if (err) {
+            console.error(c.name + ': ' + err.message);
+            process.exit(1);
+        }
+        var fn = c.run(c.connections ? conns : conns[0]);
+        common.measure(c.name, c.iterations || options.iterations, fn, function (err, result) {
+            if (err) {
+                console.error(c.name + ': ' + err.message);
+                process.exitCode = 1;
+            } else {
+                common.printResult(result);
+            }
+            conns.forEach(function (conn) {
+                conn.disconnect();
+            });
+            runCase(index + 1);
+        });
+    });
+})(0);
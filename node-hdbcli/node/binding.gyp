@@ -1,17 +1,47 @@
 {
+  'variables': {
+    # Build the in-memory stand-in for libdbcapiHDB used by bench/
+    'hana_mock%': 0,
+    # Build bench/microbench.cpp; needs hana_mock and a shared build of
+    # Node.js that provides V8
+    'hana_microbench%': 0,
+    'node_shared_library%': '',
+    # Build in the static probes of src/h/probes.h; needs sys/sdt.h
+    'hana_usdt%': 0,
+
+    'hana_sources': [ "src/hana.cpp",
+		      "src/utils.cpp",
+		      "src/connection.cpp",
+		      "src/statement.cpp",
+		      "src/resultset.cpp",
+		      "src/stmt_cache.cpp",
+		      "src/worker_pool.cpp",
+		      "src/pool.cpp",
+		      "src/addon_context.cpp",
+		      "src/columnar.cpp",
+		      "src/op_stats.cpp",
+		      "src/slow_log.cpp",
+		      "src/mem_stats.cpp",
+		      "src/spill.cpp",
+		      "src/dbcapi_record.cpp",
+		      "src/probes.cpp",
+		      "src/DBCAPI_DLL.cpp", ],
+  },
+
   "targets": [
     {
       "target_name": "hana-client",
       "defines": [ '_DBCAPI_VERSION=2', 'DRIVER_NAME=hana' ],
-      "sources": [ "src/hana.cpp",
-		   "src/utils.cpp",
-		   "src/connection.cpp",
-		   "src/statement.cpp",
-		   "src/resultset.cpp",
-		   "src/DBCAPI_DLL.cpp", ],
+      "sources": [ "<@(hana_sources)" ],
 
       "include_dirs": [ "src/h", ],
 
+      'conditions': [
+	[ 'hana_usdt==1 and OS=="linux"', {
+	  "defines": [ 'HANA_USDT' ]
+	}]
+      ],
+
       'configurations': {
 	'Release': {
 	  'msvs_settings': {
@@ -22,5 +52,67 @@
 	}
       }
     }
+  ],
+
+  'conditions': [
+    [ 'hana_mock==1', {
+      "targets": [
+	{
+	  "target_name": "dbcapi-mock",
+	  "type": "shared_library",
+	  "product_name": "dbcapiHDB",
+	  "defines": [ '_DBCAPI_VERSION=2' ],
+	  "sources": [ "mock/config.cpp",
+		       "mock/dbcapi_mock.cpp", ],
+
+	  "include_dirs": [ "src/h", "mock", ],
+
+	  'cflags_cc': [ '-std=c++11' ],
+	  'xcode_settings': {
+	    'CLANG_CXX_LANGUAGE_STANDARD': 'c++11',
+	    'GCC_ENABLE_CPP_EXCEPTIONS': 'YES'
+	  },
+	  'configurations': {
+	    'Release': {
+	      'msvs_settings': {
+		'VCCLCompilerTool': {
+		  'ExceptionHandling': 1
+		}
+	      }
+	    }
+	  }
+	}
+      ]
+    }],
+    [ 'hana_mock==1 and hana_microbench==1', {
+      "targets": [
+	{
+	  "target_name": "hana-microbench",
+	  "type": "executable",
+	  "dependencies": [ "dbcapi-mock" ],
+	  "defines": [ '_DBCAPI_VERSION=2', 'DRIVER_NAME=hana' ],
+	  "sources": [ "bench/microbench.cpp",
+		       "<@(hana_sources)" ],
+
+	  "include_dirs": [ "src/h", ],
+	  "libraries": [ "<(node_shared_library)" ],
+
+	  'cflags_cc': [ '-std=c++11' ],
+	  'xcode_settings': {
+	    'CLANG_CXX_LANGUAGE_STANDARD': 'c++11',
+	    'GCC_ENABLE_CPP_EXCEPTIONS': 'YES'
+	  },
+	  'configurations': {
+	    'Release': {
+	      'msvs_settings': {
+		'VCCLCompilerTool': {
+		  'ExceptionHandling': 1
+		}
+	      }
+	    }
+	  }
+	}
+      ]
+    }]
   ]
 }
@@ -0,0 +1,77 @@
+'use strict';
+
+module.exports =
+{
+    // Returns the values of a column of a columnar result. Numeric columns
+    // are returned as typed arrays (NULL rows hold 0), boolean, string and
+    // binary columns as arrays with null for NULL rows.
+    getColumn: function (result, index) {
+        return getColumn(result.columns[index], result.rowCount);
+    },
+
+    // Converts a columnar result into an array of row objects, like the
+    // result of Connection.exec
+    toRows: function (result) {
+        var columns = result.columns;
+        var values = [];
+        var rows = new Array(result.rowCount);
+
+        for (var c = 0; c < columns.length; c++) {
+            values.push(getColumn(columns[c], result.rowCount));
+        }
+        for (var r = 0; r < result.rowCount; r++) {
+            var row = {};
+            for (var c = 0; c < columns.length; c++) {
+                row[columns[c].name] = values[c][r];
+            }
+            rows[r] = row;
+        }
+        return rows;
+    },
+
+    // Returns the ArrayBuffers of a columnar result, to be passed as the
+    // transfer list of postMessage
+    transferList: function (result) {
+        var list = [];
+        result.columns.forEach(function (column) {
+            list.push(column.values, column.nulls);
+            if (column.offsets) {
+                list.push(column.offsets);
+            }
+        });
+        return list;
+    }
+};
+
+function getColumn(column, rowCount) {
+    var nulls = new Uint8Array(column.nulls);
+    var values;
+
+    switch (column.format) {
+        case 'int32':
+            return new Int32Array(column.values, 0, rowCount);
+        case 'float64':
+            return new Float64Array(column.values, 0, rowCount);
+        case 'boolean':
+            var bytes = new Uint8Array(column.values);
+            values = new Array(rowCount);
+            for (var i = 0; i < rowCount; i++) {
+                values[i] = nulls[i] ? null : bytes[i] !== 0;
+            }
+            return values;
+        default:
+            var offsets = new Uint32Array(column.offsets);
+            var buffer = Buffer.from(column.values);
+            values = new Array(rowCount);
+            for (var i = 0; i < rowCount; i++) {
+                if (nulls[i]) {
+                    values[i] = null;
+                } else if (column.format === 'string') {
+                    values[i] = buffer.toString('utf8', offsets[i], offsets[i + 1]);
+                } else {
+                    values[i] = Buffer.from(buffer.slice(offsets[i], offsets[i + 1]));
+                }
+            }
+            return values;
+    }
+}
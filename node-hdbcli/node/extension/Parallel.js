@@ -0,0 +1,416 @@
+'use strict';
+
+module.exports =
+{
+    // Runs a statement once per parameter set (partition) on several pooled
+    // connections. Returns a readable stream of results in completion order,
+    // or calls callback( err, results ) with the results in partition order.
+    execPartitioned: function (pool, sql, partitions, options, callback) {
+        if (typeof options === 'function') {
+            callback = options;
+            options = undefined;
+        }
+        checkPartitions(partitions);
+        checkCount(options, 'concurrency');
+        var stream = new PartitionStream(pool, sql, partitions, options || {});
+
+        if (callback === undefined) {
+            return stream;
+        }
+        collect(stream, partitions.length, stream.merge, callback);
+    },
+
+    // Splits rows into chunks and runs execBatch for them on several pooled
+    // connections. Calls callback( err, rowsAffected ) with the total.
+    execBatchParallel: function (pool, sql, rows, options, callback) {
+        if (typeof options === 'function') {
+            callback = options;
+            options = undefined;
+        }
+        checkRows(rows);
+        checkCount(options, 'chunkRows');
+        checkCount(options, 'connections');
+        new ParallelBatch(pool, sql, rows, options || {}, callback).start();
+    }
+};
+
+var util = require('util');
+var Readable = require('stream').Readable;
+
+var DEFAULT_CONCURRENCY = 4;
+var DEFAULT_CHUNK_ROWS = 1000;
+
+// Partition stream
+//
+// Each lane borrows a connection, prepares the statement once and executes
+// it for one partition after another. A lane waits before starting its next
+// partition while the stream's buffer is full, so that the number of
+// results held in memory stays bounded when the consumer is slow.
+function PartitionStream(pool, sql, partitions, options) {
+    Readable.call(this, { objectMode: true, highWaterMark: options.highWaterMark });
+    this.pool = pool;
+    this.sql = sql;
+    this.partitions = partitions;
+    this.merge = options.merge === true;
+    this.concurrency = Math.max(1, Math.min(poolMax(pool, options.concurrency || DEFAULT_CONCURRENCY),
+                                            partitions.length));
+    this.next = 0;
+    this.lanes = 0;
+    this.paused = [];
+    this.failed = false;
+    this.stopped = false;
+    this.started = false;
+};
+
+util.inherits(PartitionStream, Readable);
+
+PartitionStream.prototype._read = function () {
+    if (!this.started) {
+        this.started = true;
+        if (this.partitions.length === 0) {
+            this.push(null);
+            return;
+        }
+        for (var i = 0; i < this.concurrency; i++) {
+            this._startLane();
+        }
+        return;
+    }
+    this._resumeLanes();
+};
+
+PartitionStream.prototype._resumeLanes = function () {
+    var paused = this.paused;
+    this.paused = [];
+    paused.forEach(function (resume) {
+        resume();
+    });
+};
+
+PartitionStream.prototype._startLane = function () {
+    var stream = this;
+    stream.lanes++;
+    stream.pool.acquire(function (err, conn) {
+        if (err) {
+            stream._endLane(err);
+            return;
+        }
+        if (stream.failed || stream.stopped || stream.next >= stream.partitions.length) {
+            stream._endLane(undefined, conn);
+            return;
+        }
+        conn.prepare(stream.sql, function (err, stmt) {
+            if (err) {
+                stream._endLane(err, conn);
+                return;
+            }
+            stream._runLane(conn, stmt);
+        });
+    });
+};
+
+PartitionStream.prototype._runLane = function (conn, stmt) {
+    var stream = this;
+    if (stream.failed || stream.stopped || stream.next >= stream.partitions.length) {
+        stmt.drop(function () {
+            stream._endLane(undefined, conn);
+        });
+        return;
+    }
+
+    var index = stream.next++;
+    stmt.exec(stream.partitions[index], function (err, result) {
+        if (err) {
+            err.partition = index;
+            stream._fail(err);
+            stream._runLane(conn, stmt);
+            return;
+        }
+        if (stream._pushResult(index, result)) {
+            stream._runLane(conn, stmt);
+        } else {
+            stream.paused.push(function () {
+                stream._runLane(conn, stmt);
+            });
+        }
+    });
+};
+
+PartitionStream.prototype._pushResult = function (index, result) {
+    if (this.failed || this.stopped) {
+        return true;
+    }
+    if (!this.merge) {
+        return this.push({ partition: index, result: result });
+    }
+    if (!Array.isArray(result)) {
+        return this.push(result);
+    }
+    var more = true;
+    for (var i = 0; i < result.length; i++) {
+        more = this.push(result[i]);
+    }
+    return more;
+};
+
+PartitionStream.prototype._endLane = function (err, conn) {
+    if (conn !== undefined) {
+        this.pool.release(conn);
+    }
+    if (err) {
+        this._fail(err);
+    }
+    this.lanes--;
+    if (this.lanes === 0 && !this.failed && !this.stopped) {
+        this.push(null);
+    }
+};
+
+// Called when the consumer destroys the stream. Lanes that are running a
+// partition stop after it and paused ones stop right away; each drops its
+// statement and releases its connection.
+PartitionStream.prototype._destroy = function (err, callback) {
+    this.stopped = true;
+    this._resumeLanes();
+    callback(err);
+};
+
+PartitionStream.prototype._fail = function (err) {
+    if (this.failed || this.stopped) {
+        return;
+    }
+    // The other lanes stop after their current partition
+    this.failed = true;
+    this._resumeLanes();
+    this.emit('error', err);
+};
+
+// Parallel batch
+//
+// Each lane borrows a connection with autocommit turned off, prepares the
+// statement once and runs execBatch for one chunk after another. Without
+// the transactional option every chunk is committed when it is done. With
+// it, the lanes wait for each other and commit together once all chunks
+// have succeeded, or roll back if any failed. The commits of the different
+// connections are not atomic: if one of them fails, the others may already
+// be committed.
+function ParallelBatch(pool, sql, rows, options, callback) {
+    var chunkRows = options.chunkRows || DEFAULT_CHUNK_ROWS;
+
+    this.pool = pool;
+    this.sql = sql;
+    this.chunks = [];
+    for (var i = 0; i < rows.length; i += chunkRows) {
+        this.chunks.push(rows.slice(i, i + chunkRows));
+    }
+    this.transactional = options.transactional === true;
+    this.concurrency = Math.max(1, Math.min(poolMax(pool, options.connections || DEFAULT_CONCURRENCY),
+                                            this.chunks.length));
+    this.callback = callback || function (err) {
+        if (err) {
+            throw err;
+        }
+    };
+    this.next = 0;
+    this.lanes = 0;
+    this.finished = [];
+    this.rowsAffected = 0;
+    this.error = undefined;
+};
+
+ParallelBatch.prototype.start = function () {
+    if (this.chunks.length === 0) {
+        this.callback(undefined, 0);
+        return;
+    }
+    this.lanes = this.concurrency;
+    for (var i = 0; i < this.concurrency; i++) {
+        this._startLane();
+    }
+};
+
+ParallelBatch.prototype._startLane = function () {
+    var batch = this;
+    batch.pool.acquire(function (err, conn) {
+        if (err) {
+            batch._endLane(err);
+            return;
+        }
+        var lane = { conn: conn, stmt: undefined, pending: 0 };
+        try {
+            conn.setAutoCommit(false);
+        } catch (ex) {
+            batch._endLane(ex, lane);
+            return;
+        }
+        conn.prepare(batch.sql, function (err, stmt) {
+            if (err) {
+                batch._endLane(err, lane);
+                return;
+            }
+            lane.stmt = stmt;
+            batch._runLane(lane);
+        });
+    });
+};
+
+ParallelBatch.prototype._runLane = function (lane) {
+    var batch = this;
+    if (batch.error !== undefined || batch.next >= batch.chunks.length) {
+        batch._endLane(undefined, lane);
+        return;
+    }
+
+    var index = batch.next++;
+    lane.stmt.execBatch(batch.chunks[index], function (err, rowsAffected) {
+        if (err) {
+            err.chunk = index;
+            batch._endLane(err, lane);
+            return;
+        }
+        lane.pending += rowsAffected;
+        if (batch.transactional) {
+            batch._runLane(lane);
+            return;
+        }
+        lane.conn.commit(function (err) {
+            if (err) {
+                err.chunk = index;
+                batch._endLane(err, lane);
+                return;
+            }
+            batch.rowsAffected += lane.pending;
+            lane.pending = 0;
+            batch._runLane(lane);
+        });
+    });
+};
+
+ParallelBatch.prototype._endLane = function (err, lane) {
+    if (err && this.error === undefined) {
+        this.error = err;
+    }
+    if (lane !== undefined) {
+        this.finished.push(lane);
+    }
+    this.lanes--;
+    if (this.lanes === 0) {
+        this._finish();
+    }
+};
+
+ParallelBatch.prototype._finish = function () {
+    var batch = this;
+    var lanes = batch.finished;
+    var remaining = lanes.length;
+    var commit = batch.transactional && batch.error === undefined;
+
+    function done(err) {
+        if (err && batch.error === undefined) {
+            batch.error = err;
+        }
+        if (--remaining > 0) {
+            return;
+        }
+        if (batch.error !== undefined) {
+            // Rows of committed chunks stay in the database
+            batch.error.rowsAffected = batch.rowsAffected;
+            batch.callback(batch.error);
+        } else {
+            batch.callback(undefined, batch.rowsAffected);
+        }
+    }
+
+    function release(lane, err) {
+        var finish = function () {
+            // Uncommitted changes are rolled back on release
+            batch.pool.release(lane.conn, function () {
+                done(err);
+            });
+        };
+        if (lane.stmt !== undefined) {
+            lane.stmt.drop(finish);
+        } else {
+            finish();
+        }
+    }
+
+    if (remaining === 0) {
+        remaining = 1;
+        done();
+        return;
+    }
+
+    lanes.forEach(function (lane) {
+        if (!commit) {
+            release(lane);
+            return;
+        }
+        lane.conn.commit(function (err) {
+            if (!err) {
+                batch.rowsAffected += lane.pending;
+            }
+            release(lane, err);
+        });
+    });
+};
+
+function collect(stream, count, merge, callback) {
+    var results = merge ? [] : new Array(count);
+    var finished = false;
+
+    stream.on('data', function (data) {
+        if (merge) {
+            results.push(data);
+        } else {
+            results[data.partition] = data.result;
+        }
+    });
+    stream.on('error', function (err) {
+        if (!finished) {
+            finished = true;
+            callback(err);
+        }
+    });
+    stream.on('end', function () {
+        if (!finished) {
+            finished = true;
+            callback(undefined, results);
+        }
+    });
+}
+
+function checkPartitions(partitions) {
+    if (!Array.isArray(partitions)) {
+        throw new Error("Invalid parameter 'partitions'.");
+    }
+}
+
+function checkRows(rows) {
+    if (!Array.isArray(rows)) {
+        throw new Error("Invalid parameter 'rows'.");
+    }
+}
+
+// Options that count something must be positive integers when given
+function checkCount(options, name) {
+    if (options === undefined || options === null || options[name] === undefined) {
+        return;
+    }
+    var value = options[name];
+    if (typeof value !== 'number' || isNaN(value)) {
+        throw new TypeError("Invalid option '" + name + "': expected a positive integer.");
+    }
+    if (value < 1 || Math.floor(value) !== value || !isFinite(value)) {
+        throw new RangeError("Invalid option '" + name + "': expected a positive integer.");
+    }
+}
+
+// More lanes than the pool has connections would only wait for each other
+function poolMax(pool, count) {
+    var stats = typeof pool.getStats === 'function' ? pool.getStats() : undefined;
+    if (stats !== undefined && stats.max > 0) {
+        return Math.min(count, stats.max);
+    }
+    return count;
+}
@@ -121,5 +121,19 @@ if (db === null) {
 
 if (db !== null) {
     debug('Success.');
+    addPoolMethods(db.Pool.prototype);
 }
 module.exports = db;
+
+// Adds the Pool methods that are implemented in JavaScript to the prototype
+// of the native Pool class
+function addPoolMethods(proto) {
+    var parallel = require('../extension/Parallel');
+
+    proto.execPartitioned = function (sql, partitions, options, callback) {
+        return parallel.execPartitioned(this, sql, partitions, options, callback);
+    };
+    proto.execBatchParallel = function (sql, rows, options, callback) {
+        parallel.execBatchParallel(this, sql, rows, options, callback);
+    };
+}
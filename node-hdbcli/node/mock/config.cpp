@@ -0,0 +1,304 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <chrono>
+#include <thread>
+#include "mock.h"
+
+struct typeInfo
+{
+    const char		*name;
+    dbcapi_data_type	type;
+    dbcapi_native_type	native_type;
+    size_t		size;
+    bool		is_lob;
+};
+
+// size is the maximum size of fixed size types and the default length of
+// the others
+static const typeInfo types[] = {
+    { "tinyint",	A_UVAL8,	DT_TINYINT,	1,	false },
+    { "smallint",	A_VAL16,	DT_SMALLINT,	2,	false },
+    { "int",		A_VAL32,	DT_INT,		4,	false },
+    { "integer",	A_VAL32,	DT_INT,		4,	false },
+    { "bigint",		A_VAL64,	DT_BIGINT,	8,	false },
+    { "double",		A_DOUBLE,	DT_DOUBLE,	8,	false },
+    { "real",		A_DOUBLE,	DT_REAL,	8,	false },
+    { "boolean",	A_UVAL8,	DT_BOOLEAN,	1,	false },
+    { "decimal",	A_STRING,	DT_DECIMAL,	24,	false },
+    { "date",		A_STRING,	DT_DATE,	10,	false },
+    { "time",		A_STRING,	DT_TIME,	8,	false },
+    { "timestamp",	A_STRING,	DT_TIMESTAMP,	29,	false },
+    { "varchar",	A_STRING,	DT_VARCHAR1,	32,	false },
+    { "nvarchar",	A_STRING,	DT_NVARCHAR,	32,	false },
+    { "varbinary",	A_BINARY,	DT_VARBINARY,	16,	false },
+    { "clob",		A_STRING,	DT_CLOB,	65536,	true },
+    { "nclob",		A_STRING,	DT_NCLOB,	65536,	true },
+    { "blob",		A_BINARY,	DT_BLOB,	65536,	true },
+};
+
+static bool isFixedSize( dbcapi_data_type type )
+/**********************************************/
+{
+    return type != A_STRING && type != A_BINARY;
+}
+
+bool parseColumns( const std::string &text, const char *prefix, std::vector<mockColumn> &cols )
+/*******************************************************************************************/
+{
+    std::vector<mockColumn> parsed;
+    size_t start = 0;
+
+    while( start <= text.length() ) {
+	size_t end = text.find( ',', start );
+	if( end == std::string::npos ) {
+	    end = text.length();
+	}
+	std::string entry = text.substr( start, end - start );
+	start = end + 1;
+	if( entry.empty() ) {
+	    continue;
+	}
+
+	std::string name = entry;
+	size_t length = 0;
+	size_t colon = entry.find( ':' );
+	if( colon != std::string::npos ) {
+	    name = entry.substr( 0, colon );
+	    length = (size_t)strtoull( entry.c_str() + colon + 1, NULL, 10 );
+	}
+
+	const typeInfo *info = NULL;
+	for( size_t i = 0; i < sizeof( types ) / sizeof( types[0] ); i++ ) {
+	    if( name == types[i].name ) {
+		info = &types[i];
+		break;
+	    }
+	}
+	if( info == NULL ) {
+	    return false;
+	}
+
+	mockColumn col;
+	char col_name[32];
+	sprintf( col_name, "%s%u", prefix, (unsigned)parsed.size() + 1 );
+	col.name = col_name;
+	col.type = info->type;
+	col.native_type = info->native_type;
+	col.is_lob = info->is_lob;
+	if( isFixedSize( info->type ) ) {
+	    col.length = info->size;
+	    col.max_size = info->size;
+	} else {
+	    col.length = ( length > 0 ) ? length : info->size;
+	    // Up to three bytes per character in CESU-8
+	    col.max_size = ( info->native_type == DT_NVARCHAR || info->native_type == DT_NCLOB )
+			   ? col.length * 3 : col.length;
+	    if( col.length < 10 && info->native_type == DT_DECIMAL ) {
+		col.length = 10;
+		col.max_size = 10;
+	    }
+	}
+	parsed.push_back( col );
+    }
+
+    cols.swap( parsed );
+    return true;
+}
+
+mockConfig::mockConfig()
+/**********************/
+{
+    rows = 100;
+    parseColumns( "int,varchar:32,double", "C", cols );
+    nulls = 0;
+    params_set = false;
+    affected_rows = -1;
+    latency_us = 0;
+    fetch_latency_us = 0;
+    packet_rows = 1000;
+    connect_latency_us = 0;
+    error = 0;
+    warning = false;
+}
+
+void mockConfig::parse( const std::string &text )
+/***********************************************/
+{
+    size_t pos = 0;
+
+    while( pos < text.length() ) {
+	while( pos < text.length() && ( isspace( (unsigned char)text[pos] ) || text[pos] == ';' ) ) {
+	    pos++;
+	}
+	size_t end = pos;
+	while( end < text.length() && !isspace( (unsigned char)text[end] ) && text[end] != ';' ) {
+	    end++;
+	}
+	std::string pair = text.substr( pos, end - pos );
+	pos = end;
+
+	size_t eq = pair.find( '=' );
+	if( eq == std::string::npos ) {
+	    continue;
+	}
+	std::string key = pair.substr( 0, eq );
+	std::string value = pair.substr( eq + 1 );
+	for( size_t i = 0; i < key.length(); i++ ) {
+	    key[i] = (char)tolower( (unsigned char)key[i] );
+	}
+
+	if( key == "rows" ) {
+	    rows = strtoll( value.c_str(), NULL, 10 );
+	} else if( key == "cols" ) {
+	    parseColumns( value, "C", cols );
+	} else if( key == "nulls" ) {
+	    nulls = atof( value.c_str() );
+	} else if( key == "params" ) {
+	    params_set = parseColumns( value, "P", params );
+	} else if( key == "affected_rows" ) {
+	    affected_rows = strtoll( value.c_str(), NULL, 10 );
+	} else if( key == "latency_us" ) {
+	    latency_us = (unsigned)strtoul( value.c_str(), NULL, 10 );
+	} else if( key == "fetch_latency_us" ) {
+	    fetch_latency_us = (unsigned)strtoul( value.c_str(), NULL, 10 );
+	} else if( key == "packet_rows" ) {
+	    packet_rows = (unsigned)strtoul( value.c_str(), NULL, 10 );
+	    if( packet_rows == 0 ) {
+		packet_rows = 1;
+	    }
+	} else if( key == "connect_latency_us" ) {
+	    connect_latency_us = (unsigned)strtoul( value.c_str(), NULL, 10 );
+	} else if( key == "error" ) {
+	    error = atoi( value.c_str() );
+	} else if( key == "warning" ) {
+	    warning = atoi( value.c_str() ) != 0;
+	}
+    }
+}
+
+void mockConfig::parseSql( const std::string &sql )
+/*************************************************/
+{
+    size_t start = sql.find( "/*" );
+
+    while( start != std::string::npos ) {
+	size_t end = sql.find( "*/", start + 2 );
+	if( end == std::string::npos ) {
+	    return;
+	}
+	size_t word = start + 2;
+	while( word < end && isspace( (unsigned char)sql[word] ) ) {
+	    word++;
+	}
+	if( sql.compare( word, 4, "mock" ) == 0 ) {
+	    parse( sql.substr( word + 4, end - word - 4 ) );
+	    return;
+	}
+	start = sql.find( "/*", end + 2 );
+    }
+}
+
+static uint64_t mix( uint64_t x )
+/*******************************/
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+bool generateValue( const mockColumn &col, int col_index, int64_t row, double nulls,
+		    char *buffer, size_t &length )
+/***********************************************************************************/
+{
+    uint64_t hash = mix( (uint64_t)row * 1000003ULL + (uint64_t)col_index );
+    // Formatted values go through text; buffer has no room for the terminator
+    char text[64];
+
+    if( nulls > 0 && (double)( hash % 1000000 ) < nulls * 1000000 ) {
+	return false;
+    }
+
+    length = col.length;
+    switch( col.type ) {
+	case A_UVAL8:
+	    *(unsigned char *)buffer = ( col.native_type == DT_BOOLEAN ) ? (unsigned char)( row & 1 )
+									 : (unsigned char)( row & 0x7f );
+	    break;
+	case A_VAL16:
+	    *(short *)buffer = (short)( row & 0x7fff );
+	    break;
+	case A_VAL32:
+	    *(int *)buffer = (int)( row & 0x7fffffff );
+	    break;
+	case A_VAL64:
+	    *(long long *)buffer = (long long)row * 1000 + col_index;
+	    break;
+	case A_DOUBLE:
+	    *(double *)buffer = (double)row + 0.25;
+	    break;
+	default:
+	    switch( col.native_type ) {
+		case DT_DECIMAL:
+		    length = (size_t)sprintf( text, "%lld.%02d", (long long)row, col_index % 100 );
+		    memcpy( buffer, text, length );
+		    break;
+		case DT_DATE:
+		    length = (size_t)sprintf( text, "2017-%02d-%02d", (int)( row % 12 ) + 1, (int)( row % 28 ) + 1 );
+		    memcpy( buffer, text, length );
+		    break;
+		case DT_TIME:
+		    length = (size_t)sprintf( text, "%02d:%02d:%02d", (int)( row % 24 ), (int)( row % 60 ), col_index % 60 );
+		    memcpy( buffer, text, length );
+		    break;
+		case DT_TIMESTAMP:
+		    length = (size_t)sprintf( text, "2017-%02d-%02d %02d:%02d:%02d.000000000",
+					      (int)( row % 12 ) + 1, (int)( row % 28 ) + 1,
+					      (int)( row % 24 ), (int)( row % 60 ), col_index % 60 );
+		    memcpy( buffer, text, length );
+		    break;
+		default:
+		    // The row number followed by a repeating pattern
+		    if( length > 0 ) {
+			char prefix[24];
+			size_t n = (size_t)sprintf( prefix, "%lld:", (long long)row );
+			if( n > length ) {
+			    n = length;
+			}
+			memcpy( buffer, prefix, n );
+			for( size_t i = n; i < length; i++ ) {
+			    buffer[i] = (char)( 'a' + ( i + col_index ) % 26 );
+			}
+		    }
+		    break;
+	    }
+	    break;
+    }
+    return true;
+}
+
+bool mockSleep( unsigned us, const std::atomic<bool> *cancelled )
+/***************************************************************/
+{
+    std::chrono::steady_clock::time_point until =
+	std::chrono::steady_clock::now() + std::chrono::microseconds( us );
+
+    while( us > 0 && std::chrono::steady_clock::now() < until ) {
+	if( cancelled != NULL && cancelled->load() ) {
+	    return false;
+	}
+	std::chrono::steady_clock::duration left = until - std::chrono::steady_clock::now();
+	if( left > std::chrono::milliseconds( 1 ) ) {
+	    left = std::chrono::milliseconds( 1 );
+	}
+	std::this_thread::sleep_for( left );
+    }
+    return cancelled == NULL || !cancelled->load();
+}
@@ -0,0 +1,930 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+//
+// A stand-in for libdbcapiHDB that answers every call from memory. It is
+// loaded through DBCAPI_API_DLL like the real client library and lets the
+// driver be measured end to end without a server; see mock.h for the
+// settings that shape the generated results.
+//
+// ***************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "mock.h"
+
+#define MOCK_VERSION		"2.00.000.00.0000000000 (mock)"
+#define ERR_CANCELLED		139
+#define ERR_INVALID_INDEX	-1
+#define ERR_NO_ROW		100
+
+struct dbcapi_interface_context
+{
+    std::string		app_name;
+};
+
+struct dbcapi_connection
+{
+    mockConfig				config;
+    bool				connected;
+    bool				autocommit;
+    int					error_code;
+    std::string				error_msg;
+    std::string				sql_state;
+    std::map<std::string, std::string>	clientinfo;
+    DBCAPI_CALLBACK_PARM		warning_callback;
+    void *				warning_data;
+    std::atomic<bool>			cancelled;
+};
+
+struct dbcapi_stmt
+{
+    dbcapi_connection *			conn;
+    std::string				sql;
+    mockConfig				config;
+    dbcapi_i32				function_code;
+
+    std::vector<mockColumn>		param_cols;
+    std::vector<std::string>		param_names;
+    std::vector<dbcapi_bind_data>	bound_params;
+    dbcapi_u32				batch_size;
+
+    bool				executed;
+    int64_t				affected_rows;
+    dbcapi_u32				rowset_size;
+    std::vector<dbcapi_data_value>	bound_cols;
+    std::vector<bool>			is_bound;
+    // First row of the current rowset; -1 before the first fetch
+    int64_t				row;
+    dbcapi_i32				fetched_rows;
+    int64_t				packet_end;
+
+    // Values of the current row for dbcapi_get_column
+    std::vector< std::vector<char> >	scratch;
+    std::vector<size_t>			scratch_length;
+    std::vector<dbcapi_bool>		scratch_null;
+    int64_t				scratch_row;
+};
+
+static void setError( dbcapi_connection *conn, int code, const char *msg, const char *state )
+/*****************************************************************************************/
+{
+    conn->error_code = code;
+    conn->error_msg = msg;
+    conn->sql_state = state;
+}
+
+static void clearError( dbcapi_connection *conn )
+/***********************************************/
+{
+    conn->error_code = 0;
+    conn->error_msg.clear();
+    conn->sql_state = "00000";
+}
+
+static bool startsWith( const std::string &sql, size_t pos, const char *keyword )
+/******************************************************************************/
+{
+    size_t len = strlen( keyword );
+    if( sql.length() - pos < len ) {
+	return false;
+    }
+    for( size_t i = 0; i < len; i++ ) {
+	if( toupper( (unsigned char)sql[pos + i] ) != keyword[i] ) {
+	    return false;
+	}
+    }
+    return pos + len == sql.length() || !isalnum( (unsigned char)sql[pos + len] );
+}
+
+// Function codes as reported by the server
+static dbcapi_i32 getFunctionCode( const std::string &sql )
+/*********************************************************/
+{
+    size_t pos = 0;
+
+    // Skip white space and comments before the first keyword
+    while( pos < sql.length() ) {
+	if( isspace( (unsigned char)sql[pos] ) || sql[pos] == '(' ) {
+	    pos++;
+	} else if( sql.compare( pos, 2, "/*" ) == 0 ) {
+	    size_t end = sql.find( "*/", pos + 2 );
+	    pos = ( end == std::string::npos ) ? sql.length() : end + 2;
+	} else if( sql.compare( pos, 2, "--" ) == 0 ) {
+	    size_t end = sql.find( '\n', pos );
+	    pos = ( end == std::string::npos ) ? sql.length() : end + 1;
+	} else {
+	    break;
+	}
+    }
+
+    if( startsWith( sql, pos, "SELECT" ) || startsWith( sql, pos, "WITH" ) ) {
+	return 5;
+    } else if( startsWith( sql, pos, "INSERT" ) || startsWith( sql, pos, "UPSERT" ) ) {
+	return 2;
+    } else if( startsWith( sql, pos, "UPDATE" ) ) {
+	return 3;
+    } else if( startsWith( sql, pos, "DELETE" ) ) {
+	return 4;
+    } else if( startsWith( sql, pos, "CALL" ) ) {
+	return 8;
+    } else if( startsWith( sql, pos, "COMMIT" ) ) {
+	return 11;
+    } else if( startsWith( sql, pos, "ROLLBACK" ) ) {
+	return 12;
+    }
+    return 1;
+}
+
+static size_t countParameters( const std::string &sql )
+/*****************************************************/
+{
+    size_t count = 0;
+    char quote = 0;
+
+    for( size_t i = 0; i < sql.length(); i++ ) {
+	char c = sql[i];
+	if( quote != 0 ) {
+	    if( c == quote ) {
+		quote = 0;
+	    }
+	} else if( c == '\'' || c == '"' ) {
+	    quote = c;
+	} else if( c == '?' ) {
+	    count++;
+	}
+    }
+    return count;
+}
+
+static bool hasResultSet( dbcapi_stmt *stmt )
+/*******************************************/
+{
+    return stmt->function_code == 5 && stmt->executed;
+}
+
+static bool checkColumn( dbcapi_stmt *stmt, dbcapi_u32 index )
+/************************************************************/
+{
+    if( !hasResultSet( stmt ) || index >= stmt->config.cols.size() ) {
+	setError( stmt->conn, ERR_INVALID_INDEX, "Invalid column index", "HY000" );
+	return false;
+    }
+    return true;
+}
+
+static bool checkRow( dbcapi_stmt *stmt )
+/***************************************/
+{
+    if( !hasResultSet( stmt ) || stmt->row < 0 || stmt->fetched_rows == 0 ) {
+	setError( stmt->conn, ERR_NO_ROW, "No current row", "24000" );
+	return false;
+    }
+    return true;
+}
+
+// Generates the current row into the scratch buffers
+static void loadRow( dbcapi_stmt *stmt )
+/**************************************/
+{
+    if( stmt->scratch_row == stmt->row ) {
+	return;
+    }
+    size_t num_cols = stmt->config.cols.size();
+    stmt->scratch.resize( num_cols );
+    stmt->scratch_length.resize( num_cols );
+    stmt->scratch_null.resize( num_cols );
+    for( size_t i = 0; i < num_cols; i++ ) {
+	const mockColumn &col = stmt->config.cols[i];
+	if( stmt->scratch[i].size() < col.max_size + 1 ) {
+	    stmt->scratch[i].resize( col.max_size + 1 );
+	}
+	size_t length = 0;
+	bool not_null = generateValue( col, (int)i, stmt->row, stmt->config.nulls,
+				       &stmt->scratch[i][0], length );
+	stmt->scratch_length[i] = not_null ? length : 0;
+	stmt->scratch_null[i] = not_null ? 0 : 1;
+    }
+    stmt->scratch_row = stmt->row;
+}
+
+// Positions the statement on the rowset starting at row
+static dbcapi_bool fetchRowset( dbcapi_stmt *stmt, int64_t row )
+/**************************************************************/
+{
+    if( !hasResultSet( stmt ) ) {
+	setError( stmt->conn, ERR_NO_ROW, "The statement has no result set", "24000" );
+	return 0;
+    }
+    clearError( stmt->conn );
+
+    if( row < 0 || row >= stmt->config.rows ) {
+	stmt->row = ( row < 0 ) ? -1 : stmt->config.rows;
+	stmt->fetched_rows = 0;
+	return 0;
+    }
+
+    // Every packet boundary crossed costs one round trip
+    if( row >= stmt->packet_end || row < stmt->packet_end - (int64_t)stmt->config.packet_rows ) {
+	if( !mockSleep( stmt->config.fetch_latency_us, &stmt->conn->cancelled ) ) {
+	    setError( stmt->conn, ERR_CANCELLED, "transaction rolled back by an internal error: Statement was cancelled", "HY008" );
+	    return 0;
+	}
+	stmt->packet_end = row - row % stmt->config.packet_rows + stmt->config.packet_rows;
+    }
+
+    int64_t count = stmt->config.rows - row;
+    if( count > (int64_t)stmt->rowset_size ) {
+	count = stmt->rowset_size;
+    }
+    stmt->row = row;
+    stmt->fetched_rows = (dbcapi_i32)count;
+
+    for( size_t i = 0; i < stmt->bound_cols.size(); i++ ) {
+	if( !stmt->is_bound[i] ) {
+	    continue;
+	}
+	const mockColumn &col = stmt->config.cols[i];
+	dbcapi_data_value &value = stmt->bound_cols[i];
+	for( int64_t r = 0; r < count; r++ ) {
+	    char *buffer = value.buffer + r * value.buffer_size;
+	    size_t length = 0;
+	    bool not_null = value.buffer_size >= col.max_size &&
+			    generateValue( col, (int)i, row + r, stmt->config.nulls, buffer, length );
+	    if( value.length != NULL ) {
+		value.length[r] = not_null ? length : 0;
+	    }
+	    if( value.is_null != NULL ) {
+		value.is_null[r] = not_null ? 0 : 1;
+	    }
+	}
+    }
+    return 1;
+}
+
+extern "C" {
+
+DBCAPI_API dbcapi_bool dbcapi_init( const char *app_name, dbcapi_u32 api_version, dbcapi_u32 *version_available )
+/***************************************************************************************************************/
+{
+    (void)app_name;
+    if( version_available != NULL ) {
+	*version_available = 2;
+    }
+    return api_version <= 2;
+}
+
+DBCAPI_API dbcapi_interface_context *dbcapi_init_ex( const char *app_name, dbcapi_u32 api_version, dbcapi_u32 *version_available )
+/********************************************************************************************************************************/
+{
+    if( !dbcapi_init( app_name, api_version, version_available ) ) {
+	return NULL;
+    }
+    dbcapi_interface_context *context = new dbcapi_interface_context();
+    context->app_name = ( app_name != NULL ) ? app_name : "";
+    return context;
+}
+
+DBCAPI_API void dbcapi_fini()
+/***************************/
+{
+}
+
+DBCAPI_API void dbcapi_fini_ex( dbcapi_interface_context *context )
+/*****************************************************************/
+{
+    delete context;
+}
+
+DBCAPI_API dbcapi_connection *dbcapi_new_connection( void )
+/*********************************************************/
+{
+    dbcapi_connection *conn = new dbcapi_connection();
+    const char *env = getenv( "DBCAPI_MOCK" );
+    if( env != NULL ) {
+	conn->config.parse( env );
+    }
+    conn->connected = false;
+    conn->autocommit = true;
+    conn->warning_callback = NULL;
+    conn->warning_data = NULL;
+    conn->cancelled = false;
+    clearError( conn );
+    return conn;
+}
+
+DBCAPI_API dbcapi_connection *dbcapi_new_connection_ex( dbcapi_interface_context *context )
+/*****************************************************************************************/
+{
+    (void)context;
+    return dbcapi_new_connection();
+}
+
+DBCAPI_API void dbcapi_free_connection( dbcapi_connection *conn )
+/***************************************************************/
+{
+    delete conn;
+}
+
+DBCAPI_API dbcapi_connection *dbcapi_make_connection( void *arg )
+/***************************************************************/
+{
+    (void)arg;
+    return dbcapi_new_connection();
+}
+
+DBCAPI_API dbcapi_connection *dbcapi_make_connection_ex( dbcapi_interface_context *context, void *arg )
+/*****************************************************************************************************/
+{
+    (void)context;
+    return dbcapi_make_connection( arg );
+}
+
+DBCAPI_API dbcapi_bool dbcapi_connect( dbcapi_connection *conn, const char *str )
+/*******************************************************************************/
+{
+    if( str != NULL ) {
+	conn->config.parse( str );
+    }
+    conn->cancelled = false;
+    mockSleep( conn->config.connect_latency_us, NULL );
+    conn->connected = true;
+    clearError( conn );
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_disconnect( dbcapi_connection *conn )
+/*****************************************************************/
+{
+    conn->connected = false;
+    clearError( conn );
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_set_clientinfo( dbcapi_connection *conn, const char *property, const char *value )
+/**************************************************************************************************************/
+{
+    if( property == NULL ) {
+	return 0;
+    }
+    if( value == NULL ) {
+	conn->clientinfo.erase( property );
+    } else {
+	conn->clientinfo[property] = value;
+    }
+    return 1;
+}
+
+DBCAPI_API const char *dbcapi_get_clientinfo( dbcapi_connection *conn, const char *property )
+/*******************************************************************************************/
+{
+    if( property == NULL ) {
+	return NULL;
+    }
+    std::map<std::string, std::string>::const_iterator it = conn->clientinfo.find( property );
+    return ( it == conn->clientinfo.end() ) ? NULL : it->second.c_str();
+}
+
+DBCAPI_API void dbcapi_cancel( dbcapi_connection *conn )
+/******************************************************/
+{
+    conn->cancelled = true;
+}
+
+DBCAPI_API dbcapi_stmt *dbcapi_prepare( dbcapi_connection *conn, const char *sql_str )
+/************************************************************************************/
+{
+    if( !conn->connected ) {
+	setError( conn, -10821, "Session not connected", "08003" );
+	return NULL;
+    }
+    clearError( conn );
+
+    dbcapi_stmt *stmt = new dbcapi_stmt();
+    stmt->conn = conn;
+    stmt->sql = ( sql_str != NULL ) ? sql_str : "";
+    stmt->config = conn->config;
+    stmt->config.parseSql( stmt->sql );
+    stmt->function_code = getFunctionCode( stmt->sql );
+
+    if( stmt->config.params_set ) {
+	stmt->param_cols = stmt->config.params;
+    } else {
+	size_t count = countParameters( stmt->sql );
+	for( size_t i = 0; i < count; i++ ) {
+	    std::vector<mockColumn> param;
+	    parseColumns( "varchar:256", "P", param );
+	    param[0].name = "P" + std::to_string( i + 1 );
+	    stmt->param_cols.push_back( param[0] );
+	}
+    }
+    for( size_t i = 0; i < stmt->param_cols.size(); i++ ) {
+	stmt->param_names.push_back( stmt->param_cols[i].name );
+    }
+    stmt->bound_params.resize( stmt->param_cols.size() );
+    memset( stmt->bound_params.data(), 0, stmt->bound_params.size() * sizeof( dbcapi_bind_data ) );
+
+    stmt->batch_size = 1;
+    stmt->executed = false;
+    stmt->affected_rows = -1;
+    stmt->rowset_size = 1;
+    stmt->row = -1;
+    stmt->fetched_rows = 0;
+    stmt->packet_end = 0;
+    stmt->scratch_row = -1;
+    return stmt;
+}
+
+DBCAPI_API dbcapi_i32 dbcapi_get_function_code( dbcapi_stmt *stmt )
+/*****************************************************************/
+{
+    return stmt->function_code;
+}
+
+DBCAPI_API void dbcapi_free_stmt( dbcapi_stmt *stmt )
+/****************************************************/
+{
+    delete stmt;
+}
+
+DBCAPI_API dbcapi_i32 dbcapi_num_params( dbcapi_stmt *stmt )
+/**********************************************************/
+{
+    return (dbcapi_i32)stmt->param_cols.size();
+}
+
+DBCAPI_API dbcapi_bool dbcapi_describe_bind_param( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_bind_data *param )
+/***************************************************************************************************************/
+{
+    if( index >= stmt->param_cols.size() ) {
+	setError( stmt->conn, ERR_INVALID_INDEX, "Invalid parameter index", "HY000" );
+	return 0;
+    }
+    const mockColumn &col = stmt->param_cols[index];
+    memset( param, 0, sizeof( dbcapi_bind_data ) );
+    param->direction = DD_INPUT;
+    param->name = const_cast<char *>( stmt->param_names[index].c_str() );
+    param->value.type = col.type;
+    param->value.buffer_size = col.max_size;
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_get_bind_param_info( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_bind_param_info *info )
+/********************************************************************************************************************/
+{
+    if( index >= stmt->param_cols.size() ) {
+	setError( stmt->conn, ERR_INVALID_INDEX, "Invalid parameter index", "HY000" );
+	return 0;
+    }
+    const mockColumn &col = stmt->param_cols[index];
+    memset( info, 0, sizeof( dbcapi_bind_param_info ) );
+    info->name = const_cast<char *>( stmt->param_names[index].c_str() );
+    info->direction = DD_INPUT;
+    info->input_value = stmt->bound_params[index].value;
+    info->native_type = col.native_type;
+    info->max_size = col.max_size;
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_bind_param( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_bind_data *param )
+/******************************************************************************************************/
+{
+    if( index >= stmt->bound_params.size() || param == NULL ) {
+	setError( stmt->conn, ERR_INVALID_INDEX, "Invalid parameter index", "HY000" );
+	return 0;
+    }
+    stmt->bound_params[index] = *param;
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_send_param_data( dbcapi_stmt *stmt, dbcapi_u32 index, char *buffer, size_t size )
+/*************************************************************************************************************/
+{
+    if( index >= stmt->bound_params.size() ) {
+	setError( stmt->conn, ERR_INVALID_INDEX, "Invalid parameter index", "HY000" );
+	return 0;
+    }
+    // Read the data like a client library copying it into a request packet
+    volatile unsigned char sum = 0;
+    for( size_t i = 0; i < size; i++ ) {
+	sum += (unsigned char)buffer[i];
+    }
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_reset_param_data( dbcapi_stmt *stmt, dbcapi_u32 index )
+/***********************************************************************************/
+{
+    return index < stmt->bound_params.size();
+}
+
+DBCAPI_API size_t dbcapi_error_length( dbcapi_connection *conn )
+/**************************************************************/
+{
+    return conn->error_msg.length() + 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_set_batch_size( dbcapi_stmt *stmt, dbcapi_u32 num_rows )
+/************************************************************************************/
+{
+    if( num_rows == 0 ) {
+	return 0;
+    }
+    stmt->batch_size = num_rows;
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_set_param_bind_type( dbcapi_stmt *stmt, size_t row_size )
+/**************************************************************************************/
+{
+    (void)stmt;
+    // Only column-wise binding is supported
+    return row_size == 0;
+}
+
+DBCAPI_API dbcapi_u32 dbcapi_get_batch_size( dbcapi_stmt *stmt )
+/**************************************************************/
+{
+    return stmt->batch_size;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_set_rowset_size( dbcapi_stmt *stmt, dbcapi_u32 num_rows )
+/*************************************************************************************/
+{
+    if( num_rows == 0 ) {
+	return 0;
+    }
+    stmt->rowset_size = num_rows;
+    return 1;
+}
+
+DBCAPI_API dbcapi_u32 dbcapi_get_rowset_size( dbcapi_stmt *stmt )
+/***************************************************************/
+{
+    return stmt->rowset_size;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_set_column_bind_type( dbcapi_stmt *stmt, dbcapi_u32 row_size )
+/******************************************************************************************/
+{
+    (void)stmt;
+    return row_size == 0;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_bind_column( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_data_value *value )
+/********************************************************************************************************/
+{
+    if( index >= stmt->config.cols.size() || value == NULL ) {
+	setError( stmt->conn, ERR_INVALID_INDEX, "Invalid column index", "HY000" );
+	return 0;
+    }
+    stmt->bound_cols.resize( stmt->config.cols.size() );
+    stmt->is_bound.resize( stmt->config.cols.size() );
+    stmt->bound_cols[index] = *value;
+    stmt->is_bound[index] = true;
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_clear_column_bindings( dbcapi_stmt *stmt )
+/**********************************************************************/
+{
+    stmt->bound_cols.clear();
+    stmt->is_bound.clear();
+    return 1;
+}
+
+DBCAPI_API dbcapi_i32 dbcapi_fetched_rows( dbcapi_stmt *stmt )
+/************************************************************/
+{
+    return stmt->fetched_rows;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_set_rowset_pos( dbcapi_stmt *stmt, dbcapi_u32 row_num )
+/***********************************************************************************/
+{
+    if( row_num >= (dbcapi_u32)stmt->fetched_rows ) {
+	return 0;
+    }
+    stmt->row += row_num;
+    stmt->fetched_rows -= (dbcapi_i32)row_num;
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_reset( dbcapi_stmt *stmt )
+/******************************************************/
+{
+    stmt->executed = false;
+    stmt->affected_rows = -1;
+    stmt->batch_size = 1;
+    stmt->row = -1;
+    stmt->fetched_rows = 0;
+    stmt->packet_end = 0;
+    stmt->scratch_row = -1;
+    clearError( stmt->conn );
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_execute( dbcapi_stmt *stmt )
+/********************************************************/
+{
+    dbcapi_connection *conn = stmt->conn;
+
+    stmt->executed = false;
+    stmt->row = -1;
+    stmt->fetched_rows = 0;
+    stmt->packet_end = 0;
+    stmt->scratch_row = -1;
+
+    // Read the bound values like a client library building a request
+    volatile unsigned char sum = 0;
+    for( size_t i = 0; i < stmt->bound_params.size(); i++ ) {
+	const dbcapi_data_value &value = stmt->bound_params[i].value;
+	if( value.buffer == NULL ) {
+	    continue;
+	}
+	for( dbcapi_u32 r = 0; r < stmt->batch_size; r++ ) {
+	    if( value.is_null != NULL && value.is_null[r] ) {
+		continue;
+	    }
+	    size_t length = ( value.length != NULL ) ? value.length[r] : value.buffer_size;
+	    if( length > value.buffer_size && value.buffer_size > 0 ) {
+		length = value.buffer_size;
+	    }
+	    const char *buffer = value.buffer + r * value.buffer_size;
+	    for( size_t b = 0; b < length; b++ ) {
+		sum += (unsigned char)buffer[b];
+	    }
+	}
+    }
+
+    if( !mockSleep( stmt->config.latency_us, &conn->cancelled ) ) {
+	conn->cancelled = false;
+	setError( conn, ERR_CANCELLED, "transaction rolled back by an internal error: Statement was cancelled", "HY008" );
+	return 0;
+    }
+    conn->cancelled = false;
+
+    if( stmt->config.error != 0 ) {
+	char msg[64];
+	sprintf( msg, "mock error %d", stmt->config.error );
+	setError( conn, stmt->config.error, msg, "HY000" );
+	return 0;
+    }
+    clearError( conn );
+
+    switch( stmt->function_code ) {
+	case 5:
+	    stmt->affected_rows = 0;
+	    break;
+	case 2:
+	case 3:
+	case 4:
+	    stmt->affected_rows = ( stmt->config.affected_rows >= 0 ) ? stmt->config.affected_rows
+								       : (int64_t)stmt->batch_size;
+	    break;
+	default:
+	    stmt->affected_rows = 0;
+	    break;
+    }
+    stmt->executed = true;
+
+    if( stmt->config.warning && conn->warning_callback != NULL ) {
+	conn->warning_callback( stmt, "mock warning", 1, "01000", conn->warning_data );
+    }
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_execute_immediate( dbcapi_connection *conn, const char *sql )
+/*****************************************************************************************/
+{
+    dbcapi_stmt *stmt = dbcapi_prepare( conn, sql );
+    if( stmt == NULL ) {
+	return 0;
+    }
+    dbcapi_bool ok = dbcapi_execute( stmt );
+    dbcapi_free_stmt( stmt );
+    return ok;
+}
+
+DBCAPI_API dbcapi_stmt *dbcapi_execute_direct( dbcapi_connection *conn, const char *sql_str )
+/*******************************************************************************************/
+{
+    dbcapi_stmt *stmt = dbcapi_prepare( conn, sql_str );
+    if( stmt == NULL ) {
+	return NULL;
+    }
+    if( !dbcapi_execute( stmt ) ) {
+	dbcapi_free_stmt( stmt );
+	return NULL;
+    }
+    return stmt;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_fetch_absolute( dbcapi_stmt *stmt, dbcapi_i32 row_num )
+/***********************************************************************************/
+{
+    // Row numbers are 1 based; negative numbers count from the end
+    int64_t row = ( row_num >= 0 ) ? (int64_t)row_num - 1 : stmt->config.rows + row_num;
+    if( row_num == 0 ) {
+	stmt->row = -1;
+	stmt->fetched_rows = 0;
+	return 0;
+    }
+    return fetchRowset( stmt, row );
+}
+
+DBCAPI_API dbcapi_bool dbcapi_fetch_next( dbcapi_stmt *stmt )
+/***********************************************************/
+{
+    int64_t row = ( stmt->row < 0 ) ? 0 : stmt->row + stmt->fetched_rows;
+    if( stmt->row >= 0 && stmt->fetched_rows == 0 ) {
+	return 0;
+    }
+    return fetchRowset( stmt, row );
+}
+
+DBCAPI_API dbcapi_bool dbcapi_get_next_result( dbcapi_stmt *stmt )
+/****************************************************************/
+{
+    (void)stmt;
+    return 0;
+}
+
+DBCAPI_API dbcapi_i32 dbcapi_affected_rows( dbcapi_stmt *stmt )
+/*************************************************************/
+{
+    return (dbcapi_i32)stmt->affected_rows;
+}
+
+DBCAPI_API dbcapi_i32 dbcapi_num_cols( dbcapi_stmt *stmt )
+/********************************************************/
+{
+    return ( stmt->function_code == 5 ) ? (dbcapi_i32)stmt->config.cols.size() : 0;
+}
+
+DBCAPI_API dbcapi_i32 dbcapi_num_rows( dbcapi_stmt *stmt )
+/********************************************************/
+{
+    return hasResultSet( stmt ) ? (dbcapi_i32)stmt->config.rows : -1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_get_column( dbcapi_stmt *stmt, dbcapi_u32 col_index, dbcapi_data_value *buffer )
+/************************************************************************************************************/
+{
+    if( !checkColumn( stmt, col_index ) || !checkRow( stmt ) ) {
+	return 0;
+    }
+    loadRow( stmt );
+    buffer->buffer = &stmt->scratch[col_index][0];
+    buffer->buffer_size = stmt->scratch[col_index].size();
+    buffer->length = &stmt->scratch_length[col_index];
+    buffer->is_null = &stmt->scratch_null[col_index];
+    buffer->type = stmt->config.cols[col_index].type;
+    buffer->is_address = 1;
+    return 1;
+}
+
+DBCAPI_API dbcapi_i32 dbcapi_get_data( dbcapi_stmt *stmt, dbcapi_u32 col_index, size_t offset, void *buffer, size_t size )
+/***********************************************************************************************************************/
+{
+    if( !checkColumn( stmt, col_index ) || !checkRow( stmt ) ) {
+	return -1;
+    }
+    loadRow( stmt );
+    size_t length = stmt->scratch_length[col_index];
+    if( stmt->scratch_null[col_index] || offset >= length ) {
+	return 0;
+    }
+    size_t count = length - offset;
+    if( count > size ) {
+	count = size;
+    }
+    memcpy( buffer, &stmt->scratch[col_index][offset], count );
+    return (dbcapi_i32)count;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_get_data_info( dbcapi_stmt *stmt, dbcapi_u32 col_index, dbcapi_data_info *buffer )
+/**************************************************************************************************************/
+{
+    if( !checkColumn( stmt, col_index ) || !checkRow( stmt ) ) {
+	return 0;
+    }
+    loadRow( stmt );
+    buffer->type = stmt->config.cols[col_index].type;
+    buffer->is_null = stmt->scratch_null[col_index];
+    buffer->data_size = stmt->scratch_length[col_index];
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_get_column_info( dbcapi_stmt *stmt, dbcapi_u32 col_index, dbcapi_column_info *buffer )
+/******************************************************************************************************************/
+{
+    if( stmt->function_code != 5 || col_index >= stmt->config.cols.size() ) {
+	setError( stmt->conn, ERR_INVALID_INDEX, "Invalid column index", "HY000" );
+	return 0;
+    }
+    const mockColumn &col = stmt->config.cols[col_index];
+    memset( buffer, 0, sizeof( dbcapi_column_info ) );
+    buffer->name = const_cast<char *>( col.name.c_str() );
+    buffer->type = col.type;
+    buffer->native_type = col.native_type;
+    buffer->precision = ( col.native_type == DT_DECIMAL ) ? 34 : 0;
+    buffer->max_size = col.max_size;
+    buffer->nullable = 1;
+    buffer->table_name = const_cast<char *>( "MOCK" );
+    buffer->owner_name = const_cast<char *>( "SYSTEM" );
+    buffer->is_bound = ( col_index < stmt->is_bound.size() && stmt->is_bound[col_index] ) ? 1 : 0;
+    if( buffer->is_bound ) {
+	buffer->binding = stmt->bound_cols[col_index];
+    }
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_commit( dbcapi_connection *conn )
+/*************************************************************/
+{
+    mockSleep( conn->config.latency_us, NULL );
+    clearError( conn );
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_rollback( dbcapi_connection *conn )
+/***************************************************************/
+{
+    mockSleep( conn->config.latency_us, NULL );
+    clearError( conn );
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_client_version( char *buffer, size_t len )
+/**********************************************************************/
+{
+    if( buffer == NULL || len == 0 ) {
+	return 0;
+    }
+    snprintf( buffer, len, "%s", MOCK_VERSION );
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_client_version_ex( dbcapi_interface_context *context, char *buffer, size_t len )
+/************************************************************************************************************/
+{
+    (void)context;
+    return dbcapi_client_version( buffer, len );
+}
+
+DBCAPI_API dbcapi_i32 dbcapi_error( dbcapi_connection *conn, char *buffer, size_t size )
+/**************************************************************************************/
+{
+    if( buffer != NULL && size > 0 ) {
+	snprintf( buffer, size, "%s", conn->error_msg.c_str() );
+    }
+    return conn->error_code;
+}
+
+DBCAPI_API size_t dbcapi_sqlstate( dbcapi_connection *conn, char *buffer, size_t size )
+/*************************************************************************************/
+{
+    if( buffer != NULL && size > 0 ) {
+	snprintf( buffer, size, "%s", conn->sql_state.c_str() );
+    }
+    return conn->sql_state.length() + 1;
+}
+
+DBCAPI_API void dbcapi_clear_error( dbcapi_connection *conn )
+/***********************************************************/
+{
+    clearError( conn );
+}
+
+DBCAPI_API dbcapi_bool dbcapi_set_autocommit( dbcapi_connection *conn, dbcapi_bool mode )
+/***************************************************************************************/
+{
+    conn->autocommit = mode != 0;
+    return 1;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_set_transaction_isolation( dbcapi_connection *conn, dbcapi_u32 isolation_level )
+/************************************************************************************************************/
+{
+    (void)conn;
+    return isolation_level <= 3;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_set_query_timeout( dbcapi_stmt *stmt, dbcapi_i32 timeout_value )
+/********************************************************************************************/
+{
+    (void)stmt;
+    return timeout_value >= 0;
+}
+
+DBCAPI_API dbcapi_bool dbcapi_register_warning_callback( dbcapi_connection *conn, DBCAPI_CALLBACK_PARM callback, void *user_data )
+/*******************************************************************************************************************************/
+{
+    conn->warning_callback = callback;
+    conn->warning_data = user_data;
+    return 1;
+}
+
+}
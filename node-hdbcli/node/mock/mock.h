@@ -0,0 +1,92 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <stdint.h>
+#include "DBCAPI.h"
+
+/** Type and size of a column or parameter of a mock statement.
+ *
+ * Parsed from entries of the form type[:length] of the cols and params
+ * settings, for example varchar:32 or blob:1048576. length is the length
+ * of the generated values; for fixed size types it is ignored.
+ */
+struct mockColumn
+{
+    std::string		name;
+    dbcapi_data_type	type;
+    dbcapi_native_type	native_type;
+    size_t		max_size;
+    size_t		length;
+    bool		is_lob;
+};
+
+/** Settings of the mock library.
+ *
+ * The settings are read from the DBCAPI_MOCK environment variable, then
+ * from the connection string and last from a comment in the SQL text whose
+ * first word is mock, each overriding the ones before. Pairs are of the
+ * form key=value and are separated by semicolons or white space, for
+ * example SELECT * FROM T followed by a comment holding
+ * "mock rows=5000 cols=int,nvarchar:64 nulls=0.1". The keys are:
+ *
+ * rows			number of rows of a query (default 100)
+ * cols			comma separated column types of a query (default
+ *			int,varchar:32,double)
+ * nulls		fraction of NULL values, between 0 and 1 (default 0)
+ * params		comma separated parameter types; by default every ?
+ *			is a varchar:256 input parameter
+ * affected_rows	rows affected by a DML statement (default: the batch
+ *			size)
+ * latency_us		delay of every execute in microseconds
+ * fetch_latency_us	delay of every fetch that starts a new packet
+ * packet_rows		rows per fetch packet (default 1000)
+ * connect_latency_us	delay of connect
+ * error		error code returned by every execute
+ * warning		if 1, every execute reports a warning
+ *
+ * Types are tinyint, smallint, int, bigint, double, real, decimal, boolean,
+ * date, time, timestamp, varchar, nvarchar, varbinary, clob, nclob and
+ * blob.
+ */
+struct mockConfig
+{
+    mockConfig();
+
+    /// Applies the key=value pairs of text. Unknown keys are ignored.
+    void parse( const std::string &text );
+    /// Applies the settings of a mock comment in sql, if any.
+    void parseSql( const std::string &sql );
+
+    int64_t			rows;
+    std::vector<mockColumn>	cols;
+    double			nulls;
+    std::vector<mockColumn>	params;
+    bool			params_set;
+    int64_t			affected_rows;
+    unsigned			latency_us;
+    unsigned			fetch_latency_us;
+    unsigned			packet_rows;
+    unsigned			connect_latency_us;
+    int				error;
+    bool			warning;
+};
+
+/// Parses a comma separated list of types. Returns false for unknown types.
+bool parseColumns( const std::string &text, const char *prefix, std::vector<mockColumn> &cols );
+
+/** Generates the value of a cell.
+ *
+ * Returns false for NULL. Otherwise the value is written to buffer, which
+ * must hold max_size bytes of the column, and its length is returned in
+ * length. The values only depend on the row and column, so every run of
+ * a benchmark sees the same data.
+ */
+bool generateValue( const mockColumn &col, int col_index, int64_t row, double nulls,
+		    char *buffer, size_t &length );
+
+/// Sleeps for us microseconds or until cancelled is set.
+bool mockSleep( unsigned us, const std::atomic<bool> *cancelled );
@@ -180,7 +180,9 @@ dbcapi_finalize_interface( DBCAPIInterface * api )
 /************************************************/
 {
     if( api->initialized ) {
-	unloadLibrary( api->dll_handle );
+	if( api->dll_handle != NULL ) {
+	    unloadLibrary( api->dll_handle );
+	}
 	memset( api, 0, sizeof(*api));
     }
 }
@@ -0,0 +1,167 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include "nodever_cover.h"
+#include "hana_utils.h"
+
+using namespace v8;
+
+static uv_once_t contexts_once = UV_ONCE_INIT;
+static uv_mutex_t contexts_mutex;
+static std::map<Isolate *, addonContext *> *contexts;
+static std::map<dbcapi_interface_context *, unsigned> *dbcapi_refs;
+
+static void initContexts()
+/************************/
+{
+    uv_mutex_init(&contexts_mutex);
+    contexts = new std::map<Isolate *, addonContext *>();
+    dbcapi_refs = new std::map<dbcapi_interface_context *, unsigned>();
+}
+
+// Instances are statics of other translation units, so the list must be
+// created on first use
+static std::vector<perIsolateFunction *> &perIsolateFunctions()
+/*************************************************************/
+{
+    static std::vector<perIsolateFunction *> instances;
+    return instances;
+}
+
+perIsolateFunction::perIsolateFunction()
+/**************************************/
+{
+    uv_mutex_init(&mutex);
+    perIsolateFunctions().push_back(this);
+}
+
+void perIsolateFunction::ClearAll(Isolate *isolate)
+/*************************************************/
+{
+    std::vector<perIsolateFunction *> &instances = perIsolateFunctions();
+    for (size_t i = 0; i < instances.size(); i++) {
+        instances[i]->Clear(isolate);
+    }
+}
+
+void perIsolateFunction::Reset(Isolate *isolate, Local<Function> fn)
+/******************************************************************/
+{
+    scoped_lock lock(mutex);
+    Persistent<Function> *&p = functions[isolate];
+    if (p == NULL) {
+        p = new Persistent<Function>();
+    }
+    p->Reset(isolate, fn);
+}
+
+Local<Function> perIsolateFunction::Get(Isolate *isolate)
+/*******************************************************/
+{
+    scoped_lock lock(mutex);
+    std::map<Isolate *, Persistent<Function> *>::iterator it = functions.find(isolate);
+    assert(it != functions.end());
+    return Local<Function>::New(isolate, *it->second);
+}
+
+void perIsolateFunction::Clear(Isolate *isolate)
+/**********************************************/
+{
+    scoped_lock lock(mutex);
+    std::map<Isolate *, Persistent<Function> *>::iterator it = functions.find(isolate);
+    if (it != functions.end()) {
+        it->second->Reset();
+        delete it->second;
+        functions.erase(it);
+    }
+}
+
+addonContext *createAddonContext(Isolate *isolate)
+/************************************************/
+{
+    uv_once(&contexts_once, initContexts);
+    scoped_lock lock(contexts_mutex);
+
+    addonContext *&ctx = (*contexts)[isolate];
+    if (ctx == NULL) {
+        ctx = new addonContext();
+        ctx->isolate = isolate;
+        ctx->loop = getEventLoop(isolate);
+        ctx->dbcapi_ctx = NULL;
+    }
+    return ctx;
+}
+
+addonContext *getAddonContext(Isolate *isolate)
+/*********************************************/
+{
+    uv_once(&contexts_once, initContexts);
+    scoped_lock lock(contexts_mutex);
+
+    std::map<Isolate *, addonContext *>::iterator it = contexts->find(isolate);
+    return it != contexts->end() ? it->second : NULL;
+}
+
+void destroyAddonContext(Isolate *isolate)
+/****************************************/
+{
+    uv_once(&contexts_once, initContexts);
+    scoped_lock lock(contexts_mutex);
+
+    std::map<Isolate *, addonContext *>::iterator it = contexts->find(isolate);
+    if (it != contexts->end()) {
+        delete it->second;
+        contexts->erase(it);
+    }
+}
+
+uv_loop_t *getEventLoop(Isolate *isolate)
+/***************************************/
+{
+#if NODE_MAJOR_VERSION >= 10
+    return node::GetCurrentEventLoop(isolate);
+#else
+    return uv_default_loop();
+#endif
+}
+
+void retainDbcapiContext(dbcapi_interface_context *ctx)
+/*****************************************************/
+{
+    if (ctx == NULL) {
+        return;
+    }
+    uv_once(&contexts_once, initContexts);
+    scoped_lock lock(contexts_mutex);
+    (*dbcapi_refs)[ctx]++;
+}
+
+void releaseDbcapiContext(dbcapi_interface_context *ctx)
+/******************************************************/
+{
+    if (ctx == NULL) {
+        return;
+    }
+    uv_once(&contexts_once, initContexts);
+    {
+        scoped_lock lock(contexts_mutex);
+        std::map<dbcapi_interface_context *, unsigned>::iterator it = dbcapi_refs->find(ctx);
+        assert(it != dbcapi_refs->end());
+        if (--it->second > 0) {
+            return;
+        }
+        dbcapi_refs->erase(it);
+    }
+    if (api.dbcapi_fini_ex != NULL) {
+        api.dbcapi_fini_ex(ctx);
+    }
+}
+
+dbcapi_connection *newConnection(dbcapi_interface_context *ctx)
+/*************************************************************/
+{
+    if (ctx != NULL && api.dbcapi_new_connection_ex != NULL) {
+        return api.dbcapi_new_connection_ex(ctx);
+    }
+    return api.dbcapi_new_connection();
+}
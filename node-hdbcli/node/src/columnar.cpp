@@ -0,0 +1,296 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include "nodever_cover.h"
+#include "hana_utils.h"
+
+using namespace v8;
+
+static const char *formatNames[] = { "int32", "float64", "boolean", "string", "binary" };
+
+static columnarResult::columnFormat getColumnFormat( const dbcapi_column_info &info )
+/**********************************************************************************/
+{
+    switch( info.type ) {
+	case A_BINARY:
+	    return columnarResult::CF_BINARY;
+	case A_STRING:
+	    return columnarResult::CF_STRING;
+	case A_VAL32:
+	case A_VAL16:
+	case A_UVAL16:
+	case A_VAL8:
+	case A_UVAL8:
+	    return ( info.native_type == DT_BOOLEAN ) ? columnarResult::CF_BOOLEAN
+						       : columnarResult::CF_INT32;
+	default:
+	    return columnarResult::CF_FLOAT64;
+    }
+}
+
+static bool getNumericValue( const dbcapi_data_value &value, double &number )
+/***************************************************************************/
+{
+    switch( value.type ) {
+	case A_VAL64:
+	    number = (double)*(long long *)value.buffer;
+	    return true;
+	case A_UVAL64:
+	    number = (double)*(unsigned long long *)value.buffer;
+	    return true;
+	case A_VAL32:
+	    number = *(int *)value.buffer;
+	    return true;
+	case A_UVAL32:
+	    number = *(unsigned int *)value.buffer;
+	    return true;
+	case A_VAL16:
+	    number = *(short *)value.buffer;
+	    return true;
+	case A_UVAL16:
+	    number = *(unsigned short *)value.buffer;
+	    return true;
+	case A_VAL8:
+	    number = *(char *)value.buffer;
+	    return true;
+	case A_UVAL8:
+	    number = *(unsigned char *)value.buffer;
+	    return true;
+	case A_DOUBLE:
+	    number = *(double *)value.buffer;
+	    return true;
+	case A_FLOAT:
+	    number = *(float *)value.buffer;
+	    return true;
+	default:
+	    return false;
+    }
+}
+
+template <class T>
+static void appendFixed( std::vector<char> &values, T val )
+/*********************************************************/
+{
+    const char *p = (const char *)&val;
+    values.insert( values.end(), p, p + sizeof( T ) );
+}
+
+columnarResult::columnarResult()
+/******************************/
+{
+    rows_affected = -1;
+    num_rows = 0;
+}
+
+bool columnarResult::appendValue( column &col, const dbcapi_data_value &value )
+/*****************************************************************************/
+{
+    bool is_null = *(value.is_null) != 0;
+    double number = 0;
+
+    col.nulls.push_back( is_null ? 1 : 0 );
+
+    switch( col.format ) {
+	case CF_STRING:
+	case CF_BINARY:
+	    if( !is_null ) {
+		if( value.type != A_STRING && value.type != A_BINARY ) {
+		    return false;
+		}
+		col.values.insert( col.values.end(), value.buffer, value.buffer + *(value.length) );
+		if( col.values.size() > UINT32_MAX ) {
+		    return false;
+		}
+	    }
+	    col.offsets.push_back( (uint32_t)col.values.size() );
+	    return true;
+
+	default:
+	    if( !is_null && !getNumericValue( value, number ) ) {
+		return false;
+	    }
+	    break;
+    }
+
+    switch( col.format ) {
+	case CF_INT32:
+	    appendFixed( col.values, (int32_t)number );
+	    break;
+	case CF_BOOLEAN:
+	    appendFixed( col.values, (unsigned char)( number != 0 ? 1 : 0 ) );
+	    break;
+	default:
+	    appendFixed( col.values, number );
+	    break;
+    }
+    return true;
+}
+
+int64_t columnarResult::bufferBytes() const
+/*****************************************/
+{
+    int64_t bytes = 0;
+    for( size_t i = 0; i < columns.size(); i++ ) {
+	bytes += columns[i].values.capacity() + columns[i].offsets.capacity() * sizeof( uint32_t ) +
+		 columns[i].nulls.capacity();
+    }
+    return bytes;
+}
+
+bool columnarResult::fetch( dbcapi_stmt *stmt, resultBinding *binding, memAccount *mem )
+/**************************************************************************************/
+{
+    dbcapi_data_value	value;
+    int			num_cols = 0;
+    resultBinding	local_binding;
+
+    if( binding == NULL ) {
+	binding = &local_binding;
+    }
+
+    rows_affected = api.dbcapi_affected_rows( stmt );
+    num_cols = api.dbcapi_num_cols( stmt );
+
+    if( rows_affected > 0 && num_cols < 1 ) {
+	return true;
+    }
+
+    rows_affected = -1;
+    if( num_cols < 1 ) {
+	return true;
+    }
+
+    int rowset_size = DEFAULT_ROWSET_SIZE;
+
+    if( binding->num_cols < 0 ) {
+	columns.resize( num_cols );
+	for( int i = 0; i < num_cols; i++ ) {
+	    dbcapi_column_info info;
+	    api.dbcapi_get_column_info( stmt, i, &info );
+	    columns[i].name = info.name;
+	    columns[i].native_type = info.native_type;
+	    columns[i].format = getColumnFormat( info );
+	    if( columns[i].format == CF_STRING || columns[i].format == CF_BINARY ) {
+		columns[i].offsets.push_back( 0 );
+	    }
+
+	    if( info.native_type == DT_BLOB || info.native_type == DT_CLOB || info.native_type == DT_NCLOB ) {
+		binding->has_lob = true;
+	    }
+
+	    if( !binding->has_lob ) {
+		dbcapi_data_value *bind_col = new dbcapi_data_value();
+		bind_col->buffer_size = info.max_size;
+		bind_col->buffer = new char[info.max_size * rowset_size];
+		bind_col->length = new size_t[rowset_size];
+		bind_col->is_null = new dbcapi_bool[rowset_size];
+		bind_col->type = info.type;
+		binding->bind_cols.push_back( bind_col );
+	    }
+	}
+	binding->num_cols = num_cols;
+    }
+
+    bool has_lob = binding->has_lob;
+    dataValueCollection &bind_cols = binding->bind_cols;
+
+    if( !has_lob ) {
+	if( !api.dbcapi_set_rowset_size( stmt, rowset_size ) ) {
+	    return false;
+	}
+	for( int i = 0; i < num_cols; i++ ) {
+	    if( !api.dbcapi_bind_column( stmt, i, bind_cols[i] ) ) {
+		return false;
+	    }
+	}
+    }
+
+    // Buffers of earlier executes were charged when they were fetched
+    int64_t charged = bufferBytes();
+    while( api.dbcapi_fetch_next( stmt ) ) {
+	int fetched_rows = api.dbcapi_fetched_rows( stmt );
+
+	for( int row = 0; row < fetched_rows; row++ ) {
+	    for( int i = 0; i < num_cols; i++ ) {
+		if( has_lob ) {
+		    if( !api.dbcapi_get_column( stmt, i, &value ) ) {
+			return false;
+		    }
+		} else {
+		    value.buffer = bind_cols[i]->buffer + row * bind_cols[i]->buffer_size;
+		    value.buffer_size = bind_cols[i]->buffer_size;
+		    value.type = bind_cols[i]->type;
+		    value.length = bind_cols[i]->length + row;
+		    value.is_null = bind_cols[i]->is_null + row;
+		}
+
+		if( !appendValue( columns[i], value ) ) {
+		    return false;
+		}
+	    }
+	    num_rows++;
+	}
+
+	if( mem != NULL ) {
+	    int64_t bytes = bufferBytes();
+	    if( !mem->charge( MEM_COLUMNAR, bytes - charged ) ) {
+		return false;
+	    }
+	    charged = bytes;
+	}
+    }
+
+    return true;
+}
+
+static Local<ArrayBuffer> newArrayBuffer( Isolate *isolate, const void *data, size_t size )
+/****************************************************************************************/
+{
+    Local<ArrayBuffer> buffer = ArrayBuffer::New( isolate, size );
+    if( size > 0 ) {
+	memcpy( buffer->GetContents().Data(), data, size );
+    }
+    return buffer;
+}
+
+Local<Object> columnarResult::toObject( Isolate *isolate )
+/********************************************************/
+{
+    EscapableHandleScope scope( isolate );
+    Local<Object> result = Object::New( isolate );
+    Local<Array> cols = Array::New( isolate, (int)columns.size() );
+
+    result->Set( String::NewFromUtf8( isolate, "rowCount" ), Number::New( isolate, (double)num_rows ) );
+
+    for( size_t i = 0; i < columns.size(); i++ ) {
+	column &col = columns[i];
+	Local<Object> obj = Object::New( isolate );
+
+	obj->Set( String::NewFromUtf8( isolate, "name" ), String::NewFromUtf8( isolate, col.name.c_str() ) );
+	obj->Set( String::NewFromUtf8( isolate, "type" ),
+		  String::NewFromUtf8( isolate, getNativeTypeName( col.native_type ) ) );
+	obj->Set( String::NewFromUtf8( isolate, "format" ),
+		  String::NewFromUtf8( isolate, formatNames[col.format] ) );
+	obj->Set( String::NewFromUtf8( isolate, "values" ),
+		  newArrayBuffer( isolate, col.values.data(), col.values.size() ) );
+	obj->Set( String::NewFromUtf8( isolate, "nulls" ),
+		  newArrayBuffer( isolate, col.nulls.data(), col.nulls.size() ) );
+	if( col.format == CF_STRING || col.format == CF_BINARY ) {
+	    obj->Set( String::NewFromUtf8( isolate, "offsets" ),
+		      newArrayBuffer( isolate, col.offsets.data(), col.offsets.size() * sizeof( uint32_t ) ) );
+	}
+	cols->Set( (uint32_t)i, obj );
+
+	std::vector<char>().swap( col.values );
+	std::vector<uint32_t>().swap( col.offsets );
+	std::vector<unsigned char>().swap( col.nulls );
+    }
+
+    result->Set( String::NewFromUtf8( isolate, "columns" ), cols );
+    if( !groups.empty() ) {
+	result->Set( String::NewFromUtf8( isolate, "groups" ),
+		     newArrayBuffer( isolate, groups.data(), groups.size() * sizeof( uint32_t ) ) );
+	std::vector<uint32_t>().swap( groups );
+    }
+    return scope.Escape( result );
+}
@@ -23,40 +23,136 @@ void DBCAPI_CALLBACK warningCallback(dbcapi_stmt    *stmt,
         return;
     }
 
-    baton->obj = obj;
-    baton->err = true;
-    baton->error_code = error_code;
-    baton->error_msg = warning;
-    baton->sql_state = sql_state;
-    baton->callback_required = true;
+    warningRecord *rec = new warningRecord();
+    rec->error_code = error_code;
+    rec->error_msg = warning;
+    rec->sql_state = sql_state;
+
+    // Lock-free push; the loop thread takes the whole list at once
+    rec->next = baton->head.load();
+    while (!baton->head.compare_exchange_weak(rec->next, rec)) {
+    }
+    uv_async_send(&baton->async);
+}
 
-    uv_work_t *req = new uv_work_t();
-    req->data = baton;
+void Connection::warningCallbackAfter(uv_async_t *handle)
+/*********************************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope	scope(isolate);
+    warningCallbackBaton *baton = static_cast<warningCallbackBaton*>(handle->data);
+
+    // Reverse the list into the order the warnings were reported
+    warningRecord *rec = baton->head.exchange(NULL);
+    warningRecord *first = NULL;
+    while (rec != NULL) {
+        warningRecord *next = rec->next;
+        rec->next = first;
+        first = rec;
+        rec = next;
+    }
 
-    int status;
-    status = uv_queue_work(uv_default_loop(), req, Connection::warningCallbackWork,
-        (uv_after_work_cb)Connection::warningCallbackAfter);
-    assert(status == 0);
+    Local<Array> warnings = Array::New(isolate);
+    int count = 0;
+    while (first != NULL) {
+        Local<Object> warning = Object::New(isolate);
+        setErrorMsg(warning, first->error_code, first->error_msg, first->sql_state);
+        warnings->Set(count++, warning);
+        warningRecord *next = first->next;
+        delete first;
+        first = next;
+    }
+
+    if (count == 0 || baton->callback.IsEmpty()) {
+        return;
+    }
+
+    Local<Function> callback = Local<Function>::New(isolate, baton->callback);
+    Local<Value> argv[2] = { warnings->Get(0), warnings };
+    TryCatch try_catch;
+    MakeCallback(isolate, isolate->GetCurrentContext()->Global(), callback, 2, argv);
+    if (try_catch.HasCaught()) {
+        node::FatalException(isolate, try_catch);
+    }
 }
 
-void Connection::warningCallbackWork(uv_work_t *req)
-/**********************************************/
+void Connection::warningCallbackClosed(uv_handle_t *handle)
+/*********************************************/
 {
-    //warningCallbackBaton *baton = static_cast<warningCallbackBaton*>(req->data);
-    //scoped_lock lock(baton->obj->conn_mutex);
+    delete static_cast<warningCallbackBaton*>(handle->data);
 }
 
-void Connection::warningCallbackAfter(uv_work_t *req)
+void Connection::traceCallbackAfter(uv_async_t *handle)
 /*********************************************/
 {
     Isolate *isolate = Isolate::GetCurrent();
     HandleScope	scope(isolate);
-    warningCallbackBaton *baton = static_cast<warningCallbackBaton*>(req->data);
-    Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
+    traceCallbackBaton *baton = static_cast<traceCallbackBaton*>(handle->data);
+
+    // Reverse the list into the order the operations completed
+    traceRecord *rec = baton->head.exchange(NULL);
+    traceRecord *first = NULL;
+    while (rec != NULL) {
+        traceRecord *next = rec->next;
+        rec->next = first;
+        first = rec;
+        rec = next;
+    }
 
-    callBack(baton->error_code, &(baton->error_msg), &(baton->sql_state),
-             baton->callback, undef, baton->callback_required);
-    delete req;
+    static const char *phaseKeys[PHASE_COUNT] = {
+        "queueMs", "lockMs", "prepareMs", "bindMs", "executeMs", "fetchMs", "convertMs", "totalMs"
+    };
+    Local<String> keys[PHASE_COUNT];
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        keys[i] = String::NewFromUtf8(isolate, phaseKeys[i]);
+    }
+    Local<String> operationKey = String::NewFromUtf8(isolate, "operation");
+    Local<String> hashKey = String::NewFromUtf8(isolate, "sqlHash");
+    Local<String> functionCodeKey = String::NewFromUtf8(isolate, "functionCode");
+    Local<String> rowsKey = String::NewFromUtf8(isolate, "rows");
+    Local<String> bytesKey = String::NewFromUtf8(isolate, "bytes");
+    Local<String> bindCountKey = String::NewFromUtf8(isolate, "bindCount");
+    Local<String> errorCodeKey = String::NewFromUtf8(isolate, "errorCode");
+
+    Local<Array> events = Array::New(isolate);
+    int count = 0;
+    while (first != NULL) {
+        Local<Object> event = Object::New(isolate);
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)first->sql_hash);
+        event->Set(operationKey, String::NewFromUtf8(isolate, first->operation));
+        event->Set(hashKey, String::NewFromUtf8(isolate, hash));
+        event->Set(functionCodeKey, Integer::New(isolate, first->function_code));
+        event->Set(rowsKey, Number::New(isolate, first->rows));
+        event->Set(bytesKey, Number::New(isolate, first->bytes));
+        event->Set(bindCountKey, Integer::New(isolate, first->bind_count));
+        event->Set(errorCodeKey, Integer::New(isolate, first->error_code));
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            event->Set(keys[i], Number::New(isolate, first->phase_ns[i] / 1e6));
+        }
+        events->Set(count++, event);
+        traceRecord *next = first->next;
+        delete first;
+        first = next;
+    }
+
+    if (count == 0 || baton->callback.IsEmpty()) {
+        return;
+    }
+
+    Local<Function> callback = Local<Function>::New(isolate, baton->callback);
+    Local<Value> argv[1] = { events };
+    TryCatch try_catch;
+    MakeCallback(isolate, isolate->GetCurrentContext()->Global(), callback, 1, argv);
+    if (try_catch.HasCaught()) {
+        node::FatalException(isolate, try_catch);
+    }
+}
+
+void Connection::traceCallbackClosed(uv_handle_t *handle)
+/*********************************************/
+{
+    delete static_cast<traceCallbackBaton*>(handle->data);
 }
 
 Connection::Connection(const FunctionCallbackInfo<Value> &args)
@@ -65,10 +161,17 @@ Connection::Connection(const FunctionCallbackInfo<Value> &args)
     Isolate *isolate = args.GetIsolate();
     HandleScope scope(isolate);
     uv_mutex_init(&conn_mutex);
+    uv_mutex_init(&cancel_mutex);
     conn = NULL;
     autoCommit = true;
     warningBaton = NULL;
+    traceBaton = NULL;
+    slow_log = NULL;
     is_connected = false;
+    pool = NULL;
+    addonContext *ctx = getAddonContext(isolate);
+    dbcapi_ctx = (ctx != NULL) ? ctx->dbcapi_ctx : NULL;
+    retainDbcapiContext(dbcapi_ctx);
 
     if (args.Length() >= 1) {
         if (args[0]->IsString()) {
@@ -98,20 +201,50 @@ Connection::~Connection()
     scoped_lock lock(conn_mutex);
 
     _arg.Reset();
+    pool_obj.Reset();
 
     if (warningBaton != NULL) {
-        delete warningBaton;
+        // The baton is freed once the async handle is closed
+        warningBaton->obj = NULL;
+        warningBaton->callback.Reset();
+        uv_close((uv_handle_t *)&warningBaton->async, warningCallbackClosed);
+        warningBaton = NULL;
     }
 
+    if (traceBaton != NULL) {
+        traceBaton->obj = NULL;
+        traceBaton->callback.Reset();
+        uv_close((uv_handle_t *)&traceBaton->async, traceCallbackClosed);
+        traceBaton = NULL;
+    }
+
+    setSlowLog(NULL);
+    for (size_t i = 0; i < retired_logs.size(); i++) {
+        retired_logs[i]->release();
+    }
+    retired_logs.clear();
+
+    stmt_cache.clear();
+
     if (conn != NULL) {
-        api.dbcapi_disconnect(conn);
-        api.dbcapi_free_connection(conn);
-        conn = NULL;
+        // cancel() only needs the handle to be gone, not disconnected
+        dbcapi_connection *old_conn;
+        {
+            scoped_lock cancel_lock(cancel_mutex);
+            old_conn = conn;
+            conn = NULL;
+        }
+        api.dbcapi_disconnect(old_conn);
+        api.dbcapi_free_connection(old_conn);
         openConnections--;
+        if (pool != NULL) {
+            pool->connectionLost();
+        }
     }
+    releaseDbcapiContext(dbcapi_ctx);
 };
 
-Persistent<Function> Connection::constructor;
+perIsolateFunction Connection::constructor;
 
 void Connection::Init(Isolate *isolate)
 /***************************************/
@@ -125,6 +258,7 @@ void Connection::Init(Isolate *isolate)
     // Prototype
     NODE_SET_PROTOTYPE_METHOD(tpl, "exec", exec);
     NODE_SET_PROTOTYPE_METHOD(tpl, "execute", exec);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "pipeline", pipeline);
     NODE_SET_PROTOTYPE_METHOD(tpl, "prepare", prepare);
     NODE_SET_PROTOTYPE_METHOD(tpl, "connect", connect);
     NODE_SET_PROTOTYPE_METHOD(tpl, "disconnect", disconnect);
@@ -135,6 +269,17 @@ void Connection::Init(Isolate *isolate)
     NODE_SET_PROTOTYPE_METHOD(tpl, "getClientInfo", getClientInfo);
     NODE_SET_PROTOTYPE_METHOD(tpl, "setClientInfo", setClientInfo);
     NODE_SET_PROTOTYPE_METHOD(tpl, "setWarningCallback", setWarningCallback);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "setTraceCallback", setTraceCallback);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "cancel", cancel);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "setStatementCacheSize", setStatementCacheSize);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "getStatementCacheStats", getStatementCacheStats);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "getQueueStats", getQueueStats);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "getStats", getStats);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "setMemoryLimit", setMemoryLimit);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "getMemoryStats", getMemoryStats);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "setSlowQueryLog", setSlowQueryLog);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "getSlowQueries", getSlowQueries);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "flushSlowQueries", flushSlowQueries);
 
     constructor.Reset(isolate, tpl->GetFunction());
 }
@@ -153,7 +298,7 @@ void Connection::New(const FunctionCallbackInfo<Value> &args)
     else {
         const int argc = 1;
         Local<Value> argv[argc] = {args[0]};
-        Local<Function> cons = Local<Function>::New(isolate, constructor);
+        Local<Function> cons = constructor.Get(isolate);
         args.GetReturnValue().Set(cons->NewInstance(argc, argv));
     }
 }
@@ -165,11 +310,31 @@ void Connection::NewInstance(const FunctionCallbackInfo<Value> &args)
     HandleScope scope(isolate);
     const unsigned argc = 1;
     Handle<Value> argv[argc] = {args[0]};
-    Local<Function> cons = Local<Function>::New(isolate, constructor);
+    Local<Function> cons = constructor.Get(isolate);
     Local<Object> instance = cons->NewInstance(argc, argv);
     args.GetReturnValue().Set(instance);
 }
 
+void Connection::CreatePooledInstance(Isolate *isolate,
+                                      dbcapi_connection *conn,
+                                      Pool *pool,
+                                      Local<Object> poolObj,
+                                      Persistent<Object> &obj)
+/*********************************************************************/
+{
+    HandleScope scope(isolate);
+    Local<Function> cons = constructor.Get(isolate);
+    Local<Object> instance = cons->NewInstance(0, NULL);
+    Connection *db = ObjectWrap::Unwrap<Connection>(instance);
+
+    db->conn = conn;
+    db->is_connected = true;
+    db->pool = pool;
+    db->pool_obj.Reset(isolate, poolObj);
+    api.dbcapi_register_warning_callback(conn, warningCallback, db);
+    obj.Reset(isolate, instance);
+}
+
 NODE_API_FUNC( Connection::exec )
 /*******************************/
 {
@@ -177,7 +342,10 @@ NODE_API_FUNC( Connection::exec )
     HandleScope scope( isolate );
     Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
 
-    int  num_args = args.Length();
+    int  options_arg = findOptionsArg( args, 1 );
+    int  num_args = args.Length() - ( options_arg >= 0 ? 1 : 0 );
+    int  arg_pos[3] = { 0, 1, 2 };
+    int  timeout = -1;
     int  cbfunc_arg = -1;
     int  invalidArg = -1;
     bool bind_required = false;
@@ -185,21 +353,26 @@ NODE_API_FUNC( Connection::exec )
 
     args.GetReturnValue().SetUndefined();
 
+    // Arguments after the options object are shifted by one
+    for ( int i = options_arg; options_arg >= 0 && i < 3; i++ ) {
+        arg_pos[i]++;
+    }
+
     if ( num_args == 0 || !args[0]->IsString() ) {
         invalidArg = 0;
     } else if (num_args == 2) {
-        if ( args[1]->IsArray() ) {
+        if ( args[arg_pos[1]]->IsArray() ) {
             bind_required = true;
-        } else if ( args[1]->IsFunction() ) {
-            cbfunc_arg = 1;
-        } else if ( !args[1]->IsUndefined() && !args[1]->IsNull() ) {
+        } else if ( args[arg_pos[1]]->IsFunction() ) {
+            cbfunc_arg = arg_pos[1];
+        } else if ( !args[arg_pos[1]]->IsUndefined() && !args[arg_pos[1]]->IsNull() ) {
             invalidArg = 1;
         }
     } else if (num_args >= 3) {
-        if ( args[1]->IsArray() || args[1]->IsNull() || args[1]->IsUndefined() ) {
-            bind_required = args[1]->IsArray();
-            if ( args[2]->IsFunction() || args[2]->IsUndefined() || args[2]->IsNull()) {
-                cbfunc_arg = ( args[2]->IsFunction() ) ? 2 : -1;
+        if ( args[arg_pos[1]]->IsArray() || args[arg_pos[1]]->IsNull() || args[arg_pos[1]]->IsUndefined() ) {
+            bind_required = args[arg_pos[1]]->IsArray();
+            if ( args[arg_pos[2]]->IsFunction() || args[arg_pos[2]]->IsUndefined() || args[arg_pos[2]]->IsNull()) {
+                cbfunc_arg = ( args[arg_pos[2]]->IsFunction() ) ? arg_pos[2] : -1;
             } else {
                 invalidArg = 2;
             }
@@ -209,9 +382,13 @@ NODE_API_FUNC( Connection::exec )
     }
 
     if ( invalidArg >= 0 ) {
-        throwErrorIP(invalidArg, "exec[ute](sql[, params][, callback])",
+        throwErrorIP(arg_pos[invalidArg], "exec[ute](sql[, params][, options][, callback])",
                      getJSTypeName(expectedTypes[invalidArg]).c_str(),
-                     getJSTypeName(getJSType(args[invalidArg])).c_str());
+                     getJSTypeName(getJSType(args[arg_pos[invalidArg]])).c_str());
+        return;
+    }
+
+    if ( !getQueryOptions( args, options_arg, "exec[ute](sql[, params][, options][, callback])", timeout ) ) {
         return;
     }
 
@@ -236,9 +413,15 @@ NODE_API_FUNC( Connection::exec )
     baton->callback_required = callback_required;
     baton->stmt = std::string(*param0);
     baton->del_stmt_ptr = true;
+    baton->query_timeout = timeout;
+
+    if( !getResultLimitOptions( args, options_arg, "exec[ute](sql[, params][, options][, callback])", baton->limit ) ) {
+	delete baton;
+	return;
+    }
 
     if( bind_required ) {
-        if (!getInputParameters(args[1], baton->provided_params, baton->error_code, baton->error_msg, baton->sql_state)) {
+        if (!getInputParameters(args[arg_pos[1]], baton->provided_params, baton->error_code, baton->error_msg, baton->sql_state)) {
             callBack( baton->error_code, &baton->error_msg, &baton->sql_state, args[cbfunc_arg], undef, callback_required );
             args.GetReturnValue().SetUndefined();
             delete baton;
@@ -246,6 +429,9 @@ NODE_API_FUNC( Connection::exec )
 	}
     }
 
+    // The parameters were converted on the main thread
+    baton->timings.end( PHASE_CONVERT );
+
     uv_work_t *req = new uv_work_t();
     req->data = baton;
 
@@ -253,8 +439,8 @@ NODE_API_FUNC( Connection::exec )
 	Local<Function> callback = Local<Function>::Cast(args[cbfunc_arg]);
 	baton->callback.Reset( isolate, callback );
 	int status;
-	status = uv_queue_work( uv_default_loop(), req, executeWork,
-				(uv_after_work_cb)executeAfter );
+	status = queueWork( req, executeWork, (uv_after_work_cb)executeAfter,
+			    &obj->work_queue );
 	assert(status == 0);
 
 	args.GetReturnValue().SetUndefined();
@@ -266,7 +452,7 @@ NODE_API_FUNC( Connection::exec )
     executeWork( req );
     bool success = fillResult( baton, ResultSet );
 
-    if( baton->dbcapi_stmt_ptr != NULL ) {
+    if( baton->dbcapi_stmt_ptr != NULL && !baton->cached_stmt ) {
 	api.dbcapi_free_stmt( baton->dbcapi_stmt_ptr );
     }
 
@@ -282,6 +468,256 @@ NODE_API_FUNC( Connection::exec )
     ResultSet.Reset();
 }
 
+struct pipelineBaton {
+    Persistent<Function> 	callback;
+    // Keeps the Statement objects of the items alive
+    Persistent<Value> 		items;
+
+    Connection 			*obj;
+    std::vector<executeBaton*>	batons;
+    bool 			stop_on_error;
+    size_t 			executed;
+
+    pipelineBaton() {
+	obj = NULL;
+	stop_on_error = false;
+	executed = 0;
+    }
+
+    ~pipelineBaton() {
+	for( size_t i = 0; i < batons.size(); i++ ) {
+	    delete batons[i];
+	}
+	obj = NULL;
+	callback.Reset();
+	items.Reset();
+    }
+};
+
+void Connection::pipelineWork( uv_work_t *req )
+/**********************************************/
+{
+    pipelineBaton *baton = static_cast<pipelineBaton*>(req->data);
+
+    for( size_t i = 0; i < baton->batons.size(); i++ ) {
+	baton->batons[i]->timings.end( PHASE_QUEUE );
+    }
+    scoped_lock lock( baton->obj->conn_mutex );
+    for( size_t i = 0; i < baton->batons.size(); i++ ) {
+	baton->batons[i]->timings.end( PHASE_LOCK );
+    }
+
+    for( size_t i = 0; i < baton->batons.size(); i++ ) {
+	executeBaton *item = baton->batons[i];
+
+	// The time spent on the items before this one is not charged to it
+	item->timings.begin();
+	executeWorkLocked( item );
+	baton->executed++;
+
+	if( item->dbcapi_stmt_ptr != NULL && item->prepared_stmt && item->del_stmt_ptr &&
+	    !item->cached_stmt ) {
+	    api.dbcapi_free_stmt( item->dbcapi_stmt_ptr );
+	    item->dbcapi_stmt_ptr = NULL;
+	}
+	if( item->err && baton->stop_on_error ) {
+	    break;
+	}
+    }
+}
+
+void Connection::pipelineAfter( uv_work_t *req )
+/***********************************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+    pipelineBaton *baton = static_cast<pipelineBaton*>(req->data);
+    Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
+    Local<Value> first_error = undef;
+    Local<Array> results = Array::New( isolate, (int)baton->executed );
+
+    for( size_t i = 0; i < baton->executed; i++ ) {
+	executeBaton *item = baton->batons[i];
+	Persistent<Value> result;
+
+	releaseBindArena( item );
+	item->mem.report( isolate );
+	item->timings.begin();
+	if( !item->err &&
+	    !getResultSet( result, item->rows_affected, item->col_names,
+			   item->string_vals, item->num_vals, item->int_vals,
+			   item->string_len, item->col_types, item->col_native_types ) ) {
+	    item->err = true;
+	    getErrorMsg( JS_ERR_RESULTSET, item->error_code, item->error_msg, item->sql_state );
+	}
+	item->timings.end( PHASE_CONVERT );
+	item->mem.set( MEM_FETCH, 0 );
+	item->mem.report( isolate );
+	recordTimings( baton->obj, item->timings );
+	traceExecute( item, "pipeline" );
+
+	if( item->err ) {
+	    Local<Object> error = Object::New( isolate );
+	    setErrorMsg( error, item->error_code, item->error_msg, item->sql_state );
+	    error->Set( String::NewFromUtf8( isolate, "index" ), Integer::New( isolate, (int)i ) );
+	    if( first_error->IsUndefined() ) {
+		first_error = error;
+	    }
+	    results->Set( (uint32_t)i, error );
+	} else {
+	    // No result for DDL statements
+	    results->Set( (uint32_t)i, item->function_code != 1 ? Local<Value>::New( isolate, result ) : undef );
+	}
+	result.Reset();
+    }
+
+    Local<Function> callback = Local<Function>::New( isolate, baton->callback );
+    Local<Value> argv[2] = { first_error, results };
+    delete baton;
+    delete req;
+
+    TryCatch try_catch;
+    MakeCallback( isolate, isolate->GetCurrentContext()->Global(), callback, 2, argv );
+    if( try_catch.HasCaught() ) {
+	node::FatalException( isolate, try_catch );
+    }
+}
+
+NODE_API_FUNC( Connection::pipeline )
+/************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
+    const char *usage = "pipeline(items[, options], callback)";
+    int  num_args = args.Length();
+    int  cbfunc_arg = num_args - 1;
+
+    args.GetReturnValue().SetUndefined();
+
+    if( num_args == 0 || !args[0]->IsArray() ) {
+	throwErrorIP( 0, usage, getJSTypeName( JS_ARRAY ).c_str(),
+		      getJSTypeName( getJSType( args[0] ) ).c_str() );
+	return;
+    }
+    if( num_args < 2 || num_args > 3 || !args[cbfunc_arg]->IsFunction() ) {
+	int invalidArg = ( num_args < 2 || num_args > 3 ) ? 1 : cbfunc_arg;
+	throwErrorIP( invalidArg, usage, getJSTypeName( JS_FUNCTION ).c_str(),
+		      getJSTypeName( getJSType( args[invalidArg] ) ).c_str() );
+	return;
+    }
+
+    bool stop_on_error = false;
+    if( num_args == 3 && !args[1]->IsUndefined() && !args[1]->IsNull() ) {
+	if( getJSType( args[1] ) != JS_OBJECT ) {
+	    throwErrorIP( 1, usage, getJSTypeName( JS_OBJECT ).c_str(),
+			  getJSTypeName( getJSType( args[1] ) ).c_str() );
+	    return;
+	}
+	Local<Value> value = args[1]->ToObject()->Get( String::NewFromUtf8( isolate, "stopOnError" ) );
+	stop_on_error = value->BooleanValue();
+    }
+
+    Connection *obj = ObjectWrap::Unwrap<Connection>( args.This() );
+    int error_code;
+    std::string error_msg;
+    std::string sql_state;
+
+    if( obj == NULL || obj->conn == NULL ) {
+	getErrorMsg( JS_ERR_INVALID_OBJECT, error_code, error_msg, sql_state );
+	callBack( error_code, &error_msg, &sql_state, args[cbfunc_arg], undef, true );
+	return;
+    }
+
+    Local<Array> items = Local<Array>::Cast( args[0] );
+    Local<String> sqlKey = String::NewFromUtf8( isolate, "sql" );
+    Local<String> stmtKey = String::NewFromUtf8( isolate, "stmt" );
+    Local<String> paramsKey = String::NewFromUtf8( isolate, "params" );
+    pipelineBaton *baton = new pipelineBaton();
+    baton->obj = obj;
+    baton->stop_on_error = stop_on_error;
+
+    for( uint32_t i = 0; i < items->Length(); i++ ) {
+	Local<Value> element = items->Get( i );
+	Local<Value> sql;
+	Local<Value> stmt;
+	Local<Value> params;
+
+	if( getJSType( element ) == JS_OBJECT ) {
+	    Local<Object> item = element->ToObject();
+	    sql = item->Get( sqlKey );
+	    stmt = item->Get( stmtKey );
+	    params = item->Get( paramsKey );
+	}
+	if( getJSType( element ) != JS_OBJECT ||
+	    !( sql->IsString() || getJSType( stmt ) == JS_OBJECT ) ||
+	    !( params->IsUndefined() || params->IsNull() || params->IsArray() ) ) {
+	    delete baton;
+	    throwErrorIP( 0, usage, "Array of { sql | stmt[, params] }",
+			  getJSTypeName( getJSType( element ) ).c_str() );
+	    return;
+	}
+
+	executeBaton *item = new executeBaton();
+	baton->batons.push_back( item );
+	item->obj = obj;
+	item->dbcapi_stmt_ptr = NULL;
+
+	if( sql->IsString() ) {
+	    String::Utf8Value sql_utf8( sql->ToString() );
+	    item->stmt = std::string( *sql_utf8 );
+	    item->del_stmt_ptr = true;
+	} else {
+	    Local<Object> stmtObj = stmt->ToObject();
+	    Statement *stmt_ptr = NULL;
+	    String::Utf8Value className( stmtObj->GetConstructorName() );
+	    if( stmtObj->InternalFieldCount() == 1 && strcmp( *className, "Statement" ) == 0 ) {
+		stmt_ptr = ObjectWrap::Unwrap<Statement>( stmtObj );
+	    }
+	    if( stmt_ptr == NULL || stmt_ptr->connection != obj || stmt_ptr->dbcapi_stmt_ptr == NULL ) {
+		delete baton;
+		getErrorMsg( JS_ERR_INVALID_OBJECT, error_code, error_msg, sql_state );
+		callBack( error_code, &error_msg, &sql_state, args[cbfunc_arg], undef, true );
+		return;
+	    }
+	    item->obj_stmt = stmt_ptr;
+	    item->dbcapi_stmt_ptr = stmt_ptr->dbcapi_stmt_ptr;
+	}
+
+	if( params->IsArray() ) {
+	    if( !getInputParameters( params, item->provided_params, item->error_code, item->error_msg,
+				     item->sql_state ) ) {
+		callBack( item->error_code, &item->error_msg, &item->sql_state, args[cbfunc_arg], undef, true );
+		delete baton;
+		return;
+	    }
+	    // Parameter data cannot be sent while other statements follow
+	    for( size_t j = 0; j < item->provided_params.size(); j++ ) {
+		if( item->provided_params[j]->value.type == A_INVALID_TYPE ) {
+		    delete baton;
+		    getErrorMsg( JS_ERR_BINDING_PARAMETERS, error_code, error_msg, sql_state );
+		    callBack( error_code, &error_msg, &sql_state, args[cbfunc_arg], undef, true );
+		    return;
+		}
+	    }
+	}
+	item->timings.end( PHASE_CONVERT );
+    }
+
+    for( size_t i = 0; i < baton->batons.size(); i++ ) {
+	baton->batons[i]->timings.begin();
+    }
+    baton->items.Reset( isolate, args[0] );
+    baton->callback.Reset( isolate, Local<Function>::Cast( args[cbfunc_arg] ) );
+
+    uv_work_t *req = new uv_work_t();
+    req->data = baton;
+
+    int status;
+    status = queueWork( req, pipelineWork, (uv_after_work_cb)pipelineAfter, &obj->work_queue );
+    assert(status == 0);
+}
+
 struct prepareBaton {
     Persistent<Function> 	callback;
     bool 			err;
@@ -293,11 +729,14 @@ struct prepareBaton {
     Statement 			*obj;
     std::string 		stmt;
     Persistent<Value> 		stmtObj;
+    int				function_code;
+    opTimings			timings;
 
     prepareBaton() {
 	err = false;
 	callback_required = false;
 	obj = NULL;
+	function_code = 0;
     }
 
     ~prepareBaton() {
@@ -318,23 +757,35 @@ void Connection::prepareWork( uv_work_t *req )
 	return;
     }
 
+    baton->timings.end( PHASE_QUEUE );
     scoped_lock lock( baton->obj->connection->conn_mutex );
+    baton->timings.end( PHASE_LOCK );
 
     baton->obj->dbcapi_stmt_ptr = api.dbcapi_prepare( baton->obj->connection->conn,
 						  baton->stmt.c_str() );
-    baton->obj->num_params = api.dbcapi_num_params( baton->obj->dbcapi_stmt_ptr );
 
-    for (int i = 0; i < baton->obj->num_params; i++) {
-        dbcapi_bind_param_info info;
-        api.dbcapi_get_bind_param_info(baton->obj->dbcapi_stmt_ptr, i, &info);
-        baton->obj->param_infos.push_back(info);
+    if( baton->obj->dbcapi_stmt_ptr == NULL ) {
+	baton->err = true;
+	getErrorMsg( baton->obj->connection->conn, baton->error_code, baton->error_msg, baton->sql_state );
+	return;
     }
 
-    if( baton->obj->dbcapi_stmt_ptr == NULL ) {
+    // Capture the bind descriptors once; executes reuse them
+    if( !baton->obj->param_descs.describe( baton->obj->dbcapi_stmt_ptr ) ) {
 	baton->err = true;
 	getErrorMsg( baton->obj->connection->conn, baton->error_code, baton->error_msg, baton->sql_state );
 	return;
     }
+    baton->obj->num_params = baton->obj->param_descs.size();
+    if( !setQueryTimeout( baton->obj->dbcapi_stmt_ptr, baton->obj->query_timeout ) ) {
+	baton->err = true;
+	getErrorMsg( baton->obj->connection->conn, baton->error_code, baton->error_msg, baton->sql_state );
+	return;
+    }
+    if( isTracing( baton->obj->connection ) ) {
+	baton->function_code = api.dbcapi_get_function_code( baton->obj->dbcapi_stmt_ptr );
+    }
+    baton->timings.end( PHASE_PREPARE );
 }
 
 void Connection::prepareAfter( uv_work_t *req )
@@ -345,6 +796,12 @@ void Connection::prepareAfter( uv_work_t *req )
     prepareBaton *baton = static_cast<prepareBaton*>(req->data);
     Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
 
+    Connection *conn = baton->obj != NULL ? baton->obj->connection : NULL;
+    recordTimings( conn, baton->timings );
+    traceOperation( conn, "prepare", baton->stmt, baton->function_code, baton->timings,
+		    0, 0, baton->err ? 0 : (int)baton->obj->num_params,
+		    baton->err ? baton->error_code : 0 );
+
     if( baton->err ) {
 	callBack( baton->error_code, &( baton->error_msg ), &( baton->sql_state),
                   baton->callback, undef, baton->callback_required );
@@ -369,17 +826,19 @@ NODE_API_FUNC( Connection::prepare )
     Isolate *isolate = args.GetIsolate();
     HandleScope scope( isolate );
     int cbfunc_arg = -1;
+    int timeout = -1;
     Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
 
     args.GetReturnValue().SetUndefined();
 
     // check parameters
-    unsigned int expectedTypes[] = { JS_STRING, JS_FUNCTION };
-    bool isOptional[] = { false, true };
-    if (!checkParameters(args, "prepare(sql, [callback])", 2, expectedTypes, &cbfunc_arg, isOptional)) {
+    unsigned int expectedTypes[] = { JS_STRING, JS_OBJECT | JS_FUNCTION, JS_FUNCTION };
+    bool isOptional[] = { false, true, true };
+    if (!checkParameters(args, "prepare(sql[, options][, callback])", 3, expectedTypes, &cbfunc_arg, isOptional) ||
+        !getQueryOptions(args, findOptionsArg(args, 1), "prepare(sql[, options][, callback])", timeout)) {
         return;
     }
-    bool callback_required = (cbfunc_arg == 1);
+    bool callback_required = (cbfunc_arg >= 1);
 
     Connection *db = ObjectWrap::Unwrap<Connection>( args.This() );
 
@@ -399,6 +858,7 @@ NODE_API_FUNC( Connection::prepare )
     Statement *obj = ObjectWrap::Unwrap<Statement>( l_stmt );
     obj->connection = db;
     obj->conn_mutex = &db->conn_mutex;
+    obj->query_timeout = timeout;
 
     if( obj == NULL ) {
         int error_code;
@@ -426,8 +886,8 @@ NODE_API_FUNC( Connection::prepare )
 	baton->callback.Reset( isolate, callback );
 	baton->stmtObj.Reset( isolate, p_stmt );
 	int status;
-	status = uv_queue_work( uv_default_loop(), req, prepareWork,
-				(uv_after_work_cb)prepareAfter );
+	status = queueWork( req, prepareWork, (uv_after_work_cb)prepareAfter,
+			    &db->work_queue );
 	assert(status == 0);
 	p_stmt.Reset();
 	return;
@@ -501,19 +961,31 @@ void Connection::connectWork( uv_work_t *req )
 
     if( !baton->external_connection ) {
         if (baton->obj->conn == NULL) {
-            baton->obj->conn = api.dbcapi_new_connection();
+            scoped_lock cancel_lock( baton->obj->cancel_mutex );
+            baton->obj->conn = newConnection( baton->obj->dbcapi_ctx );
         }
         api.dbcapi_set_autocommit( baton->obj->conn, baton->obj->autoCommit );
 
 	if( !api.dbcapi_connect( baton->obj->conn, baton->conn_string.c_str() ) ) {
 	    getErrorMsg( baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state );
 	    baton->err = true;
-	    api.dbcapi_free_connection( baton->obj->conn );
-	    baton->obj->conn = NULL;
+	    dbcapi_connection *old_conn;
+	    {
+		scoped_lock cancel_lock( baton->obj->cancel_mutex );
+		old_conn = baton->obj->conn;
+		baton->obj->conn = NULL;
+	    }
+	    api.dbcapi_free_connection( old_conn );
 	    return;
 	}
     } else {
-	baton->obj->conn = api.dbcapi_make_connection( baton->external_conn_ptr );
+	scoped_lock cancel_lock( baton->obj->cancel_mutex );
+	if( baton->obj->dbcapi_ctx != NULL && api.dbcapi_make_connection_ex != NULL ) {
+	    baton->obj->conn = api.dbcapi_make_connection_ex( baton->obj->dbcapi_ctx,
+							       baton->external_conn_ptr );
+	} else {
+	    baton->obj->conn = api.dbcapi_make_connection( baton->external_conn_ptr );
+	}
         api.dbcapi_set_autocommit( baton->obj->conn, baton->obj->autoCommit );
 	if( baton->obj->conn == NULL ) {
 	    getErrorMsg( baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state );
@@ -649,8 +1121,8 @@ NODE_API_FUNC( Connection::connect )
 	baton->callback.Reset( isolate, callback );
 
 	int status;
-	status = uv_queue_work( uv_default_loop(), req, connectWork,
-				(uv_after_work_cb)connectAfter );
+	status = queueWork( req, connectWork, (uv_after_work_cb)connectAfter,
+			    &obj->work_queue );
 	assert(status == 0);
 	args.GetReturnValue().SetUndefined();
 	return;
@@ -675,20 +1147,25 @@ void Connection::disconnectWork( uv_work_t *req )
     }
 
     api.dbcapi_register_warning_callback(baton->obj->conn, NULL, baton->obj);
+    baton->obj->stmt_cache.clear();
+
+    // Detach the handle under cancel_mutex only, so a cancel() on the JS
+    // thread does not wait for the disconnect round trip
+    dbcapi_connection *conn;
+    {
+	scoped_lock cancel_lock( baton->obj->cancel_mutex );
+	conn = baton->obj->conn;
+	baton->obj->conn = NULL;
+	baton->obj->is_connected = false;
+    }
 
     if( !baton->obj->external_connection ) {
-	api.dbcapi_disconnect( baton->obj->conn );
+	api.dbcapi_disconnect( conn );
     }
     // Must free the connection object or there will be a memory leak
-    api.dbcapi_free_connection( baton->obj->conn );
-
-    baton->obj->is_connected = false;
-    baton->obj->conn = NULL;
+    api.dbcapi_free_connection( conn );
 
     openConnections--;
-    if( openConnections <= 0 ) {
-	openConnections = 0;
-    }
 
     return;
 }
@@ -711,6 +1188,14 @@ NODE_API_FUNC( Connection::disconnect )
     bool callback_required = (cbfunc_arg >= 0);
 
     Connection *obj = ObjectWrap::Unwrap<Connection>( args.This() );
+
+    if( obj->pool != NULL ) {
+	// Pooled connections go back to their pool instead
+	Local<Value> callback = callback_required ? args[cbfunc_arg] : Local<Value>();
+	Pool::releaseConnection( isolate, args.This(), callback, callback_required );
+	return;
+    }
+
     noParamBaton *baton = new noParamBaton();
     baton->callback_required = callback_required;
     baton->obj = obj;
@@ -723,8 +1208,8 @@ NODE_API_FUNC( Connection::disconnect )
 	baton->callback.Reset( isolate, callback );
 
 	int status;
-	status = uv_queue_work( uv_default_loop(), req, disconnectWork,
-				(uv_after_work_cb)noParamAfter );
+	status = queueWork( req, disconnectWork, (uv_after_work_cb)noParamAfter,
+			    &obj->work_queue );
 	assert(status == 0);
 
 	args.GetReturnValue().SetUndefined();
@@ -785,8 +1270,8 @@ NODE_API_FUNC( Connection::commit )
 	baton->callback.Reset( isolate, callback );
 
 	int status;
-	status = uv_queue_work( uv_default_loop(), req, commitWork,
-				(uv_after_work_cb)noParamAfter );
+	status = queueWork( req, commitWork, (uv_after_work_cb)noParamAfter,
+			    &obj->work_queue );
 	assert(status == 0);
 
 	args.GetReturnValue().SetUndefined();
@@ -847,8 +1332,8 @@ NODE_API_FUNC( Connection::rollback )
 	baton->callback.Reset( isolate, callback );
 
 	int status;
-	status = uv_queue_work( uv_default_loop(), req, rollbackWork,
-				(uv_after_work_cb)noParamAfter );
+	status = queueWork( req, rollbackWork, (uv_after_work_cb)noParamAfter,
+			    &obj->work_queue );
 	assert(status == 0);
 
 	args.GetReturnValue().SetUndefined();
@@ -973,18 +1458,274 @@ NODE_API_FUNC(Connection::setWarningCallback)
 
     Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
 
-    if (obj->warningBaton != NULL) {
-        delete obj->warningBaton;
-        obj->warningBaton = NULL;
+    if (args[0]->IsUndefined() || args[0]->IsNull()) {
+        if (obj->warningBaton != NULL) {
+            obj->warningBaton->callback.Reset();
+        }
+        return;
+    }
+
+    // The baton is created once and kept, since driver threads may be
+    // reporting a warning while the callback is replaced
+    if (obj->warningBaton == NULL) {
+        warningCallbackBaton *baton = new warningCallbackBaton();
+        baton->obj = obj;
+        baton->async.data = baton;
+        uv_async_init(getEventLoop(isolate), &baton->async, warningCallbackAfter);
+        uv_unref((uv_handle_t *)&baton->async);
+        obj->warningBaton = baton;
+    }
+    Local<Function> callback = Local<Function>::Cast(args[cbfunc_arg]);
+    obj->warningBaton->callback.Reset(isolate, callback);
+}
+
+NODE_API_FUNC(Connection::setTraceCallback)
+/***********************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+    int cbfunc_arg = -1;
+
+    args.GetReturnValue().SetUndefined();
+
+    // check parameters
+    unsigned int expectedTypes[] = { JS_FUNCTION };
+    bool isOptional[] = { true };
+    if (!checkParameters(args, "setTraceCallback(callback)", 1, expectedTypes, &cbfunc_arg, isOptional)) {
+        return;
     }
 
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+
+    // Events are only produced on the loop thread, so the baton can be
+    // dropped right away; events that are still queued are discarded
     if (args[0]->IsUndefined() || args[0]->IsNull()) {
+        if (obj->traceBaton != NULL) {
+            obj->traceBaton->obj = NULL;
+            obj->traceBaton->callback.Reset();
+            uv_close((uv_handle_t *)&obj->traceBaton->async, traceCallbackClosed);
+            obj->traceBaton = NULL;
+        }
         return;
     }
 
-    warningCallbackBaton *baton = new warningCallbackBaton();
-    obj->warningBaton = baton;
-    baton->obj = obj;
+    if (obj->traceBaton == NULL) {
+        traceCallbackBaton *baton = new traceCallbackBaton();
+        baton->obj = obj;
+        baton->async.data = baton;
+        uv_async_init(getEventLoop(isolate), &baton->async, traceCallbackAfter);
+        uv_unref((uv_handle_t *)&baton->async);
+        obj->traceBaton = baton;
+    }
     Local<Function> callback = Local<Function>::Cast(args[cbfunc_arg]);
-    baton->callback.Reset(isolate, callback);
+    obj->traceBaton->callback.Reset(isolate, callback);
+}
+
+NODE_API_FUNC(Connection::setStatementCacheSize)
+/***********************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+
+    args.GetReturnValue().SetUndefined();
+
+    // check parameters
+    unsigned int expectedTypes[] = { JS_INTEGER };
+    if (!checkParameters(args, "setStatementCacheSize(size)", 1, expectedTypes)) {
+        return;
+    }
+
+    int size = args[0]->Int32Value();
+    if (size < 0) {
+        throwErrorIP(0, "setStatementCacheSize(size)", "non-negative integer",
+                     getJSTypeName(getJSType(args[0])).c_str());
+        return;
+    }
+
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+    scoped_lock lock(obj->conn_mutex);
+    obj->stmt_cache.setCapacity((size_t)size);
+}
+
+NODE_API_FUNC(Connection::getStatementCacheStats)
+/***********************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+    Local<Object> stats = Object::New(isolate);
+
+    // No conn_mutex: a running execute holds it until its fetch is done
+    StatementCache &cache = obj->stmt_cache;
+    stats->Set(String::NewFromUtf8(isolate, "capacity"), Integer::NewFromUnsigned(isolate, (uint32_t)cache.capacity));
+    stats->Set(String::NewFromUtf8(isolate, "size"), Integer::NewFromUnsigned(isolate, (uint32_t)cache.size()));
+    stats->Set(String::NewFromUtf8(isolate, "hits"), Number::New(isolate, (double)cache.hits));
+    stats->Set(String::NewFromUtf8(isolate, "misses"), Number::New(isolate, (double)cache.misses));
+    stats->Set(String::NewFromUtf8(isolate, "evictions"), Number::New(isolate, (double)cache.evictions));
+    args.GetReturnValue().Set(stats);
+}
+
+NODE_API_FUNC(Connection::getQueueStats)
+/***********************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+    Local<Object> stats = Object::New(isolate);
+    WorkQueue::stats queue;
+
+    // Does not take conn_mutex, so it can be called while a request runs
+    dbPool.getQueueStats(obj->work_queue, queue);
+    stats->Set(String::NewFromUtf8(isolate, "length"), Number::New(isolate, (double)queue.length));
+    stats->Set(String::NewFromUtf8(isolate, "oldestWaitMs"), Number::New(isolate, queue.oldest_wait_ms));
+    stats->Set(String::NewFromUtf8(isolate, "maxWaitMs"), Number::New(isolate, queue.max_wait_ms));
+    stats->Set(String::NewFromUtf8(isolate, "completed"), Number::New(isolate, queue.completed));
+    args.GetReturnValue().Set(stats);
+}
+
+NODE_API_FUNC(Connection::getStats)
+/***********************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+    bool reset = false;
+
+    if (args.Length() > 0 && !args[0]->IsUndefined() && !convertToBool(args[0], reset)) {
+        throwErrorIP(0, "getStats([reset])", "boolean", getJSTypeName(getJSType(args[0])).c_str());
+        return;
+    }
+    args.GetReturnValue().Set(obj->stats.toObject(isolate));
+    if (reset) {
+        obj->stats.reset();
+    }
+}
+
+NODE_API_FUNC(Connection::setMemoryLimit)
+/***********************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+
+    args.GetReturnValue().SetUndefined();
+
+    if (args.Length() != 1 || !args[0]->IsNumber() || args[0]->NumberValue() < 0) {
+        throwErrorIP(0, "setMemoryLimit(bytes)", "non-negative number",
+                     getJSTypeName(getJSType(args[0])).c_str());
+        return;
+    }
+
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+    obj->mem.limit = (int64_t)args[0]->NumberValue();
+}
+
+NODE_API_FUNC(Connection::getMemoryStats)
+/***********************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+    Local<Object> stats = Object::New(isolate);
+
+    stats->Set(String::NewFromUtf8(isolate, "totalBytes"), Number::New(isolate, (double)obj->mem.bytes.load()));
+    stats->Set(String::NewFromUtf8(isolate, "limitBytes"), Number::New(isolate, (double)obj->mem.limit.load()));
+    args.GetReturnValue().Set(stats);
+}
+
+void Connection::setSlowLog(slowQueryLog *log)
+/***********************************************************************/
+{
+    if (log != NULL) {
+        log->addRef();
+    }
+    slowQueryLog *old = slow_log.exchange(log);
+    if (old != NULL) {
+        // A worker may still be recording into it
+        retired_logs.push_back(old);
+    }
+}
+
+NODE_API_FUNC(Connection::setSlowQueryLog)
+/***********************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+    const char *usage = "setSlowQueryLog(options)";
+
+    args.GetReturnValue().SetUndefined();
+
+    if (args.Length() < 1 || args[0]->IsNull() || args[0]->IsUndefined()) {
+        obj->setSlowLog(NULL);
+        return;
+    }
+    slowQueryLog *log = newSlowQueryLog(args[0], 0, usage);
+    if (log == NULL) {
+        return;
+    }
+    obj->setSlowLog(log);
+    log->release();
+}
+
+NODE_API_FUNC(Connection::getSlowQueries)
+/***********************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+    bool clear = false;
+
+    if (args.Length() > 0 && !args[0]->IsUndefined() && !convertToBool(args[0], clear)) {
+        throwErrorIP(0, "getSlowQueries([clear])", "boolean", getJSTypeName(getJSType(args[0])).c_str());
+        return;
+    }
+    slowQueryLog *log = obj->slow_log.load();
+    if (log == NULL) {
+        args.GetReturnValue().Set(Array::New(isolate));
+        return;
+    }
+    args.GetReturnValue().Set(log->toArray(isolate, clear));
+}
+
+NODE_API_FUNC(Connection::flushSlowQueries)
+/***********************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+    int cbfunc_arg = -1;
+
+    args.GetReturnValue().SetUndefined();
+
+    unsigned int expectedTypes[] = { JS_STRING, JS_FUNCTION };
+    bool isOptional[] = { false, false };
+    if (!checkParameters(args, "flushSlowQueries(path, callback)", 2, expectedTypes, &cbfunc_arg, isOptional)) {
+        return;
+    }
+    String::Utf8Value path(args[0]->ToString());
+    Local<Function> callback = Local<Function>::Cast(args[cbfunc_arg]);
+    slowQueryLog *log = obj->slow_log.load();
+
+    if (log == NULL) {
+        Local<Value> count = Integer::New(isolate, 0);
+        callBack(0, NULL, NULL, args[cbfunc_arg], count, true);
+        return;
+    }
+    flushSlowQueryLog(isolate, log, std::string(*path), callback);
+}
+
+NODE_API_FUNC(Connection::cancel)
+/***********************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+    Connection *obj = ObjectWrap::Unwrap<Connection>(args.This());
+
+    args.GetReturnValue().SetUndefined();
+
+    // Do not take conn_mutex: it is held by the execute being cancelled
+    scoped_lock lock(obj->cancel_mutex);
+    if (obj->conn != NULL) {
+        api.dbcapi_cancel(obj->conn);
+    }
 }
@@ -0,0 +1,1737 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+//
+// The file starts with RECORD_MAGIC and is followed by one record per call:
+//
+//   op, connection id, statement id, elapsed ns, result, payload length
+//
+// all as LEB128 varints, the result zigzag encoded, and then the payload
+// that the op needs to repeat what the call wrote into the caller's
+// buffers. Connections are numbered in the order they are created and
+// statements in the order they are prepared, both from 1.
+//
+// ***************************************************************************
+#include "nodever_cover.h"
+#include "hana_utils.h"
+#include <stdio.h>
+#include <map>
+#include <set>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <unordered_map>
+
+using namespace v8;
+
+#define RECORD_MAGIC		"HDBCREC1"
+#define RECORD_MAGIC_LEN	8
+// Records are written out once this many bytes are buffered
+#define RECORD_FLUSH_SIZE	( 256 * 1024 )
+// Replay waits are added up until they are worth a sleep
+#define REPLAY_MIN_WAIT_NS	50000
+
+enum recordOp
+{
+    OP_CONNECT = 1,
+    OP_DISCONNECT,
+    OP_SET_CLIENTINFO,
+    OP_GET_CLIENTINFO,
+    OP_SET_AUTOCOMMIT,
+    OP_COMMIT,
+    OP_ROLLBACK,
+    OP_PREPARE,
+    OP_EXECUTE_DIRECT,
+    OP_GET_FUNCTION_CODE,
+    OP_SET_QUERY_TIMEOUT,
+    OP_NUM_PARAMS,
+    OP_DESCRIBE_BIND_PARAM,
+    OP_GET_BIND_PARAM_INFO,
+    OP_BIND_PARAM,
+    OP_SEND_PARAM_DATA,
+    OP_RESET,
+    OP_SET_BATCH_SIZE,
+    OP_EXECUTE,
+    OP_GET_NEXT_RESULT,
+    OP_AFFECTED_ROWS,
+    OP_NUM_COLS,
+    OP_GET_COLUMN_INFO,
+    OP_SET_ROWSET_SIZE,
+    OP_BIND_COLUMN,
+    OP_FETCH_NEXT,
+    OP_FETCHED_ROWS,
+    OP_GET_COLUMN,
+    OP_GET_DATA,
+    OP_GET_DATA_INFO,
+    OP_ERROR,
+    OP_SQLSTATE,
+    OP_COUNT
+};
+
+static const char *opNames[OP_COUNT] = {
+    "", "connect", "disconnect", "set_clientinfo", "get_clientinfo",
+    "set_autocommit", "commit", "rollback", "prepare", "execute_direct",
+    "get_function_code", "set_query_timeout", "num_params",
+    "describe_bind_param", "get_bind_param_info", "bind_param",
+    "send_param_data", "reset", "set_batch_size", "execute",
+    "get_next_result", "affected_rows", "num_cols", "get_column_info",
+    "set_rowset_size", "bind_column", "fetch_next", "fetched_rows",
+    "get_column", "get_data", "get_data_info", "error", "sqlstate"
+};
+
+class recordWriter
+{
+  public:
+    void putUInt( uint64_t value )
+    {
+	while( value >= 0x80 ) {
+	    data.push_back( (char)( ( value & 0x7f ) | 0x80 ) );
+	    value >>= 7;
+	}
+	data.push_back( (char)value );
+    }
+    void putInt( int64_t value )
+    {
+	putUInt( ( (uint64_t)value << 1 ) ^ (uint64_t)( value >> 63 ) );
+    }
+    void putBytes( const void *bytes, size_t length )
+    {
+	putUInt( length );
+	if( length > 0 ) {
+	    data.insert( data.end(), (const char *)bytes, (const char *)bytes + length );
+	}
+    }
+    /// NULL and "" are kept apart
+    void putString( const char *str )
+    {
+	if( str == NULL ) {
+	    putUInt( 0 );
+	    return;
+	}
+	size_t length = strlen( str );
+	putUInt( length + 1 );
+	data.insert( data.end(), str, str + length );
+    }
+
+    std::vector<char>	data;
+};
+
+class recordReader
+{
+  public:
+    recordReader( const char *data, size_t length ) :
+	failed( false ), pos( data ), end( data + length ) {}
+
+    uint64_t getUInt()
+    {
+	uint64_t value = 0;
+	for( int shift = 0; shift < 64; shift += 7 ) {
+	    if( pos >= end ) {
+		break;
+	    }
+	    unsigned char byte = (unsigned char)*pos++;
+	    value |= (uint64_t)( byte & 0x7f ) << shift;
+	    if( ( byte & 0x80 ) == 0 ) {
+		return value;
+	    }
+	}
+	failed = true;
+	return 0;
+    }
+    int64_t getInt()
+    {
+	uint64_t value = getUInt();
+	return (int64_t)( value >> 1 ) ^ -(int64_t)( value & 1 );
+    }
+    const char *getBytes( size_t &length )
+    {
+	length = (size_t)getUInt();
+	if( failed || length > (size_t)( end - pos ) ) {
+	    failed = true;
+	    length = 0;
+	    return NULL;
+	}
+	const char *bytes = pos;
+	pos += length;
+	return bytes;
+    }
+    /// Returns false for NULL
+    bool getString( std::string &str )
+    {
+	size_t length = (size_t)getUInt();
+	str.clear();
+	if( failed || length == 0 ) {
+	    return false;
+	}
+	if( length - 1 > (size_t)( end - pos ) ) {
+	    failed = true;
+	    return false;
+	}
+	str.assign( pos, length - 1 );
+	pos += length - 1;
+	return true;
+    }
+    bool atEnd() const { return pos >= end; }
+
+    bool	failed;
+
+  private:
+    const char	*pos;
+    const char	*end;
+};
+
+static size_t valueBytes( dbcapi_data_type type, size_t length )
+/**************************************************************/
+{
+    switch( type ) {
+	case A_DOUBLE:
+	case A_VAL64:
+	case A_UVAL64:
+	    return 8;
+	case A_VAL32:
+	case A_UVAL32:
+	case A_FLOAT:
+	    return 4;
+	case A_VAL16:
+	case A_UVAL16:
+	    return 2;
+	case A_VAL8:
+	case A_UVAL8:
+	    return 1;
+	default:
+	    return length;
+    }
+}
+
+static void putValue( recordWriter &w, dbcapi_data_type type, const char *buffer,
+		      size_t buffer_size, const size_t *length, const dbcapi_bool *is_null )
+/***************************************************************************************/
+{
+    bool null_value = ( is_null != NULL && *is_null );
+
+    w.putUInt( type );
+    w.putUInt( null_value ? 1 : 0 );
+    if( null_value ) {
+	return;
+    }
+    size_t len = ( length != NULL ? *length : 0 );
+    size_t bytes = valueBytes( type, len );
+    // buffer_size is 0 for values that the library returns in its own memory
+    if( buffer_size > 0 && bytes > buffer_size ) {
+	bytes = buffer_size;
+    }
+    w.putUInt( len );
+    w.putBytes( buffer, buffer == NULL ? 0 : bytes );
+}
+
+static uint64_t hashSQL( const char *sql )
+/****************************************/
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for( ; sql != NULL && *sql != '\0'; sql++ ) {
+	hash ^= (unsigned char)*sql;
+	hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+//
+// Recording
+//
+
+struct recordedStmt
+{
+    recordedStmt() : id( 0 ), conn( 0 ), batch_size( 1 ) {}
+
+    unsigned				id;
+    unsigned				conn;
+    dbcapi_u32				batch_size;
+    // Copies of what was bound, for the values that execute and
+    // fetch_next write into the driver's buffers
+    std::map<dbcapi_u32, dbcapi_bind_data>	params;
+    std::map<dbcapi_u32, dbcapi_data_value>	cols;
+};
+
+static DBCAPIInterface			real;
+static uv_mutex_t			record_mutex;
+static FILE *				record_file = NULL;
+static std::vector<char>		record_buffer;
+static unsigned				record_next_conn = 0;
+static unsigned				record_next_stmt = 0;
+static std::unordered_map<dbcapi_connection*, unsigned>	record_conns;
+// Nodes of an unordered_map stay where they are, so a statement's entry
+// may be used without the lock by the thread that is calling into it
+static std::unordered_map<dbcapi_stmt*, recordedStmt>	record_stmts;
+
+static void flushRecordBuffer()
+/*****************************/
+{
+    if( record_file != NULL && !record_buffer.empty() ) {
+	fwrite( &record_buffer[0], 1, record_buffer.size(), record_file );
+	fflush( record_file );
+    }
+    record_buffer.clear();
+}
+
+void flushApiRecorder()
+/*********************/
+{
+    if( record_file == NULL ) {
+	return;
+    }
+    scoped_lock lock( record_mutex );
+    flushRecordBuffer();
+}
+
+static void flushAtExit()
+/***********************/
+{
+    flushApiRecorder();
+}
+
+static void writeRecord( recordOp op, unsigned conn, unsigned stmt, uint64_t start,
+			 int64_t result, const recordWriter *payload = NULL )
+/**********************************************************************************/
+{
+    uint64_t elapsed = uv_hrtime() - start;
+    recordWriter head;
+
+    head.data.reserve( 40 );
+    head.putUInt( op );
+    head.putUInt( conn );
+    head.putUInt( stmt );
+    head.putUInt( elapsed );
+    head.putInt( result );
+    head.putUInt( payload != NULL ? payload->data.size() : 0 );
+
+    scoped_lock lock( record_mutex );
+    record_buffer.insert( record_buffer.end(), head.data.begin(), head.data.end() );
+    if( payload != NULL ) {
+	record_buffer.insert( record_buffer.end(), payload->data.begin(), payload->data.end() );
+    }
+    if( record_buffer.size() >= RECORD_FLUSH_SIZE ) {
+	flushRecordBuffer();
+    }
+}
+
+static unsigned addConnection( dbcapi_connection *conn )
+/******************************************************/
+{
+    if( conn == NULL ) {
+	return 0;
+    }
+    scoped_lock lock( record_mutex );
+    unsigned id = ++record_next_conn;
+    record_conns[conn] = id;
+    return id;
+}
+
+static unsigned findConnection( dbcapi_connection *conn )
+/*******************************************************/
+{
+    scoped_lock lock( record_mutex );
+    std::unordered_map<dbcapi_connection*, unsigned>::iterator it = record_conns.find( conn );
+    return ( it != record_conns.end() ? it->second : 0 );
+}
+
+static unsigned addStmt( dbcapi_stmt *stmt, unsigned conn )
+/*********************************************************/
+{
+    if( stmt == NULL ) {
+	return 0;
+    }
+    scoped_lock lock( record_mutex );
+    recordedStmt &rs = record_stmts[stmt];
+    rs = recordedStmt();
+    rs.id = ++record_next_stmt;
+    rs.conn = conn;
+    return rs.id;
+}
+
+static recordedStmt *findStmt( dbcapi_stmt *stmt )
+/************************************************/
+{
+    static recordedStmt unknown;
+
+    scoped_lock lock( record_mutex );
+    std::unordered_map<dbcapi_stmt*, recordedStmt>::iterator it = record_stmts.find( stmt );
+    return ( it != record_stmts.end() ? &it->second : &unknown );
+}
+
+static void writeConnRecord( recordOp op, dbcapi_connection *conn, uint64_t start, int64_t result )
+/*************************************************************************************************/
+{
+    writeRecord( op, findConnection( conn ), 0, start, result );
+}
+
+static void writeStmtRecord( recordOp op, recordedStmt *rs, uint64_t start, int64_t result,
+			     const recordWriter *payload = NULL )
+/****************************************************************************************/
+{
+    writeRecord( op, rs->conn, rs->id, start, result, payload );
+}
+
+static dbcapi_connection *recNewConnection()
+/******************************************/
+{
+    dbcapi_connection *conn = real.dbcapi_new_connection();
+    addConnection( conn );
+    return conn;
+}
+
+static dbcapi_connection *recNewConnectionEx( dbcapi_interface_context *context )
+/*******************************************************************************/
+{
+    dbcapi_connection *conn = real.dbcapi_new_connection_ex( context );
+    addConnection( conn );
+    return conn;
+}
+
+static dbcapi_connection *recMakeConnection( void *arg )
+/******************************************************/
+{
+    dbcapi_connection *conn = real.dbcapi_make_connection( arg );
+    addConnection( conn );
+    return conn;
+}
+
+static dbcapi_connection *recMakeConnectionEx( dbcapi_interface_context *context, void *arg )
+/*******************************************************************************************/
+{
+    dbcapi_connection *conn = real.dbcapi_make_connection_ex( context, arg );
+    addConnection( conn );
+    return conn;
+}
+
+static void recFreeConnection( dbcapi_connection *conn )
+/******************************************************/
+{
+    {
+	scoped_lock lock( record_mutex );
+	record_conns.erase( conn );
+    }
+    real.dbcapi_free_connection( conn );
+}
+
+static void recFini()
+/*******************/
+{
+    flushApiRecorder();
+    real.dbcapi_fini();
+}
+
+static dbcapi_bool recConnect( dbcapi_connection *conn, const char *str )
+/***********************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_connect( conn, str );
+    writeConnRecord( OP_CONNECT, conn, start, ret );
+    return ret;
+}
+
+static dbcapi_bool recDisconnect( dbcapi_connection *conn )
+/*********************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_disconnect( conn );
+    writeConnRecord( OP_DISCONNECT, conn, start, ret );
+    return ret;
+}
+
+static dbcapi_bool recSetClientinfo( dbcapi_connection *conn, const char *property, const char *value )
+/*****************************************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_set_clientinfo( conn, property, value );
+    writeConnRecord( OP_SET_CLIENTINFO, conn, start, ret );
+    return ret;
+}
+
+static const char *recGetClientinfo( dbcapi_connection *conn, const char *property )
+/**********************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    const char *value = real.dbcapi_get_clientinfo( conn, property );
+    recordWriter w;
+    w.putString( value );
+    writeRecord( OP_GET_CLIENTINFO, findConnection( conn ), 0, start, value != NULL, &w );
+    return value;
+}
+
+static dbcapi_bool recSetAutocommit( dbcapi_connection *conn, dbcapi_bool mode )
+/******************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_set_autocommit( conn, mode );
+    writeConnRecord( OP_SET_AUTOCOMMIT, conn, start, ret );
+    return ret;
+}
+
+static dbcapi_bool recCommit( dbcapi_connection *conn )
+/*****************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_commit( conn );
+    writeConnRecord( OP_COMMIT, conn, start, ret );
+    return ret;
+}
+
+static dbcapi_bool recRollback( dbcapi_connection *conn )
+/*******************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_rollback( conn );
+    writeConnRecord( OP_ROLLBACK, conn, start, ret );
+    return ret;
+}
+
+static dbcapi_stmt *recPrepare( dbcapi_connection *conn, const char *sql )
+/************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_stmt *stmt = real.dbcapi_prepare( conn, sql );
+    unsigned conn_id = findConnection( conn );
+    recordWriter w;
+    w.putUInt( hashSQL( sql ) );
+    writeRecord( OP_PREPARE, conn_id, 0, start, addStmt( stmt, conn_id ), &w );
+    return stmt;
+}
+
+static dbcapi_stmt *recExecuteDirect( dbcapi_connection *conn, const char *sql )
+/******************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_stmt *stmt = real.dbcapi_execute_direct( conn, sql );
+    unsigned conn_id = findConnection( conn );
+    recordWriter w;
+    w.putUInt( hashSQL( sql ) );
+    writeRecord( OP_EXECUTE_DIRECT, conn_id, 0, start, addStmt( stmt, conn_id ), &w );
+    return stmt;
+}
+
+static void recFreeStmt( dbcapi_stmt *stmt )
+/******************************************/
+{
+    {
+	scoped_lock lock( record_mutex );
+	record_stmts.erase( stmt );
+    }
+    real.dbcapi_free_stmt( stmt );
+}
+
+static dbcapi_i32 recGetFunctionCode( dbcapi_stmt *stmt )
+/*******************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_i32 ret = real.dbcapi_get_function_code( stmt );
+    writeStmtRecord( OP_GET_FUNCTION_CODE, findStmt( stmt ), start, ret );
+    return ret;
+}
+
+static dbcapi_bool recSetQueryTimeout( dbcapi_stmt *stmt, dbcapi_i32 timeout )
+/****************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_set_query_timeout( stmt, timeout );
+    writeStmtRecord( OP_SET_QUERY_TIMEOUT, findStmt( stmt ), start, ret );
+    return ret;
+}
+
+static dbcapi_i32 recNumParams( dbcapi_stmt *stmt )
+/*************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_i32 ret = real.dbcapi_num_params( stmt );
+    writeStmtRecord( OP_NUM_PARAMS, findStmt( stmt ), start, ret );
+    return ret;
+}
+
+static dbcapi_bool recDescribeBindParam( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_bind_data *data )
+/****************************************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_describe_bind_param( stmt, index, data );
+    recordWriter w;
+    if( ret ) {
+	w.putUInt( data->direction );
+	w.putUInt( data->value.type );
+	w.putUInt( data->value.buffer_size );
+	w.putUInt( data->value.is_address ? 1 : 0 );
+	w.putString( data->name );
+    }
+    writeStmtRecord( OP_DESCRIBE_BIND_PARAM, findStmt( stmt ), start, ret, &w );
+    return ret;
+}
+
+static dbcapi_bool recGetBindParamInfo( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_bind_param_info *info )
+/*********************************************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_get_bind_param_info( stmt, index, info );
+    recordWriter w;
+    if( ret ) {
+	w.putString( info->name );
+	w.putUInt( info->direction );
+	w.putUInt( info->input_value.type );
+	w.putUInt( info->input_value.buffer_size );
+	w.putUInt( info->output_value.type );
+	w.putUInt( info->output_value.buffer_size );
+    }
+    writeStmtRecord( OP_GET_BIND_PARAM_INFO, findStmt( stmt ), start, ret, &w );
+    return ret;
+}
+
+static dbcapi_bool recBindParam( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_bind_data *data )
+/********************************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_bind_param( stmt, index, data );
+    recordedStmt *rs = findStmt( stmt );
+    if( ret && rs->id != 0 ) {
+	rs->params[index] = *data;
+    }
+    writeStmtRecord( OP_BIND_PARAM, rs, start, ret );
+    return ret;
+}
+
+static dbcapi_bool recSendParamData( dbcapi_stmt *stmt, dbcapi_u32 index, char *buffer, size_t size )
+/***************************************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_send_param_data( stmt, index, buffer, size );
+    writeStmtRecord( OP_SEND_PARAM_DATA, findStmt( stmt ), start, ret );
+    return ret;
+}
+
+static dbcapi_bool recReset( dbcapi_stmt *stmt )
+/**********************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_reset( stmt );
+    writeStmtRecord( OP_RESET, findStmt( stmt ), start, ret );
+    return ret;
+}
+
+static dbcapi_bool recSetBatchSize( dbcapi_stmt *stmt, dbcapi_u32 num_rows )
+/**************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_set_batch_size( stmt, num_rows );
+    recordedStmt *rs = findStmt( stmt );
+    if( ret && rs->id != 0 ) {
+	rs->batch_size = num_rows;
+    }
+    writeStmtRecord( OP_SET_BATCH_SIZE, rs, start, ret );
+    return ret;
+}
+
+static dbcapi_bool recExecute( dbcapi_stmt *stmt )
+/************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_execute( stmt );
+    recordedStmt *rs = findStmt( stmt );
+    recordWriter w;
+
+    // The values of output parameters; batches have none
+    if( ret && rs->batch_size <= 1 ) {
+	std::map<dbcapi_u32, dbcapi_bind_data>::iterator it;
+	for( it = rs->params.begin(); it != rs->params.end(); ++it ) {
+	    const dbcapi_bind_data &param = it->second;
+	    if( ( param.direction & DD_OUTPUT ) == 0 || param.value.buffer == NULL ) {
+		continue;
+	    }
+	    w.putUInt( it->first + 1 );
+	    putValue( w, param.value.type, param.value.buffer, param.value.buffer_size,
+		      param.value.length, param.value.is_null );
+	}
+    }
+    if( rs->id != 0 ) {
+	rs->cols.clear();
+    }
+    writeStmtRecord( OP_EXECUTE, rs, start, ret, &w );
+    return ret;
+}
+
+static dbcapi_bool recGetNextResult( dbcapi_stmt *stmt )
+/******************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_get_next_result( stmt );
+    recordedStmt *rs = findStmt( stmt );
+    if( rs->id != 0 ) {
+	rs->cols.clear();
+    }
+    writeStmtRecord( OP_GET_NEXT_RESULT, rs, start, ret );
+    return ret;
+}
+
+static dbcapi_i32 recAffectedRows( dbcapi_stmt *stmt )
+/****************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_i32 ret = real.dbcapi_affected_rows( stmt );
+    writeStmtRecord( OP_AFFECTED_ROWS, findStmt( stmt ), start, ret );
+    return ret;
+}
+
+static dbcapi_i32 recNumCols( dbcapi_stmt *stmt )
+/***********************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_i32 ret = real.dbcapi_num_cols( stmt );
+    writeStmtRecord( OP_NUM_COLS, findStmt( stmt ), start, ret );
+    return ret;
+}
+
+static dbcapi_bool recGetColumnInfo( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_column_info *info )
+/**************************************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_get_column_info( stmt, index, info );
+    recordWriter w;
+    if( ret ) {
+	w.putString( info->name );
+	w.putUInt( info->type );
+	w.putUInt( info->native_type );
+	w.putUInt( info->precision );
+	w.putUInt( info->scale );
+	w.putUInt( info->max_size );
+	w.putUInt( info->nullable ? 1 : 0 );
+	w.putString( info->table_name );
+	w.putString( info->owner_name );
+    }
+    writeStmtRecord( OP_GET_COLUMN_INFO, findStmt( stmt ), start, ret, &w );
+    return ret;
+}
+
+static dbcapi_bool recSetRowsetSize( dbcapi_stmt *stmt, dbcapi_u32 num_rows )
+/***************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_set_rowset_size( stmt, num_rows );
+    writeStmtRecord( OP_SET_ROWSET_SIZE, findStmt( stmt ), start, ret );
+    return ret;
+}
+
+static dbcapi_bool recBindColumn( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_data_value *value )
+/***********************************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_bind_column( stmt, index, value );
+    recordedStmt *rs = findStmt( stmt );
+    if( ret && rs->id != 0 ) {
+	rs->cols[index] = *value;
+    }
+    writeStmtRecord( OP_BIND_COLUMN, rs, start, ret );
+    return ret;
+}
+
+static dbcapi_bool recFetchNext( dbcapi_stmt *stmt )
+/**************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_fetch_next( stmt );
+    recordedStmt *rs = findStmt( stmt );
+    recordWriter w;
+
+    // The rowset that was written into the bound columns
+    if( ret && !rs->cols.empty() ) {
+	dbcapi_i32 rows = real.dbcapi_fetched_rows( stmt );
+	if( rows < 0 ) {
+	    rows = 0;
+	}
+	w.putUInt( rows );
+	w.putUInt( rs->cols.size() );
+	std::map<dbcapi_u32, dbcapi_data_value>::iterator it;
+	for( it = rs->cols.begin(); it != rs->cols.end(); ++it ) {
+	    const dbcapi_data_value &col = it->second;
+	    w.putUInt( it->first );
+	    for( dbcapi_i32 row = 0; row < rows; row++ ) {
+		putValue( w, col.type, col.buffer + row * col.buffer_size, col.buffer_size,
+			  col.length + row, col.is_null + row );
+	    }
+	}
+    }
+    writeStmtRecord( OP_FETCH_NEXT, rs, start, ret, &w );
+    return ret;
+}
+
+static dbcapi_i32 recFetchedRows( dbcapi_stmt *stmt )
+/***************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_i32 ret = real.dbcapi_fetched_rows( stmt );
+    writeStmtRecord( OP_FETCHED_ROWS, findStmt( stmt ), start, ret );
+    return ret;
+}
+
+static dbcapi_bool recGetColumn( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_data_value *value )
+/**********************************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_get_column( stmt, index, value );
+    recordWriter w;
+    if( ret ) {
+	putValue( w, value->type, value->buffer, 0, value->length, value->is_null );
+    }
+    writeStmtRecord( OP_GET_COLUMN, findStmt( stmt ), start, ret, &w );
+    return ret;
+}
+
+static dbcapi_i32 recGetData( dbcapi_stmt *stmt, dbcapi_u32 index, size_t offset, void *buffer, size_t size )
+/***********************************************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_i32 ret = real.dbcapi_get_data( stmt, index, offset, buffer, size );
+    recordWriter w;
+    if( ret > 0 ) {
+	w.putBytes( buffer, (size_t)ret );
+    }
+    writeStmtRecord( OP_GET_DATA, findStmt( stmt ), start, ret, &w );
+    return ret;
+}
+
+static dbcapi_bool recGetDataInfo( dbcapi_stmt *stmt, dbcapi_u32 index, dbcapi_data_info *info )
+/**********************************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_bool ret = real.dbcapi_get_data_info( stmt, index, info );
+    recordWriter w;
+    if( ret ) {
+	w.putUInt( info->type );
+	w.putUInt( info->is_null ? 1 : 0 );
+	w.putUInt( info->data_size );
+    }
+    writeStmtRecord( OP_GET_DATA_INFO, findStmt( stmt ), start, ret, &w );
+    return ret;
+}
+
+static dbcapi_i32 recError( dbcapi_connection *conn, char *buffer, size_t size )
+/******************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    dbcapi_i32 ret = real.dbcapi_error( conn, buffer, size );
+    recordWriter w;
+    w.putString( buffer != NULL && size > 0 ? buffer : NULL );
+    writeRecord( OP_ERROR, findConnection( conn ), 0, start, ret, &w );
+    return ret;
+}
+
+static size_t recSqlstate( dbcapi_connection *conn, char *buffer, size_t size )
+/*****************************************************************************/
+{
+    uint64_t start = uv_hrtime();
+    size_t ret = real.dbcapi_sqlstate( conn, buffer, size );
+    recordWriter w;
+    w.putString( buffer != NULL && size > 0 ? buffer : NULL );
+    writeRecord( OP_SQLSTATE, findConnection( conn ), 0, start, (int64_t)ret, &w );
+    return ret;
+}
+
+bool installApiRecorder( DBCAPIInterface *api, const char *path, std::string &errText )
+/*************************************************************************************/
+{
+    static bool mutex_initialized = false;
+
+    if( !mutex_initialized ) {
+	uv_mutex_init( &record_mutex );
+	atexit( flushAtExit );
+	mutex_initialized = true;
+    }
+    // The library may be loaded again after cleanAPI; keep appending
+    if( record_file == NULL ) {
+	record_file = fopen( path, "wb" );
+	if( record_file == NULL ) {
+	    errText = "Failed to create the DBCAPI recording ";
+	    errText += path;
+	    errText += ".";
+	    return false;
+	}
+	fwrite( RECORD_MAGIC, 1, RECORD_MAGIC_LEN, record_file );
+    }
+    real = *api;
+
+    api->dbcapi_fini = recFini;
+    api->dbcapi_new_connection = recNewConnection;
+    api->dbcapi_make_connection = recMakeConnection;
+    if( real.dbcapi_new_connection_ex != NULL ) {
+	api->dbcapi_new_connection_ex = recNewConnectionEx;
+    }
+    if( real.dbcapi_make_connection_ex != NULL ) {
+	api->dbcapi_make_connection_ex = recMakeConnectionEx;
+    }
+    api->dbcapi_free_connection = recFreeConnection;
+    api->dbcapi_connect = recConnect;
+    api->dbcapi_disconnect = recDisconnect;
+    api->dbcapi_set_clientinfo = recSetClientinfo;
+    api->dbcapi_get_clientinfo = recGetClientinfo;
+    api->dbcapi_set_autocommit = recSetAutocommit;
+    api->dbcapi_commit = recCommit;
+    api->dbcapi_rollback = recRollback;
+    api->dbcapi_prepare = recPrepare;
+    api->dbcapi_execute_direct = recExecuteDirect;
+    api->dbcapi_free_stmt = recFreeStmt;
+    api->dbcapi_get_function_code = recGetFunctionCode;
+    if( real.dbcapi_set_query_timeout != NULL ) {
+	api->dbcapi_set_query_timeout = recSetQueryTimeout;
+    }
+    api->dbcapi_num_params = recNumParams;
+    api->dbcapi_describe_bind_param = recDescribeBindParam;
+    api->dbcapi_get_bind_param_info = recGetBindParamInfo;
+    api->dbcapi_bind_param = recBindParam;
+    api->dbcapi_send_param_data = recSendParamData;
+    api->dbcapi_reset = recReset;
+    if( real.dbcapi_set_batch_size != NULL ) {
+	api->dbcapi_set_batch_size = recSetBatchSize;
+    }
+    api->dbcapi_execute = recExecute;
+    api->dbcapi_get_next_result = recGetNextResult;
+    api->dbcapi_affected_rows = recAffectedRows;
+    api->dbcapi_num_cols = recNumCols;
+    api->dbcapi_get_column_info = recGetColumnInfo;
+    if( real.dbcapi_set_rowset_size != NULL ) {
+	api->dbcapi_set_rowset_size = recSetRowsetSize;
+    }
+    if( real.dbcapi_bind_column != NULL ) {
+	api->dbcapi_bind_column = recBindColumn;
+    }
+    api->dbcapi_fetch_next = recFetchNext;
+    if( real.dbcapi_fetched_rows != NULL ) {
+	api->dbcapi_fetched_rows = recFetchedRows;
+    }
+    api->dbcapi_get_column = recGetColumn;
+    api->dbcapi_get_data = recGetData;
+    api->dbcapi_get_data_info = recGetDataInfo;
+    api->dbcapi_error = recError;
+    api->dbcapi_sqlstate = recSqlstate;
+    return true;
+}
+
+//
+// Replay
+//
+
+struct replayRecord
+{
+    unsigned char	op;
+    unsigned		stmt;
+    uint64_t		elapsed_ns;
+    int64_t		result;
+    const char *	payload;
+    size_t		payload_length;
+};
+
+struct replayValue
+{
+    std::string		data;
+    size_t		length;
+    dbcapi_bool		is_null;
+};
+
+struct replayConnection
+{
+    unsigned				id;
+    const std::vector<replayRecord> *	records;
+    size_t				next;
+    uv_mutex_t				mutex;
+    // Set once the calls no longer match the recording
+    std::string				diverged;
+    uint64_t				wait_ns;
+    std::map<std::string, std::string>	clientinfo;
+};
+
+struct replayStmt
+{
+    unsigned					id;
+    replayConnection *				conn;
+    std::map<dbcapi_u32, dbcapi_bind_data>	params;
+    std::map<dbcapi_u32, dbcapi_data_value>	cols;
+    // Values of the current row handed out by get_column
+    std::map<dbcapi_u32, replayValue>		values;
+    // Names handed out by get_column_info and the parameter descriptions
+    std::deque<std::string>			names;
+};
+
+static std::vector<char>			replay_data;
+static std::vector< std::vector<replayRecord> >	replay_streams;
+static double					replay_scale = 1.0;
+static uv_mutex_t				replay_mutex;
+static unsigned					replay_next_conn = 0;
+// Connections created but not connected yet
+static std::set<replayConnection*>		replay_opening;
+
+static const char *parallelOpenText =
+    "Connections were opened in parallel, e.g. by a connection pool. Replay matches "
+    "connections by the order they are created, so it only supports connections that "
+    "are opened one at a time.";
+
+/** Serializes the calls on a replayed connection and waits for their
+ * recorded time once the connection is unlocked.
+ */
+class replayCall
+{
+  public:
+    replayCall( replayConnection *conn_ ) : conn( conn_ )
+    {
+	uv_mutex_lock( &conn->mutex );
+    }
+    ~replayCall()
+    {
+	uint64_t wait = 0;
+	if( conn->wait_ns >= REPLAY_MIN_WAIT_NS ) {
+	    wait = conn->wait_ns;
+	    conn->wait_ns = 0;
+	}
+	uv_mutex_unlock( &conn->mutex );
+	if( wait > 0 ) {
+	    std::this_thread::sleep_for( std::chrono::nanoseconds( wait ) );
+	}
+    }
+
+  private:
+    replayConnection *conn;
+};
+
+static inline replayConnection *toReplay( dbcapi_connection *conn )
+/*****************************************************************/
+{
+    return reinterpret_cast<replayConnection*>( conn );
+}
+
+static inline replayStmt *toReplay( dbcapi_stmt *stmt )
+/*****************************************************/
+{
+    return reinterpret_cast<replayStmt*>( stmt );
+}
+
+static void diverge( replayConnection *conn, const char *reason, recordOp op )
+/****************************************************************************/
+{
+    std::ostringstream msg;
+    msg << "The DBCAPI calls differ from the recording: " << reason << " at call "
+	<< conn->next + 1 << " of connection " << conn->id << " (" << opNames[op] << ").";
+    conn->diverged = msg.str();
+}
+
+/** Returns the next record of conn if it is for op on stmt, which is 0
+ * for calls on the connection.
+ */
+static const replayRecord *nextRecord( replayConnection *conn, recordOp op, unsigned stmt = 0 )
+/*********************************************************************************************/
+{
+    if( !conn->diverged.empty() ) {
+	return NULL;
+    }
+    if( conn->next >= conn->records->size() ) {
+	diverge( conn, "the recording has no more calls", op );
+	return NULL;
+    }
+    const replayRecord &rec = (*conn->records)[conn->next];
+    if( rec.op != op || rec.stmt != stmt ) {
+	diverge( conn, rec.op != op ? "a different function was recorded"
+				    : "the call was recorded for another statement", op );
+	return NULL;
+    }
+    conn->next++;
+    conn->wait_ns += (uint64_t)( rec.elapsed_ns * replay_scale );
+    return &rec;
+}
+
+static bool getValue( recordReader &r, replayValue &value, dbcapi_data_type &type )
+/*********************************************************************************/
+{
+    size_t bytes;
+    const char *data;
+
+    type = (dbcapi_data_type)r.getUInt();
+    value.is_null = ( r.getUInt() != 0 );
+    value.length = 0;
+    value.data.clear();
+    if( !value.is_null ) {
+	value.length = (size_t)r.getUInt();
+	data = r.getBytes( bytes );
+	value.data.assign( data != NULL ? data : "", bytes );
+    }
+    return !r.failed;
+}
+
+/// Writes value into buffer, as a driver buffer of buffer_size bytes
+static void putBuffer( const replayValue &value, char *buffer, size_t buffer_size,
+		       size_t *length, dbcapi_bool *is_null )
+/*******************************************************************************/
+{
+    if( is_null != NULL ) {
+	*is_null = value.is_null;
+    }
+    if( length != NULL ) {
+	*length = value.length;
+    }
+    if( buffer != NULL && !value.is_null ) {
+	memcpy( buffer, value.data.data(),
+		value.data.size() < buffer_size ? value.data.size() : buffer_size );
+    }
+}
+
+static const char *keepName( replayStmt *stmt, recordReader &r )
+/**************************************************************/
+{
+    std::string name;
+    if( !r.getString( name ) ) {
+	return NULL;
+    }
+    stmt->names.push_back( name );
+    return stmt->names.back().c_str();
+}
+
+static dbcapi_bool repInit( const char *, dbcapi_u32 api_version, dbcapi_u32 *max_version )
+/*****************************************************************************************/
+{
+    if( max_version != NULL ) {
+	*max_version = api_version;
+    }
+    return 1;
+}
+
+static void repFini()
+/*******************/
+{
+}
+
+static dbcapi_connection *repNewConnection()
+/******************************************/
+{
+    static const std::vector<replayRecord> none;
+    replayConnection *conn = new replayConnection();
+
+    conn->next = 0;
+    conn->wait_ns = 0;
+    uv_mutex_init( &conn->mutex );
+
+    scoped_lock lock( replay_mutex );
+    conn->id = ++replay_next_conn;
+    conn->records = ( conn->id < replay_streams.size() ? &replay_streams[conn->id] : &none );
+    // The order in which connections that are opened at the same time are
+    // created differs from run to run, so their calls cannot be matched
+    if( !replay_opening.empty() ) {
+	conn->diverged = parallelOpenText;
+	for( std::set<replayConnection*>::iterator it = replay_opening.begin();
+	     it != replay_opening.end(); ++it ) {
+	    scoped_lock conn_lock( (*it)->mutex );
+	    (*it)->diverged = parallelOpenText;
+	}
+    }
+    replay_opening.insert( conn );
+    return reinterpret_cast<dbcapi_connection*>( conn );
+}
+
+static dbcapi_connection *repMakeConnection( void * )
+/***************************************************/
+{
+    dbcapi_connection *conn = repNewConnection();
+    // Wraps a connection that is already open
+    scoped_lock lock( replay_mutex );
+    replay_opening.erase( toReplay( conn ) );
+    return conn;
+}
+
+static void repFreeConnection( dbcapi_connection *dbcapi_conn )
+/*************************************************************/
+{
+    replayConnection *conn = toReplay( dbcapi_conn );
+    if( conn != NULL ) {
+	{
+	    scoped_lock lock( replay_mutex );
+	    replay_opening.erase( conn );
+	}
+	uv_mutex_destroy( &conn->mutex );
+	delete conn;
+    }
+}
+
+static dbcapi_bool replayConnResult( dbcapi_connection *dbcapi_conn, recordOp op )
+/********************************************************************************/
+{
+    replayConnection *conn = toReplay( dbcapi_conn );
+    replayCall call( conn );
+    const replayRecord *rec = nextRecord( conn, op );
+    return ( rec != NULL ? (dbcapi_bool)rec->result : 0 );
+}
+
+static dbcapi_bool repConnect( dbcapi_connection *conn, const char * )
+/********************************************************************/
+{
+    dbcapi_bool ok = replayConnResult( conn, OP_CONNECT );
+    scoped_lock lock( replay_mutex );
+    replay_opening.erase( toReplay( conn ) );
+    return ok;
+}
+
+static dbcapi_bool repDisconnect( dbcapi_connection *conn )
+/*********************************************************/
+{
+    return replayConnResult( conn, OP_DISCONNECT );
+}
+
+static dbcapi_bool repSetClientinfo( dbcapi_connection *conn, const char *, const char * )
+/****************************************************************************************/
+{
+    return replayConnResult( conn, OP_SET_CLIENTINFO );
+}
+
+static const char *repGetClientinfo( dbcapi_connection *dbcapi_conn, const char *property )
+/*****************************************************************************************/
+{
+    replayConnection *conn = toReplay( dbcapi_conn );
+    replayCall call( conn );
+    const replayRecord *rec = nextRecord( conn, OP_GET_CLIENTINFO );
+    std::string value;
+
+    if( rec == NULL ) {
+	return NULL;
+    }
+    recordReader r( rec->payload, rec->payload_length );
+    if( !r.getString( value ) ) {
+	return NULL;
+    }
+    std::string &kept = conn->clientinfo[property != NULL ? property : ""];
+    kept = value;
+    return kept.c_str();
+}
+
+static dbcapi_bool repSetAutocommit( dbcapi_connection *conn, dbcapi_bool )
+/*************************************************************************/
+{
+    return replayConnResult( conn, OP_SET_AUTOCOMMIT );
+}
+
+static dbcapi_bool repCommit( dbcapi_connection *conn )
+/*****************************************************/
+{
+    return replayConnResult( conn, OP_COMMIT );
+}
+
+static dbcapi_bool repRollback( dbcapi_connection *conn )
+/*******************************************************/
+{
+    return replayConnResult( conn, OP_ROLLBACK );
+}
+
+static dbcapi_stmt *replayNewStmt( dbcapi_connection *dbcapi_conn, const char *sql, recordOp op )
+/***********************************************************************************************/
+{
+    replayConnection *conn = toReplay( dbcapi_conn );
+    replayCall call( conn );
+    const replayRecord *rec = nextRecord( conn, op );
+
+    if( rec == NULL || rec->result == 0 ) {
+	return NULL;
+    }
+    recordReader r( rec->payload, rec->payload_length );
+    if( r.getUInt() != hashSQL( sql ) ) {
+	conn->next--;
+	diverge( conn, "different SQL was recorded", op );
+	return NULL;
+    }
+    replayStmt *stmt = new replayStmt();
+    stmt->id = (unsigned)rec->result;
+    stmt->conn = conn;
+    return reinterpret_cast<dbcapi_stmt*>( stmt );
+}
+
+static dbcapi_stmt *repPrepare( dbcapi_connection *conn, const char *sql )
+/************************************************************************/
+{
+    return replayNewStmt( conn, sql, OP_PREPARE );
+}
+
+static dbcapi_stmt *repExecuteDirect( dbcapi_connection *conn, const char *sql )
+/******************************************************************************/
+{
+    return replayNewStmt( conn, sql, OP_EXECUTE_DIRECT );
+}
+
+static void repFreeStmt( dbcapi_stmt *stmt )
+/******************************************/
+{
+    delete toReplay( stmt );
+}
+
+static int64_t replayStmtResult( dbcapi_stmt *dbcapi_stmt, recordOp op, int64_t failed )
+/**************************************************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, op, stmt->id );
+    return ( rec != NULL ? rec->result : failed );
+}
+
+static dbcapi_i32 repGetFunctionCode( dbcapi_stmt *stmt )
+/*******************************************************/
+{
+    return (dbcapi_i32)replayStmtResult( stmt, OP_GET_FUNCTION_CODE, 0 );
+}
+
+static dbcapi_bool repSetQueryTimeout( dbcapi_stmt *stmt, dbcapi_i32 )
+/********************************************************************/
+{
+    return (dbcapi_bool)replayStmtResult( stmt, OP_SET_QUERY_TIMEOUT, 0 );
+}
+
+static dbcapi_i32 repNumParams( dbcapi_stmt *stmt )
+/*************************************************/
+{
+    return (dbcapi_i32)replayStmtResult( stmt, OP_NUM_PARAMS, -1 );
+}
+
+static dbcapi_bool repDescribeBindParam( dbcapi_stmt *dbcapi_stmt, dbcapi_u32, dbcapi_bind_data *data )
+/*****************************************************************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, OP_DESCRIBE_BIND_PARAM, stmt->id );
+
+    if( rec == NULL || rec->result == 0 ) {
+	return 0;
+    }
+    recordReader r( rec->payload, rec->payload_length );
+    memset( data, 0, sizeof( dbcapi_bind_data ) );
+    data->direction = (dbcapi_data_direction)r.getUInt();
+    data->value.type = (dbcapi_data_type)r.getUInt();
+    data->value.buffer_size = (size_t)r.getUInt();
+    data->value.is_address = ( r.getUInt() != 0 );
+    data->name = (char *)keepName( stmt, r );
+    return 1;
+}
+
+static dbcapi_bool repGetBindParamInfo( dbcapi_stmt *dbcapi_stmt, dbcapi_u32, dbcapi_bind_param_info *info )
+/**********************************************************************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, OP_GET_BIND_PARAM_INFO, stmt->id );
+
+    if( rec == NULL || rec->result == 0 ) {
+	return 0;
+    }
+    recordReader r( rec->payload, rec->payload_length );
+    memset( info, 0, sizeof( dbcapi_bind_param_info ) );
+    info->name = (char *)keepName( stmt, r );
+    info->direction = (dbcapi_data_direction)r.getUInt();
+    info->input_value.type = (dbcapi_data_type)r.getUInt();
+    info->input_value.buffer_size = (size_t)r.getUInt();
+    info->output_value.type = (dbcapi_data_type)r.getUInt();
+    info->output_value.buffer_size = (size_t)r.getUInt();
+    return 1;
+}
+
+static dbcapi_bool repBindParam( dbcapi_stmt *dbcapi_stmt, dbcapi_u32 index, dbcapi_bind_data *data )
+/***************************************************************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, OP_BIND_PARAM, stmt->id );
+
+    if( rec == NULL || rec->result == 0 ) {
+	return 0;
+    }
+    stmt->params[index] = *data;
+    return 1;
+}
+
+static dbcapi_bool repSendParamData( dbcapi_stmt *stmt, dbcapi_u32, char *, size_t )
+/**********************************************************************************/
+{
+    return (dbcapi_bool)replayStmtResult( stmt, OP_SEND_PARAM_DATA, 0 );
+}
+
+static dbcapi_bool repReset( dbcapi_stmt *stmt )
+/**********************************************/
+{
+    return (dbcapi_bool)replayStmtResult( stmt, OP_RESET, 0 );
+}
+
+static dbcapi_bool repSetBatchSize( dbcapi_stmt *stmt, dbcapi_u32 )
+/*****************************************************************/
+{
+    return (dbcapi_bool)replayStmtResult( stmt, OP_SET_BATCH_SIZE, 0 );
+}
+
+static dbcapi_bool repExecute( dbcapi_stmt *dbcapi_stmt )
+/*******************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, OP_EXECUTE, stmt->id );
+
+    stmt->cols.clear();
+    stmt->values.clear();
+    if( rec == NULL || rec->result == 0 ) {
+	return 0;
+    }
+    recordReader r( rec->payload, rec->payload_length );
+    replayValue value;
+    dbcapi_data_type type;
+    while( !r.atEnd() && !r.failed ) {
+	dbcapi_u32 index = (dbcapi_u32)r.getUInt() - 1;
+	if( !getValue( r, value, type ) ) {
+	    break;
+	}
+	std::map<dbcapi_u32, dbcapi_bind_data>::iterator it = stmt->params.find( index );
+	if( it != stmt->params.end() ) {
+	    dbcapi_data_value &v = it->second.value;
+	    putBuffer( value, v.buffer, v.buffer_size, v.length, v.is_null );
+	}
+    }
+    return 1;
+}
+
+static dbcapi_bool repGetNextResult( dbcapi_stmt *dbcapi_stmt )
+/*************************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    stmt->cols.clear();
+    stmt->values.clear();
+    return (dbcapi_bool)replayStmtResult( dbcapi_stmt, OP_GET_NEXT_RESULT, 0 );
+}
+
+static dbcapi_i32 repAffectedRows( dbcapi_stmt *stmt )
+/****************************************************/
+{
+    return (dbcapi_i32)replayStmtResult( stmt, OP_AFFECTED_ROWS, -1 );
+}
+
+static dbcapi_i32 repNumCols( dbcapi_stmt *stmt )
+/***********************************************/
+{
+    return (dbcapi_i32)replayStmtResult( stmt, OP_NUM_COLS, -1 );
+}
+
+static dbcapi_bool repGetColumnInfo( dbcapi_stmt *dbcapi_stmt, dbcapi_u32, dbcapi_column_info *info )
+/***************************************************************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, OP_GET_COLUMN_INFO, stmt->id );
+
+    if( rec == NULL || rec->result == 0 ) {
+	return 0;
+    }
+    recordReader r( rec->payload, rec->payload_length );
+    memset( info, 0, sizeof( dbcapi_column_info ) );
+    info->name = (char *)keepName( stmt, r );
+    info->type = (dbcapi_data_type)r.getUInt();
+    info->native_type = (dbcapi_native_type)r.getUInt();
+    info->precision = (unsigned short)r.getUInt();
+    info->scale = (unsigned short)r.getUInt();
+    info->max_size = (size_t)r.getUInt();
+    info->nullable = ( r.getUInt() != 0 );
+    info->table_name = (char *)keepName( stmt, r );
+    info->owner_name = (char *)keepName( stmt, r );
+    return 1;
+}
+
+static dbcapi_bool repSetRowsetSize( dbcapi_stmt *stmt, dbcapi_u32 )
+/******************************************************************/
+{
+    return (dbcapi_bool)replayStmtResult( stmt, OP_SET_ROWSET_SIZE, 0 );
+}
+
+static dbcapi_bool repBindColumn( dbcapi_stmt *dbcapi_stmt, dbcapi_u32 index, dbcapi_data_value *value )
+/******************************************************************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, OP_BIND_COLUMN, stmt->id );
+
+    if( rec == NULL || rec->result == 0 ) {
+	return 0;
+    }
+    stmt->cols[index] = *value;
+    return 1;
+}
+
+static dbcapi_bool repFetchNext( dbcapi_stmt *dbcapi_stmt )
+/*********************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, OP_FETCH_NEXT, stmt->id );
+
+    stmt->values.clear();
+    if( rec == NULL || rec->result == 0 ) {
+	return 0;
+    }
+    if( rec->payload_length == 0 ) {
+	return 1;
+    }
+    recordReader r( rec->payload, rec->payload_length );
+    size_t rows = (size_t)r.getUInt();
+    size_t num_cols = (size_t)r.getUInt();
+    replayValue value;
+    dbcapi_data_type type;
+    for( size_t i = 0; i < num_cols && !r.failed; i++ ) {
+	std::map<dbcapi_u32, dbcapi_data_value>::iterator it = stmt->cols.find( (dbcapi_u32)r.getUInt() );
+	if( it == stmt->cols.end() ) {
+	    stmt->conn->next--;
+	    diverge( stmt->conn, "the recorded rowset has columns that are not bound", OP_FETCH_NEXT );
+	    return 0;
+	}
+	dbcapi_data_value &col = it->second;
+	for( size_t row = 0; row < rows && getValue( r, value, type ); row++ ) {
+	    putBuffer( value, col.buffer + row * col.buffer_size, col.buffer_size,
+		       col.length + row, col.is_null + row );
+	}
+    }
+    return 1;
+}
+
+static dbcapi_i32 repFetchedRows( dbcapi_stmt *stmt )
+/***************************************************/
+{
+    return (dbcapi_i32)replayStmtResult( stmt, OP_FETCHED_ROWS, -1 );
+}
+
+static dbcapi_bool repGetColumn( dbcapi_stmt *dbcapi_stmt, dbcapi_u32 index, dbcapi_data_value *buffer )
+/******************************************************************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, OP_GET_COLUMN, stmt->id );
+
+    if( rec == NULL || rec->result == 0 ) {
+	return 0;
+    }
+    recordReader r( rec->payload, rec->payload_length );
+    replayValue &value = stmt->values[index];
+    dbcapi_data_type type;
+    getValue( r, value, type );
+    buffer->buffer = (char *)value.data.data();
+    buffer->buffer_size = value.data.size();
+    buffer->length = &value.length;
+    buffer->is_null = &value.is_null;
+    buffer->type = type;
+    buffer->is_address = 0;
+    return 1;
+}
+
+static dbcapi_i32 repGetData( dbcapi_stmt *dbcapi_stmt, dbcapi_u32, size_t, void *buffer, size_t size )
+/*****************************************************************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, OP_GET_DATA, stmt->id );
+
+    if( rec == NULL ) {
+	return -1;
+    }
+    if( rec->result > 0 ) {
+	recordReader r( rec->payload, rec->payload_length );
+	size_t length;
+	const char *data = r.getBytes( length );
+	if( data != NULL ) {
+	    memcpy( buffer, data, length < size ? length : size );
+	}
+    }
+    return (dbcapi_i32)rec->result;
+}
+
+static dbcapi_bool repGetDataInfo( dbcapi_stmt *dbcapi_stmt, dbcapi_u32, dbcapi_data_info *info )
+/************************************************************************************************/
+{
+    replayStmt *stmt = toReplay( dbcapi_stmt );
+    replayCall call( stmt->conn );
+    const replayRecord *rec = nextRecord( stmt->conn, OP_GET_DATA_INFO, stmt->id );
+
+    if( rec == NULL || rec->result == 0 ) {
+	return 0;
+    }
+    recordReader r( rec->payload, rec->payload_length );
+    info->type = (dbcapi_data_type)r.getUInt();
+    info->is_null = ( r.getUInt() != 0 );
+    info->data_size = (size_t)r.getUInt();
+    return 1;
+}
+
+static void copyString( const std::string &str, char *buffer, size_t size )
+/*************************************************************************/
+{
+    if( buffer == NULL || size == 0 ) {
+	return;
+    }
+    size_t length = ( str.size() < size - 1 ? str.size() : size - 1 );
+    memcpy( buffer, str.data(), length );
+    buffer[length] = '\0';
+}
+
+static dbcapi_i32 repError( dbcapi_connection *dbcapi_conn, char *buffer, size_t size )
+/*************************************************************************************/
+{
+    replayConnection *conn = toReplay( dbcapi_conn );
+    replayCall call( conn );
+    std::string msg;
+
+    if( conn->diverged.empty() ) {
+	const replayRecord *rec = nextRecord( conn, OP_ERROR );
+	if( rec != NULL ) {
+	    recordReader r( rec->payload, rec->payload_length );
+	    r.getString( msg );
+	    copyString( msg, buffer, size );
+	    return (dbcapi_i32)rec->result;
+	}
+    }
+    copyString( conn->diverged, buffer, size );
+    return JS_ERR_REPLAY_DIVERGED;
+}
+
+static size_t repSqlstate( dbcapi_connection *dbcapi_conn, char *buffer, size_t size )
+/************************************************************************************/
+{
+    replayConnection *conn = toReplay( dbcapi_conn );
+    replayCall call( conn );
+    std::string state = "HY000";
+
+    if( conn->diverged.empty() ) {
+	const replayRecord *rec = nextRecord( conn, OP_SQLSTATE );
+	if( rec != NULL ) {
+	    recordReader r( rec->payload, rec->payload_length );
+	    r.getString( state );
+	    copyString( state, buffer, size );
+	    return (size_t)rec->result;
+	}
+    }
+    copyString( state, buffer, size );
+    return state.size() + 1;
+}
+
+static void repClearError( dbcapi_connection * )
+/**********************************************/
+{
+}
+
+static void repCancel( dbcapi_connection * )
+/******************************************/
+{
+}
+
+static dbcapi_bool repRegisterWarningCallback( dbcapi_connection *, DBCAPI_CALLBACK_PARM, void * )
+/***********************************************************************************************/
+{
+    return 1;
+}
+
+static bool loadReplay( const char *path, std::string &errText )
+/**************************************************************/
+{
+    FILE *file = fopen( path, "rb" );
+    char chunk[64 * 1024];
+    size_t read;
+
+    if( file == NULL ) {
+	errText = "Failed to open the DBCAPI recording ";
+	errText += path;
+	errText += ".";
+	return false;
+    }
+    replay_data.clear();
+    while( ( read = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 ) {
+	replay_data.insert( replay_data.end(), chunk, chunk + read );
+    }
+    fclose( file );
+
+    errText = "The DBCAPI recording ";
+    errText += path;
+    errText += " is damaged.";
+    if( replay_data.size() < RECORD_MAGIC_LEN ||
+	memcmp( &replay_data[0], RECORD_MAGIC, RECORD_MAGIC_LEN ) != 0 ) {
+	return false;
+    }
+
+    replay_streams.clear();
+    recordReader r( &replay_data[0] + RECORD_MAGIC_LEN, replay_data.size() - RECORD_MAGIC_LEN );
+    while( !r.atEnd() ) {
+	replayRecord rec;
+	rec.op = (unsigned char)r.getUInt();
+	unsigned conn = (unsigned)r.getUInt();
+	rec.stmt = (unsigned)r.getUInt();
+	rec.elapsed_ns = r.getUInt();
+	rec.result = r.getInt();
+	rec.payload = r.getBytes( rec.payload_length );
+	if( r.failed || rec.op == 0 || rec.op >= OP_COUNT ) {
+	    return false;
+	}
+	if( conn >= replay_streams.size() ) {
+	    replay_streams.resize( conn + 1 );
+	}
+	replay_streams[conn].push_back( rec );
+    }
+    errText.clear();
+    return true;
+}
+
+bool initializeApiReplay( DBCAPIInterface *api, const char *path, const char *scale,
+			  std::string &errText )
+/*********************************************************************************/
+{
+    static bool mutex_initialized = false;
+
+    if( !mutex_initialized ) {
+	uv_mutex_init( &replay_mutex );
+	mutex_initialized = true;
+    }
+    memset( api, 0, sizeof( *api ) );
+    // The interface is set up again after cleanAPI; the connections made
+    // from then on continue where the earlier ones stopped
+    if( replay_data.empty() && !loadReplay( path, errText ) ) {
+	return false;
+    }
+    replay_scale = ( scale != NULL && scale[0] != '\0' ? strtod( scale, NULL ) : 1.0 );
+    if( replay_scale < 0 ) {
+	replay_scale = 0;
+    }
+
+    api->dbcapi_init = repInit;
+    api->dbcapi_fini = repFini;
+    api->dbcapi_new_connection = repNewConnection;
+    api->dbcapi_make_connection = repMakeConnection;
+    api->dbcapi_free_connection = repFreeConnection;
+    api->dbcapi_connect = repConnect;
+    api->dbcapi_disconnect = repDisconnect;
+    api->dbcapi_set_clientinfo = repSetClientinfo;
+    api->dbcapi_get_clientinfo = repGetClientinfo;
+    api->dbcapi_set_autocommit = repSetAutocommit;
+    api->dbcapi_commit = repCommit;
+    api->dbcapi_rollback = repRollback;
+    api->dbcapi_prepare = repPrepare;
+    api->dbcapi_execute_direct = repExecuteDirect;
+    api->dbcapi_free_stmt = repFreeStmt;
+    api->dbcapi_get_function_code = repGetFunctionCode;
+    api->dbcapi_set_query_timeout = repSetQueryTimeout;
+    api->dbcapi_num_params = repNumParams;
+    api->dbcapi_describe_bind_param = repDescribeBindParam;
+    api->dbcapi_get_bind_param_info = repGetBindParamInfo;
+    api->dbcapi_bind_param = repBindParam;
+    api->dbcapi_send_param_data = repSendParamData;
+    api->dbcapi_reset = repReset;
+    api->dbcapi_set_batch_size = repSetBatchSize;
+    api->dbcapi_execute = repExecute;
+    api->dbcapi_get_next_result = repGetNextResult;
+    api->dbcapi_affected_rows = repAffectedRows;
+    api->dbcapi_num_cols = repNumCols;
+    api->dbcapi_get_column_info = repGetColumnInfo;
+    api->dbcapi_set_rowset_size = repSetRowsetSize;
+    api->dbcapi_bind_column = repBindColumn;
+    api->dbcapi_fetch_next = repFetchNext;
+    api->dbcapi_fetched_rows = repFetchedRows;
+    api->dbcapi_get_column = repGetColumn;
+    api->dbcapi_get_data = repGetData;
+    api->dbcapi_get_data_info = repGetDataInfo;
+    api->dbcapi_error = repError;
+    api->dbcapi_sqlstate = repSqlstate;
+    api->dbcapi_clear_error = repClearError;
+    api->dbcapi_cancel = repCancel;
+    api->dbcapi_register_warning_callback = repRegisterWarningCallback;
+    api->initialized = 1;
+    return true;
+}
@@ -0,0 +1,58 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include <map>
+
+using namespace v8;
+
+/** A JavaScript function kept for each isolate the addon is loaded into,
+ * e.g. a class constructor. Main and worker threads each get their own.
+ * @internal
+ */
+class perIsolateFunction
+{
+  public:
+    perIsolateFunction();
+
+    void Reset(Isolate *isolate, Local<Function> fn);
+    /// Must be called inside a HandleScope.
+    Local<Function> Get(Isolate *isolate);
+    void Clear(Isolate *isolate);
+
+    /// Clears the functions of isolate in all instances.
+    static void ClearAll(Isolate *isolate);
+
+  private:
+    uv_mutex_t mutex;
+    std::map<Isolate *, Persistent<Function> *> functions;
+};
+
+/** State of the addon in one isolate.
+ * @internal
+ */
+struct addonContext
+{
+    Isolate			*isolate;
+    uv_loop_t			*loop;
+    /// Set when the client library exports dbcapi_init_ex, or NULL.
+    dbcapi_interface_context	*dbcapi_ctx;
+};
+
+/// Creates the state for isolate, or returns the existing one.
+addonContext *createAddonContext(Isolate *isolate);
+addonContext *getAddonContext(Isolate *isolate);
+void destroyAddonContext(Isolate *isolate);
+
+/// Returns the event loop of the isolate's thread.
+uv_loop_t *getEventLoop(Isolate *isolate);
+
+/** The isolate that created a client library context, and every Connection
+ * and pool of that isolate, hold a reference to it. The context is
+ * finalized with dbcapi_fini_ex when the last one is released, so it is
+ * never finalized under connections that still use it. ctx may be NULL.
+ */
+void retainDbcapiContext(dbcapi_interface_context *ctx);
+void releaseDbcapiContext(dbcapi_interface_context *ctx);
+
+/// Creates a connection in ctx if the client library supports contexts.
+dbcapi_connection *newConnection(dbcapi_interface_context *ctx);
@@ -0,0 +1,68 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include <stdint.h>
+
+using namespace v8;
+
+struct resultBinding;
+class memAccount;
+
+/** Result of a query in columnar form.
+ *
+ * The rows are fetched on a worker thread into one buffer per column. The
+ * JavaScript result holds a copy of each buffer in an ArrayBuffer, so it
+ * can be handed to another thread with postMessage and a transfer list.
+ * Fixed width columns are stored as Int32, Float64 or Uint8 (booleans)
+ * values, with 0 in NULL rows. String and binary columns are stored as the
+ * concatenated bytes plus rowCount + 1 Uint32 offsets. Every column has a
+ * Uint8 NULL indicator per row.
+ * @internal
+ */
+class columnarResult
+{
+  public:
+    enum columnFormat
+    {
+	CF_INT32,
+	CF_FLOAT64,
+	CF_BOOLEAN,
+	CF_STRING,
+	CF_BINARY
+    };
+
+    struct column
+    {
+	std::string			name;
+	dbcapi_native_type		native_type;
+	columnFormat			format;
+	std::vector<char>		values;
+	std::vector<uint32_t>		offsets;
+	std::vector<unsigned char>	nulls;
+    };
+
+    columnarResult();
+
+    /// Fetches all rows of an executed statement. Runs on a worker thread
+    /// with the connection's conn_mutex held. If binding is given, the rows
+    /// of repeated executes of the statement are appended. If mem is given,
+    /// the column buffers are charged to it and the fetch fails once a
+    /// memory limit is exceeded.
+    bool fetch( dbcapi_stmt *stmt, resultBinding *binding = NULL, memAccount *mem = NULL );
+
+    /// Builds the JavaScript result and frees the native buffers. Must be
+    /// called inside a HandleScope.
+    Local<Object> toObject( Isolate *isolate );
+
+    /// Number of rows changed by a DML statement, or -1 for a query.
+    int			rows_affected;
+    size_t		num_rows;
+    std::vector<column>	columns;
+    /// Start row of each group and num_rows at the end, or empty. Set by
+    /// Statement::execMany, which fetches one group per parameter set.
+    std::vector<uint32_t> groups;
+
+  private:
+    bool appendValue( column &col, const dbcapi_data_value &value );
+    int64_t bufferBytes() const;
+};
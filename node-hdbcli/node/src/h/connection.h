@@ -7,25 +7,86 @@ using namespace node;
 #include "nodever_cover.h"
 
 class Connection;
+class Pool;
 
-struct warningCallbackBaton {
-    Persistent<Function> 	callback;
-    bool                        callback_required;
-    bool 			err;
+struct warningRecord {
+    warningRecord 		*next;
     int                         error_code;
     std::string 		error_msg;
     std::string                 sql_state;
+};
+
+/** Delivers the warnings of a connection to its warning callback.
+ *
+ * DBCAPI reports warnings on whatever thread runs the call. Each warning is
+ * pushed onto a lock-free list and the loop is woken with uv_async_send;
+ * all warnings that arrived since the last wake-up are passed to the
+ * callback in one call. The baton lives until its async handle is closed.
+ * @internal
+ */
+struct warningCallbackBaton {
+    Persistent<Function> 	callback;
+    uv_async_t			async;
+    std::atomic<warningRecord*>	head;
     Connection 			*obj;
 
     warningCallbackBaton() {
         obj = NULL;
-        err = false;
-        callback_required = true;
+        head = NULL;
     }
 
     ~warningCallbackBaton() {
         obj = NULL;
         callback.Reset();
+        warningRecord *rec = head.exchange(NULL);
+        while (rec != NULL) {
+            warningRecord *next = rec->next;
+            delete rec;
+            rec = next;
+        }
+    }
+};
+
+/// One operation reported to a trace callback. @internal
+struct traceRecord {
+    traceRecord			*next;
+    const char			*operation;
+    uint64_t			sql_hash;
+    int				function_code;
+    int				error_code;
+    double			rows;
+    double			bytes;
+    int				bind_count;
+    uint64_t			phase_ns[PHASE_COUNT];
+};
+
+/** Delivers the trace events of a connection to its trace callback.
+ *
+ * Works like warningCallbackBaton: events are pushed onto a lock-free list
+ * as operations complete and handed to the callback in batches, once per
+ * wake-up of the loop.
+ * @internal
+ */
+struct traceCallbackBaton {
+    Persistent<Function> 	callback;
+    uv_async_t			async;
+    std::atomic<traceRecord*>	head;
+    Connection 			*obj;
+
+    traceCallbackBaton() {
+        obj = NULL;
+        head = NULL;
+    }
+
+    ~traceCallbackBaton() {
+        obj = NULL;
+        callback.Reset();
+        traceRecord *rec = head.exchange(NULL);
+        while (rec != NULL) {
+            traceRecord *next = rec->next;
+            delete rec;
+            rec = next;
+        }
     }
 };
 
@@ -166,6 +227,16 @@ class Connection : public ObjectWrap
     /// @internal
     static NODE_API_FUNC( NewInstance );
 
+    /** Wraps a connected handle lent out by pool in a new Connection
+     * object.
+     * @internal
+     */
+    static void CreatePooledInstance( Isolate *isolate,
+				      dbcapi_connection *conn,
+				      Pool *pool,
+				      Local<Object> poolObj,
+				      Persistent<Object> &obj );
+
   private:
     /// @internal
     Connection( const FunctionCallbackInfo<Value> &args );
@@ -173,7 +244,7 @@ class Connection : public ObjectWrap
     ~Connection();
 
     /// @internal
-    static Persistent<Function> constructor;
+    static perIsolateFunction constructor;
 
     /// @internal
     static void noParamAfter( uv_work_t *req );
@@ -341,10 +412,12 @@ class Connection : public ObjectWrap
      * client.disconnect()
      * </pre></p>
      *
-     * @fn Result Connection::exec( String sql, Array params, Function callback )
+     * @fn Result Connection::exec( String sql, Array params, Object options, Function callback )
      *
      * @param sql The SQL statement to be executed. ( type: String )
      * @param params Optional array of bind parameters. ( type: Array )
+     * @param options Optional options. The timeout property sets the
+     * query timeout in seconds. ( type: Object )
      * @param callback The optional callback function. ( type: Function )
      *
      * @return If no callback is specified, the result is returned.
@@ -352,6 +425,55 @@ class Connection : public ObjectWrap
      */
     static NODE_API_FUNC( exec );
 
+    /** Executes several statements in one request.
+     *
+     * Each element of items is an Object with either a sql property (a
+     * String) or a stmt property (a Statement of this connection), and an
+     * optional params property (an Array of bind parameters). The
+     * statements run one after another on a single thread of the database
+     * thread pool, without other requests of the connection in between, so
+     * that a sequence of short statements costs one thread pool round trip
+     * instead of one per statement. LOB parameters sent with
+     * sendParameterData are not supported.
+     *
+     * If the stopOnError option is true, the statements after the first one
+     * that fails are not executed. The callback function is of the form:
+     *
+     * <p><pre>
+     * function( err, results )
+     * {
+     *
+     * };
+     * </pre></p>
+     *
+     * where err is the first error, if any, and results is an Array with
+     * the result of each executed statement, as for exec. The entry of a
+     * failed statement is its error, which has an index property.
+     *
+     * <p><pre>
+     * client.pipeline( [ { sql: "INSERT INTO T VALUES( ? )", params: [ 1 ] },
+     *                    { stmt: update, params: [ 1 ] },
+     *                    { sql: "SELECT COUNT(*) FROM T" } ],
+     *                  { stopOnError: true },
+     *                  function( err, results ) {
+     *                      console.log( results[2] );
+     *                  } );
+     * </pre></p>
+     *
+     * @fn Connection::pipeline( Array items, Object options, Function callback )
+     *
+     * @param items The statements to be executed. ( type: Array )
+     * @param options Optional options. ( type: Object )
+     * @param callback The callback function. ( type: Function )
+     *
+     */
+    static NODE_API_FUNC( pipeline );
+
+    /// @internal
+    static void pipelineWork( uv_work_t *req );
+    /// @internal
+    static void pipelineAfter( uv_work_t *req );
+
     /** Prepares the specified SQL statement.
      *
      * This method prepares a SQL statement and returns a Statement object
@@ -380,9 +502,11 @@ class Connection : public ObjectWrap
      * client.disconnect();
      * </pre></p>
      *
-     * @fn Statement Connection::prepare( String sql, Function callback )
+     * @fn Statement Connection::prepare( String sql, Object options, Function callback )
      *
      * @param sql The SQL statement to be executed. ( type: String )
+     * @param options Optional options. The timeout property sets the
+     * default query timeout in seconds for executes of the statement. ( type: Object )
      * @param callback The optional callback function. ( type: Function )
      *
      * @return If no callback is specified, a Statement object is returned.
@@ -518,23 +642,255 @@ class Connection : public ObjectWrap
     */
     static NODE_API_FUNC(getClientInfo);
 
+    /** Enables the statement cache used by exec and sets its size.
+    *
+    * When the cache is enabled, statements run through Connection::exec
+    * are kept prepared, keyed by their SQL text, and reused by later calls
+    * with the same SQL. The least recently used statement is dropped once
+    * the cache is full. A size of 0 (the default) disables the cache and
+    * drops all cached statements.
+    *
+    * <p><pre>
+    * var hana = require( '@sap/hana-client' );
+    * var client = hana.createConnection();
+    * client.connect( "serverNode=myserver;uid=system;pwd=manager" )
+    * client.setStatementCacheSize( 50 );
+    * result = client.exec( "SELECT * FROM Customers WHERE ID = ?", [101] );
+    * result = client.exec( "SELECT * FROM Customers WHERE ID = ?", [102] );
+    * console.log( client.getStatementCacheStats() );
+    * client.disconnect();
+    * </pre></p>
+    *
+    * @fn Connection::setStatementCacheSize( Integer size )
+    *
+    * @param size The maximum number of cached statements. ( type: Integer )
+    *
+    */
+    static NODE_API_FUNC(setStatementCacheSize);
+
+    /** Cancels the statement currently executing on the connection.
+    *
+    * This method can be called while an asynchronous exec, execQuery,
+    * execBatch or fetch is blocked on the server; the cancelled operation
+    * completes with an error. It does not wait for the connection to
+    * become idle.
+    *
+    * <p><pre>
+    * var hana = require( '@sap/hana-client' );
+    * var client = hana.createConnection();
+    * client.connect( "serverNode=myserver;uid=system;pwd=manager" )
+    * client.exec( "SELECT COUNT(*) FROM LargeTable, LargeTable", function( err, result ) {
+    *     console.log( err );
+    * } );
+    * setTimeout( function() { client.cancel(); }, 1000 );
+    * </pre></p>
+    *
+    * @fn Connection::cancel()
+    *
+    */
+    static NODE_API_FUNC(cancel);
+
+    /** Retrieves the statement cache counters.
+    *
+    * @fn Object Connection::getStatementCacheStats()
+    *
+    * @return An Object with the properties capacity, size, hits, misses
+    * and evictions. ( type: Object )
+    *
+    */
+    static NODE_API_FUNC(getStatementCacheStats);
+
+    /** Retrieves the counters of the connection's request queue.
+    *
+    * Asynchronous requests on a connection run one at a time in the order
+    * they were made. Requests waiting for their turn do not occupy a
+    * thread of the pool.
+    *
+    * @fn Object Connection::getQueueStats()
+    *
+    * @return An Object with the properties length (requests waiting or
+    * running), oldestWaitMs (the wait time of the oldest waiting request),
+    * maxWaitMs (the longest time a request has waited) and completed.
+    * ( type: Object )
+    *
+    */
+    static NODE_API_FUNC(getQueueStats);
+
+    /** Retrieves the latency histograms of the connection's operations.
+    *
+    * Every exec of the connection or of one of its statements, including
+    * pipelined ones, records the time spent in each phase: queue (waiting
+    * for a thread of the pool), lock (waiting for an earlier call on the
+    * connection), prepare, bind, execute, fetch, convert (converting
+    * parameters and results between JavaScript and the client library on
+    * the main thread) and total.
+    *
+    * @fn Object Connection::getStats( Boolean reset )
+    *
+    * @param reset If true, the histograms are cleared after they are read.
+    * ( type: Boolean )
+    *
+    * @return An Object with one property per phase, each an Object with the
+    * properties count, minMs, maxMs, meanMs, p50Ms, p90Ms, p99Ms and
+    * p999Ms. ( type: Object )
+    *
+    */
+    static NODE_API_FUNC(getStats);
+
+    /** Limits the native memory held for the connection's results.
+    *
+    * The memory of fetched rows, column buffers and bind buffers of an
+    * operation is counted against the limit while the operation runs. An
+    * exec whose result would take the connection over the limit fails with
+    * error code -20020 instead of fetching the remaining rows. The limit set
+    * with hana.setMemoryLimit applies to the whole process as well.
+    *
+    * @fn Connection::setMemoryLimit( Number bytes )
+    *
+    * @param bytes The limit in bytes, or 0 for no limit. ( type: Number )
+    *
+    */
+    static NODE_API_FUNC(setMemoryLimit);
+
+    /** Retrieves the native memory held for the connection's operations.
+    *
+    * @fn Object Connection::getMemoryStats()
+    *
+    * @return An Object with the properties totalBytes and limitBytes.
+    * ( type: Object )
+    *
+    */
+    static NODE_API_FUNC(getMemoryStats);
+
     /** Sets a callback function for warnings.
     *
+    * Warnings that arrive in quick succession are passed in one call.
+    * The callback function is of the form:
+    *
+    * <p><pre>
+    * function( warning, warnings )
+    * {
+    *
+    * };
+    * </pre></p>
+    *
+    * where warning is the first warning and warnings is an Array of all
+    * warnings of the call, in the order they were reported.
+    *
     * @fn Connection::setWarningCallback( Function callback )
     *
-    * @param callback The callback function. ( type: Function )
+    * @param callback The callback function, or null to stop receiving
+    * warnings. ( type: Function )
     *
     */
     static NODE_API_FUNC(setWarningCallback);
 
+    /** Sets a callback function that receives a trace event for every
+    * exec, prepare, batch execute and ResultSet.next of the connection and
+    * its statements.
+    *
+    * Events are collected as the operations complete and passed in
+    * batches, so tracing adds little to each operation. The callback
+    * function is of the form:
+    *
+    * <p><pre>
+    * function( events )
+    * {
+    *
+    * };
+    * </pre></p>
+    *
+    * where events is an Array of Objects with the properties operation
+    * ('exec', 'prepare', 'batch' or 'fetch'), sqlHash (a hex string that
+    * identifies the SQL text), functionCode, rows, bytes (the size of the
+    * fetched values), bindCount, errorCode (0 on success) and the phase
+    * timings queueMs, lockMs, prepareMs, bindMs, executeMs, fetchMs,
+    * convertMs and totalMs (see Connection::getStats).
+    *
+    * @fn Connection::setTraceCallback( Function callback )
+    *
+    * @param callback The callback function, or null to stop tracing.
+    * ( type: Function )
+    *
+    */
+    static NODE_API_FUNC(setTraceCallback);
+
+    /** Starts recording the operations of the connection that run longer
+    * than a threshold, or stops recording.
+    *
+    * Each exec of the connection and its statements, including pipelined
+    * ones, is checked on the worker thread once it has executed and
+    * fetched. Operations over the threshold are copied into a ring buffer
+    * of size entries that is allocated when the log is set; the oldest
+    * entries are overwritten. The options object supports thresholdMs
+    * (default 1000), size (default 128) and sampleBinds (default 0), which
+    * captures the bind values of every sampleBinds-th recorded operation;
+    * otherwise only the type and length of each parameter is kept.
+    * Connections lent out by a pool with the slowQueryLog option share the
+    * log of the pool.
+    *
+    * @fn Connection::setSlowQueryLog( Object options )
+    *
+    * @param options The options, or null to stop recording.
+    * ( type: Object )
+    *
+    */
+    static NODE_API_FUNC(setSlowQueryLog);
+
+    /** Retrieves the operations recorded by the slow query log.
+    *
+    * @fn Array Connection::getSlowQueries( Boolean clear )
+    *
+    * @param clear If true, the returned entries are not returned again.
+    * ( type: Boolean )
+    *
+    * @return An Array of Objects with the properties timeMs, operation,
+    * sql, sqlTruncated, functionCode, errorCode, rows, the phase timings
+    * queueMs to totalMs (see Connection::getStats), paramCount and params,
+    * an Array of Objects with the properties type, length, isNull and,
+    * for sampled operations, value. Empty if no log is set.
+    * ( type: Array )
+    *
+    */
+    static NODE_API_FUNC(getSlowQueries);
+
+    /** Appends the entries of the slow query log that have not been read
+    * with clear to a file, one JSON object per line.
+    *
+    * The file is written on the thread pool. The callback function is of
+    * the form:
+    *
+    * <p><pre>
+    * function( err, count )
+    * {
+    *
+    * };
+    * </pre></p>
+    *
+    * @fn Connection::flushSlowQueries( String path, Function callback )
+    *
+    * @param path The path of the file. ( type: String )
+    * @param callback The callback function. ( type: Function )
+    *
+    */
+    static NODE_API_FUNC(flushSlowQueries);
+
   public:
     /// @internal
-    static void warningCallbackAfter(uv_work_t *req);
+    static void warningCallbackAfter(uv_async_t *handle);
+    /// @internal
+    static void warningCallbackClosed(uv_handle_t *handle);
     /// @internal
-    static void warningCallbackWork(uv_work_t *req);
+    static void traceCallbackAfter(uv_async_t *handle);
+    /// @internal
+    static void traceCallbackClosed(uv_handle_t *handle);
+    /// Replaces the slow query log; log may be NULL. @internal
+    void setSlowLog(slowQueryLog *log);
 
     /// @internal
     dbcapi_connection	*conn;
+    /// The client library context of the isolate, or NULL. @internal
+    dbcapi_interface_context *dbcapi_ctx;
     /// @internal
     unsigned int	max_api_ver;
     /// @internal
@@ -543,10 +899,46 @@ class Connection : public ObjectWrap
     bool		autoCommit;
     /// @internal
     uv_mutex_t 		conn_mutex;
+    /** Guards the lifetime of conn for cancel(), which must not wait for
+     * conn_mutex while an execute holds it.
+     * @internal
+     */
+    uv_mutex_t 		cancel_mutex;
     /// @internal
     Persistent<String>	_arg;
     /// @internal
     warningCallbackBaton *warningBaton;
+    /// Set while a trace callback is registered. @internal
+    traceCallbackBaton	*traceBaton;
     /// @internal
     bool 		is_connected;
+    /// @internal
+    StatementCache	stmt_cache;
+    /// @internal
+    WorkQueue		work_queue;
+    /// Latency histograms of the connection's operations. @internal
+    opStats		stats;
+    /// Native memory of the operations running on the connection. @internal
+    memCounter		mem;
+    /// Read by the workers without conn_mutex; replaced logs are kept in
+    /// retired_logs until the connection is freed. @internal
+    std::atomic<slowQueryLog *> slow_log;
+    /// @internal
+    std::vector<slowQueryLog *> retired_logs;
+    /// The pool that lent out this connection, or NULL. @internal
+    Pool		*pool;
+    /// @internal
+    Persistent<Object>	pool_obj;
 };
+
+/// @internal
+inline WorkQueue *workQueueOf(Connection *conn)
+{
+    return conn != NULL ? &conn->work_queue : NULL;
+}
+
+/// @internal
+inline bool isTracing(Connection *conn)
+{
+    return conn != NULL && conn->traceBaton != NULL;
+}
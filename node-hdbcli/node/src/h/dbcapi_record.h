@@ -0,0 +1,27 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+
+/** Recording of the calls the driver makes into DBCAPI and their replay.
+ *
+ * installApiRecorder wraps the functions of a loaded interface so that the
+ * results of every call, and what it wrote into the driver's buffers, are
+ * appended to a file together with the time the call took. Arguments such
+ * as connect strings, SQL text and parameter values are not written.
+ *
+ * initializeApiReplay fills the interface with functions that answer from
+ * such a file instead of the client library. Calls are matched per
+ * connection, in the order the connections are created, and each call
+ * waits for its recorded time multiplied by scale. A call that does not
+ * match the recording fails with JS_ERR_REPLAY_DIVERGED, as does every
+ * later call on that connection.
+ * @internal
+ */
+
+/// Returns false and sets errText if the file cannot be created.
+bool installApiRecorder( DBCAPIInterface *api, const char *path, std::string &errText );
+/// Writes out the records that are still buffered.
+void flushApiRecorder();
+/// scale may be NULL; it defaults to 1 and 0 turns the waits off.
+bool initializeApiReplay( DBCAPIInterface *api, const char *path, const char *scale,
+			  std::string &errText );
@@ -15,3 +15,13 @@
 #define JS_ERR_NO_RESULTSET_AVAILABLE                   -20012
 #define JS_ERR_TOO_MANY_PARAMETERS                      -20013
 #define JS_ERR_NOT_ENOUGH_PARAMETERS                    -20014
+#define JS_ERR_POOL_CLOSED                              -20015
+#define JS_ERR_POOL_TIMEOUT                             -20016
+#define JS_ERR_POOL_EXISTS                              -20017
+#define JS_ERR_POOL_NOT_FOUND                           -20018
+#define JS_ERR_WRITING_FILE                             -20019
+#define JS_ERR_MEMORY_LIMIT                             -20020
+#define JS_ERR_RESULT_TOO_LARGE                         -20021
+#define JS_ERR_SPILL                                    -20022
+#define JS_ERR_REPLAY_DIVERGED                          -20023
+#define JS_ERR_NOT_SUPPORTED                            -20024
@@ -7,6 +7,7 @@
 #include <string.h>
 #include <sstream>
 #include <vector>
+#include <atomic>
 #include "DBCAPI_DLL.h"
 #include "DBCAPI.h"
 
@@ -34,14 +35,26 @@
 
 #include "nodever_cover.h"
 #include "errors.h"
+#include "param_descs.h"
+#include "columnar.h"
+#include "addon_context.h"
+#include "stmt_cache.h"
+#include "worker_pool.h"
+#include "op_stats.h"
+#include "mem_stats.h"
+#include "slow_log.h"
+#include "spill.h"
+#include "dbcapi_record.h"
+#include "probes.h"
 #include "connection.h"
+#include "pool.h"
 #include "stmt.h"
 #include "resultset.h"
 
 using namespace v8;
 
 extern DBCAPIInterface api;
-extern unsigned openConnections;
+extern std::atomic<unsigned> openConnections;
 extern uv_mutex_t api_mutex;
 
 // JavaScriptType
@@ -65,6 +78,8 @@ enum TimeType {
     T_TIME
 };
 
+#define DEFAULT_ROWSET_SIZE 10
+
 #if !defined( _unused )
 #define _unused( x ) ((void)x)
 #endif
@@ -72,10 +87,28 @@ enum TimeType {
 void clearParameter(dbcapi_bind_data* param, bool free);
 void clearParameters(std::vector<dbcapi_bind_data> & params);
 void clearParameters(std::vector<dbcapi_bind_data*> & params);
-void copyParameters(std::vector<dbcapi_bind_data> & paramsSrc,
-                    std::vector<dbcapi_bind_data> & paramsDest);
-void copyParameters(std::vector<dbcapi_bind_data> & paramsDest,
-                    std::vector<dbcapi_bind_data*> & paramsSrc);
+
+// Statement bind arena: grow-only bind buffers that every execute of a
+// prepared statement overwrites in place
+void prepareBindArena(std::vector<dbcapi_bind_data> &  arena,
+                      std::vector<size_t> &            capacity,
+                      const paramDescriptors &         descs);
+// Returns false without touching the arena if a value needs the regular
+// binding path
+bool setBindArenaValues(Handle<Value>                    arg,
+                        std::vector<dbcapi_bind_data> &  arena,
+                        std::vector<size_t> &            capacity,
+                        const paramDescriptors &         descs);
+bool bindArenaParameters(dbcapi_connection *              conn,
+                         dbcapi_stmt *                    stmt,
+                         std::vector<dbcapi_bind_data> &  arena,
+                         int &                            errCode,
+                         std::string &                    errText,
+                         std::string &                    sqlState);
+void storeParameters(std::vector<dbcapi_bind_data> &   arena,
+                     std::vector<size_t> &             capacity,
+                     const paramDescriptors &          descs,
+                     std::vector<dbcapi_bind_data*> &  params);
 
 template <class T>
 void clearVector(std::vector<T*>& vector)
@@ -133,6 +166,21 @@ private:
     std::vector<dbcapi_data_value*> vals;
 };
 
+/** Column bindings of a result set. Passing the same object to
+ * fetchResultSet or columnarResult::fetch for repeated executes of a
+ * statement sets up the column information and bind buffers only once.
+ * @internal
+ */
+struct resultBinding
+{
+    resultBinding() { num_cols = -1; has_lob = false; }
+
+    /// -1 until the first fetch
+    int			num_cols;
+    bool		has_lob;
+    dataValueCollection	bind_cols;
+};
+
 struct executeBaton
 {
     Persistent<Function>		callback;
@@ -148,6 +196,10 @@ struct executeBaton
     Statement                           *obj_stmt;
     dbcapi_stmt 			*dbcapi_stmt_ptr;
     bool				prepared_stmt;
+    bool				cached_stmt;
+    bool				use_arena;
+    int					function_code;
+    int					query_timeout;
     std::string				stmt;
     std::vector<char*> 			string_vals;
     std::vector<double*> 		num_vals;
@@ -160,6 +212,14 @@ struct executeBaton
     int 				rows_affected;
     std::vector<dbcapi_data_type> 	col_types;
     std::vector<dbcapi_native_type> 	col_native_types;
+    // Set to fetch the result in columnar form instead
+    columnarResult			*columnar;
+    opTimings				timings;
+    int					bind_count;
+    // Native memory of the baton and of the fetched rows
+    memAccount				mem;
+    // maxResultBytes of a row result
+    resultLimit				limit;
 
     executeBaton()
     {
@@ -170,8 +230,15 @@ struct executeBaton
         dbcapi_stmt_ptr = NULL;
         rows_affected = -1;
         prepared_stmt = false;
+        cached_stmt = false;
+        use_arena = false;
+        function_code = 0;
+        query_timeout = -1;
         send_param_data = false;
         del_stmt_ptr = false;
+        columnar = NULL;
+        bind_count = 0;
+        mem.add(MEM_BATON, sizeof(executeBaton));
     }
 
     ~executeBaton()
@@ -186,6 +253,7 @@ struct executeBaton
         clearVector(string_len);
         col_types.clear();
         col_native_types.clear();
+        delete columnar;
         callback.Reset();
 
         //for (size_t i = 0; i < params.size(); i++) {
@@ -223,6 +291,39 @@ bool checkParameters( const FunctionCallbackInfo<Value> &args,
                       bool *isOptional = NULL,
                       bool *foundOptionalArg = NULL );
 
+int findOptionsArg( const FunctionCallbackInfo<Value> &args, int firstIndex );
+bool getQueryOptions( const FunctionCallbackInfo<Value> &args,
+                      int optionsArg,
+                      const char *function,
+                      int &timeout );
+bool getResultLimitOptions( const FunctionCallbackInfo<Value> &args,
+                            int optionsArg,
+                            const char *function,
+                            resultLimit &limit );
+bool setQueryTimeout( dbcapi_stmt *stmt, int timeout );
+
+/** Applies the timeout of one execute to a statement handle.
+ *
+ * A negative timeout leaves the handle alone, so executes without one make
+ * no call. A handle that outlives the execute gets restore_to back when the
+ * object goes out of scope; pass -1 for a handle that is freed afterwards.
+ * @internal
+ */
+class scopedQueryTimeout
+{
+    public:
+	scopedQueryTimeout( dbcapi_stmt *stmt_, int timeout_, int restore_to_ );
+	~scopedQueryTimeout();
+
+	/// False if the timeout could not be set.
+	bool		ok;
+
+    private:
+	dbcapi_stmt	*stmt;
+	int		timeout;
+	int		restore_to;
+};
+
 void callBack( int                      errCode,
                std::string *		errText,
                std::string *            sqlState,
@@ -263,9 +364,17 @@ bool getBindParameters( Handle<Value> 				arg,
                         std::vector<dbcapi_bind_data*> 	        &params,
                         std::vector<size_t> &	                buffer_size );
 
-bool getBindParameters( std::vector<dbcapi_bind_data*> &    inputParams,
-                        std::vector<dbcapi_bind_data*> &    params,
-                        dbcapi_stmt *                       stmt );
+/** Copies the parameters of execBatch, batch_size rows of row_param_count
+ * values each, into one array of values per column as bound by
+ * dbcapi_bind_param with a batch size. The directions of the new
+ * parameters are left to the caller.
+ * @internal
+ */
+void packBatchParameters( const std::vector<dbcapi_bind_data*> &  rows,
+                          int                                     row_param_count,
+                          int                                     batch_size,
+                          const std::vector<size_t> &             buffer_size,
+                          std::vector<dbcapi_bind_data*> &        params );
 
 bool getInputParameters( Handle<Value>                      arg,
                          std::vector<dbcapi_bind_data*> &   params,
@@ -273,9 +382,14 @@ bool getInputParameters( Handle<Value>                      arg,
                          std::string &                      errText,
                          std::string &                      sqlState );
 
+bool getBindParameters( std::vector<dbcapi_bind_data*> &    inputParams,
+                        std::vector<dbcapi_bind_data*> &    params,
+                        const paramDescriptors &            descs);
+
 bool bindParameters( dbcapi_connection *                 conn,
                      dbcapi_stmt *                       stmt,
                      std::vector<dbcapi_bind_data*> &    params,
+                     const paramDescriptors &            descs,
                      int &                               errCode,
                      std::string &                       errText,
                      std::string &                       sqlState,
@@ -285,7 +399,7 @@ bool checkParameterCount( int &                             errCode,
                           std::string &                     errText,
                           std::string &                     sqlState,
                           std::vector<dbcapi_bind_data*> &  providedParams,
-                          dbcapi_stmt *                     dbcapi_stmt_ptr);
+                          const paramDescriptors &          descs);
 
 bool fillResult( executeBaton *baton,
                  Persistent<Value> &ResultSet );
@@ -308,7 +422,10 @@ bool fetchResultSet( dbcapi_stmt 			*dbcapi_stmt_ptr
 		   , std::vector<int*> 			&int_vals
 		   , std::vector<size_t*> 		&string_len
 		   , std::vector<dbcapi_data_type> 	&col_types
-                   , std::vector<dbcapi_native_type> 	&col_native_types );
+                   , std::vector<dbcapi_native_type> 	&col_native_types
+		   , resultBinding			*binding = NULL
+		   , memAccount				*mem = NULL
+		   , resultLimit			*limit = NULL );
 
 struct noParamBaton {
     Persistent<Function> 	callback;
@@ -332,6 +449,25 @@ struct noParamBaton {
 
 void executeAfter( uv_work_t *req );
 void executeWork( uv_work_t *req );
+/// Runs the statement of baton; the connection's conn_mutex must be held.
+void executeWorkLocked( executeBaton *baton );
+void releaseBindArena( executeBaton *baton );
+/// Closes the total of timings and adds them to the statistics of conn and
+/// of the process.
+void recordTimings( Connection *conn, opTimings &timings );
+uint64_t hashSql( const std::string &sql );
+/// Queues an event for the trace callback of conn, if one is set.
+void traceOperation( Connection *	conn,
+		     const char *	operation,
+		     const std::string &sql,
+		     int		function_code,
+		     const opTimings &	timings,
+		     double		rows,
+		     double		bytes,
+		     int		bind_count,
+		     int		error_code );
+/// Queues the trace event of an exec; call after the result is converted.
+void traceExecute( executeBaton *baton, const char *operation );
 
 bool compareString( const std::string &str1, const std::string &str2, bool caseSensitive );
 bool compareString( const std::string &str1, const char* str2, bool caseSensitive );
@@ -0,0 +1,78 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+
+/// Kinds of native memory held by the driver. @internal
+enum memCategory
+{
+    MEM_BATON,		// operation batons and their copies of the parameters
+    MEM_FETCH,		// rows fetched by exec, until they are converted
+    MEM_COLUMNAR,	// column buffers of columnar results
+    MEM_BIND_ARENA,	// bind buffers kept by prepared statements
+    MEM_BATCH,		// parameter rows and packed buffers of execBatch
+    MEM_RESULTSET,	// column descriptions held by ResultSet objects
+    MEM_COUNT
+};
+
+/// Bytes in use against an optional limit; 0 means no limit. @internal
+struct memCounter
+{
+    memCounter() : bytes( 0 ), limit( 0 ) {}
+
+    std::atomic<int64_t>	bytes;
+    std::atomic<int64_t>	limit;
+};
+
+/** Native memory of the whole process, by category. @internal
+ */
+struct memStats
+{
+    memStats();
+
+    memCounter			total;
+    std::atomic<int64_t>	peak;
+    std::atomic<int64_t>	rejected;
+    std::atomic<int64_t>	by_category[MEM_COUNT];
+
+    Local<Object> toObject( Isolate *isolate );
+};
+
+extern memStats processMemory;
+
+/** The native memory owned by one object, such as a baton.
+ *
+ * charge and add update the process counters and may be called on any
+ * thread that owns the object at the time. report tells V8 how much
+ * external memory the object holds and must be called on the thread of
+ * the isolate; the amount reported is returned to V8 when the account is
+ * released, so the account must then be released on that thread as well.
+ * @internal
+ */
+class memAccount
+{
+  public:
+    memAccount();
+    ~memAccount();
+
+    /// Also counts the memory charged from now on against the limit of conn.
+    void setConnection( memCounter *conn );
+    /// Adds size bytes unless that exceeds the limit of the process or of
+    /// the connection; then sets exceeded and returns false.
+    bool charge( memCategory category, int64_t size );
+    /// Adds size bytes, which may be negative, without checking limits.
+    void add( memCategory category, int64_t size );
+    /// Changes the bytes of category to size without checking limits.
+    void set( memCategory category, int64_t size );
+    void report( Isolate *isolate );
+    void release();
+    int64_t total() const;
+
+    bool	exceeded;
+
+  private:
+    int64_t	sizes[MEM_COUNT];
+    int64_t	conn_size;
+    int64_t	reported;
+    memCounter	*conn;
+    Isolate	*isolate;
+};
@@ -0,0 +1,114 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+
+/// Phases of a database operation whose latency is recorded. @internal
+enum opPhase
+{
+    PHASE_QUEUE,	// waiting for a thread of the pool
+    PHASE_LOCK,		// waiting for the connection's conn_mutex
+    PHASE_PREPARE,	// dbcapi_prepare or statement cache lookup
+    PHASE_BIND,		// binding the parameters
+    PHASE_EXECUTE,	// dbcapi_execute
+    PHASE_FETCH,	// fetching the rows
+    PHASE_CONVERT,	// converting the result to JavaScript values
+    PHASE_TOTAL,	// from the call to the end of the conversion
+    PHASE_COUNT
+};
+
+/** Timestamps of one operation, carried in its baton.
+ *
+ * start() is called when the operation is queued; every end() adds the
+ * time since the previous start(), end() or begin() to a phase. Phases
+ * that an operation skips stay at zero and are not recorded.
+ * @internal
+ */
+struct opTimings
+{
+    opTimings() { start(); }
+
+    void start()
+    {
+	started_at = uv_hrtime();
+	mark = started_at;
+	for( int i = 0; i < PHASE_COUNT; i++ ) {
+	    phase_ns[i] = 0;
+	}
+    }
+    /// Starts timing a phase without charging the time since the last mark.
+    void begin() { mark = uv_hrtime(); }
+    void end( opPhase phase )
+    {
+	uint64_t now = uv_hrtime();
+	phase_ns[phase] += now - mark;
+	mark = now;
+    }
+
+    uint64_t	started_at;
+    uint64_t	mark;
+    uint64_t	phase_ns[PHASE_COUNT];
+};
+
+/** Log-linear latency histogram in the manner of HdrHistogram.
+ *
+ * Values are kept in microseconds. Values below 16 us are exact; above,
+ * every power of two is split into 16 buckets, which bounds the error of a
+ * percentile to about 6%. The buckets are allocated on the first record.
+ * @internal
+ */
+class latencyHistogram
+{
+  public:
+    /// Summary reported by getStats().
+    struct summary
+    {
+	double	count;
+	double	min_ms;
+	double	max_ms;
+	double	mean_ms;
+	double	p50_ms;
+	double	p90_ms;
+	double	p99_ms;
+	double	p999_ms;
+    };
+
+    latencyHistogram();
+
+    void record( uint64_t ns );
+    void reset();
+    void getSummary( summary &out ) const;
+
+  private:
+    static size_t bucketOf( uint64_t us );
+    static uint64_t highestValueOf( size_t bucket );
+    uint64_t percentile( double fraction ) const;
+
+    std::vector<uint32_t> counts;
+    uint64_t	total;
+    uint64_t	sum_us;
+    uint64_t	min_us;
+    uint64_t	max_us;
+};
+
+/** Latency histograms of every phase of a connection or of the process.
+ * Safe to use from several threads.
+ * @internal
+ */
+class opStats
+{
+  public:
+    opStats();
+    ~opStats();
+
+    void record( const opTimings &timings );
+    void reset();
+    /// Returns an object with one summary object per phase.
+    Local<Object> toObject( Isolate *isolate );
+
+  private:
+    uv_mutex_t		mutex;
+    latencyHistogram	phases[PHASE_COUNT];
+};
+
+/// Histograms of all connections of the process. @internal
+extern opStats processStats;
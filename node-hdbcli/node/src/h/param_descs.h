@@ -0,0 +1,27 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+
+/** Bind parameter descriptors of a prepared statement.
+ *
+ * The descriptors are captured once after the statement has been prepared
+ * and used for every later execute, so that binding does not have to call
+ * dbcapi_describe_bind_param and dbcapi_get_bind_param_info again.
+ * @internal
+ */
+struct paramDescriptors
+{
+    /// direction and default type of each parameter
+    std::vector<dbcapi_bind_data>	params;
+    /// native type and maximum size of each parameter
+    std::vector<dbcapi_bind_param_info>	infos;
+    /// number of DD_INPUT and DD_INPUT_OUTPUT parameters
+    int					num_inputs;
+
+    paramDescriptors() : num_inputs(0) {}
+
+    /// Describes all parameters of stmt. The caller must hold conn_mutex.
+    bool describe(dbcapi_stmt *stmt);
+    void clear();
+    int size() const { return (int)params.size(); }
+};
@@ -0,0 +1,367 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+using namespace v8;
+
+#include "nodever_cover.h"
+
+#define POOL_HISTOGRAM_BUCKETS	13
+
+class Pool;
+struct executeBaton;
+
+/** Connections and counters of a pool, shared by the Pool objects of all
+ * threads that use it. All members are protected by mutex.
+ * @internal
+ */
+struct poolCore
+{
+    struct pooledConnection
+    {
+	dbcapi_connection   *conn;
+	uint64_t	    last_used;
+    };
+
+    poolCore();
+    ~poolCore();
+
+    /// Hands conn to the Pool that has waited longest or adds it to the
+    /// idle list. Returns false if the pool is closed, in which case the
+    /// caller disconnects conn. Called with mutex held.
+    bool putLocked( dbcapi_connection *conn );
+
+    /// Passes the error of a failed open to a waiting Pool that no other
+    /// open can serve. Called with mutex held.
+    void failLocked( int code, const std::string &msg, const std::string &state );
+
+    /// Number of connections to open for the waiters and min. Called with
+    /// mutex held.
+    unsigned growLocked();
+
+    uv_mutex_t			mutex;
+    std::string			name;
+    std::string			conn_string;
+    dbcapi_interface_context	*dbcapi_ctx;
+    unsigned			min_size;
+    unsigned			max_size;
+    unsigned			idle_timeout_ms;
+    unsigned			max_wait_ms;
+    bool			validate_on_borrow;
+    /// Shared with the connections lent out, or NULL
+    slowQueryLog		*slow_log;
+
+    std::deque<pooledConnection> idle;
+    /// One entry per waiting acquire that has not been served yet
+    std::deque<Pool *>		tickets;
+    unsigned			in_use;
+    unsigned			opening;
+    unsigned			destroying;
+    /// Pool objects that are not closed
+    unsigned			attached;
+    /// Pool objects that exist
+    unsigned			refs;
+    bool			closed;
+
+    double			created;
+    double			destroyed;
+    double			acquired;
+    double			timeouts;
+    double			validation_failures;
+    double			errors;
+    double			histogram[POOL_HISTOGRAM_BUCKETS];
+};
+
+/** Represents a pool of database connections.
+ * @class Pool
+ *
+ * The pool keeps between min and max open connections to the database
+ * server and lends them out as Connection objects. The connection
+ * parameters are converted to a connection string once when the pool is
+ * created, and connections are opened in parallel on the database thread
+ * pool. Connections that stay idle longer than idleTimeoutMs are closed
+ * while the pool holds more than min connections.
+ *
+ * <p><pre>
+ * var hana = require( '@sap/hana-client' );
+ * var pool = hana.createPool( "serverNode=myserver:30015;uid=system;pwd=manager",
+ *                             { min: 2, max: 10, idleTimeoutMs: 60000 } );
+ * pool.acquire( function( err, conn ) {
+ *     conn.exec( "SELECT * FROM Customers", function( err, rows ) {
+ *         console.log( rows );
+ *         pool.release( conn );
+ *     } );
+ * } );
+ * </pre></p>
+ *
+ * A pool that is given a name is owned by the process. Worker threads get
+ * their own Pool object for it with hana.getPool and borrow connections
+ * from the same set. Each Pool object only delivers callbacks on the
+ * thread that created it.
+ */
+class Pool : public node::ObjectWrap
+{
+  public:
+    /// Also exports the class as Pool, so that lib/index.js can add the
+    /// methods implemented in JavaScript to its prototype. @internal
+    static void Init( Isolate *, Local<Object> exports );
+
+    /** Creates a connection pool.
+     *
+     * The options object supports the following properties:
+     * min (default 0), the number of connections opened up front and kept
+     * open; max (default 10), the maximum number of open connections;
+     * idleTimeoutMs (default 60000, 0 to never close idle connections);
+     * maxWaitMs (default 0, wait forever), how long acquire waits for a
+     * connection before failing; and validateOnBorrow (default false),
+     * which pings a connection before lending it out. If name is set, the
+     * pool is registered under that name for hana.getPool. slowQueryLog
+     * takes the options of Connection::setSlowQueryLog and records the
+     * slow operations of all connections of the pool in one log.
+     *
+     * @fn Pool hana.createPool( Object conn_params, Object options )
+     *
+     * @param conn_params A string or object of connection parameters.
+     * @param options The optional pool options. ( type: Object )
+     *
+     * @return The new pool. ( type: Pool )
+     *
+     */
+    static NODE_API_FUNC( NewInstance );
+
+    /** Returns a Pool object for a named pool created by this or another
+     * thread.
+     *
+     * @fn Pool hana.getPool( String name )
+     *
+     * @param name The name given to createPool. ( type: String )
+     *
+     * @return The pool. ( type: Pool )
+     *
+     */
+    static NODE_API_FUNC( GetInstance );
+
+    /// @internal
+    Pool( poolCore *core );
+    /// @internal
+    ~Pool();
+
+    /** Returns the handle of a pooled connection to its pool once the
+     * connection's earlier requests have finished. Used by release and by
+     * Connection::disconnect.
+     * @internal
+     */
+    static void releaseConnection( Isolate *isolate,
+				   Local<Object> connObj,
+				   Local<Value> callback,
+				   bool callback_required );
+
+    /** Called when a lent connection is garbage collected without being
+     * released; the connection closes its own handle.
+     * @internal
+     */
+    void connectionLost();
+
+  private:
+    /// @internal
+    static perIsolateFunction constructor;
+    /// @internal
+    static NODE_API_FUNC( New );
+
+    /** Lends a connection from the pool.
+     *
+     * An idle connection is used if there is one. Otherwise a new
+     * connection is opened if the pool holds fewer than max connections,
+     * or the request waits for a connection to be released.
+     * The callback function is of the form:
+     *
+     * <p><pre>
+     * function( err, conn )
+     * {
+     *
+     * };
+     * </pre></p>
+     *
+     * @fn Pool::acquire( Function callback )
+     *
+     * @param callback The callback function. ( type: Function )
+     *
+     */
+    static NODE_API_FUNC( acquire );
+
+    /** Returns a connection to the pool.
+     *
+     * Uncommitted changes are rolled back. The connection is returned after
+     * requests that are still queued on it have finished; it must not be
+     * used afterwards. Calling disconnect on a pooled connection has the
+     * same effect.
+     *
+     * @fn Pool::release( Connection conn, Function callback )
+     *
+     * @param conn The connection obtained from acquire.
+     * @param callback The optional callback function.
+     *
+     */
+    static NODE_API_FUNC( release );
+
+    /** Executes a SQL statement on a connection of the pool.
+     *
+     * The connection is returned to the pool as soon as the statement has
+     * been executed. Query results are returned in columnar form: an
+     * Object with the properties rowCount and columns. Each column has the
+     * properties name, type, format (int32, float64, boolean, string or
+     * binary), values, nulls and, for string and binary columns, offsets;
+     * the last three are ArrayBuffers. For DML statements the number of
+     * affected rows is returned.
+     * The callback function is of the form:
+     *
+     * <p><pre>
+     * function( err, result )
+     * {
+     *
+     * };
+     * </pre></p>
+     *
+     * @fn Pool::exec( String sql, Array params, Object options, Function callback )
+     *
+     * @param sql The SQL statement to be executed. ( type: String )
+     * @param params The optional array of parameters to bind.
+     * @param options The optional query options, see Connection::exec.
+     * @param callback The callback function. ( type: Function )
+     *
+     */
+    static NODE_API_FUNC( exec );
+
+    /** Closes the pool.
+     *
+     * Idle connections are closed, waiting acquire calls fail, and
+     * connections that are still lent out are closed when they are
+     * released. For a named pool only this Pool object is closed; the
+     * connections are closed with the last one.
+     *
+     * @fn Pool::close( Function callback )
+     *
+     * @param callback The optional callback function.
+     *
+     */
+    static NODE_API_FUNC( close );
+
+    /** Retrieves the pool counters.
+     *
+     * @fn Object Pool::getStats()
+     *
+     * @return An Object with the properties name, size, max, idle, inUse,
+     * opening, waiters, created, destroyed, acquired, timeouts, validationFailures,
+     * errors and acquireLatency. acquireLatency holds the bounds of the
+     * histogram buckets in milliseconds and the counts per bucket; the last
+     * count is for latencies above the last bound. ( type: Object )
+     *
+     */
+    static NODE_API_FUNC( getStats );
+    /** Retrieves the operations recorded by the slow query log of the
+     * pool, see Connection::getSlowQueries.
+     *
+     * @fn Array Pool::getSlowQueries( Boolean clear )
+     *
+     * @param clear If true, the returned entries are not returned again.
+     * ( type: Boolean )
+     *
+     * @return An Array of entries; empty if the pool has no slow query
+     * log. ( type: Array )
+     *
+     */
+    static NODE_API_FUNC( getSlowQueries );
+    /** Appends the unread entries of the slow query log of the pool to a
+     * file, see Connection::flushSlowQueries.
+     *
+     * @fn Pool::flushSlowQueries( String path, Function callback )
+     *
+     * @param path The path of the file. ( type: String )
+     * @param callback The callback function. ( type: Function )
+     *
+     */
+    static NODE_API_FUNC( flushSlowQueries );
+
+    /// @internal
+    static void openWork( uv_work_t *req );
+    /// @internal
+    static void openAfter( uv_work_t *req );
+    /// @internal
+    static void validateWork( uv_work_t *req );
+    /// @internal
+    static void validateAfter( uv_work_t *req );
+    /// @internal
+    static void releaseWork( uv_work_t *req );
+    /// @internal
+    static void releaseAfter( uv_work_t *req );
+    /// @internal
+    static void destroyWork( uv_work_t *req );
+    /// @internal
+    static void destroyAfter( uv_work_t *req );
+    /// @internal
+    static void execWork( uv_work_t *req );
+    /// @internal
+    static void execAfter( uv_work_t *req );
+    /// @internal
+    static void timerCallback( uv_timer_t *handle );
+    /// @internal
+    static void timerClosed( uv_handle_t *handle );
+    /// @internal
+    static void readyCallback( uv_async_t *handle );
+    /// @internal
+    static void asyncClosed( uv_handle_t *handle );
+    /// @internal
+    static void cleanupHook( void *arg );
+
+    struct waiter
+    {
+	Persistent<Function> callback;
+	uint64_t	    since;
+	/// Statement run by exec, or NULL for acquire
+	executeBaton	    *job;
+
+	waiter() { job = NULL; }
+	~waiter();
+    };
+
+    /// A connection (or the error of a failed open) passed to this object
+    /// by another thread
+    struct handoff
+    {
+	dbcapi_connection   *conn;
+	int		    error_code;
+	std::string	    error_msg;
+	std::string	    sql_state;
+    };
+
+    friend struct poolCore;
+
+    void start( Isolate *isolate );
+    void addWaiter( waiter *w );
+    void openConnection();
+    void growBy( unsigned count );
+    void lend( waiter *w, dbcapi_connection *conn );
+    void deliver( waiter *w, dbcapi_connection *conn );
+    void failWaiter( waiter *w, int code );
+    void returnUnused( dbcapi_connection *conn );
+    void destroyConnection( dbcapi_connection *conn );
+    void onReady();
+    void updateAsyncRef();
+    void onTimer();
+    void closeTimer();
+    void detach( bool notify );
+    void finishClose();
+
+    poolCore			*core;
+    Isolate			*isolate;
+
+    // All members below are only touched on the thread of this object,
+    // except ready, which is protected by the core mutex
+    std::deque<waiter *>	waiters;
+    std::deque<handoff>		ready;
+    unsigned			destroying;
+    bool			closed;
+    bool			cleanup_hook;
+    Persistent<Function>	close_callback;
+    uv_timer_t			*timer;
+    uv_async_t			*async;
+};
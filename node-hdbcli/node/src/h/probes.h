@@ -0,0 +1,50 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+
+/** Static probes for perf, bpftrace and SystemTap.
+ *
+ * The probes are built in with node-gyp rebuild --hana_usdt=1 on Linux,
+ * which needs sys/sdt.h (systemtap-sdt-dev or systemtap-sdt-devel). A probe
+ * that nothing is attached to is a single nop. The provider is hana:
+ *
+ *   dbcapi__entry( const char *function, void *handle )
+ *   dbcapi__return( const char *function, void *handle )
+ *	around every call into the client library; function is the name
+ *	without dbcapi_ and handle the connection or statement, if any
+ *   convert__start( const char *what, int64_t columns )
+ *   convert__done( const char *what, int64_t rows )
+ *	around the conversion of rows to JavaScript; what is getResultSet
+ *	or getValues
+ * @internal
+ */
+#if defined( HANA_USDT )
+#include <sys/sdt.h>
+#define HANA_PROBE2( name, arg1, arg2 )		DTRACE_PROBE2( hana, name, arg1, arg2 )
+#else
+// The arguments still count as used, so builds without the probes do not
+// warn about parameters that only feed them
+#define HANA_PROBE2( name, arg1, arg2 )		( (void)( arg1 ), (void)( arg2 ) )
+#endif
+
+/// Fires convert__start when created and convert__done with rows when
+/// destroyed. @internal
+class convertProbe
+{
+  public:
+    convertProbe( const char *what_, size_t columns ) : what( what_ ), rows( 0 )
+    {
+	HANA_PROBE2( convert__start, what, (int64_t)columns );
+    }
+    ~convertProbe()
+    {
+	HANA_PROBE2( convert__done, what, rows );
+    }
+
+    const char	*what;
+    int64_t	rows;
+};
+
+/// Routes the calls through api through the dbcapi__entry and
+/// dbcapi__return probes; does nothing unless the probes are built in.
+void installApiProbes( DBCAPIInterface *api );
@@ -60,7 +60,7 @@ class ResultSet : public node::ObjectWrap
     static bool getSQLValue( ResultSet *obj, dbcapi_data_value &value,
 			     const FunctionCallbackInfo<Value> &args );
     /// @internal
-    static Persistent<Function> constructor;
+    static perIsolateFunction constructor;
     /// @internal
     static NODE_API_FUNC( New );
 
@@ -298,6 +298,12 @@ class ResultSet : public node::ObjectWrap
   public:
     void getColumnInfos();
 
+    /** Records the statement whose cursor pool dbcapi_stmt_ptr came from,
+     * so that the cursor is handed back instead of freed on close.
+     * @internal
+     */
+    void setOwner(Isolate *isolate, Statement *stmt, Local<Object> stmtObj);
+
     /// @internal
     Connection		*connection;
     /// @internal
@@ -308,4 +314,10 @@ class ResultSet : public node::ObjectWrap
     bool		fetched_first;
     /// @internal
     uv_mutex_t          *conn_mutex;
+    /// @internal
+    Statement           *owner_stmt;
+    /// @internal
+    Persistent<Object>  owner_stmt_obj;
+    /// Native memory of the column descriptions. @internal
+    memAccount          mem;
 };
@@ -0,0 +1,98 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+
+#define SLOW_LOG_SQL_LENGTH	512
+#define SLOW_LOG_MAX_PARAMS	16
+#define SLOW_LOG_VALUE_LENGTH	32
+
+struct executeBaton;
+
+/// Shape and, if sampled, value of one bind parameter. @internal
+struct slowQueryParam
+{
+    int		type;		// dbcapi_data_type
+    bool	is_null;
+    uint32_t	length;
+    char	value[SLOW_LOG_VALUE_LENGTH];
+};
+
+/// One operation recorded by a slowQueryLog. Fixed size, so that
+/// recording copies into a preallocated slot. @internal
+struct slowQueryEntry
+{
+    uint64_t		index;
+    double		time_ms;	// wall clock, ms since the epoch
+    const char *	operation;
+    int			function_code;
+    int			error_code;
+    double		rows;
+    uint64_t		phase_ns[PHASE_COUNT];
+    size_t		sql_length;	// of the whole text; sql may be truncated
+    char		sql[SLOW_LOG_SQL_LENGTH];
+    int			param_count;
+    bool		has_values;
+    slowQueryParam	params[SLOW_LOG_MAX_PARAMS];
+};
+
+/** Fixed size ring buffer of the operations that took longer than a
+ * threshold.
+ *
+ * Workers record into it without locks: a slot is claimed with an atomic
+ * counter and guarded by a sequence number that is odd while the slot is
+ * written, so readers skip slots that are being overwritten. All slots
+ * are allocated up front; operations under the threshold only compare
+ * their elapsed time. The log is reference counted because a pool shares
+ * it with the connections it lends out.
+ * @internal
+ */
+class slowQueryLog
+{
+  public:
+    slowQueryLog( uint64_t threshold_ns, unsigned capacity, unsigned sample_binds );
+
+    void addRef();
+    void release();
+
+    /// Records the exec of baton if it has run longer than the threshold.
+    /// Called on the worker thread with the connection locked.
+    void capture( executeBaton *baton, const char *operation );
+    /// Copies the entries in the order they were recorded. If consume is
+    /// set, the entries are not returned by later reads; a consuming read
+    /// stops at the first entry that is still being written.
+    void read( std::vector<slowQueryEntry> &out, bool consume );
+    Local<Array> toArray( Isolate *isolate, bool consume );
+
+    uint64_t	threshold_ns;
+
+  private:
+    ~slowQueryLog();
+
+    struct slot
+    {
+	std::atomic<uint32_t>	seq;
+	slowQueryEntry		entry;
+    };
+
+    std::atomic<int>		refs;
+    std::atomic<uint64_t>	next;
+    std::atomic<uint64_t>	read_from;
+    std::atomic<uint64_t>	captured;
+    unsigned			capacity;
+    unsigned			sample_binds;
+    slot			*slots;
+};
+
+/** Reads the options object of setSlowQueryLog or the slowQueryLog pool
+ * option: thresholdMs, size and sampleBinds. Throws and returns NULL if an
+ * option is invalid.
+ * @internal
+ */
+slowQueryLog *newSlowQueryLog( Local<Value> options, int arg, const char *usage );
+
+/// Appends the unread entries of log to the file at path as JSON lines on
+/// the thread pool and calls callback( err, count ). @internal
+void flushSlowQueryLog( Isolate *		isolate,
+			slowQueryLog *		log,
+			const std::string &	path,
+			Local<Function>		callback );
@@ -0,0 +1,172 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include <stdio.h>
+
+using namespace v8;
+
+/// Every SPILL_INDEX_INTERVAL-th row has its file offset kept in memory
+#define SPILL_INDEX_INTERVAL	256
+
+/** Rows of a result written to a temporary file.
+ *
+ * fetchResultSet moves the rows it has fetched into the file one rowset at
+ * a time once the result grows past its maxResultBytes budget, so the
+ * memory used by the fetch stays bounded. Each cell is stored as its
+ * dbcapi_data_type followed by the value: 4 bytes for integer types of up
+ * to 16 bits and signed 32 bits, a double for the wider number types and
+ * the length and bytes of strings and binaries. NULL values have type
+ * A_INVALID_TYPE and no value. When the fetch is done the file is mapped
+ * into memory and rows are converted to JavaScript only when they are
+ * read. The file is removed as soon as it is created, so it goes away
+ * when it is closed or the process exits.
+ * @internal
+ */
+class spillFile
+{
+  public:
+    spillFile();
+    ~spillFile();
+
+    /// Creates the file in $TMPDIR, or the system's temporary directory,
+    /// for rows of num_cols columns.
+    bool open( size_t num_cols );
+    /// Appends the rows held in the vectors, as filled in by
+    /// fetchResultSet, and frees them.
+    bool append( std::vector<char*> &			string_vals,
+		 std::vector<double*> &			num_vals,
+		 std::vector<int*> &			int_vals,
+		 std::vector<size_t*> &			string_len,
+		 std::vector<dbcapi_data_type> &	col_types );
+    /// Writes out the buffered rows and maps the file into memory.
+    bool finish();
+    /// Converts count rows from start. Called on the main thread after
+    /// finish.
+    Local<Array> getRows( Isolate *isolate, size_t start, size_t count );
+    void close();
+
+    /// Moved from the baton of the exec
+    std::vector<char*>			col_names;
+    std::vector<dbcapi_native_type>	col_native_types;
+    size_t				num_rows;
+    uint64_t				size;
+
+  private:
+    bool write( const void *data, size_t length );
+    bool flush();
+    /// Returns the offset of the row after the one at offset.
+    uint64_t skipRow( uint64_t offset ) const;
+
+    FILE *			file;
+    char *			map;
+#if defined( _WIN32 )
+    void *			mapping;
+#endif
+    size_t			num_cols;
+    std::vector<uint64_t>	index;
+    std::vector<char>		buffer;
+};
+
+/** Policies of maxResultBytes
+ * @internal
+ */
+enum resultPolicy
+{
+    RESULT_POLICY_ERROR,
+    RESULT_POLICY_TRUNCATE,
+    RESULT_POLICY_SPILL
+};
+
+/** The maxResultBytes budget of an exec and its state during the fetch.
+ * @internal
+ */
+struct resultLimit
+{
+    resultLimit() : max_bytes( 0 ), policy( RESULT_POLICY_ERROR ), bytes( 0 ),
+		    truncated( false ), exceeded( false ), spill_failed( false ),
+		    spill( NULL ) {}
+    ~resultLimit() { delete spill; }
+
+    /// 0 means no budget
+    int64_t		max_bytes;
+    resultPolicy	policy;
+    /// Estimated size of the rows held in memory
+    int64_t		bytes;
+    bool		truncated;
+    bool		exceeded;
+    bool		spill_failed;
+    /// Set once the rows are written to a file; the result takes it over
+    spillFile *		spill;
+};
+
+/** Result of an exec that was spilled to a temporary file.
+ *
+ * @class SpilledResult
+ *
+ * Returned by Connection::exec and Statement::exec with the resultPolicy
+ * 'spill' when the rows do not fit into maxResultBytes. The rows stay in
+ * the file and are converted when they are read.
+ *
+ * <p><pre>
+ * conn.exec( "SELECT * FROM Orders", { maxResultBytes: 64 * 1024 * 1024,
+ *                                      resultPolicy: 'spill' },
+ *            function( err, result ) {
+ *     if( Array.isArray( result ) ) {
+ *         process( result );
+ *         return;
+ *     }
+ *     for( var i = 0; i < result.getRowCount(); i += 1000 ) {
+ *         process( result.getRows( i, 1000 ) );
+ *     }
+ *     result.close();
+ * } );
+ * </pre></p>
+ */
+class SpilledResult : public node::ObjectWrap
+{
+  public:
+    /// @internal
+    static void Init( Isolate * );
+    /// Wraps spill, which the object takes over. @internal
+    static Local<Object> NewInstance( Isolate *isolate, spillFile *spill );
+
+  private:
+    /// @internal
+    SpilledResult();
+    /// @internal
+    ~SpilledResult();
+
+    /// @internal
+    static perIsolateFunction constructor;
+    /// @internal
+    static NODE_API_FUNC( New );
+
+    /** Gets the number of rows of the result.
+     *
+     * @fn Integer SpilledResult::getRowCount()
+     *
+     * @return The number of rows. ( type: Integer )
+     */
+    static NODE_API_FUNC( getRowCount );
+
+    /** Gets rows of the result.
+     *
+     * @fn Array SpilledResult::getRows( Integer start, Integer count )
+     *
+     * @param start The zero-based index of the first row. ( type: Integer )
+     * @param count The number of rows; fewer are returned at the end of the
+     *              result. ( type: Integer )
+     *
+     * @return An array of row objects, as returned by exec. ( type: Array )
+     */
+    static NODE_API_FUNC( getRows );
+
+    /** Removes the temporary file. Later calls of getRows fail.
+     *
+     * @fn SpilledResult::close()
+     */
+    static NODE_API_FUNC( close );
+
+    /// @internal
+    spillFile		*spill;
+};
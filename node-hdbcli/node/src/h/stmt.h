@@ -34,7 +34,7 @@ class Statement : public node::ObjectWrap
 
   private:
     /// @internal
-    static Persistent<Function> constructor;
+    static perIsolateFunction constructor;
     /// @internal
     static NODE_API_FUNC( New );
 
@@ -82,9 +82,11 @@ class Statement : public node::ObjectWrap
      * client.disconnect();
      * </pre></p>
      *
-     * @fn result Statement::exec( Array params, Function callback )
+     * @fn result Statement::exec( Array params, Object options, Function callback )
      *
      * @param params The optional array of bind parameters.
+     * @param options The optional options. The timeout property sets the
+     * query timeout in seconds.
      * @param callback The optional callback function.
      *
      * @return If no callback is specified, the result is returned.
@@ -124,9 +126,11 @@ class Statement : public node::ObjectWrap
     * client.disconnect();
     * </pre></p>
     *
-    * @fn result Statement::execQuery( Array params, Function callback )
+    * @fn result Statement::execQuery( Array params, Object options, Function callback )
     *
     * @param params The optional array of bind parameters.
+    * @param options The optional options. The timeout property sets the
+    * query timeout in seconds.
     * @param callback The optional callback function.
     *
     * @return If no callback is specified, the result set is returned. ( type: ResultSet )
@@ -166,9 +170,11 @@ class Statement : public node::ObjectWrap
     * client.disconnect();
     * </pre></p>
     *
-    * @fn result Statement::execBatch( Array params, Function callback )
+    * @fn result Statement::execBatch( Array params, Object options, Function callback )
     *
     * @param params The array of bind parameters.
+    * @param options The optional options. The timeout property sets the
+    * query timeout in seconds.
     * @param callback The optional callback function.
     *
     * @return If no callback is specified, the number of rows affected is returned. ( type: Integer )
@@ -176,6 +182,54 @@ class Statement : public node::ObjectWrap
     */
     static NODE_API_FUNC(execBatch);
 
+    /** Executes a prepared query once for each of several sets of bind
+    * parameters.
+    *
+    * All executes run in one request on a single thread of the database
+    * thread pool, and the column information and fetch buffers of the
+    * result set are set up only once, so that many small lookups with the
+    * same statement are much cheaper than as many calls of exec.
+    * The statement must return a result set; LOB parameters sent with
+    * sendParameterData are not supported. If one of the executes fails,
+    * the whole call fails.
+    *
+    * The result is an Array with the rows of each parameter set, in the
+    * order of params. If the columnar option is true, the rows of all
+    * parameter sets are instead returned as one columnar result, as
+    * returned by Pool::exec, with an additional groups property: an
+    * ArrayBuffer of params.length + 1 Uint32 values, where the rows of
+    * parameter set i are the rows from groups[i] to groups[i + 1].
+    *
+    * This method can be either synchronous or asynchronous depending on
+    * whether or not a callback function is specified.
+    * The callback function is of the form:
+    *
+    * <p><pre>
+    * function( err, result )
+    * {
+    *
+    * };
+    * </pre></p>
+    *
+    * <p><pre>
+    * stmt = client.prepare( "SELECT * FROM Customers WHERE ID = ?" );
+    * result = stmt.execMany( [[101], [102], [103]] );
+    * console.log( result[1] );
+    * </pre></p>
+    *
+    * @fn result Statement::execMany( Array params, Object options, Function callback )
+    *
+    * @param params The array of arrays of bind parameters.
+    * @param options The optional options. The timeout property sets the
+    * query timeout in seconds; the columnar property selects the columnar
+    * result.
+    * @param callback The optional callback function.
+    *
+    * @return If no callback is specified, the result is returned.
+    *
+    */
+    static NODE_API_FUNC(execMany);
+
     /** Drops the statement.
      *
      * This method drops the prepared statement and frees up resources.
@@ -277,6 +331,11 @@ class Statement : public node::ObjectWrap
     /// @internal
     static void executeBatchAfter(uv_work_t *req);
 
+    /// @internal
+    static void executeManyWork(uv_work_t *req);
+    /// @internal
+    static void executeManyAfter(uv_work_t *req);
+
     /// @internal
     static void dropAfter(uv_work_t *req);
     /// @internal
@@ -302,25 +361,68 @@ class Statement : public node::ObjectWrap
     static bool checkExecParameters(const FunctionCallbackInfo<Value> &args,
                              const char *function,
                              bool &bind_required,
-                             int &cbfunc_arg);
+                             int &cbfunc_arg,
+                             int &timeout,
+                             resultLimit *limit = NULL);
 
   public:
+    /** Takes a cursor for execQuery from the idle cursor pool, or prepares
+     * a new one if the pool is empty. The caller must hold conn_mutex.
+     * @internal
+     */
+    dbcapi_stmt *acquireCursor();
+
+    /** Returns a cursor obtained from acquireCursor. The cursor is reset
+     * and kept for reuse while the statement is valid and the pool holds
+     * fewer cursors than the peak number of concurrently open result sets;
+     * otherwise it is freed. The caller must hold conn_mutex.
+     * @internal
+     */
+    void releaseCursor(dbcapi_stmt *cursor);
+
+    /// @internal
+    void freeCursors();
+
+    /// Reports the size of the bind arena after it has changed. Called on
+    /// the main thread. @internal
+    void accountBindArena(Isolate *isolate);
+
     /// @internal
     Connection		*connection;
     /// @internal
     dbcapi_stmt         *dbcapi_stmt_ptr;
     /// @internal
     int	num_params;
-    /// @internal
+    /** Bind arena: grow-only bind buffers reused by every execute. Output
+     * parameter values are read from here by getParameterValue.
+     * @internal
+     */
     std::vector<dbcapi_bind_data> params;
     /// @internal
+    std::vector<size_t> params_capacity;
+    /// Set while an execute that binds from params is in flight. @internal
+    bool                params_busy;
+    /// @internal
     executeBaton        *execBaton;
     /// @internal
     uv_mutex_t          *conn_mutex;
     /// @internal
     std::string         sql;
     /// @internal
-    std::vector<dbcapi_bind_param_info> param_infos;
+    paramDescriptors    param_descs;
     /// @internal
     bool                is_dropped;
+    /// Query timeout in seconds from the prepare options, or -1. It is set
+    /// on the statement's handles when they are prepared. @internal
+    int                 query_timeout;
+    /// Timeout the statement's handles have between executes. @internal
+    int idleTimeout() const { return query_timeout >= 0 ? query_timeout : 0; }
+    /// @internal
+    std::vector<dbcapi_stmt*> idle_cursors;
+    /// @internal
+    int                 open_cursors;
+    /// @internal
+    int                 max_open_cursors;
+    /// Native memory of the bind arena. @internal
+    memAccount          arena_mem;
 };
@@ -0,0 +1,62 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include <list>
+#include <unordered_map>
+
+/** Per-connection cache of prepared statements used by Connection::exec.
+ *
+ * Statements are keyed by their SQL text and evicted in least recently
+ * used order once the cache holds more than its capacity. A capacity of
+ * zero (the default) disables the cache. All methods must be called with
+ * the connection's conn_mutex held; the counters are atomic so that stats
+ * can be read without it while an execute holds the lock.
+ * @internal
+ */
+class StatementCache
+{
+  public:
+    StatementCache();
+    ~StatementCache();
+
+    /// Returns the cached handle for sql and its parameter descriptors and
+    /// marks it most recently used, or NULL on a miss.
+    dbcapi_stmt *lookup(const std::string &sql, const paramDescriptors *&descs);
+
+    /// Adds a freshly prepared handle. Returns false (and leaves ownership
+    /// with the caller) if the cache is disabled.
+    bool insert(const std::string &sql, dbcapi_stmt *stmt,
+                const paramDescriptors &descs);
+
+    /// Drops the handle for sql, e.g. after it failed to execute.
+    void remove(const std::string &sql);
+
+    /// Sets the capacity, evicting entries that no longer fit.
+    void setCapacity(size_t capacity);
+
+    /// Frees all cached handles.
+    void clear();
+
+    bool enabled() const { return capacity > 0; }
+    size_t size() const { return num_entries; }
+
+    std::atomic<size_t>		capacity;
+    std::atomic<size_t>		num_entries;
+    std::atomic<uint64_t>	hits;
+    std::atomic<uint64_t>	misses;
+    std::atomic<uint64_t>	evictions;
+
+  private:
+    struct entry
+    {
+        std::string	sql;
+        dbcapi_stmt	*stmt;
+        paramDescriptors descs;
+    };
+    typedef std::list<entry> entry_list;
+
+    void evict(size_t max_entries);
+
+    entry_list	entries;
+    std::unordered_map<std::string, entry_list::iterator> index;
+};
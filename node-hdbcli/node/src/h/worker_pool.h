@@ -0,0 +1,152 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include <deque>
+
+class WorkQueue;
+class WorkerPool;
+struct loopPort;
+
+/// @internal
+struct workRequest
+{
+    uv_work_t		*req;
+    uv_work_cb		work;
+    uv_after_work_cb	after;
+    WorkQueue		*queue;
+    loopPort		*port;
+    uint64_t		queued_at;
+};
+
+/** Completion handle of one event loop. The main thread and every worker
+ * thread that loads the addon has its own. Members other than async are
+ * protected by the pool mutex.
+ * @internal
+ */
+struct loopPort
+{
+    WorkerPool		*pool;
+    uv_async_t		async;
+    std::deque<workRequest> completed;
+    size_t		in_flight;
+    bool		referenced;
+    bool		closing;
+};
+
+/** FIFO of the requests of one connection.
+ *
+ * At most one request of a queue is handed to the pool at a time; the rest
+ * wait here without occupying a thread. When the running request finishes,
+ * its thread takes the next one directly. All members are protected by the
+ * pool mutex.
+ * @internal
+ */
+class WorkQueue
+{
+  public:
+    /// Counters reported by Connection.getQueueStats().
+    struct stats
+    {
+	size_t	    length;
+	double	    oldest_wait_ms;
+	double	    max_wait_ms;
+	double	    completed;
+    };
+
+    WorkQueue();
+
+  private:
+    friend class WorkerPool;
+
+    std::deque<workRequest> waiting;
+    bool	running;
+    double	max_wait_ms;
+    double	completed;
+};
+
+/** Thread pool that runs the blocking DBCAPI calls.
+ *
+ * The pool is separate from the libuv default pool, so slow queries do not
+ * hold up fs, dns or zlib work. It grows with the number of open
+ * connections, between minThreads and maxThreads. Completed requests are
+ * handed back to the loop that queued them through a uv_async_t, where
+ * their after callbacks run in completion order.
+ *
+ * The pool is shared by all threads that load the addon.
+ * @internal
+ */
+class WorkerPool
+{
+  public:
+    /// Counters reported by hana.getThreadPoolStats().
+    struct stats
+    {
+	unsigned    threads;
+	unsigned    max_threads;
+	unsigned    busy;
+	size_t	    queued;
+	double	    completed;
+	double	    avg_wait_ms;
+	double	    max_wait_ms;
+    };
+
+    WorkerPool();
+
+    /// Sets up the completion handle of loop. Must be called on the loop's
+    /// thread before it queues work.
+    bool init(uv_loop_t *loop);
+
+    /// Closes the completion handle of the calling thread's loop. Waits
+    /// for the requests of that loop that are still queued or running and
+    /// runs their after callbacks first.
+    void shutdownLoop();
+
+    /// Queues req like uv_queue_work. If queue is not NULL, req runs after
+    /// all earlier requests of that queue have finished. Must be called on
+    /// a thread whose loop was set up with init.
+    int queueWork(uv_work_t *req, uv_work_cb work, uv_after_work_cb after,
+		  WorkQueue *queue = NULL);
+
+    /// Sets the maximum number of threads. Threads that are already
+    /// running are kept.
+    void setMaxThreads(unsigned max_threads);
+
+    /// Starts threads up to count (at most maxThreads) ahead of a burst of
+    /// requests that should run in parallel.
+    void reserveThreads(unsigned count);
+
+    void getStats(stats &out);
+    void getQueueStats(WorkQueue &queue, WorkQueue::stats &out);
+
+    unsigned	minThreads;
+    unsigned	maxThreads;
+
+  private:
+    static void workerMain(void *arg);
+    static void completionCallback(uv_async_t *handle);
+    static void portClosed(uv_handle_t *handle);
+
+    void growLocked();
+    void recordWaitLocked(const workRequest &r);
+    void drainCompleted(loopPort *port);
+
+    bool		env_checked;
+    uv_key_t		port_key;
+    uv_mutex_t		mutex;
+    uv_cond_t		work_cond;
+    uv_cond_t		done_cond;
+    std::deque<workRequest>	pending;
+    std::vector<uv_thread_t> threads;
+    unsigned		idle;
+    unsigned		busy;
+    double		num_completed;
+    double		num_started;
+    double		total_wait_ms;
+    double		max_wait_ms;
+};
+
+extern WorkerPool dbPool;
+
+/// Runs work on the database worker pool and after on the loop thread.
+int queueWork(uv_work_t *req, uv_work_cb work, uv_after_work_cb after,
+	      WorkQueue *queue = NULL);
@@ -7,14 +7,26 @@
 using namespace v8;
 
 DBCAPIInterface api;
-unsigned openConnections = 0;
+std::atomic<unsigned> openConnections( 0 );
 uv_mutex_t api_mutex;
+static uv_once_t api_mutex_once = UV_ONCE_INIT;
 
 void executeWork( uv_work_t *req )
 /********************************/
 {
     executeBaton *baton = static_cast<executeBaton*>(req->data);
+    baton->timings.end( PHASE_QUEUE );
     scoped_lock lock( baton->obj->conn_mutex );
+    baton->timings.end( PHASE_LOCK );
+
+    executeWorkLocked( baton );
+}
+
+static void executeStatement( executeBaton *baton )
+/*************************************************/
+{
+    const paramDescriptors *descs = NULL;
+    paramDescriptors prepared_descs;
 
    if( baton->obj->conn == NULL ) {
 	baton->err = true;
@@ -23,14 +35,31 @@ void executeWork( uv_work_t *req )
     }
 
     if( baton->dbcapi_stmt_ptr == NULL && baton->stmt.length() > 0 ) {
-	baton->dbcapi_stmt_ptr = api.dbcapi_prepare( baton->obj->conn,
-						 baton->stmt.c_str() );
-	if( baton->dbcapi_stmt_ptr == NULL ) {
-	    baton->err = true;
-	    getErrorMsg( baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state );
-	    return;
+	baton->dbcapi_stmt_ptr = baton->obj->stmt_cache.lookup( baton->stmt, descs );
+	if( baton->dbcapi_stmt_ptr != NULL ) {
+	    baton->cached_stmt = true;
+	} else {
+	    baton->dbcapi_stmt_ptr = api.dbcapi_prepare( baton->obj->conn,
+						     baton->stmt.c_str() );
+	    if( baton->dbcapi_stmt_ptr == NULL ) {
+		baton->err = true;
+		getErrorMsg( baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state );
+		return;
+	    }
+	    baton->prepared_stmt = true;
+	    if( !prepared_descs.describe( baton->dbcapi_stmt_ptr ) ) {
+		baton->err = true;
+		getErrorMsg( baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state );
+		api.dbcapi_free_stmt( baton->dbcapi_stmt_ptr );
+		baton->dbcapi_stmt_ptr = NULL;
+		return;
+	    }
+	    descs = &prepared_descs;
+	    // The cache takes ownership of the handle if it is enabled
+	    baton->cached_stmt = baton->obj->stmt_cache.insert( baton->stmt, baton->dbcapi_stmt_ptr,
+								 prepared_descs );
 	}
-	baton->prepared_stmt = true;
+	baton->timings.end( PHASE_PREPARE );
 
     } else if( baton->dbcapi_stmt_ptr == NULL ) {
 	baton->err = true;
@@ -44,21 +73,48 @@ void executeWork( uv_work_t *req )
 	return;
     }
 
-    if (!checkParameterCount(baton->error_code, baton->error_msg, baton->sql_state,
-        baton->provided_params, baton->dbcapi_stmt_ptr)) {
-        baton->err = true;
-        return;
+    if( descs == NULL ) {
+	if( baton->obj_stmt != NULL && baton->dbcapi_stmt_ptr == baton->obj_stmt->dbcapi_stmt_ptr ) {
+	    descs = &baton->obj_stmt->param_descs;
+	} else {
+	    if( !prepared_descs.describe( baton->dbcapi_stmt_ptr ) ) {
+		baton->err = true;
+		getErrorMsg( baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state );
+		return;
+	    }
+	    descs = &prepared_descs;
+	}
     }
 
-    getBindParameters(baton->provided_params, baton->params, baton->dbcapi_stmt_ptr);
-
     bool sendParamData = false;
-    if (!bindParameters(baton->obj->conn, baton->dbcapi_stmt_ptr, baton->params,
-        baton->error_code, baton->error_msg, baton->sql_state, sendParamData)) {
-        baton->err = true;
-        return;
+    if (baton->use_arena) {
+        // Values were written into the statement's bind buffers up front
+        if (!bindArenaParameters(baton->obj->conn, baton->dbcapi_stmt_ptr, baton->obj_stmt->params,
+            baton->error_code, baton->error_msg, baton->sql_state)) {
+            baton->err = true;
+            return;
+        }
+    } else {
+        if (!checkParameterCount(baton->error_code, baton->error_msg, baton->sql_state,
+            baton->provided_params, *descs)) {
+            baton->err = true;
+            return;
+        }
+
+        getBindParameters(baton->provided_params, baton->params, *descs);
+
+        if (!bindParameters(baton->obj->conn, baton->dbcapi_stmt_ptr, baton->params, *descs,
+            baton->error_code, baton->error_msg, baton->sql_state, sendParamData)) {
+            baton->err = true;
+            return;
+        }
+        for (size_t i = 0; i < baton->params.size(); i++) {
+            baton->mem.add(MEM_BATON, (int64_t)(sizeof(dbcapi_bind_data) + baton->params[i]->value.buffer_size));
+        }
     }
 
+    baton->bind_count = baton->use_arena ? (int)baton->obj_stmt->params.size() : (int)baton->params.size();
+
     if (sendParamData) {
         baton->send_param_data = true;
         if (baton->obj_stmt->execBaton != NULL && baton->obj_stmt->execBaton != baton) {
@@ -67,40 +123,109 @@ void executeWork( uv_work_t *req )
         baton->obj_stmt->execBaton = baton;
     }
 
-    dbcapi_bool success_execute = api.dbcapi_execute( baton->dbcapi_stmt_ptr );
+    baton->timings.end( PHASE_BIND );
 
-    if (success_execute && baton->obj_stmt != NULL) {
-        copyParameters( baton->obj_stmt->params, baton->params );
+    // Cached and prepared handles are reused, so they get their own timeout
+    // back after an exec that had a different one
+    int restore_to = -1;
+    if( baton->cached_stmt ) {
+	restore_to = 0;
+    } else if( baton->obj_stmt != NULL && baton->dbcapi_stmt_ptr == baton->obj_stmt->dbcapi_stmt_ptr ) {
+	restore_to = baton->obj_stmt->idleTimeout();
     }
+    dbcapi_bool success_execute;
+    {
+	scopedQueryTimeout timeout( baton->dbcapi_stmt_ptr, baton->query_timeout, restore_to );
+	success_execute = timeout.ok && api.dbcapi_execute( baton->dbcapi_stmt_ptr );
+    }
+    baton->timings.end( PHASE_EXECUTE );
 
     if( !success_execute ) {
 	baton->err = true;
 	getErrorMsg( baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state );
+	if( baton->cached_stmt ) {
+	    // Do not keep a handle that may have become invalid
+	    baton->obj->stmt_cache.remove( baton->stmt );
+	    baton->dbcapi_stmt_ptr = NULL;
+	    baton->cached_stmt = false;
+	}
 	return;
     }
 
-    if( !fetchResultSet( baton->dbcapi_stmt_ptr, baton->rows_affected, baton->col_names,
-			 baton->string_vals, baton->num_vals, baton->int_vals,
-			 baton->string_len, baton->col_types, baton->col_native_types) ) {
+    // Cached handles may be reused by another exec before fillResult runs
+    baton->function_code = api.dbcapi_get_function_code( baton->dbcapi_stmt_ptr );
+
+    bool fetched;
+    baton->mem.setConnection( &baton->obj->mem );
+    if( baton->columnar != NULL ) {
+	fetched = baton->columnar->fetch( baton->dbcapi_stmt_ptr, NULL, &baton->mem );
+    } else {
+	fetched = fetchResultSet( baton->dbcapi_stmt_ptr, baton->rows_affected, baton->col_names,
+				  baton->string_vals, baton->num_vals, baton->int_vals,
+				  baton->string_len, baton->col_types, baton->col_native_types,
+				  NULL, &baton->mem, &baton->limit );
+    }
+    baton->timings.end( PHASE_FETCH );
+    if( !fetched ) {
 	baton->err = true;
-	getErrorMsg( baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state );
+	if( baton->mem.exceeded ) {
+	    getErrorMsg( JS_ERR_MEMORY_LIMIT, baton->error_code, baton->error_msg, baton->sql_state );
+	} else if( baton->limit.exceeded ) {
+	    getErrorMsg( JS_ERR_RESULT_TOO_LARGE, baton->error_code, baton->error_msg, baton->sql_state );
+	} else if( baton->limit.spill_failed ) {
+	    getErrorMsg( JS_ERR_SPILL, baton->error_code, baton->error_msg, baton->sql_state );
+	} else {
+	    getErrorMsg( baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state );
+	}
 	return;
     }
 }
 
+void executeWorkLocked( executeBaton *baton )
+/*******************************************/
+{
+    executeStatement( baton );
+
+    // Operations under the threshold only compare their elapsed time
+    slowQueryLog *log = baton->obj->slow_log.load( std::memory_order_acquire );
+    if( log != NULL ) {
+	log->capture( baton, "exec" );
+    }
+}
+
+void releaseBindArena( executeBaton *baton )
+/******************************************/
+{
+    Statement *stmt = baton->obj_stmt;
+
+    if( stmt == NULL ) {
+	return;
+    }
+    if( baton->use_arena ) {
+	// Output values are already in the statement's bind buffers
+	stmt->params_busy = false;
+	baton->use_arena = false;
+    } else if( !baton->err && !stmt->params_busy ) {
+	storeParameters( stmt->params, stmt->params_capacity, stmt->param_descs, baton->params );
+	stmt->accountBindArena( Isolate::GetCurrent() );
+    }
+}
+
 void executeAfter( uv_work_t *req )
 /*********************************/
 {
     Isolate *isolate = Isolate::GetCurrent();
     HandleScope scope( isolate );
     executeBaton *baton = static_cast<executeBaton*>( req->data );
+    releaseBindArena( baton );
     Persistent<Value> ResultSet;
     fillResult( baton, ResultSet );
     ResultSet.Reset();
 
     scoped_lock	lock( baton->obj->conn_mutex );
 
-    if( baton->dbcapi_stmt_ptr != NULL && baton->prepared_stmt && baton->del_stmt_ptr ) {
+    if( baton->dbcapi_stmt_ptr != NULL && baton->prepared_stmt && baton->del_stmt_ptr &&
+	!baton->cached_stmt ) {
 	api.dbcapi_free_stmt( baton->dbcapi_stmt_ptr );
 	baton->dbcapi_stmt_ptr = NULL;
     }
@@ -125,30 +250,174 @@ bool cleanAPI()
     return false;
 }
 
-void init( Local<Object> exports )
+NODE_API_FUNC( setThreadPoolSize )
 /********************************/
 {
-    uv_mutex_init(&api_mutex);
-    Isolate *isolate = exports->GetIsolate();
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+
+    if( args.Length() != 1 || !args[0]->IsUint32() || args[0]->Uint32Value() == 0 ) {
+	throwErrorIP( 0, "setThreadPoolSize(size)",
+		      "positive integer", getJSTypeName( getJSType( args[0] ) ).c_str() );
+	return;
+    }
+    dbPool.setMaxThreads( args[0]->Uint32Value() );
+    args.GetReturnValue().SetUndefined();
+}
+
+NODE_API_FUNC( getThreadPoolStats )
+/*********************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    WorkerPool::stats stats;
+    Local<Object> obj = Object::New( isolate );
+
+    dbPool.getStats( stats );
+    obj->Set( String::NewFromUtf8( isolate, "threads" ), Integer::NewFromUnsigned( isolate, stats.threads ) );
+    obj->Set( String::NewFromUtf8( isolate, "maxThreads" ), Integer::NewFromUnsigned( isolate, stats.max_threads ) );
+    obj->Set( String::NewFromUtf8( isolate, "busy" ), Integer::NewFromUnsigned( isolate, stats.busy ) );
+    obj->Set( String::NewFromUtf8( isolate, "queued" ), Number::New( isolate, (double)stats.queued ) );
+    obj->Set( String::NewFromUtf8( isolate, "completed" ), Number::New( isolate, stats.completed ) );
+    obj->Set( String::NewFromUtf8( isolate, "avgWaitMs" ), Number::New( isolate, stats.avg_wait_ms ) );
+    obj->Set( String::NewFromUtf8( isolate, "maxWaitMs" ), Number::New( isolate, stats.max_wait_ms ) );
+    args.GetReturnValue().Set( obj );
+}
+
+NODE_API_FUNC( getStats )
+/***********************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    bool reset = false;
+
+    if( args.Length() > 0 && !args[0]->IsUndefined() && !convertToBool( args[0], reset ) ) {
+	throwErrorIP( 0, "getStats([reset])", "boolean", getJSTypeName( getJSType( args[0] ) ).c_str() );
+	return;
+    }
+    args.GetReturnValue().Set( processStats.toObject( isolate ) );
+    if( reset ) {
+	processStats.reset();
+    }
+}
+
+NODE_API_FUNC( getMemoryStats )
+/*****************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+
+    args.GetReturnValue().Set( processMemory.toObject( isolate ) );
+}
+
+NODE_API_FUNC( setMemoryLimit )
+/*****************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+
+    if( args.Length() != 1 || !args[0]->IsNumber() || args[0]->NumberValue() < 0 ) {
+	throwErrorIP( 0, "setMemoryLimit(bytes)",
+		      "non-negative number", getJSTypeName( getJSType( args[0] ) ).c_str() );
+	return;
+    }
+    processMemory.total.limit = (int64_t)args[0]->NumberValue();
+    args.GetReturnValue().SetUndefined();
+}
+
+static void initApiMutex()
+/************************/
+{
+    uv_mutex_init( &api_mutex );
+}
+
+#if NODE_MAJOR_VERSION >= 10
+static void cleanupIsolate( void *arg )
+/*************************************/
+{
+    Isolate *isolate = static_cast<Isolate*>( arg );
+    addonContext *ctx = getAddonContext( isolate );
+
+    // Waits for the requests the isolate still has running first
+    dbPool.shutdownLoop();
+    if( ctx != NULL ) {
+	// Connections and pools that are still open keep the context
+	releaseDbcapiContext( ctx->dbcapi_ctx );
+    }
+    perIsolateFunction::ClearAll( isolate );
+    destroyAddonContext( isolate );
+}
+#endif
+
+void init( Local<Object> exports, Local<Value> module, Local<Context> context, void *priv )
+/****************************************************************************************/
+{
+    // Runs once for the main thread and once for every worker thread
+    uv_once( &api_mutex_once, initApiMutex );
+    Isolate *isolate = context->GetIsolate();
     Statement::Init( isolate );
     Connection::Init( isolate );
     ResultSet::Init( isolate );
+    SpilledResult::Init( isolate );
+    Pool::Init( isolate, exports );
     NODE_SET_METHOD( exports, "createConnection", Connection::NewInstance );
     NODE_SET_METHOD( exports, "createClient", Connection::NewInstance );
+    NODE_SET_METHOD( exports, "createPool", Pool::NewInstance );
+    NODE_SET_METHOD( exports, "getPool", Pool::GetInstance );
+    NODE_SET_METHOD( exports, "setThreadPoolSize", setThreadPoolSize );
+    NODE_SET_METHOD( exports, "getThreadPoolStats", getThreadPoolStats );
+    NODE_SET_METHOD( exports, "getStats", getStats );
+    NODE_SET_METHOD( exports, "getMemoryStats", getMemoryStats );
+    NODE_SET_METHOD( exports, "setMemoryLimit", setMemoryLimit );
 
-    if (api.initialized == false) {
+    addonContext *ctx = createAddonContext( isolate );
+    if( !dbPool.init( ctx->loop ) ) {
+	std::string sqlState = "HY000";
+	std::string errText = "Failed to start the database thread pool.";
+	throwError( JS_ERR_GENERAL_ERROR, errText, sqlState );
+	return;
+    }
+
+    {
         scoped_lock api_lock(api_mutex);
         if (api.initialized == false) {
             unsigned int max_api_ver;
             char * env = getenv("DBCAPI_API_DLL");
-            if (!dbcapi_initialize_interface(&api, env) ||
-                !api.dbcapi_init("Node.js", _DBCAPI_VERSION, &max_api_ver)) {
+            char * record = getenv("HANA_DBCAPI_RECORD");
+            char * replay = getenv("HANA_DBCAPI_REPLAY");
+            std::string errText = "Failed to load DBCAPI.";
+            bool replaying = (replay != NULL && replay[0] != '\0');
+            bool loaded;
+            if (replaying) {
+                loaded = initializeApiReplay(&api, replay, getenv("HANA_DBCAPI_REPLAY_SCALE"), errText);
+            } else {
+                loaded = dbcapi_initialize_interface(&api, env) != 0;
+            }
+            // The probes time the library itself, without the recorder
+            if (loaded) {
+                installApiProbes(&api);
+            }
+            if (loaded && !replaying && record != NULL && record[0] != '\0') {
+                loaded = installApiRecorder(&api, record, errText);
+            }
+            if (!loaded || !api.dbcapi_init("Node.js", _DBCAPI_VERSION, &max_api_ver)) {
                 std::string sqlState = "HY000";
-                std::string errText = "Failed to load DBCAPI.";
                 throwError(JS_ERR_INITIALIZING_DBCAPI, errText, sqlState);
+                return;
             }
         }
     }
+
+    // Each isolate gets its own client library context if it is supported
+    if( ctx->dbcapi_ctx == NULL && api.dbcapi_init_ex != NULL ) {
+	dbcapi_u32 max_api_ver;
+	ctx->dbcapi_ctx = api.dbcapi_init_ex( "Node.js", _DBCAPI_VERSION, &max_api_ver );
+	retainDbcapiContext( ctx->dbcapi_ctx );
+    }
+
+#if NODE_MAJOR_VERSION >= 10
+    node::AddEnvironmentCleanupHook( isolate, cleanupIsolate, isolate );
+#endif
 }
 
-NODE_MODULE( DRIVER_NAME, init )
+NODE_MODULE_CONTEXT_AWARE( DRIVER_NAME, init )
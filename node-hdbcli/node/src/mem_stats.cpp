@@ -0,0 +1,164 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include "nodever_cover.h"
+#include "hana_utils.h"
+
+using namespace v8;
+
+memStats processMemory;
+
+static const char *categoryNames[MEM_COUNT] = {
+    "baton", "fetch", "columnar", "bindArena", "batch", "resultSet"
+};
+
+memStats::memStats()
+/******************/
+{
+    peak = 0;
+    rejected = 0;
+    for( int i = 0; i < MEM_COUNT; i++ ) {
+	by_category[i] = 0;
+    }
+}
+
+Local<Object> memStats::toObject( Isolate *isolate )
+/**************************************************/
+{
+    EscapableHandleScope scope( isolate );
+    Local<Object> obj = Object::New( isolate );
+
+    obj->Set( String::NewFromUtf8( isolate, "totalBytes" ), Number::New( isolate, (double)total.bytes.load() ) );
+    obj->Set( String::NewFromUtf8( isolate, "peakBytes" ), Number::New( isolate, (double)peak.load() ) );
+    obj->Set( String::NewFromUtf8( isolate, "limitBytes" ), Number::New( isolate, (double)total.limit.load() ) );
+    obj->Set( String::NewFromUtf8( isolate, "rejected" ), Number::New( isolate, (double)rejected.load() ) );
+    for( int i = 0; i < MEM_COUNT; i++ ) {
+	obj->Set( String::NewFromUtf8( isolate, categoryNames[i] ),
+		  Number::New( isolate, (double)by_category[i].load() ) );
+    }
+    return scope.Escape( obj );
+}
+
+memAccount::memAccount()
+/**********************/
+{
+    exceeded = false;
+    conn_size = 0;
+    reported = 0;
+    conn = NULL;
+    isolate = NULL;
+    for( int i = 0; i < MEM_COUNT; i++ ) {
+	sizes[i] = 0;
+    }
+}
+
+memAccount::~memAccount()
+/***********************/
+{
+    release();
+}
+
+void memAccount::setConnection( memCounter *counter )
+/***************************************************/
+{
+    conn = counter;
+}
+
+bool memAccount::charge( memCategory category, int64_t size )
+/***********************************************************/
+{
+    int64_t limit = processMemory.total.limit.load();
+    int64_t total = ( processMemory.total.bytes += size );
+
+    if( limit > 0 && size > 0 && total > limit ) {
+	processMemory.total.bytes -= size;
+	processMemory.rejected++;
+	exceeded = true;
+	return false;
+    }
+    if( conn != NULL ) {
+	int64_t conn_limit = conn->limit.load();
+	int64_t conn_total = ( conn->bytes += size );
+	if( conn_limit > 0 && size > 0 && conn_total > conn_limit ) {
+	    conn->bytes -= size;
+	    processMemory.total.bytes -= size;
+	    processMemory.rejected++;
+	    exceeded = true;
+	    return false;
+	}
+	conn_size += size;
+    }
+    processMemory.by_category[category] += size;
+    sizes[category] += size;
+
+    int64_t peak = processMemory.peak.load();
+    while( total > peak && !processMemory.peak.compare_exchange_weak( peak, total ) ) {
+    }
+    return true;
+}
+
+void memAccount::add( memCategory category, int64_t size )
+/********************************************************/
+{
+    int64_t total = ( processMemory.total.bytes += size );
+    if( conn != NULL ) {
+	conn->bytes += size;
+	conn_size += size;
+    }
+    processMemory.by_category[category] += size;
+    sizes[category] += size;
+
+    int64_t peak = processMemory.peak.load();
+    while( total > peak && !processMemory.peak.compare_exchange_weak( peak, total ) ) {
+    }
+}
+
+void memAccount::set( memCategory category, int64_t size )
+/********************************************************/
+{
+    if( size != sizes[category] ) {
+	add( category, size - sizes[category] );
+    }
+}
+
+void memAccount::report( Isolate *isolate_ )
+/******************************************/
+{
+    int64_t delta = total() - reported;
+
+    isolate = isolate_;
+    if( delta != 0 ) {
+	isolate->AdjustAmountOfExternalAllocatedMemory( delta );
+	reported += delta;
+    }
+}
+
+void memAccount::release()
+/************************/
+{
+    for( int i = 0; i < MEM_COUNT; i++ ) {
+	if( sizes[i] != 0 ) {
+	    processMemory.by_category[i] -= sizes[i];
+	    processMemory.total.bytes -= sizes[i];
+	    sizes[i] = 0;
+	}
+    }
+    if( conn != NULL && conn_size != 0 ) {
+	conn->bytes -= conn_size;
+    }
+    conn_size = 0;
+    if( reported != 0 && isolate != NULL ) {
+	isolate->AdjustAmountOfExternalAllocatedMemory( -reported );
+    }
+    reported = 0;
+}
+
+int64_t memAccount::total() const
+/*******************************/
+{
+    int64_t sum = 0;
+    for( int i = 0; i < MEM_COUNT; i++ ) {
+	sum += sizes[i];
+    }
+    return sum;
+}
@@ -0,0 +1,265 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include "hana_utils.h"
+
+#define SUB_BUCKET_BITS		4
+#define SUB_BUCKET_COUNT	( 1 << SUB_BUCKET_BITS )
+// Up to 2^40 us, about 12 days
+#define BUCKET_COUNT		( ( 40 - SUB_BUCKET_BITS + 2 ) * SUB_BUCKET_COUNT )
+
+opStats processStats;
+
+static const char *phaseNames[PHASE_COUNT] = {
+    "queue", "lock", "prepare", "bind", "execute", "fetch", "convert", "total"
+};
+
+latencyHistogram::latencyHistogram()
+/**********************************/
+{
+    reset();
+}
+
+void latencyHistogram::reset()
+/****************************/
+{
+    counts.clear();
+    total = 0;
+    sum_us = 0;
+    min_us = 0;
+    max_us = 0;
+}
+
+size_t latencyHistogram::bucketOf( uint64_t us )
+/**********************************************/
+{
+    if( us < SUB_BUCKET_COUNT ) {
+	return (size_t)us;
+    }
+    int msb = 63;
+    while( ( us >> msb ) == 0 ) {
+	msb--;
+    }
+    int shift = msb - SUB_BUCKET_BITS;
+    size_t bucket = (size_t)( shift + 1 ) * SUB_BUCKET_COUNT +
+		    (size_t)( ( us >> shift ) & ( SUB_BUCKET_COUNT - 1 ) );
+    return bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1;
+}
+
+uint64_t latencyHistogram::highestValueOf( size_t bucket )
+/********************************************************/
+{
+    if( bucket < SUB_BUCKET_COUNT ) {
+	return bucket;
+    }
+    int shift = (int)( bucket / SUB_BUCKET_COUNT ) - 1;
+    uint64_t sub = bucket % SUB_BUCKET_COUNT;
+    return ( ( SUB_BUCKET_COUNT + sub + 1 ) << shift ) - 1;
+}
+
+void latencyHistogram::record( uint64_t ns )
+/******************************************/
+{
+    uint64_t us = ns / 1000;
+
+    if( counts.empty() ) {
+	counts.resize( BUCKET_COUNT, 0 );
+    }
+    counts[bucketOf( us )]++;
+    if( total == 0 || us < min_us ) {
+	min_us = us;
+    }
+    if( us > max_us ) {
+	max_us = us;
+    }
+    total++;
+    sum_us += us;
+}
+
+uint64_t latencyHistogram::percentile( double fraction ) const
+/************************************************************/
+{
+    uint64_t rank = (uint64_t)( fraction * total + 0.5 );
+    uint64_t seen = 0;
+
+    if( rank == 0 ) {
+	rank = 1;
+    }
+    for( size_t i = 0; i < counts.size(); i++ ) {
+	seen += counts[i];
+	if( seen >= rank ) {
+	    uint64_t value = highestValueOf( i );
+	    return value < max_us ? value : max_us;
+	}
+    }
+    return max_us;
+}
+
+void latencyHistogram::getSummary( summary &out ) const
+/*****************************************************/
+{
+    memset( &out, 0, sizeof( out ) );
+    if( total == 0 ) {
+	return;
+    }
+    out.count = (double)total;
+    out.min_ms = min_us / 1e3;
+    out.max_ms = max_us / 1e3;
+    out.mean_ms = (double)sum_us / total / 1e3;
+    out.p50_ms = percentile( 0.5 ) / 1e3;
+    out.p90_ms = percentile( 0.9 ) / 1e3;
+    out.p99_ms = percentile( 0.99 ) / 1e3;
+    out.p999_ms = percentile( 0.999 ) / 1e3;
+}
+
+opStats::opStats()
+/****************/
+{
+    uv_mutex_init( &mutex );
+}
+
+opStats::~opStats()
+/*****************/
+{
+    uv_mutex_destroy( &mutex );
+}
+
+void opStats::record( const opTimings &timings )
+/**********************************************/
+{
+    scoped_lock lock( mutex );
+    for( int i = 0; i < PHASE_COUNT; i++ ) {
+	// Phases the operation went through; waits may be shorter than the
+	// clock resolution, so they are always recorded
+	if( timings.phase_ns[i] > 0 || i == PHASE_QUEUE || i == PHASE_LOCK ) {
+	    phases[i].record( timings.phase_ns[i] );
+	}
+    }
+}
+
+void opStats::reset()
+/*******************/
+{
+    scoped_lock lock( mutex );
+    for( int i = 0; i < PHASE_COUNT; i++ ) {
+	phases[i].reset();
+    }
+}
+
+Local<Object> opStats::toObject( Isolate *isolate )
+/*************************************************/
+{
+    EscapableHandleScope scope( isolate );
+    Local<Object> obj = Object::New( isolate );
+    latencyHistogram::summary summaries[PHASE_COUNT];
+
+    {
+	scoped_lock lock( mutex );
+	for( int i = 0; i < PHASE_COUNT; i++ ) {
+	    phases[i].getSummary( summaries[i] );
+	}
+    }
+
+    for( int i = 0; i < PHASE_COUNT; i++ ) {
+	const latencyHistogram::summary &s = summaries[i];
+	Local<Object> phase = Object::New( isolate );
+	phase->Set( String::NewFromUtf8( isolate, "count" ), Number::New( isolate, s.count ) );
+	phase->Set( String::NewFromUtf8( isolate, "minMs" ), Number::New( isolate, s.min_ms ) );
+	phase->Set( String::NewFromUtf8( isolate, "maxMs" ), Number::New( isolate, s.max_ms ) );
+	phase->Set( String::NewFromUtf8( isolate, "meanMs" ), Number::New( isolate, s.mean_ms ) );
+	phase->Set( String::NewFromUtf8( isolate, "p50Ms" ), Number::New( isolate, s.p50_ms ) );
+	phase->Set( String::NewFromUtf8( isolate, "p90Ms" ), Number::New( isolate, s.p90_ms ) );
+	phase->Set( String::NewFromUtf8( isolate, "p99Ms" ), Number::New( isolate, s.p99_ms ) );
+	phase->Set( String::NewFromUtf8( isolate, "p999Ms" ), Number::New( isolate, s.p999_ms ) );
+	obj->Set( String::NewFromUtf8( isolate, phaseNames[i] ), phase );
+    }
+    return scope.Escape( obj );
+}
+
+void recordTimings( Connection *conn, opTimings &timings )
+/********************************************************/
+{
+    timings.phase_ns[PHASE_TOTAL] = uv_hrtime() - timings.started_at;
+    if( conn != NULL ) {
+	conn->stats.record( timings );
+    }
+    processStats.record( timings );
+}
+
+uint64_t hashSql( const std::string &sql )
+/****************************************/
+{
+    // FNV-1a over 8 byte words, so that long statements stay cheap
+    const char *p = sql.data();
+    size_t len = sql.length();
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for( ; len >= 8; p += 8, len -= 8 ) {
+	uint64_t word;
+	memcpy( &word, p, 8 );
+	hash = ( hash ^ word ) * 0x100000001b3ULL;
+    }
+    for( ; len > 0; p++, len-- ) {
+	hash = ( hash ^ (unsigned char)*p ) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void traceOperation( Connection *	conn,
+		     const char *	operation,
+		     const std::string &sql,
+		     int		function_code,
+		     const opTimings &	timings,
+		     double		rows,
+		     double		bytes,
+		     int		bind_count,
+		     int		error_code )
+/******************************************************/
+{
+    if( !isTracing( conn ) ) {
+	return;
+    }
+    traceCallbackBaton *baton = conn->traceBaton;
+    traceRecord *rec = new traceRecord();
+    rec->operation = operation;
+    rec->sql_hash = hashSql( sql );
+    rec->function_code = function_code;
+    rec->error_code = error_code;
+    rec->rows = rows;
+    rec->bytes = bytes;
+    rec->bind_count = bind_count;
+    memcpy( rec->phase_ns, timings.phase_ns, sizeof( rec->phase_ns ) );
+
+    rec->next = baton->head.load();
+    while( !baton->head.compare_exchange_weak( rec->next, rec ) ) {
+    }
+    uv_async_send( &baton->async );
+}
+
+void traceExecute( executeBaton *baton, const char *operation )
+/*************************************************************/
+{
+    if( !isTracing( baton->obj ) ) {
+	return;
+    }
+
+    double rows = 0;
+    double bytes = 0;
+    if( baton->columnar != NULL ) {
+	rows = (double)baton->columnar->num_rows;
+    } else if( !baton->col_names.empty() ) {
+	rows = (double)( baton->col_types.size() / baton->col_names.size() );
+	for( size_t i = 0; i < baton->string_len.size(); i++ ) {
+	    bytes += (double)*baton->string_len[i];
+	}
+	bytes += (double)( baton->num_vals.size() * sizeof( double ) +
+			   baton->int_vals.size() * sizeof( int ) );
+    } else if( baton->rows_affected > 0 ) {
+	rows = baton->rows_affected;
+    }
+
+    const std::string &sql = ( baton->stmt.empty() && baton->obj_stmt != NULL ) ? baton->obj_stmt->sql
+										: baton->stmt;
+    traceOperation( baton->obj, operation, sql, baton->function_code, baton->timings,
+		    rows, bytes, baton->bind_count, baton->err ? baton->error_code : 0 );
+}
@@ -0,0 +1,1437 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include "nodever_cover.h"
+#include "hana_utils.h"
+
+using namespace v8;
+
+// Upper bounds of the acquire latency histogram buckets in milliseconds
+static const double histogramBounds[POOL_HISTOGRAM_BUCKETS - 1] = {
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000
+};
+
+static const char *pingSql = "SELECT 1 FROM DUMMY";
+static const char *createPoolUsage = "createPool(conn_params[, options])";
+
+struct poolBaton {
+    Persistent<Function> 	callback;
+    bool 			err;
+    int                         error_code;
+    std::string 		error_msg;
+    std::string                 sql_state;
+    bool 			callback_required;
+
+    Pool			*pool;
+    dbcapi_connection		*conn;
+    void			*waiter;
+    Connection			*obj;
+    Persistent<Object>		connObj;
+
+    poolBaton() {
+	pool = NULL;
+	conn = NULL;
+	waiter = NULL;
+	obj = NULL;
+	err = false;
+	callback_required = false;
+    }
+
+    ~poolBaton() {
+	pool = NULL;
+	obj = NULL;
+	callback.Reset();
+	connObj.Reset();
+    }
+};
+
+static uv_once_t registry_once = UV_ONCE_INIT;
+static uv_mutex_t registry_mutex;
+static std::map<std::string, poolCore *> *registry;
+
+static void initRegistry()
+/************************/
+{
+    uv_mutex_init( &registry_mutex );
+    registry = new std::map<std::string, poolCore *>();
+}
+
+static void closeConnection( dbcapi_connection *conn )
+/****************************************************/
+{
+    api.dbcapi_disconnect( conn );
+    api.dbcapi_free_connection( conn );
+    openConnections--;
+}
+
+poolCore::poolCore()
+/******************/
+{
+    uv_mutex_init( &mutex );
+    dbcapi_ctx = NULL;
+    min_size = 0;
+    max_size = 0;
+    idle_timeout_ms = 0;
+    max_wait_ms = 0;
+    validate_on_borrow = false;
+    slow_log = NULL;
+    in_use = 0;
+    opening = 0;
+    destroying = 0;
+    attached = 0;
+    refs = 0;
+    closed = false;
+    created = 0;
+    destroyed = 0;
+    acquired = 0;
+    timeouts = 0;
+    validation_failures = 0;
+    errors = 0;
+    for( int i = 0; i < POOL_HISTOGRAM_BUCKETS; i++ ) {
+	histogram[i] = 0;
+    }
+}
+
+poolCore::~poolCore()
+/*******************/
+{
+    for( size_t i = 0; i < idle.size(); i++ ) {
+	closeConnection( idle[i].conn );
+    }
+    releaseDbcapiContext( dbcapi_ctx );
+    if( slow_log != NULL ) {
+	slow_log->release();
+    }
+    uv_mutex_destroy( &mutex );
+}
+
+bool poolCore::putLocked( dbcapi_connection *conn )
+/*************************************************/
+{
+    if( closed ) {
+	return false;
+    }
+    if( !tickets.empty() ) {
+	Pool *pool = tickets.front();
+	tickets.pop_front();
+	Pool::handoff h;
+	h.conn = conn;
+	h.error_code = 0;
+	pool->ready.push_back( h );
+	in_use++;
+	uv_async_send( pool->async );
+    } else {
+	pooledConnection pc;
+	pc.conn = conn;
+	pc.last_used = uv_hrtime();
+	idle.push_back( pc );
+    }
+    return true;
+}
+
+void poolCore::failLocked( int code, const std::string &msg, const std::string &state )
+/*************************************************************************************/
+{
+    // Fail a waiter that no other connection being opened can serve, so
+    // that acquire does not hang while the server is unreachable
+    if( tickets.size() > opening ) {
+	Pool *pool = tickets.front();
+	tickets.pop_front();
+	Pool::handoff h;
+	h.conn = NULL;
+	h.error_code = code;
+	h.error_msg = msg;
+	h.sql_state = state;
+	pool->ready.push_back( h );
+	uv_async_send( pool->async );
+    }
+}
+
+unsigned poolCore::growLocked()
+/*****************************/
+{
+    unsigned count = 0;
+
+    // Open connections for the waiters that the ones being opened won't
+    // serve, and to get back to min after connections failed or were lost
+    while( !closed && idle.size() + in_use + opening < max_size &&
+	   ( tickets.size() > opening || idle.size() + in_use + opening < min_size ) ) {
+	opening++;
+	count++;
+    }
+    return count;
+}
+
+static bool removeTicket( std::deque<Pool *> &tickets, Pool *pool )
+/*****************************************************************/
+{
+    for( size_t i = tickets.size(); i > 0; i-- ) {
+	if( tickets[i - 1] == pool ) {
+	    tickets.erase( tickets.begin() + ( i - 1 ) );
+	    return true;
+	}
+    }
+    return false;
+}
+
+perIsolateFunction Pool::constructor;
+
+Pool::waiter::~waiter()
+/*********************/
+{
+    callback.Reset();
+    delete job;
+}
+
+Pool::Pool( poolCore *pool_core )
+/*******************************/
+{
+    core = pool_core;
+    isolate = NULL;
+    destroying = 0;
+    closed = false;
+    cleanup_hook = false;
+    timer = NULL;
+    async = NULL;
+}
+
+Pool::~Pool()
+/***********/
+{
+    if( !closed ) {
+	detach( false );
+    }
+    close_callback.Reset();
+
+    bool last;
+    {
+	scoped_lock lock( core->mutex );
+	last = ( --core->refs == 0 );
+    }
+    if( last ) {
+	delete core;
+    }
+}
+
+void Pool::Init( Isolate *isolate, Local<Object> exports )
+/********************************************************/
+{
+    HandleScope scope( isolate );
+    Local<FunctionTemplate> tpl = FunctionTemplate::New( isolate, New );
+    tpl->SetClassName( String::NewFromUtf8( isolate, "Pool" ) );
+    tpl->InstanceTemplate()->SetInternalFieldCount( 1 );
+
+    NODE_SET_PROTOTYPE_METHOD( tpl, "acquire", acquire );
+    NODE_SET_PROTOTYPE_METHOD( tpl, "release", release );
+    NODE_SET_PROTOTYPE_METHOD( tpl, "exec", exec );
+    NODE_SET_PROTOTYPE_METHOD( tpl, "close", close );
+    NODE_SET_PROTOTYPE_METHOD( tpl, "getStats", getStats );
+    NODE_SET_PROTOTYPE_METHOD( tpl, "getSlowQueries", getSlowQueries );
+    NODE_SET_PROTOTYPE_METHOD( tpl, "flushSlowQueries", flushSlowQueries );
+
+    constructor.Reset( isolate, tpl->GetFunction() );
+    exports->Set( String::NewFromUtf8( isolate, "Pool" ), tpl->GetFunction() );
+}
+
+NODE_API_FUNC( Pool::NewInstance )
+/********************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    const unsigned argc = 2;
+    Handle<Value> argv[argc] = { args[0], args[1] };
+    Local<Function> cons = constructor.Get( isolate );
+    args.GetReturnValue().Set( cons->NewInstance( argc, argv ) );
+}
+
+NODE_API_FUNC( Pool::GetInstance )
+/********************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+
+    if( args.Length() < 1 || !args[0]->IsString() ) {
+	throwErrorIP( 0, "getPool(name)", "string",
+		      getJSTypeName( getJSType( args[0] ) ).c_str() );
+	return;
+    }
+
+    String::Utf8Value name( args[0]->ToString() );
+    poolCore *core = NULL;
+    {
+	uv_once( &registry_once, initRegistry );
+	scoped_lock reg_lock( registry_mutex );
+	std::map<std::string, poolCore *>::iterator it = registry->find( *name );
+	if( it != registry->end() ) {
+	    core = it->second;
+	    scoped_lock lock( core->mutex );
+	    core->attached++;
+	    core->refs++;
+	}
+    }
+    if( core == NULL ) {
+	throwError( JS_ERR_POOL_NOT_FOUND );
+	return;
+    }
+
+    // The constructor attaches to the core instead of creating one
+    const unsigned argc = 1;
+    Handle<Value> argv[argc] = { External::New( isolate, core ) };
+    Local<Function> cons = constructor.Get( isolate );
+    args.GetReturnValue().Set( cons->NewInstance( argc, argv ) );
+}
+
+static bool getPoolOption( Local<Object> options, const char *name, unsigned &value )
+/************************************************************************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    Local<Value> val = options->Get( String::NewFromUtf8( isolate, name ) );
+
+    if( val->IsUndefined() ) {
+	return true;
+    }
+    if( !val->IsUint32() ) {
+	throwErrorIP( 1, createPoolUsage, "non-negative integer",
+		      getJSTypeName( getJSType( val ) ).c_str() );
+	return false;
+    }
+    value = val->Uint32Value();
+    return true;
+}
+
+NODE_API_FUNC( Pool::New )
+/************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+
+    if( args[0]->IsExternal() ) {
+	Pool *obj = new Pool( static_cast<poolCore*>( Local<External>::Cast( args[0] )->Value() ) );
+	obj->Wrap( args.This() );
+	obj->start( isolate );
+	args.GetReturnValue().Set( args.This() );
+	return;
+    }
+
+    std::string conn_str;
+    std::string name;
+    unsigned min = 0;
+    unsigned max = 10;
+    unsigned idle_timeout = 60000;
+    unsigned max_wait = 0;
+    bool validate = false;
+    slowQueryLog *slow_log = NULL;
+
+    // The connection string is built once for all connections of the pool
+    if( args[0]->IsString() ) {
+	String::Utf8Value param0( args[0]->ToString() );
+	conn_str = std::string( *param0 );
+    } else if( args[0]->IsObject() ) {
+	Persistent<String> arg_string;
+	hashToString( args[0]->ToObject(), arg_string );
+	Local<String> local_arg_string = Local<String>::New( isolate, arg_string );
+	String::Utf8Value param0( local_arg_string );
+	conn_str = std::string( *param0 );
+	arg_string.Reset();
+    } else {
+	throwErrorIP( 0, createPoolUsage, "string|object",
+		      getJSTypeName( getJSType( args[0] ) ).c_str() );
+	return;
+    }
+    conn_str.append( ";CHARSET=UTF-8;SCROLLABLERESULT=0" );
+
+    if( args[1]->IsObject() ) {
+	Local<Object> options = args[1]->ToObject();
+	if( !getPoolOption( options, "min", min ) ||
+	    !getPoolOption( options, "max", max ) ||
+	    !getPoolOption( options, "idleTimeoutMs", idle_timeout ) ||
+	    !getPoolOption( options, "maxWaitMs", max_wait ) ) {
+	    return;
+	}
+	validate = options->Get( String::NewFromUtf8( isolate, "validateOnBorrow" ) )->BooleanValue();
+	Local<Value> name_val = options->Get( String::NewFromUtf8( isolate, "name" ) );
+	if( name_val->IsString() ) {
+	    String::Utf8Value name_str( name_val->ToString() );
+	    name = std::string( *name_str );
+	} else if( !name_val->IsUndefined() && !name_val->IsNull() ) {
+	    throwErrorIP( 1, createPoolUsage, "{ name: string }",
+			  getJSTypeName( getJSType( name_val ) ).c_str() );
+	    return;
+	}
+    } else if( !args[1]->IsUndefined() && !args[1]->IsNull() ) {
+	throwErrorIP( 1, createPoolUsage, "object",
+		      getJSTypeName( getJSType( args[1] ) ).c_str() );
+	return;
+    }
+    if( max == 0 || min > max ) {
+	throwError( JS_ERR_INVALID_ARGUMENTS );
+	return;
+    }
+    if( args[1]->IsObject() ) {
+	Local<Value> log_val = args[1]->ToObject()->Get( String::NewFromUtf8( isolate, "slowQueryLog" ) );
+	if( !log_val->IsUndefined() && !log_val->IsNull() ) {
+	    slow_log = newSlowQueryLog( log_val, 1, createPoolUsage );
+	    if( slow_log == NULL ) {
+		return;
+	    }
+	}
+    }
+
+    poolCore *core = new poolCore();
+    core->name = name;
+    core->conn_string = conn_str;
+    core->min_size = min;
+    core->max_size = max;
+    core->idle_timeout_ms = idle_timeout;
+    core->max_wait_ms = max_wait;
+    core->validate_on_borrow = validate;
+    core->slow_log = slow_log;
+    core->attached = 1;
+    core->refs = 1;
+
+    if( name.empty() ) {
+	addonContext *ctx = getAddonContext( isolate );
+	core->dbcapi_ctx = ( ctx != NULL ) ? ctx->dbcapi_ctx : NULL;
+	retainDbcapiContext( core->dbcapi_ctx );
+    } else {
+	// A named pool outlives the thread that created it, so it must not
+	// use that thread's client library context
+	uv_once( &registry_once, initRegistry );
+	scoped_lock reg_lock( registry_mutex );
+	if( registry->find( name ) != registry->end() ) {
+	    delete core;
+	    throwError( JS_ERR_POOL_EXISTS );
+	    return;
+	}
+	(*registry)[name] = core;
+    }
+
+    Pool *obj = new Pool( core );
+    obj->Wrap( args.This() );
+    obj->start( isolate );
+
+    // Pre-warm the pool in parallel
+    unsigned count;
+    {
+	scoped_lock lock( core->mutex );
+	count = core->growLocked();
+    }
+    obj->growBy( count );
+
+    args.GetReturnValue().Set( args.This() );
+}
+
+void Pool::start( Isolate *iso )
+/******************************/
+{
+    isolate = iso;
+    uv_loop_t *loop = getEventLoop( isolate );
+
+    // Receives connections passed on by other threads. It only keeps the
+    // loop alive while there are waiters.
+    async = new uv_async_t();
+    uv_async_init( loop, async, readyCallback );
+    async->data = this;
+    uv_unref( (uv_handle_t *)async );
+
+    // Checks for idle connections and waiters that timed out. The timer
+    // does not keep the process alive.
+    uint64_t period = 1000;
+    if( core->idle_timeout_ms > 0 && core->idle_timeout_ms < period ) {
+	period = core->idle_timeout_ms;
+    }
+    if( core->max_wait_ms > 0 && core->max_wait_ms < period ) {
+	period = core->max_wait_ms;
+    }
+    timer = new uv_timer_t();
+    uv_timer_init( loop, timer );
+    timer->data = this;
+    uv_timer_start( timer, timerCallback, period, period );
+    uv_unref( (uv_handle_t *)timer );
+
+#if NODE_MAJOR_VERSION >= 10
+    // Leaves a shared pool cleanly when a worker thread exits
+    node::AddEnvironmentCleanupHook( isolate, cleanupHook, this );
+    cleanup_hook = true;
+#endif
+}
+
+void Pool::cleanupHook( void *arg )
+/*********************************/
+{
+    Pool *pool = static_cast<Pool*>( arg );
+    pool->cleanup_hook = false;
+    if( !pool->closed ) {
+	pool->detach( false );
+    }
+}
+
+void Pool::updateAsyncRef()
+/*************************/
+{
+    if( async == NULL ) {
+	return;
+    }
+    if( waiters.empty() ) {
+	uv_unref( (uv_handle_t *)async );
+    } else {
+	uv_ref( (uv_handle_t *)async );
+    }
+}
+
+void Pool::growBy( unsigned count )
+/*********************************/
+{
+    if( count > 1 ) {
+	dbPool.reserveThreads( count );
+    }
+    for( unsigned i = 0; i < count; i++ ) {
+	openConnection();
+    }
+}
+
+void Pool::openConnection()
+/*************************/
+{
+    poolBaton *baton = new poolBaton();
+    baton->pool = this;
+
+    uv_work_t *req = new uv_work_t();
+    req->data = baton;
+
+    Ref();
+    int status = queueWork( req, openWork, (uv_after_work_cb)openAfter );
+    if( status != 0 ) {
+	{
+	    scoped_lock lock( core->mutex );
+	    core->opening--;
+	}
+	Unref();
+	delete baton;
+	delete req;
+    }
+}
+
+void Pool::openWork( uv_work_t *req )
+/***********************************/
+{
+    poolBaton *baton = static_cast<poolBaton*>(req->data);
+    poolCore *core = baton->pool->core;
+
+    baton->conn = newConnection( core->dbcapi_ctx );
+    if( baton->conn == NULL ) {
+	getErrorMsg( JS_ERR_GENERAL_ERROR, baton->error_code, baton->error_msg, baton->sql_state );
+    } else {
+	api.dbcapi_set_autocommit( baton->conn, true );
+	if( !api.dbcapi_connect( baton->conn, core->conn_string.c_str() ) ) {
+	    getErrorMsg( baton->conn, baton->error_code, baton->error_msg, baton->sql_state );
+	    api.dbcapi_free_connection( baton->conn );
+	    baton->conn = NULL;
+	}
+    }
+
+    // The connection is handed on from here, so it is not lost if the
+    // thread that asked for it exits before openAfter runs
+    if( baton->conn == NULL ) {
+	scoped_lock lock( core->mutex );
+	core->opening--;
+	core->errors++;
+	core->failLocked( baton->error_code, baton->error_msg, baton->sql_state );
+	return;
+    }
+
+    openConnections++;
+    bool kept;
+    {
+	scoped_lock lock( core->mutex );
+	core->opening--;
+	core->created++;
+	kept = core->putLocked( baton->conn );
+	if( !kept ) {
+	    core->destroyed++;
+	}
+    }
+    if( !kept ) {
+	closeConnection( baton->conn );
+    }
+}
+
+void Pool::openAfter( uv_work_t *req )
+/************************************/
+{
+    poolBaton *baton = static_cast<poolBaton*>(req->data);
+
+    baton->pool->Unref();
+    delete baton;
+    delete req;
+}
+
+void Pool::readyCallback( uv_async_t *handle )
+/********************************************/
+{
+    Pool *pool = static_cast<Pool*>(handle->data);
+    if( pool != NULL ) {
+	pool->onReady();
+    }
+}
+
+void Pool::asyncClosed( uv_handle_t *handle )
+/*******************************************/
+{
+    delete (uv_async_t *)handle;
+}
+
+void Pool::onReady()
+/******************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+    std::deque<handoff> items;
+    {
+	scoped_lock lock( core->mutex );
+	items.swap( ready );
+    }
+
+    for( size_t i = 0; i < items.size(); i++ ) {
+	handoff &h = items[i];
+	if( h.conn == NULL ) {
+	    if( !waiters.empty() ) {
+		waiter *w = waiters.front();
+		waiters.pop_front();
+		Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
+		callBack( h.error_code, &h.error_msg, &h.sql_state, w->callback, undef, true );
+		delete w;
+	    }
+	} else if( waiters.empty() || closed ) {
+	    // The waiter timed out after the connection was passed on
+	    returnUnused( h.conn );
+	} else {
+	    waiter *w = waiters.front();
+	    waiters.pop_front();
+	    lend( w, h.conn );
+	}
+    }
+    updateAsyncRef();
+}
+
+void Pool::addWaiter( waiter *w )
+/*******************************/
+{
+    dbcapi_connection *conn = NULL;
+    unsigned count;
+    {
+	scoped_lock lock( core->mutex );
+	// Most recently used first, so that the oldest connections age out
+	if( !core->idle.empty() ) {
+	    conn = core->idle.back().conn;
+	    core->idle.pop_back();
+	    core->in_use++;
+	} else {
+	    core->tickets.push_back( this );
+	}
+	count = core->growLocked();
+    }
+
+    if( conn != NULL ) {
+	lend( w, conn );
+    } else {
+	waiters.push_back( w );
+	updateAsyncRef();
+    }
+    growBy( count );
+}
+
+void Pool::returnUnused( dbcapi_connection *conn )
+/************************************************/
+{
+    bool kept;
+    {
+	scoped_lock lock( core->mutex );
+	core->in_use--;
+	kept = core->putLocked( conn );
+    }
+    if( !kept ) {
+	destroyConnection( conn );
+    }
+}
+
+void Pool::lend( waiter *w, dbcapi_connection *conn )
+/***************************************************/
+{
+    if( !core->validate_on_borrow ) {
+	deliver( w, conn );
+	return;
+    }
+
+    poolBaton *baton = new poolBaton();
+    baton->pool = this;
+    baton->conn = conn;
+    baton->waiter = w;
+
+    uv_work_t *req = new uv_work_t();
+    req->data = baton;
+    Ref();
+    int status = queueWork( req, validateWork, (uv_after_work_cb)validateAfter );
+    if( status != 0 ) {
+	Unref();
+	delete baton;
+	delete req;
+	deliver( w, conn );
+    }
+}
+
+void Pool::deliver( waiter *w, dbcapi_connection *conn )
+/******************************************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+    double latency_ms = ( uv_hrtime() - w->since ) / 1e6;
+    int bucket = 0;
+
+    while( bucket < POOL_HISTOGRAM_BUCKETS - 1 && latency_ms > histogramBounds[bucket] ) {
+	bucket++;
+    }
+    {
+	scoped_lock lock( core->mutex );
+	core->histogram[bucket]++;
+	core->acquired++;
+    }
+
+    Persistent<Object> p_conn;
+    Connection::CreatePooledInstance( isolate, conn, this, handle(), p_conn );
+    Local<Object> connObj = Local<Object>::New( isolate, p_conn );
+    p_conn.Reset();
+    if( core->slow_log != NULL ) {
+	ObjectWrap::Unwrap<Connection>( connObj )->setSlowLog( core->slow_log );
+    }
+
+    if( w->job != NULL ) {
+	executeBaton *baton = w->job;
+	Connection *obj = ObjectWrap::Unwrap<Connection>( connObj );
+	w->job = NULL;
+	baton->obj = obj;
+	baton->callback.Reset( isolate, w->callback );
+	delete w;
+
+	uv_work_t *req = new uv_work_t();
+	req->data = baton;
+	int status = queueWork( req, execWork, (uv_after_work_cb)execAfter, &obj->work_queue );
+	if( status != 0 ) {
+	    execWork( req );
+	    execAfter( req );
+	}
+	// Queued behind the statement on the connection
+	releaseConnection( isolate, connObj, Local<Value>(), false );
+	return;
+    }
+
+    Local<Value> result = connObj;
+    callBack( 0, NULL, NULL, w->callback, result, true );
+    delete w;
+}
+
+void Pool::failWaiter( waiter *w, int code )
+/******************************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+    Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
+    int error_code;
+    std::string error_msg;
+    std::string sql_state;
+
+    getErrorMsg( code, error_code, error_msg, sql_state );
+    callBack( error_code, &error_msg, &sql_state, w->callback, undef, true );
+    delete w;
+}
+
+void Pool::validateWork( uv_work_t *req )
+/***************************************/
+{
+    poolBaton *baton = static_cast<poolBaton*>(req->data);
+    dbcapi_stmt *stmt = api.dbcapi_execute_direct( baton->conn, pingSql );
+
+    if( stmt == NULL ) {
+	baton->err = true;
+	return;
+    }
+    api.dbcapi_free_stmt( stmt );
+}
+
+void Pool::validateAfter( uv_work_t *req )
+/****************************************/
+{
+    poolBaton *baton = static_cast<poolBaton*>(req->data);
+    Pool *pool = baton->pool;
+    poolCore *core = pool->core;
+    waiter *w = static_cast<waiter*>(baton->waiter);
+
+    if( baton->err || pool->closed ) {
+	unsigned count = 0;
+	{
+	    scoped_lock lock( core->mutex );
+	    if( baton->err ) {
+		core->validation_failures++;
+	    }
+	    core->in_use--;
+	    if( !pool->closed ) {
+		// Retry with another connection, keeping the waiter's place
+		core->tickets.push_front( pool );
+		count = core->growLocked();
+	    }
+	}
+	pool->destroyConnection( baton->conn );
+	if( pool->closed ) {
+	    pool->failWaiter( w, JS_ERR_POOL_CLOSED );
+	} else {
+	    pool->waiters.push_front( w );
+	    pool->updateAsyncRef();
+	    pool->growBy( count );
+	}
+    } else {
+	pool->deliver( w, baton->conn );
+    }
+
+    pool->Unref();
+    delete baton;
+    delete req;
+}
+
+void Pool::execWork( uv_work_t *req )
+/***********************************/
+{
+    executeBaton *baton = static_cast<executeBaton*>(req->data);
+
+    executeWork( req );
+
+    // The connection goes back to the pool before execAfter runs, so the
+    // statement handle is freed here
+    scoped_lock lock( baton->obj->conn_mutex );
+    if( baton->dbcapi_stmt_ptr != NULL && baton->prepared_stmt && !baton->cached_stmt ) {
+	api.dbcapi_free_stmt( baton->dbcapi_stmt_ptr );
+	baton->dbcapi_stmt_ptr = NULL;
+    }
+}
+
+void Pool::execAfter( uv_work_t *req )
+/************************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+    executeBaton *baton = static_cast<executeBaton*>(req->data);
+    Local<Value> result = Local<Value>::New( isolate, Undefined( isolate ) );
+
+    baton->mem.report( isolate );
+    if( baton->err ) {
+	callBack( baton->error_code, &baton->error_msg, &baton->sql_state,
+		  baton->callback, result, true );
+    } else {
+	if( baton->columnar->rows_affected >= 0 ) {
+	    result = Integer::New( isolate, baton->columnar->rows_affected );
+	} else if( !baton->columnar->columns.empty() ) {
+	    result = baton->columnar->toObject( isolate );
+	    baton->mem.set( MEM_COLUMNAR, 0 );
+	    baton->mem.report( isolate );
+	}
+	// No result for DDL statements
+	callBack( 0, NULL, NULL, baton->callback, result, true, baton->function_code != 1 );
+    }
+
+    delete baton;
+    delete req;
+}
+
+void Pool::destroyConnection( dbcapi_connection *conn )
+/*****************************************************/
+{
+    poolBaton *baton = new poolBaton();
+    baton->pool = this;
+    baton->conn = conn;
+
+    uv_work_t *req = new uv_work_t();
+    req->data = baton;
+    {
+	scoped_lock lock( core->mutex );
+	core->destroying++;
+    }
+    destroying++;
+    Ref();
+    int status = queueWork( req, destroyWork, (uv_after_work_cb)destroyAfter );
+    if( status != 0 ) {
+	destroyWork( req );
+	destroyAfter( req );
+    }
+}
+
+void Pool::destroyWork( uv_work_t *req )
+/**************************************/
+{
+    poolBaton *baton = static_cast<poolBaton*>(req->data);
+    poolCore *core = baton->pool->core;
+
+    closeConnection( baton->conn );
+    baton->conn = NULL;
+
+    scoped_lock lock( core->mutex );
+    core->destroying--;
+    core->destroyed++;
+}
+
+void Pool::destroyAfter( uv_work_t *req )
+/***************************************/
+{
+    poolBaton *baton = static_cast<poolBaton*>(req->data);
+    Pool *pool = baton->pool;
+
+    pool->destroying--;
+    if( pool->closed && pool->destroying == 0 ) {
+	pool->finishClose();
+    }
+
+    pool->Unref();
+    delete baton;
+    delete req;
+}
+
+void Pool::connectionLost()
+/*************************/
+{
+    // Runs during garbage collection, so only the counters are updated;
+    // the timer opens a replacement if needed
+    scoped_lock lock( core->mutex );
+    core->in_use--;
+    core->destroyed++;
+}
+
+void Pool::releaseConnection( Isolate *isolate,
+			      Local<Object> connObj,
+			      Local<Value> callback,
+			      bool callback_required )
+/***********************************************************/
+{
+    HandleScope scope( isolate );
+    Connection *obj = ObjectWrap::Unwrap<Connection>( connObj );
+    Pool *pool = obj->pool;
+
+    poolBaton *baton = new poolBaton();
+    baton->pool = pool;
+    baton->obj = obj;
+    baton->callback_required = callback_required;
+    baton->connObj.Reset( isolate, connObj );
+    if( callback_required ) {
+	baton->callback.Reset( isolate, Local<Function>::Cast( callback ) );
+    }
+
+    // The pool is kept alive by the baton from here on
+    obj->pool = NULL;
+    obj->pool_obj.Reset();
+
+    uv_work_t *req = new uv_work_t();
+    req->data = baton;
+    pool->Ref();
+
+    // Runs after the requests that are already queued on the connection
+    int status = queueWork( req, releaseWork, (uv_after_work_cb)releaseAfter,
+			    &obj->work_queue );
+    if( status != 0 ) {
+	releaseWork( req );
+	releaseAfter( req );
+    }
+}
+
+void Pool::releaseWork( uv_work_t *req )
+/**************************************/
+{
+    poolBaton *baton = static_cast<poolBaton*>(req->data);
+    Connection *obj = baton->obj;
+    poolCore *core = baton->pool->core;
+
+    {
+	scoped_lock lock( obj->conn_mutex );
+
+	if( obj->conn == NULL ) {
+	    return;
+	}
+
+	api.dbcapi_register_warning_callback( obj->conn, NULL, NULL );
+	obj->stmt_cache.clear();
+
+	if( !obj->autoCommit ) {
+	    if( !api.dbcapi_rollback( obj->conn ) ) {
+		baton->err = true;
+		getErrorMsg( obj->conn, baton->error_code, baton->error_msg, baton->sql_state );
+	    }
+	    api.dbcapi_set_autocommit( obj->conn, true );
+	    obj->autoCommit = true;
+	}
+
+	scoped_lock cancel_lock( obj->cancel_mutex );
+	baton->conn = obj->conn;
+	obj->conn = NULL;
+	obj->is_connected = false;
+    }
+
+    // Handed on right away, so that waiters on other threads do not wait
+    // for this thread's event loop. A connection that failed to roll back
+    // is not lent out again.
+    bool kept = false;
+    {
+	scoped_lock lock( core->mutex );
+	core->in_use--;
+	if( !baton->err ) {
+	    kept = core->putLocked( baton->conn );
+	}
+	if( !kept ) {
+	    core->destroyed++;
+	}
+    }
+    if( !kept ) {
+	closeConnection( baton->conn );
+    }
+    baton->conn = NULL;
+}
+
+void Pool::releaseAfter( uv_work_t *req )
+/***************************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+    poolBaton *baton = static_cast<poolBaton*>(req->data);
+    Pool *pool = baton->pool;
+    Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
+
+    if( baton->callback_required ) {
+	if( baton->err ) {
+	    callBack( baton->error_code, &baton->error_msg, &baton->sql_state,
+		      baton->callback, undef, true );
+	} else {
+	    callBack( 0, NULL, NULL, baton->callback, undef, true, false );
+	}
+    }
+
+    pool->Unref();
+    delete baton;
+    delete req;
+}
+
+void Pool::timerCallback( uv_timer_t *handle )
+/********************************************/
+{
+    Pool *pool = static_cast<Pool*>(handle->data);
+    if( pool != NULL ) {
+	pool->onTimer();
+    }
+}
+
+void Pool::onTimer()
+/******************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+    uint64_t now = uv_hrtime();
+    std::deque<waiter *> expired;
+    std::vector<dbcapi_connection *> aged;
+    unsigned count;
+
+    {
+	scoped_lock lock( core->mutex );
+
+	if( core->max_wait_ms > 0 ) {
+	    for( std::deque<waiter *>::iterator it = waiters.begin(); it != waiters.end(); ) {
+		if( ( now - (*it)->since ) / 1000000 >= core->max_wait_ms ) {
+		    expired.push_back( *it );
+		    it = waiters.erase( it );
+		    // If no ticket is left, a connection is already on its way
+		    // and goes back to the pool in onReady
+		    removeTicket( core->tickets, this );
+		    core->timeouts++;
+		} else {
+		    ++it;
+		}
+	    }
+	}
+
+	// Idle connections are ordered from least to most recently used
+	if( core->idle_timeout_ms > 0 ) {
+	    while( !core->idle.empty() && core->idle.size() + core->in_use > core->min_size &&
+		   ( now - core->idle.front().last_used ) / 1000000 >= core->idle_timeout_ms ) {
+		aged.push_back( core->idle.front().conn );
+		core->idle.pop_front();
+	    }
+	}
+
+	// Replace connections that failed or were lost
+	count = core->growLocked();
+    }
+
+    for( size_t i = 0; i < expired.size(); i++ ) {
+	failWaiter( expired[i], JS_ERR_POOL_TIMEOUT );
+    }
+    for( size_t i = 0; i < aged.size(); i++ ) {
+	destroyConnection( aged[i] );
+    }
+    growBy( count );
+    updateAsyncRef();
+}
+
+void Pool::closeTimer()
+/*********************/
+{
+    if( timer != NULL ) {
+	uv_timer_stop( timer );
+	timer->data = NULL;
+	uv_close( (uv_handle_t *)timer, timerClosed );
+	timer = NULL;
+    }
+}
+
+void Pool::timerClosed( uv_handle_t *handle )
+/*******************************************/
+{
+    delete (uv_timer_t *)handle;
+}
+
+void Pool::detach( bool notify )
+/******************************/
+{
+    std::deque<handoff> leftover;
+    std::deque<poolCore::pooledConnection> idle;
+    std::deque<waiter *> pending;
+
+    closed = true;
+    closeTimer();
+    pending.swap( waiters );
+
+#if NODE_MAJOR_VERSION >= 10
+    if( cleanup_hook ) {
+	node::RemoveEnvironmentCleanupHook( isolate, cleanupHook, this );
+	cleanup_hook = false;
+    }
+#endif
+
+    {
+	uv_once( &registry_once, initRegistry );
+	scoped_lock reg_lock( registry_mutex );
+	scoped_lock lock( core->mutex );
+
+	while( removeTicket( core->tickets, this ) ) {
+	}
+	leftover.swap( ready );
+	core->attached--;
+	if( core->attached == 0 ) {
+	    core->closed = true;
+	    idle.swap( core->idle );
+	    if( !core->name.empty() ) {
+		registry->erase( core->name );
+	    }
+	}
+    }
+
+    // Nobody passes connections to this object any more
+    if( async != NULL ) {
+	async->data = NULL;
+	uv_close( (uv_handle_t *)async, asyncClosed );
+	async = NULL;
+    }
+
+    for( size_t i = 0; i < pending.size(); i++ ) {
+	if( notify ) {
+	    failWaiter( pending[i], JS_ERR_POOL_CLOSED );
+	} else {
+	    delete pending[i];
+	}
+    }
+
+    for( size_t i = 0; i < leftover.size(); i++ ) {
+	if( leftover[i].conn != NULL ) {
+	    bool kept;
+	    {
+		scoped_lock lock( core->mutex );
+		core->in_use--;
+		kept = core->putLocked( leftover[i].conn );
+	    }
+	    if( !kept ) {
+		idle.push_back( poolCore::pooledConnection() );
+		idle.back().conn = leftover[i].conn;
+	    }
+	}
+    }
+
+    // Outside of JavaScript (garbage collection, thread exit) the
+    // connections are closed right away
+    for( size_t i = 0; i < idle.size(); i++ ) {
+	if( notify ) {
+	    destroyConnection( idle[i].conn );
+	} else {
+	    closeConnection( idle[i].conn );
+	    scoped_lock lock( core->mutex );
+	    core->destroyed++;
+	}
+    }
+}
+
+void Pool::finishClose()
+/**********************/
+{
+    if( close_callback.IsEmpty() ) {
+	return;
+    }
+
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+    Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
+    Persistent<Function> callback;
+    callback.Reset( isolate, close_callback );
+    close_callback.Reset();
+    callBack( 0, NULL, NULL, callback, undef, true, false );
+    callback.Reset();
+}
+
+NODE_API_FUNC( Pool::acquire )
+/****************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    int cbfunc_arg = -1;
+
+    unsigned int expectedTypes[] = { JS_FUNCTION };
+    if( !checkParameters( args, "acquire(callback)", 1, expectedTypes, &cbfunc_arg ) ) {
+	return;
+    }
+
+    Pool *obj = ObjectWrap::Unwrap<Pool>( args.This() );
+    waiter *w = new waiter();
+    w->callback.Reset( isolate, Local<Function>::Cast( args[cbfunc_arg] ) );
+    w->since = uv_hrtime();
+
+    if( obj->closed ) {
+	obj->failWaiter( w, JS_ERR_POOL_CLOSED );
+	return;
+    }
+
+    obj->addWaiter( w );
+    args.GetReturnValue().SetUndefined();
+}
+
+NODE_API_FUNC( Pool::release )
+/****************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    int cbfunc_arg = -1;
+
+    unsigned int expectedTypes[] = { JS_OBJECT, JS_FUNCTION };
+    bool isOptional[] = { false, true };
+    if( !checkParameters( args, "release(conn[, callback])", 2, expectedTypes, &cbfunc_arg, isOptional ) ) {
+	return;
+    }
+    bool callback_required = ( cbfunc_arg >= 0 );
+
+    Pool *obj = ObjectWrap::Unwrap<Pool>( args.This() );
+    Local<Object> connObj = args[0]->ToObject();
+    Connection *conn = NULL;
+    if( connObj->InternalFieldCount() == 1 ) {
+	conn = ObjectWrap::Unwrap<Connection>( connObj );
+    }
+
+    if( conn == NULL || conn->pool != obj ) {
+	Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
+	int error_code;
+	std::string error_msg;
+	std::string sql_state;
+	getErrorMsg( JS_ERR_INVALID_OBJECT, error_code, error_msg, sql_state );
+	callBack( error_code, &error_msg, &sql_state, args[cbfunc_arg], undef, callback_required );
+	return;
+    }
+
+    Local<Value> callback = callback_required ? args[cbfunc_arg] : Local<Value>();
+    releaseConnection( isolate, connObj, callback, callback_required );
+    args.GetReturnValue().SetUndefined();
+}
+
+NODE_API_FUNC( Pool::exec )
+/*************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    const char *usage = "exec(sql[, params][, options], callback)";
+    int  options_arg = findOptionsArg( args, 1 );
+    int  arg_pos[3] = { -1, -1, -1 };
+    int  num_args = 0;
+    int  timeout = -1;
+
+    args.GetReturnValue().SetUndefined();
+
+    for( int i = 0; i < args.Length() && num_args < 3; i++ ) {
+	if( i != options_arg ) {
+	    arg_pos[num_args++] = i;
+	}
+    }
+
+    if( num_args == 0 || !args[arg_pos[0]]->IsString() ) {
+	throwErrorIP( 0, usage, "string", getJSTypeName( getJSType( args[0] ) ).c_str() );
+	return;
+    }
+    int cbfunc_arg = arg_pos[num_args - 1];
+    if( num_args < 2 || !args[cbfunc_arg]->IsFunction() ) {
+	throwErrorIP( num_args < 2 ? 1 : cbfunc_arg, usage, "function",
+		      getJSTypeName( getJSType( args[num_args < 2 ? 1 : cbfunc_arg] ) ).c_str() );
+	return;
+    }
+    int params_arg = ( num_args == 3 ) ? arg_pos[1] : -1;
+    if( params_arg >= 0 && !args[params_arg]->IsArray() &&
+	!args[params_arg]->IsUndefined() && !args[params_arg]->IsNull() ) {
+	throwErrorIP( params_arg, usage, "array",
+		      getJSTypeName( getJSType( args[params_arg] ) ).c_str() );
+	return;
+    }
+    if( !getQueryOptions( args, options_arg, usage, timeout ) ) {
+	return;
+    }
+
+    Pool *obj = ObjectWrap::Unwrap<Pool>( args.This() );
+    waiter *w = new waiter();
+    w->callback.Reset( isolate, Local<Function>::Cast( args[cbfunc_arg] ) );
+    w->since = uv_hrtime();
+
+    String::Utf8Value sql( args[arg_pos[0]]->ToString() );
+    executeBaton *baton = new executeBaton();
+    baton->callback_required = true;
+    baton->stmt = std::string( *sql );
+    baton->query_timeout = timeout;
+    baton->columnar = new columnarResult();
+    w->job = baton;
+
+    if( params_arg >= 0 && args[params_arg]->IsArray() ) {
+	if( !getInputParameters( args[params_arg], baton->provided_params,
+				 baton->error_code, baton->error_msg, baton->sql_state ) ) {
+	    Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
+	    callBack( baton->error_code, &baton->error_msg, &baton->sql_state,
+		      w->callback, undef, true );
+	    delete w;
+	    return;
+	}
+    }
+
+    if( obj->closed ) {
+	obj->failWaiter( w, JS_ERR_POOL_CLOSED );
+	return;
+    }
+
+    obj->addWaiter( w );
+}
+
+NODE_API_FUNC( Pool::close )
+/**************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    int cbfunc_arg = -1;
+
+    unsigned int expectedTypes[] = { JS_FUNCTION };
+    bool isOptional[] = { true };
+    if( !checkParameters( args, "close([callback])", 1, expectedTypes, &cbfunc_arg, isOptional ) ) {
+	return;
+    }
+
+    Pool *obj = ObjectWrap::Unwrap<Pool>( args.This() );
+    if( cbfunc_arg >= 0 ) {
+	obj->close_callback.Reset( isolate, Local<Function>::Cast( args[cbfunc_arg] ) );
+    }
+
+    if( !obj->closed ) {
+	obj->detach( true );
+    }
+
+    if( obj->destroying == 0 ) {
+	obj->finishClose();
+    }
+    args.GetReturnValue().SetUndefined();
+}
+
+NODE_API_FUNC( Pool::getStats )
+/*****************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    Pool *obj = ObjectWrap::Unwrap<Pool>( args.This() );
+    poolCore *core = obj->core;
+    Local<Object> stats = Object::New( isolate );
+    scoped_lock lock( core->mutex );
+
+    if( !core->name.empty() ) {
+	stats->Set( String::NewFromUtf8( isolate, "name" ), String::NewFromUtf8( isolate, core->name.c_str() ) );
+    }
+    stats->Set( String::NewFromUtf8( isolate, "size" ),
+		Integer::NewFromUnsigned( isolate, (uint32_t)( core->idle.size() + core->in_use ) ) );
+    stats->Set( String::NewFromUtf8( isolate, "max" ), Integer::NewFromUnsigned( isolate, core->max_size ) );
+    stats->Set( String::NewFromUtf8( isolate, "idle" ), Integer::NewFromUnsigned( isolate, (uint32_t)core->idle.size() ) );
+    stats->Set( String::NewFromUtf8( isolate, "inUse" ), Integer::NewFromUnsigned( isolate, core->in_use ) );
+    stats->Set( String::NewFromUtf8( isolate, "opening" ), Integer::NewFromUnsigned( isolate, core->opening ) );
+    stats->Set( String::NewFromUtf8( isolate, "waiters" ), Integer::NewFromUnsigned( isolate, (uint32_t)core->tickets.size() ) );
+    stats->Set( String::NewFromUtf8( isolate, "created" ), Number::New( isolate, core->created ) );
+    stats->Set( String::NewFromUtf8( isolate, "destroyed" ), Number::New( isolate, core->destroyed ) );
+    stats->Set( String::NewFromUtf8( isolate, "acquired" ), Number::New( isolate, core->acquired ) );
+    stats->Set( String::NewFromUtf8( isolate, "timeouts" ), Number::New( isolate, core->timeouts ) );
+    stats->Set( String::NewFromUtf8( isolate, "validationFailures" ), Number::New( isolate, core->validation_failures ) );
+    stats->Set( String::NewFromUtf8( isolate, "errors" ), Number::New( isolate, core->errors ) );
+
+    Local<Array> bounds = Array::New( isolate, POOL_HISTOGRAM_BUCKETS - 1 );
+    Local<Array> counts = Array::New( isolate, POOL_HISTOGRAM_BUCKETS );
+    for( int i = 0; i < POOL_HISTOGRAM_BUCKETS; i++ ) {
+	if( i < POOL_HISTOGRAM_BUCKETS - 1 ) {
+	    bounds->Set( i, Number::New( isolate, histogramBounds[i] ) );
+	}
+	counts->Set( i, Number::New( isolate, core->histogram[i] ) );
+    }
+    Local<Object> latency = Object::New( isolate );
+    latency->Set( String::NewFromUtf8( isolate, "bounds" ), bounds );
+    latency->Set( String::NewFromUtf8( isolate, "counts" ), counts );
+    stats->Set( String::NewFromUtf8( isolate, "acquireLatency" ), latency );
+
+    args.GetReturnValue().Set( stats );
+}
+
+NODE_API_FUNC( Pool::getSlowQueries )
+/***********************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    Pool *obj = ObjectWrap::Unwrap<Pool>( args.This() );
+    bool clear = false;
+
+    if( args.Length() > 0 && !args[0]->IsUndefined() && !convertToBool( args[0], clear ) ) {
+	throwErrorIP( 0, "getSlowQueries([clear])", "boolean", getJSTypeName( getJSType( args[0] ) ).c_str() );
+	return;
+    }
+    if( obj->core->slow_log == NULL ) {
+	args.GetReturnValue().Set( Array::New( isolate ) );
+	return;
+    }
+    args.GetReturnValue().Set( obj->core->slow_log->toArray( isolate, clear ) );
+}
+
+NODE_API_FUNC( Pool::flushSlowQueries )
+/*************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    Pool *obj = ObjectWrap::Unwrap<Pool>( args.This() );
+    int cbfunc_arg = -1;
+
+    args.GetReturnValue().SetUndefined();
+
+    unsigned int expectedTypes[] = { JS_STRING, JS_FUNCTION };
+    bool isOptional[] = { false, false };
+    if( !checkParameters( args, "flushSlowQueries(path, callback)", 2, expectedTypes, &cbfunc_arg, isOptional ) ) {
+	return;
+    }
+    if( obj->core->slow_log == NULL ) {
+	Local<Value> count = Integer::New( isolate, 0 );
+	callBack( 0, NULL, NULL, args[cbfunc_arg], count, true );
+	return;
+    }
+    String::Utf8Value path( args[0]->ToString() );
+    flushSlowQueryLog( isolate, obj->core->slow_log, std::string( *path ),
+		       Local<Function>::Cast( args[cbfunc_arg] ) );
+}
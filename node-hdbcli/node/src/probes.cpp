@@ -0,0 +1,106 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include "nodever_cover.h"
+#include "hana_utils.h"
+
+using namespace v8;
+
+#if defined( HANA_USDT )
+
+// The functions of the client library that the probes call
+static DBCAPIInterface probedApi;
+
+class callProbe
+{
+  public:
+    callProbe( const char *function_, void *handle_ ) : function( function_ ), handle( handle_ )
+    {
+	HANA_PROBE2( dbcapi__entry, function, handle );
+    }
+    ~callProbe()
+    {
+	HANA_PROBE2( dbcapi__return, function, handle );
+    }
+
+  private:
+    const char	*function;
+    void	*handle;
+};
+
+// The handle is the first argument if it is a pointer
+static inline void *probeHandle()
+{
+    return NULL;
+}
+
+template<typename T, typename... Rest>
+static inline void *probeHandle( T *first, Rest... )
+{
+    return (void *)first;
+}
+
+template<typename T, typename... Rest>
+static inline void *probeHandle( T, Rest... )
+{
+    return NULL;
+}
+
+template<typename Func, Func DBCAPIInterface::*Member, typename Name>
+struct probedCall;
+
+template<typename R, typename... A, R (*DBCAPIInterface::*Member)( A... ), typename Name>
+struct probedCall<R (*)( A... ), Member, Name>
+{
+    static R call( A... args )
+    {
+	callProbe probe( Name::get(), probeHandle( args... ) );
+	return ( probedApi.*Member )( args... );
+    }
+};
+
+#define DBCAPI_FUNCTIONS( f )								\
+    f( init ) f( fini ) f( new_connection ) f( free_connection )			\
+    f( make_connection ) f( connect ) f( disconnect ) f( set_clientinfo )		\
+    f( get_clientinfo ) f( execute_immediate ) f( prepare ) f( get_function_code )	\
+    f( free_stmt ) f( num_params ) f( describe_bind_param ) f( bind_param )		\
+    f( send_param_data ) f( reset ) f( get_bind_param_info ) f( execute )		\
+    f( execute_direct ) f( fetch_absolute ) f( fetch_next ) f( get_next_result )	\
+    f( affected_rows ) f( num_cols ) f( num_rows ) f( get_column ) f( get_data )	\
+    f( get_data_info ) f( get_column_info ) f( commit ) f( rollback )			\
+    f( client_version ) f( error ) f( sqlstate ) f( clear_error ) f( init_ex )		\
+    f( fini_ex ) f( new_connection_ex ) f( make_connection_ex )			\
+    f( client_version_ex ) f( cancel ) f( set_batch_size ) f( set_param_bind_type )	\
+    f( get_batch_size ) f( set_rowset_size ) f( get_rowset_size )			\
+    f( set_column_bind_type ) f( bind_column ) f( clear_column_bindings )		\
+    f( fetched_rows ) f( set_rowset_pos ) f( reset_param_data ) f( error_length )	\
+    f( set_autocommit ) f( set_transaction_isolation ) f( set_query_timeout )		\
+    f( register_warning_callback )
+
+#define PROBE_NAME( x )									\
+    struct x##_probe_name { static const char *get() { return #x; } };
+
+DBCAPI_FUNCTIONS( PROBE_NAME )
+
+#define INSTALL_PROBE( x )								\
+    if( api->dbcapi_##x != NULL ) {							\
+	probedApi.dbcapi_##x = api->dbcapi_##x;						\
+	api->dbcapi_##x = probedCall<dbcapi_##x##_func, &DBCAPIInterface::dbcapi_##x,	\
+				     x##_probe_name>::call;				\
+    }
+
+void installApiProbes( DBCAPIInterface *api )
+/*******************************************/
+{
+    probedApi = *api;
+    DBCAPI_FUNCTIONS( INSTALL_PROBE )
+}
+
+#else
+
+void installApiProbes( DBCAPIInterface * )
+/****************************************/
+{
+}
+
+#endif
@@ -16,33 +16,52 @@ ResultSet::ResultSet()
     dbcapi_stmt_ptr = NULL;
     is_closed = false;
     fetched_first = false;
+    owner_stmt = NULL;
 }
 
 ResultSet::~ResultSet()
 /*********************/
 {
-    scoped_lock lock(*conn_mutex);
-    freeStmt(this);
-    deleteColumnInfos();
+    {
+        scoped_lock lock(*conn_mutex);
+        freeStmt(this);
+        deleteColumnInfos();
+    }
+    owner_stmt = NULL;
+    owner_stmt_obj.Reset();
 }
 
 void ResultSet::freeStmt(ResultSet *resultset)
 {
     if (resultset->dbcapi_stmt_ptr != NULL) {
-        api.dbcapi_free_stmt(resultset->dbcapi_stmt_ptr);
+        if (resultset->owner_stmt != NULL) {
+            resultset->owner_stmt->releaseCursor(resultset->dbcapi_stmt_ptr);
+        } else {
+            api.dbcapi_free_stmt(resultset->dbcapi_stmt_ptr);
+        }
         resultset->dbcapi_stmt_ptr = NULL;
     }
     resultset->is_closed = true;
 }
 
+void ResultSet::setOwner(Isolate *isolate, Statement *stmt, Local<Object> stmtObj)
+/********************************************************************************/
+{
+    // The reference keeps the statement alive until this result set is
+    // collected, so the cursor can always be returned to its pool.
+    owner_stmt = stmt;
+    owner_stmt_obj.Reset(isolate, stmtObj);
+}
+
 void ResultSet::deleteColumnInfos()
 /*********************/
 {
     clearVector(column_infos);
     num_cols = 0;
+    mem.set(MEM_RESULTSET, 0);
 }
 
-Persistent<Function> ResultSet::constructor;
+perIsolateFunction ResultSet::constructor;
 
 void ResultSet::Init( Isolate *isolate )
 /**************************************/
@@ -146,6 +165,7 @@ void ResultSet::getColumnInfos()
 /*****************************************/
 {
     num_cols = fetchColumnInfos(dbcapi_stmt_ptr, column_infos);
+    mem.set(MEM_RESULTSET, (int64_t)column_infos.size() * (int64_t)(sizeof(dbcapi_column_info) + sizeof(void *)));
 }
 
 struct nextBaton {
@@ -158,6 +178,7 @@ struct nextBaton {
 
     ResultSet 			*obj;
     bool 			retVal;
+    opTimings			timings;
 
     nextBaton() {
 	err = false;
@@ -179,6 +200,15 @@ void ResultSet::nextAfter( uv_work_t *req )
     nextBaton *baton = static_cast<nextBaton*>(req->data);
     Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
 
+    // Fetches are traced but, being one per row, kept out of the statistics
+    if( !baton->err && isTracing( baton->obj->connection ) ) {
+	ResultSet *rs = baton->obj;
+	baton->timings.phase_ns[PHASE_TOTAL] = uv_hrtime() - baton->timings.started_at;
+	traceOperation( rs->connection, "fetch",
+			rs->owner_stmt != NULL ? rs->owner_stmt->sql : std::string(), 0,
+			baton->timings, baton->retVal ? 1 : 0, 0, 0, 0 );
+    }
+
     if( baton->err ) {
 	callBack( baton->error_code, &( baton->error_msg ), &( baton->sql_state ),
                  baton->callback, undef, baton->callback_required );
@@ -204,8 +234,11 @@ void ResultSet::nextWork( uv_work_t *req )
 	return;
     }
 
+    baton->timings.end( PHASE_QUEUE );
     scoped_lock lock(*baton->obj->conn_mutex);
+    baton->timings.end( PHASE_LOCK );
     baton->retVal = ( api.dbcapi_fetch_next( baton->obj->dbcapi_stmt_ptr ) != 0 );
+    baton->timings.end( PHASE_FETCH );
     baton->obj->fetched_first = true;
 }
 
@@ -238,8 +271,8 @@ void ResultSet::next( const FunctionCallbackInfo<Value> &args )
 	Local<Function> callback = Local<Function>::Cast(args[cbfunc_arg]);
 	baton->callback.Reset( isolate, callback );
 
-	int status = uv_queue_work( uv_default_loop(), req, nextWork,
-				    (uv_after_work_cb)nextAfter );
+	int status = queueWork( req, nextWork, (uv_after_work_cb)nextAfter,
+				workQueueOf( obj->connection ) );
 	assert(status == 0);
 	_unused( status );
 
@@ -355,6 +388,7 @@ void ResultSet::getValues(const FunctionCallbackInfo<Value> &args)
         return;
     }
 
+    convertProbe probe("getValues", obj->num_cols);
     for (int i = 0; i < obj->num_cols; i++) {
         dbcapi_data_value value;
         memset(&value, 0, sizeof(dbcapi_data_value));
@@ -411,6 +445,7 @@ void ResultSet::getValues(const FunctionCallbackInfo<Value> &args)
         }
     }
 
+    probe.rows = 1;
     args.GetReturnValue().Set(row);
 }
 
@@ -683,8 +718,8 @@ NODE_API_FUNC(ResultSet::getData)
         Local<Function> callback = Local<Function>::Cast(args[cbfunc_arg]);
         baton->callback.Reset(isolate, callback);
 
-        int status = uv_queue_work(uv_default_loop(), req, getDataWork,
-                                   (uv_after_work_cb)getDataAfter);
+        int status = queueWork(req, getDataWork, (uv_after_work_cb)getDataAfter,
+                               workQueueOf(obj->connection));
         assert(status == 0);
         _unused(status);
 
@@ -800,8 +835,8 @@ void ResultSet::close(const FunctionCallbackInfo<Value> &args)
         Local<Function> callback = Local<Function>::Cast(args[cbfunc_arg]);
         baton->callback.Reset(isolate, callback);
 
-        int status = uv_queue_work(uv_default_loop(), req, closeWork,
-            (uv_after_work_cb)closeAfter);
+        int status = queueWork(req, closeWork, (uv_after_work_cb)closeAfter,
+                               workQueueOf(obj->connection));
         assert(status == 0);
         _unused(status);
         return;
@@ -842,6 +877,7 @@ void ResultSet::nextResultAfter(uv_work_t *req)
     nextResultBaton *baton = static_cast<nextResultBaton*>(req->data);
     Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
 
+    baton->obj->mem.report(isolate);
     if (baton->err) {
         callBack(baton->error_code, &(baton->error_msg), &(baton->sql_state),
                  baton->callback, undef, baton->callback_required);
@@ -905,8 +941,8 @@ void ResultSet::nextResult(const FunctionCallbackInfo<Value> &args)
         Local<Function> callback = Local<Function>::Cast(args[cbfunc_arg]);
         baton->callback.Reset(isolate, callback);
 
-        int status = uv_queue_work(uv_default_loop(), req, nextResultWork,
-                                   (uv_after_work_cb)nextResultAfter);
+        int status = queueWork(req, nextResultWork, (uv_after_work_cb)nextResultAfter,
+                               workQueueOf(obj->connection));
         assert(status == 0);
         _unused(status);
 
@@ -949,7 +985,7 @@ void ResultSet::CreateNewInstance(
 
     const unsigned argc = 1;
     Handle<Value> argv[argc] = { args[0] };
-    Local<Function> local_func = Local<Function>::New( isolate, constructor );
+    Local<Function> local_func = constructor.Get( isolate );
     Local<Object> instance = local_func->NewInstance(argc, argv);
     obj.Reset(isolate, instance);
 }
@@ -0,0 +1,475 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include "nodever_cover.h"
+#include "hana_utils.h"
+#include <chrono>
+#include <stdio.h>
+
+using namespace v8;
+
+static const char *typeNames[] = {
+    "invalid", "binary", "string", "double", "int64", "uint64", "int32", "uint32",
+    "int16", "uint16", "int8", "uint8", "float"
+};
+
+static const char *phaseKeys[PHASE_COUNT] = {
+    "queueMs", "lockMs", "prepareMs", "bindMs", "executeMs", "fetchMs", "convertMs", "totalMs"
+};
+
+static const char *typeName( int type )
+/*************************************/
+{
+    if( type < 0 || type >= (int)( sizeof( typeNames ) / sizeof( typeNames[0] ) ) ) {
+	return "invalid";
+    }
+    return typeNames[type];
+}
+
+slowQueryLog::slowQueryLog( uint64_t threshold, unsigned size, unsigned sample )
+/******************************************************************************/
+{
+    threshold_ns = threshold;
+    capacity = size;
+    sample_binds = sample;
+    refs = 1;
+    next = 0;
+    read_from = 0;
+    captured = 0;
+    slots = new slot[capacity];
+    for( unsigned i = 0; i < capacity; i++ ) {
+	slots[i].seq = 0;
+    }
+}
+
+slowQueryLog::~slowQueryLog()
+/***************************/
+{
+    delete [] slots;
+}
+
+void slowQueryLog::addRef()
+/*************************/
+{
+    refs++;
+}
+
+void slowQueryLog::release()
+/**************************/
+{
+    if( --refs == 0 ) {
+	delete this;
+    }
+}
+
+// Renders a bind value as text, truncated to the size of out
+static void formatValue( const dbcapi_data_value &value, char *out, size_t size )
+/*******************************************************************************/
+{
+    const char *data = value.buffer;
+    size_t length = ( value.length != NULL ) ? *value.length : value.buffer_size;
+
+    out[0] = '\0';
+    if( data != NULL && value.is_address ) {
+	data = *(char **)data;
+    }
+    if( data == NULL ) {
+	return;
+    }
+    switch( value.type ) {
+	case A_STRING:
+	    if( length > size - 1 ) {
+		length = size - 1;
+	    }
+	    memcpy( out, data, length );
+	    out[length] = '\0';
+	    break;
+	case A_BINARY:
+	    for( size_t i = 0; i < length && 2 * i + 2 < size; i++ ) {
+		snprintf( out + 2 * i, 3, "%02x", (unsigned char)data[i] );
+	    }
+	    break;
+	case A_DOUBLE:
+	    snprintf( out, size, "%.17g", *(double *)data );
+	    break;
+	case A_FLOAT:
+	    snprintf( out, size, "%.9g", *(float *)data );
+	    break;
+	case A_VAL64:
+	    snprintf( out, size, "%lld", *(long long *)data );
+	    break;
+	case A_UVAL64:
+	    snprintf( out, size, "%llu", *(unsigned long long *)data );
+	    break;
+	case A_VAL32:
+	    snprintf( out, size, "%d", *(int *)data );
+	    break;
+	case A_UVAL32:
+	    snprintf( out, size, "%u", *(unsigned int *)data );
+	    break;
+	case A_VAL16:
+	    snprintf( out, size, "%d", *(short *)data );
+	    break;
+	case A_UVAL16:
+	    snprintf( out, size, "%u", *(unsigned short *)data );
+	    break;
+	case A_VAL8:
+	    snprintf( out, size, "%d", *(signed char *)data );
+	    break;
+	case A_UVAL8:
+	    snprintf( out, size, "%u", *(unsigned char *)data );
+	    break;
+	default:
+	    break;
+    }
+}
+
+static void captureParam( slowQueryParam &param, const dbcapi_bind_data &data, bool with_value )
+/**********************************************************************************************/
+{
+    const dbcapi_data_value &value = data.value;
+
+    param.type = value.type;
+    param.is_null = ( value.is_null != NULL && *value.is_null );
+    param.length = (uint32_t)( value.length != NULL ? *value.length : value.buffer_size );
+    param.value[0] = '\0';
+    if( with_value && !param.is_null ) {
+	formatValue( value, param.value, sizeof( param.value ) );
+    }
+}
+
+void slowQueryLog::capture( executeBaton *baton, const char *operation )
+/**********************************************************************/
+{
+    uint64_t elapsed = uv_hrtime() - baton->timings.started_at;
+
+    if( elapsed < threshold_ns ) {
+	return;
+    }
+
+    uint64_t index = next++;
+    slot &s = slots[index % capacity];
+    uint32_t seq = s.seq.load();
+
+    // Another worker is still writing this slot a whole lap earlier
+    if( ( seq & 1 ) != 0 || !s.seq.compare_exchange_strong( seq, seq + 1 ) ) {
+	return;
+    }
+
+    slowQueryEntry &e = s.entry;
+    const std::string &sql = ( baton->stmt.empty() && baton->obj_stmt != NULL ) ? baton->obj_stmt->sql
+										: baton->stmt;
+    size_t sql_length = sql.length() < SLOW_LOG_SQL_LENGTH ? sql.length() : SLOW_LOG_SQL_LENGTH - 1;
+
+    e.index = index;
+    e.time_ms = (double)std::chrono::duration_cast<std::chrono::milliseconds>(
+	std::chrono::system_clock::now().time_since_epoch() ).count();
+    e.operation = operation;
+    e.function_code = baton->function_code;
+    e.error_code = baton->err ? baton->error_code : 0;
+    if( baton->columnar != NULL ) {
+	e.rows = (double)baton->columnar->num_rows;
+    } else if( !baton->col_names.empty() ) {
+	e.rows = (double)( baton->col_types.size() / baton->col_names.size() );
+    } else {
+	e.rows = baton->rows_affected > 0 ? baton->rows_affected : 0;
+    }
+    memcpy( e.phase_ns, baton->timings.phase_ns, sizeof( e.phase_ns ) );
+    e.phase_ns[PHASE_TOTAL] = elapsed;
+    e.sql_length = sql.length();
+    memcpy( e.sql, sql.data(), sql_length );
+    e.sql[sql_length] = '\0';
+
+    e.has_values = ( sample_binds > 0 && captured++ % sample_binds == 0 );
+    if( baton->use_arena ) {
+	const std::vector<dbcapi_bind_data> &params = baton->obj_stmt->params;
+	e.param_count = (int)params.size();
+	for( size_t i = 0; i < params.size() && i < SLOW_LOG_MAX_PARAMS; i++ ) {
+	    captureParam( e.params[i], params[i], e.has_values );
+	}
+    } else {
+	const std::vector<dbcapi_bind_data*> &params = baton->params;
+	e.param_count = (int)params.size();
+	for( size_t i = 0; i < params.size() && i < SLOW_LOG_MAX_PARAMS; i++ ) {
+	    captureParam( e.params[i], *params[i], e.has_values );
+	}
+    }
+
+    s.seq.store( seq + 2, std::memory_order_release );
+}
+
+void slowQueryLog::read( std::vector<slowQueryEntry> &out, bool consume )
+/***********************************************************************/
+{
+    uint64_t end = next.load();
+    uint64_t begin = read_from.load();
+
+    if( end - begin > capacity ) {
+	begin = end - capacity;
+    }
+    out.reserve( out.size() + (size_t)( end - begin ) );
+    for( uint64_t i = begin; i < end; i++ ) {
+	slot &s = slots[i % capacity];
+	uint32_t seq = s.seq.load( std::memory_order_acquire );
+	bool busy = ( seq & 1 ) != 0;
+	if( !busy ) {
+	    out.push_back( s.entry );
+	    std::atomic_thread_fence( std::memory_order_acquire );
+	    busy = s.seq.load( std::memory_order_relaxed ) != seq;
+	    if( busy || out.back().index != i ) {
+		// Being written, or dropped by its writer
+		out.pop_back();
+	    }
+	}
+	if( busy && consume ) {
+	    // The slot is consumed by a later read once it is written
+	    end = i;
+	    break;
+	}
+    }
+    if( consume ) {
+	// Only move forward; another reader may have consumed more
+	uint64_t from = read_from.load();
+	while( from < end && !read_from.compare_exchange_weak( from, end ) ) {
+	}
+    }
+}
+
+Local<Array> slowQueryLog::toArray( Isolate *isolate, bool consume )
+/******************************************************************/
+{
+    EscapableHandleScope scope( isolate );
+    std::vector<slowQueryEntry> entries;
+
+    read( entries, consume );
+    Local<Array> arr = Array::New( isolate, (int)entries.size() );
+    for( size_t i = 0; i < entries.size(); i++ ) {
+	const slowQueryEntry &e = entries[i];
+	Local<Object> obj = Object::New( isolate );
+	obj->Set( String::NewFromUtf8( isolate, "timeMs" ), Number::New( isolate, e.time_ms ) );
+	obj->Set( String::NewFromUtf8( isolate, "operation" ), String::NewFromUtf8( isolate, e.operation ) );
+	obj->Set( String::NewFromUtf8( isolate, "sql" ), String::NewFromUtf8( isolate, e.sql ) );
+	obj->Set( String::NewFromUtf8( isolate, "sqlTruncated" ),
+		  Boolean::New( isolate, e.sql_length >= SLOW_LOG_SQL_LENGTH ) );
+	obj->Set( String::NewFromUtf8( isolate, "functionCode" ), Integer::New( isolate, e.function_code ) );
+	obj->Set( String::NewFromUtf8( isolate, "errorCode" ), Integer::New( isolate, e.error_code ) );
+	obj->Set( String::NewFromUtf8( isolate, "rows" ), Number::New( isolate, e.rows ) );
+	for( int p = 0; p < PHASE_COUNT; p++ ) {
+	    obj->Set( String::NewFromUtf8( isolate, phaseKeys[p] ), Number::New( isolate, e.phase_ns[p] / 1e6 ) );
+	}
+	obj->Set( String::NewFromUtf8( isolate, "paramCount" ), Integer::New( isolate, e.param_count ) );
+
+	int count = e.param_count < SLOW_LOG_MAX_PARAMS ? e.param_count : SLOW_LOG_MAX_PARAMS;
+	Local<Array> params = Array::New( isolate, count );
+	for( int p = 0; p < count; p++ ) {
+	    const slowQueryParam &param = e.params[p];
+	    Local<Object> pobj = Object::New( isolate );
+	    pobj->Set( String::NewFromUtf8( isolate, "type" ), String::NewFromUtf8( isolate, typeName( param.type ) ) );
+	    pobj->Set( String::NewFromUtf8( isolate, "length" ), Number::New( isolate, param.length ) );
+	    pobj->Set( String::NewFromUtf8( isolate, "isNull" ), Boolean::New( isolate, param.is_null ) );
+	    if( e.has_values && !param.is_null ) {
+		pobj->Set( String::NewFromUtf8( isolate, "value" ), String::NewFromUtf8( isolate, param.value ) );
+	    }
+	    params->Set( (uint32_t)p, pobj );
+	}
+	obj->Set( String::NewFromUtf8( isolate, "params" ), params );
+	arr->Set( (uint32_t)i, obj );
+    }
+    return scope.Escape( arr );
+}
+
+static bool getUnsignedOption( Local<Object> options, const char *name, int arg,
+			       const char *usage, unsigned &value )
+/************************************************************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    Local<Value> val = options->Get( String::NewFromUtf8( isolate, name ) );
+
+    if( val->IsUndefined() ) {
+	return true;
+    }
+    if( !val->IsUint32() ) {
+	throwErrorIP( arg, usage, "non-negative integer", getJSTypeName( getJSType( val ) ).c_str() );
+	return false;
+    }
+    value = val->Uint32Value();
+    return true;
+}
+
+slowQueryLog *newSlowQueryLog( Local<Value> options, int arg, const char *usage )
+/*******************************************************************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    double threshold_ms = 1000;
+    unsigned size = 128;
+    unsigned sample_binds = 0;
+
+    if( !options->IsObject() ) {
+	throwErrorIP( arg, usage, "object", getJSTypeName( getJSType( options ) ).c_str() );
+	return NULL;
+    }
+    Local<Object> obj = options->ToObject();
+    Local<Value> threshold = obj->Get( String::NewFromUtf8( isolate, "thresholdMs" ) );
+    if( !threshold->IsUndefined() ) {
+	if( !threshold->IsNumber() || threshold->NumberValue() < 0 ) {
+	    throwErrorIP( arg, usage, "non-negative number", getJSTypeName( getJSType( threshold ) ).c_str() );
+	    return NULL;
+	}
+	threshold_ms = threshold->NumberValue();
+    }
+    if( !getUnsignedOption( obj, "size", arg, usage, size ) ||
+	!getUnsignedOption( obj, "sampleBinds", arg, usage, sample_binds ) ) {
+	return NULL;
+    }
+    if( size == 0 ) {
+	throwError( JS_ERR_INVALID_ARGUMENTS );
+	return NULL;
+    }
+    return new slowQueryLog( (uint64_t)( threshold_ms * 1e6 ), size, sample_binds );
+}
+
+struct flushBaton {
+    Persistent<Function>	callback;
+    bool			err;
+    int				error_code;
+    std::string			error_msg;
+    std::string			sql_state;
+
+    slowQueryLog		*log;
+    std::string			path;
+    int				count;
+
+    flushBaton() {
+	err = false;
+	log = NULL;
+	count = 0;
+    }
+
+    ~flushBaton() {
+	if( log != NULL ) {
+	    log->release();
+	}
+	callback.Reset();
+    }
+};
+
+static void appendJsonString( std::string &out, const char *text )
+/*****************************************************************/
+{
+    out += '"';
+    for( const char *p = text; *p != '\0'; p++ ) {
+	unsigned char c = (unsigned char)*p;
+	if( c == '"' || c == '\\' ) {
+	    out += '\\';
+	    out += (char)c;
+	} else if( c < 0x20 ) {
+	    char buffer[8];
+	    snprintf( buffer, sizeof( buffer ), "\\u%04x", c );
+	    out += buffer;
+	} else {
+	    out += (char)c;
+	}
+    }
+    out += '"';
+}
+
+static void appendEntry( std::string &out, const slowQueryEntry &e )
+/******************************************************************/
+{
+    char buffer[64];
+
+    snprintf( buffer, sizeof( buffer ), "{\"timeMs\":%.0f,\"operation\":", e.time_ms );
+    out += buffer;
+    appendJsonString( out, e.operation );
+    out += ",\"sql\":";
+    appendJsonString( out, e.sql );
+    snprintf( buffer, sizeof( buffer ), ",\"sqlTruncated\":%s,\"functionCode\":%d",
+	      e.sql_length >= SLOW_LOG_SQL_LENGTH ? "true" : "false", e.function_code );
+    out += buffer;
+    snprintf( buffer, sizeof( buffer ), ",\"errorCode\":%d,\"rows\":%.0f", e.error_code, e.rows );
+    out += buffer;
+    for( int p = 0; p < PHASE_COUNT; p++ ) {
+	snprintf( buffer, sizeof( buffer ), ",\"%s\":%.3f", phaseKeys[p], e.phase_ns[p] / 1e6 );
+	out += buffer;
+    }
+    snprintf( buffer, sizeof( buffer ), ",\"paramCount\":%d,\"params\":[", e.param_count );
+    out += buffer;
+    for( int p = 0; p < e.param_count && p < SLOW_LOG_MAX_PARAMS; p++ ) {
+	const slowQueryParam &param = e.params[p];
+	snprintf( buffer, sizeof( buffer ), "%s{\"type\":\"%s\",\"length\":%u,\"isNull\":%s",
+		  p > 0 ? "," : "", typeName( param.type ), param.length,
+		  param.is_null ? "true" : "false" );
+	out += buffer;
+	if( e.has_values && !param.is_null ) {
+	    out += ",\"value\":";
+	    appendJsonString( out, param.value );
+	}
+	out += '}';
+    }
+    out += "]}\n";
+}
+
+static void flushWork( uv_work_t *req )
+/*************************************/
+{
+    flushBaton *baton = static_cast<flushBaton*>(req->data);
+    std::vector<slowQueryEntry> entries;
+    std::string text;
+
+    baton->log->read( entries, true );
+    for( size_t i = 0; i < entries.size(); i++ ) {
+	appendEntry( text, entries[i] );
+    }
+
+    FILE *file = fopen( baton->path.c_str(), "ab" );
+    if( file == NULL ) {
+	baton->err = true;
+	getErrorMsg( JS_ERR_WRITING_FILE, baton->error_code, baton->error_msg, baton->sql_state );
+	return;
+    }
+    bool written = fwrite( text.data(), 1, text.length(), file ) == text.length();
+    if( fclose( file ) != 0 || !written ) {
+	baton->err = true;
+	getErrorMsg( JS_ERR_WRITING_FILE, baton->error_code, baton->error_msg, baton->sql_state );
+	return;
+    }
+    baton->count = (int)entries.size();
+}
+
+static void flushAfter( uv_work_t *req )
+/**************************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+    flushBaton *baton = static_cast<flushBaton*>(req->data);
+    Local<Value> undef = Local<Value>::New( isolate, Undefined( isolate ) );
+
+    if( baton->err ) {
+	callBack( baton->error_code, &( baton->error_msg ), &( baton->sql_state ),
+		  baton->callback, undef, true );
+    } else {
+	Local<Value> count = Integer::New( isolate, baton->count );
+	callBack( 0, NULL, NULL, baton->callback, count, true );
+    }
+    delete baton;
+    delete req;
+}
+
+void flushSlowQueryLog( Isolate *		isolate,
+			slowQueryLog *		log,
+			const std::string &	path,
+			Local<Function>		callback )
+/*****************************************************/
+{
+    flushBaton *baton = new flushBaton();
+    log->addRef();
+    baton->log = log;
+    baton->path = path;
+    baton->callback.Reset( isolate, callback );
+
+    uv_work_t *req = new uv_work_t();
+    req->data = baton;
+    int status = queueWork( req, flushWork, (uv_after_work_cb)flushAfter );
+    assert( status == 0 );
+    _unused( status );
+}
@@ -0,0 +1,439 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include "nodever_cover.h"
+#include "hana_utils.h"
+#include <stdlib.h>
+
+#if defined( _WIN32 )
+    #include <windows.h>
+    #include <io.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+using namespace v8;
+
+// Rows are written to the file in chunks of this size
+#define SPILL_BUFFER_SIZE	( 1024 * 1024 )
+
+spillFile::spillFile()
+/********************/
+{
+    num_rows = 0;
+    size = 0;
+    file = NULL;
+    map = NULL;
+#if defined( _WIN32 )
+    mapping = NULL;
+#endif
+    num_cols = 0;
+}
+
+spillFile::~spillFile()
+/*********************/
+{
+    close();
+}
+
+bool spillFile::open( size_t cols )
+/*********************************/
+{
+    num_cols = cols;
+#if defined( _WIN32 )
+    // Deleted when it is closed
+    file = tmpfile();
+#else
+    const char *dir = getenv( "TMPDIR" );
+    if( dir == NULL || *dir == '\0' ) {
+	dir = "/tmp";
+    }
+    std::string path = std::string( dir ) + "/hana-result-XXXXXX";
+    std::vector<char> name( path.begin(), path.end() );
+    name.push_back( '\0' );
+
+    int fd = mkstemp( &name[0] );
+    if( fd < 0 ) {
+	return false;
+    }
+    unlink( &name[0] );
+    file = fdopen( fd, "w+b" );
+    if( file == NULL ) {
+	::close( fd );
+    }
+#endif
+    if( file == NULL ) {
+	return false;
+    }
+    buffer.reserve( SPILL_BUFFER_SIZE );
+    return true;
+}
+
+bool spillFile::write( const void *data, size_t length )
+/******************************************************/
+{
+    if( buffer.size() + length > SPILL_BUFFER_SIZE && !flush() ) {
+	return false;
+    }
+    buffer.insert( buffer.end(), (const char *)data, (const char *)data + length );
+    size += length;
+    return true;
+}
+
+bool spillFile::flush()
+/*********************/
+{
+    if( !buffer.empty() && fwrite( &buffer[0], 1, buffer.size(), file ) != buffer.size() ) {
+	return false;
+    }
+    buffer.clear();
+    return true;
+}
+
+bool spillFile::append( std::vector<char*> &		string_vals,
+			std::vector<double*> &		num_vals,
+			std::vector<int*> &		int_vals,
+			std::vector<size_t*> &		string_len,
+			std::vector<dbcapi_data_type> &	col_types )
+/**************************************************************/
+{
+    size_t count_string = 0, count_num = 0, count_int = 0;
+
+    for( size_t cell = 0; cell < col_types.size(); cell++ ) {
+	if( cell % num_cols == 0 ) {
+	    if( num_rows % SPILL_INDEX_INTERVAL == 0 ) {
+		index.push_back( size );
+	    }
+	    num_rows++;
+	}
+
+	unsigned char type = (unsigned char)col_types[cell];
+	if( !write( &type, 1 ) ) {
+	    return false;
+	}
+	switch( col_types[cell] ) {
+	    case A_INVALID_TYPE:
+		break;
+
+	    case A_VAL32:
+	    case A_VAL16:
+	    case A_UVAL16:
+	    case A_VAL8:
+	    case A_UVAL8:
+		if( !write( int_vals[count_int], sizeof( int ) ) ) {
+		    return false;
+		}
+		delete int_vals[count_int];
+		int_vals[count_int++] = NULL;
+		break;
+
+	    case A_UVAL32:
+	    case A_UVAL64:
+	    case A_VAL64:
+	    case A_DOUBLE:
+		if( !write( num_vals[count_num], sizeof( double ) ) ) {
+		    return false;
+		}
+		delete num_vals[count_num];
+		num_vals[count_num++] = NULL;
+		break;
+
+	    case A_BINARY:
+	    case A_STRING:
+	    {
+		uint32_t length = (uint32_t)*string_len[count_string];
+		if( !write( &length, sizeof( length ) ) ||
+		    !write( string_vals[count_string], length ) ) {
+		    return false;
+		}
+		delete [] string_vals[count_string];
+		delete string_len[count_string];
+		string_vals[count_string] = NULL;
+		string_len[count_string++] = NULL;
+		break;
+	    }
+
+	    default:
+		return false;
+	}
+    }
+
+    string_vals.clear();
+    num_vals.clear();
+    int_vals.clear();
+    string_len.clear();
+    col_types.clear();
+    return true;
+}
+
+bool spillFile::finish()
+/**********************/
+{
+    if( !flush() || fflush( file ) != 0 ) {
+	return false;
+    }
+    std::vector<char>().swap( buffer );
+    if( size == 0 ) {
+	return true;
+    }
+#if defined( _WIN32 )
+    HANDLE handle = (HANDLE)_get_osfhandle( _fileno( file ) );
+    mapping = CreateFileMapping( handle, NULL, PAGE_READONLY, 0, 0, NULL );
+    if( mapping == NULL ) {
+	return false;
+    }
+    map = (char *)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+#else
+    void *addr = mmap( NULL, (size_t)size, PROT_READ, MAP_SHARED, fileno( file ), 0 );
+    map = ( addr == MAP_FAILED ) ? NULL : (char *)addr;
+#endif
+    return map != NULL;
+}
+
+uint64_t spillFile::skipRow( uint64_t offset ) const
+/**************************************************/
+{
+    for( size_t i = 0; i < num_cols; i++ ) {
+	switch( (dbcapi_data_type)map[offset++] ) {
+	    case A_VAL32:
+	    case A_VAL16:
+	    case A_UVAL16:
+	    case A_VAL8:
+	    case A_UVAL8:
+		offset += sizeof( int );
+		break;
+
+	    case A_UVAL32:
+	    case A_UVAL64:
+	    case A_VAL64:
+	    case A_DOUBLE:
+		offset += sizeof( double );
+		break;
+
+	    case A_BINARY:
+	    case A_STRING:
+	    {
+		uint32_t length;
+		memcpy( &length, map + offset, sizeof( length ) );
+		offset += sizeof( length ) + length;
+		break;
+	    }
+
+	    default:
+		break;
+	}
+    }
+    return offset;
+}
+
+Local<Array> spillFile::getRows( Isolate *isolate, size_t start, size_t count )
+/*****************************************************************************/
+{
+    EscapableHandleScope scope( isolate );
+    Local<Array> rows = Array::New( isolate );
+
+    if( map == NULL || start >= num_rows ) {
+	return scope.Escape( rows );
+    }
+    if( count > num_rows - start ) {
+	count = num_rows - start;
+    }
+
+    std::vector<Local<String>> colNamesLocal;
+    for( size_t i = 0; i < num_cols; i++ ) {
+	colNamesLocal.push_back( String::NewFromUtf8( isolate, col_names[i] ) );
+    }
+
+    uint64_t offset = index[start / SPILL_INDEX_INTERVAL];
+    for( size_t skip = start % SPILL_INDEX_INTERVAL; skip > 0; skip-- ) {
+	offset = skipRow( offset );
+    }
+
+    for( size_t row = 0; row < count; row++ ) {
+	Local<Object> curr_row = Object::New( isolate );
+	for( size_t i = 0; i < num_cols; i++ ) {
+	    switch( (dbcapi_data_type)map[offset++] ) {
+		case A_VAL32:
+		case A_VAL16:
+		case A_UVAL16:
+		case A_VAL8:
+		case A_UVAL8:
+		{
+		    int val;
+		    memcpy( &val, map + offset, sizeof( val ) );
+		    offset += sizeof( val );
+		    if( col_native_types[i] == DT_BOOLEAN ) {
+			curr_row->Set( colNamesLocal[i], Boolean::New( isolate, val > 0 ) );
+		    } else {
+			curr_row->Set( colNamesLocal[i], Integer::New( isolate, val ) );
+		    }
+		    break;
+		}
+
+		case A_UVAL32:
+		case A_UVAL64:
+		case A_VAL64:
+		case A_DOUBLE:
+		{
+		    double val;
+		    memcpy( &val, map + offset, sizeof( val ) );
+		    offset += sizeof( val );
+		    curr_row->Set( colNamesLocal[i], Number::New( isolate, val ) );
+		    break;
+		}
+
+		case A_BINARY:
+		{
+		    uint32_t length;
+		    memcpy( &length, map + offset, sizeof( length ) );
+		    offset += sizeof( length );
+		    curr_row->Set( colNamesLocal[i],
+				   node::Buffer::Copy( isolate, map + offset, length ).ToLocalChecked() );
+		    offset += length;
+		    break;
+		}
+
+		case A_STRING:
+		{
+		    uint32_t length;
+		    memcpy( &length, map + offset, sizeof( length ) );
+		    offset += sizeof( length );
+		    curr_row->Set( colNamesLocal[i],
+				   String::NewFromUtf8( isolate, map + offset, NewStringType::kNormal,
+							(int)length ).ToLocalChecked() );
+		    offset += length;
+		    break;
+		}
+
+		default:
+		    curr_row->Set( colNamesLocal[i], Null( isolate ) );
+		    break;
+	    }
+	}
+	rows->Set( (uint32_t)row, curr_row );
+    }
+    return scope.Escape( rows );
+}
+
+void spillFile::close()
+/*********************/
+{
+#if defined( _WIN32 )
+    if( map != NULL ) {
+	UnmapViewOfFile( map );
+    }
+    if( mapping != NULL ) {
+	CloseHandle( mapping );
+	mapping = NULL;
+    }
+#else
+    if( map != NULL ) {
+	munmap( map, (size_t)size );
+    }
+#endif
+    map = NULL;
+    if( file != NULL ) {
+	fclose( file );
+	file = NULL;
+    }
+    std::vector<uint64_t>().swap( index );
+    std::vector<char>().swap( buffer );
+    clearVector( col_names );
+}
+
+// SpilledResult Object Functions
+
+perIsolateFunction SpilledResult::constructor;
+
+SpilledResult::SpilledResult()
+/****************************/
+{
+    spill = NULL;
+}
+
+SpilledResult::~SpilledResult()
+/*****************************/
+{
+    delete spill;
+}
+
+void SpilledResult::Init( Isolate *isolate )
+/******************************************/
+{
+    Local<FunctionTemplate> tpl = FunctionTemplate::New( isolate, New );
+    tpl->SetClassName( String::NewFromUtf8( isolate, "SpilledResult" ) );
+    tpl->InstanceTemplate()->SetInternalFieldCount( 1 );
+
+    NODE_SET_PROTOTYPE_METHOD( tpl, "getRowCount",	getRowCount );
+    NODE_SET_PROTOTYPE_METHOD( tpl, "getRows",		getRows );
+    NODE_SET_PROTOTYPE_METHOD( tpl, "close",		close );
+
+    constructor.Reset( isolate, tpl->GetFunction() );
+}
+
+void SpilledResult::New( const FunctionCallbackInfo<Value> &args )
+/****************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    SpilledResult *obj = new SpilledResult();
+    obj->Wrap( args.This() );
+    args.GetReturnValue().Set( args.This() );
+}
+
+Local<Object> SpilledResult::NewInstance( Isolate *isolate, spillFile *spill )
+/****************************************************************************/
+{
+    EscapableHandleScope scope( isolate );
+    Local<Function> cons = constructor.Get( isolate );
+    Local<Object> instance = cons->NewInstance( 0, NULL );
+    SpilledResult *obj = ObjectWrap::Unwrap<SpilledResult>( instance );
+    obj->spill = spill;
+    return scope.Escape( instance );
+}
+
+NODE_API_FUNC( SpilledResult::getRowCount )
+/*****************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    SpilledResult *obj = ObjectWrap::Unwrap<SpilledResult>( args.This() );
+    size_t rows = ( obj->spill != NULL ) ? obj->spill->num_rows : 0;
+
+    args.GetReturnValue().Set( Number::New( isolate, (double)rows ) );
+}
+
+NODE_API_FUNC( SpilledResult::getRows )
+/*************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    SpilledResult *obj = ObjectWrap::Unwrap<SpilledResult>( args.This() );
+
+    for( int i = 0; i < 2; i++ ) {
+	if( args.Length() <= i || !args[i]->IsUint32() ) {
+	    throwErrorIP( i, "getRows(start, count)", "non-negative integer",
+			  getJSTypeName( getJSType( args[i] ) ).c_str() );
+	    return;
+	}
+    }
+    if( obj->spill == NULL ) {
+	throwError( JS_ERR_INVALID_OBJECT );
+	return;
+    }
+    args.GetReturnValue().Set( obj->spill->getRows( isolate, args[0]->Uint32Value(),
+						     args[1]->Uint32Value() ) );
+}
+
+NODE_API_FUNC( SpilledResult::close )
+/***********************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope( isolate );
+    SpilledResult *obj = ObjectWrap::Unwrap<SpilledResult>( args.This() );
+
+    delete obj->spill;
+    obj->spill = NULL;
+    args.GetReturnValue().SetUndefined();
+}
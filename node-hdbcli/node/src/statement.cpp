@@ -17,6 +17,10 @@ Statement::Statement()
     execBaton = NULL;
     conn_mutex = NULL;
     is_dropped = false;
+    query_timeout = -1;
+    params_busy = false;
+    open_cursors = 0;
+    max_open_cursors = 0;
 }
 
 Statement::~Statement()
@@ -26,16 +30,84 @@ Statement::~Statement()
         delete execBaton;
         execBaton = NULL;
     }
-    if( dbcapi_stmt_ptr != NULL ) {
+    if( dbcapi_stmt_ptr != NULL || !idle_cursors.empty() ) {
         scoped_lock lock(*conn_mutex);
-        api.dbcapi_free_stmt( dbcapi_stmt_ptr );
-        dbcapi_stmt_ptr = NULL;
+        freeCursors();
+        if( dbcapi_stmt_ptr != NULL ) {
+            api.dbcapi_free_stmt( dbcapi_stmt_ptr );
+            dbcapi_stmt_ptr = NULL;
+        }
     }
     clearParameters( params );
-    param_infos.clear();
+    param_descs.clear();
+}
+
+dbcapi_stmt *Statement::acquireCursor()
+/*************************************/
+{
+    dbcapi_stmt *cursor = NULL;
+
+    if (!idle_cursors.empty()) {
+        cursor = idle_cursors.back();
+        idle_cursors.pop_back();
+    } else {
+        cursor = api.dbcapi_prepare(connection->conn, sql.c_str());
+        if (cursor == NULL) {
+            return NULL;
+        }
+        if (!setQueryTimeout(cursor, query_timeout)) {
+            api.dbcapi_free_stmt(cursor);
+            return NULL;
+        }
+    }
+
+    open_cursors++;
+    if (open_cursors > max_open_cursors) {
+        max_open_cursors = open_cursors;
+    }
+    return cursor;
+}
+
+void Statement::releaseCursor(dbcapi_stmt *cursor)
+/************************************************/
+{
+    if (cursor == NULL) {
+        return;
+    }
+    if (open_cursors > 0) {
+        open_cursors--;
+    }
+
+    if (!is_dropped && connection != NULL && connection->is_connected &&
+        (int)idle_cursors.size() < max_open_cursors &&
+        api.dbcapi_reset(cursor)) {
+        idle_cursors.push_back(cursor);
+        return;
+    }
+    api.dbcapi_free_stmt(cursor);
 }
 
-Persistent<Function> Statement::constructor;
+void Statement::freeCursors()
+/***************************/
+{
+    for (size_t i = 0; i < idle_cursors.size(); i++) {
+        api.dbcapi_free_stmt(idle_cursors[i]);
+    }
+    idle_cursors.clear();
+}
+
+void Statement::accountBindArena(Isolate *isolate)
+/***********************************************/
+{
+    int64_t size = (int64_t)(params.size() * sizeof(dbcapi_bind_data));
+    for (size_t i = 0; i < params_capacity.size(); i++) {
+        size += (int64_t)params_capacity[i];
+    }
+    arena_mem.set(MEM_BIND_ARENA, size);
+    arena_mem.report(isolate);
+}
+
+perIsolateFunction Statement::constructor;
 
 void Statement::Init(Isolate *isolate)
 /***************************************/
@@ -54,6 +126,7 @@ void Statement::Init(Isolate *isolate)
     NODE_SET_PROTOTYPE_METHOD(tpl, "executeQuery", execQuery);
     NODE_SET_PROTOTYPE_METHOD(tpl, "execBatch", execBatch);
     NODE_SET_PROTOTYPE_METHOD(tpl, "executeBatch", execBatch);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "execMany", execMany);
     NODE_SET_PROTOTYPE_METHOD(tpl, "drop", drop);
     NODE_SET_PROTOTYPE_METHOD(tpl, "getParameterInfo", getParameterInfo);
     NODE_SET_PROTOTYPE_METHOD(tpl, "getParameterValue", getParameterValue);
@@ -89,36 +162,45 @@ void Statement::CreateNewInstance(const FunctionCallbackInfo<Value> &	args,
     HandleScope	scope(isolate);
     const unsigned argc = 1;
     Handle<Value> argv[argc] = { args[0] };
-    Local<Function>cons = Local<Function>::New(isolate, constructor);
+    Local<Function>cons = constructor.Get(isolate);
     obj.Reset(isolate, cons->NewInstance(argc, argv));
 }
 
 bool Statement::checkExecParameters(const FunctionCallbackInfo<Value> &args,
                                     const char *function,
                                     bool &bind_required,
-                                    int  &cbfunc_arg)
+                                    int  &cbfunc_arg,
+                                    int  &timeout,
+                                    resultLimit *limit)
 /*******************************/
 {
-    int  num_args = args.Length();
+    int  options_arg = findOptionsArg(args, 0);
+    int  num_args = args.Length() - (options_arg >= 0 ? 1 : 0);
+    int  arg_pos[2] = { 0, 1 };
     int  invalidArg = -1;
     unsigned int expectedTypes[] = { JS_ARRAY | JS_FUNCTION, JS_FUNCTION };
 
     cbfunc_arg = -1;
     bind_required = false;
 
+    // Arguments after the options object are shifted by one
+    for (int i = options_arg; options_arg >= 0 && i < 2; i++) {
+        arg_pos[i]++;
+    }
+
     if (num_args == 1) {
-        if (args[0]->IsArray()) {
+        if (args[arg_pos[0]]->IsArray()) {
             bind_required = true;
-        } else if (args[0]->IsFunction()) {
-            cbfunc_arg = 0;
-        } else if (!args[0]->IsUndefined() && !args[0]->IsNull()) {
+        } else if (args[arg_pos[0]]->IsFunction()) {
+            cbfunc_arg = arg_pos[0];
+        } else if (!args[arg_pos[0]]->IsUndefined() && !args[arg_pos[0]]->IsNull()) {
             invalidArg = 0;
         }
     } else if (num_args >= 2) {
-        if (args[0]->IsArray() || args[0]->IsNull() || args[0]->IsUndefined()) {
-            bind_required = args[0]->IsArray();
-            if (args[1]->IsFunction() || args[1]->IsUndefined() || args[1]->IsNull()) {
-                cbfunc_arg = (args[1]->IsFunction()) ? 1 : -1;
+        if (args[arg_pos[0]]->IsArray() || args[arg_pos[0]]->IsNull() || args[arg_pos[0]]->IsUndefined()) {
+            bind_required = args[arg_pos[0]]->IsArray();
+            if (args[arg_pos[1]]->IsFunction() || args[arg_pos[1]]->IsUndefined() || args[arg_pos[1]]->IsNull()) {
+                cbfunc_arg = (args[arg_pos[1]]->IsFunction()) ? arg_pos[1] : -1;
             } else {
                 invalidArg = 1;
             }
@@ -128,13 +210,16 @@ bool Statement::checkExecParameters(const FunctionCallbackInfo<Value> &args,
     }
 
     if (invalidArg >= 0) {
-        throwErrorIP(invalidArg, function,
+        throwErrorIP(arg_pos[invalidArg], function,
                      getJSTypeName(expectedTypes[invalidArg]).c_str(),
-                     getJSTypeName(getJSType(args[invalidArg])).c_str());
+                     getJSTypeName(getJSType(args[arg_pos[invalidArg]])).c_str());
         return false;
     }
 
-    return true;
+    if (limit != NULL && !getResultLimitOptions(args, options_arg, function, *limit)) {
+        return false;
+    }
+    return getQueryOptions(args, options_arg, function, timeout);
 }
 
 NODE_API_FUNC(Statement::isValid)
@@ -153,11 +238,14 @@ NODE_API_FUNC(Statement::exec)
     Isolate *isolate = args.GetIsolate();
     HandleScope scope(isolate);
     int  cbfunc_arg = -1;
+    int  timeout = -1;
     bool bind_required = false;
+    resultLimit limit;
 
     args.GetReturnValue().SetUndefined();
 
-    if (!checkExecParameters(args, "exec[ute]([params][, callback])", bind_required, cbfunc_arg)) {
+    if (!checkExecParameters(args, "exec[ute]([params][, options][, callback])", bind_required, cbfunc_arg, timeout,
+                             &limit)) {
         return;
     }
 
@@ -173,15 +261,30 @@ NODE_API_FUNC(Statement::exec)
     baton->obj_stmt = obj;
     baton->dbcapi_stmt_ptr = obj->dbcapi_stmt_ptr;
     baton->callback_required = callback_required;
-
-    if (bind_required) {
+    baton->query_timeout = timeout;
+    baton->limit.max_bytes = limit.max_bytes;
+    baton->limit.policy = limit.policy;
+
+    // Write the values straight into the statement's bind buffers unless
+    // another execute is still using them or a value needs special handling
+    if (!obj->params_busy &&
+        setBindArenaValues(bind_required ? args[0] : Local<Value>(), obj->params,
+                           obj->params_capacity, obj->param_descs)) {
+        baton->use_arena = true;
+        obj->params_busy = true;
+        obj->accountBindArena(isolate);
+    } else if (bind_required) {
         if (!getInputParameters(args[0], baton->provided_params, baton->error_code, baton->error_msg, baton->sql_state)) {
             Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
             callBack(baton->error_code, &baton->error_msg, &baton->sql_state, args[cbfunc_arg], undef, callback_required);
+            delete baton;
             return;
         }
     }
 
+    // The parameters were converted on the main thread
+    baton->timings.end(PHASE_CONVERT);
+
     uv_work_t *req = new uv_work_t();
     req->data = baton;
 
@@ -190,8 +293,8 @@ NODE_API_FUNC(Statement::exec)
         baton->callback.Reset(isolate, callback);
 
         int status;
-        status = uv_queue_work(uv_default_loop(), req, executeWork,
-                               (uv_after_work_cb)executeAfter);
+        status = queueWork(req, executeWork, (uv_after_work_cb)executeAfter,
+                           workQueueOf(obj->connection));
         assert(status == 0);
 
         return;
@@ -200,7 +303,11 @@ NODE_API_FUNC(Statement::exec)
     Persistent<Value> ResultSet;
 
     executeWork(req);
+    releaseBindArena(baton);
     bool success = fillResult(baton, ResultSet);
+    if (!baton->send_param_data) {
+        delete baton;
+    }
     delete req;
 
     if (!success) {
@@ -230,6 +337,10 @@ struct executeBatchBaton
     int 				rows_affected;
     int                                 batch_size;
     int                                 row_param_count;
+    int                                 query_timeout;
+    int                                 function_code;
+    opTimings                           timings;
+    memAccount                          mem;
 
     executeBatchBaton()
     {
@@ -241,6 +352,8 @@ struct executeBatchBaton
         batch_size = -1;
         rows_affected = -1;
         row_param_count = -1;
+        query_timeout = -1;
+        function_code = 0;
     }
 
     ~executeBatchBaton()
@@ -253,18 +366,28 @@ struct executeBatchBaton
     }
 };
 
+static void finishBatch(executeBatchBaton *baton)
+/*******************************/
+{
+    recordTimings(baton->obj, baton->timings);
+    traceOperation(baton->obj, "batch", baton->obj_stmt->sql, baton->function_code, baton->timings,
+                   baton->err ? 0 : baton->rows_affected, 0,
+                   baton->row_param_count * baton->batch_size, baton->err ? baton->error_code : 0);
+}
+
 NODE_API_FUNC(Statement::execBatch)
 /*******************************/
 {
     Isolate *isolate = args.GetIsolate();
     HandleScope scope(isolate);
     int cbfunc_arg = -1;
+    int timeout = -1;
     bool bind_required = false;
-    char *fun = "exec[ute]Batch([params][, callback])";
+    char *fun = "exec[ute]Batch([params][, options][, callback])";
 
     args.GetReturnValue().SetUndefined();
 
-    if (!checkExecParameters(args, fun, bind_required, cbfunc_arg)) {
+    if (!checkExecParameters(args, fun, bind_required, cbfunc_arg, timeout)) {
         return;
     }
 
@@ -273,7 +396,7 @@ NODE_API_FUNC(Statement::execBatch)
     Handle<Array> bind_params = Handle<Array>::Cast(args[0]);
     int batch_size = bind_params->Length();
 
-    if (batch_size < 1) {
+    if (!bind_required || batch_size < 1) {
         invalid_arguments = true;
     } else {
         for (int i = 0; i < batch_size; i++) {
@@ -316,6 +439,7 @@ NODE_API_FUNC(Statement::execBatch)
     baton->callback_required = callback_required;
     baton->batch_size = batch_size;
     baton->row_param_count = row_param_count;
+    baton->query_timeout = timeout;
 
     if (!getBindParameters(args[0], row_param_count, baton->params, baton->buffer_size)) {
         int error_code;
@@ -327,6 +451,26 @@ NODE_API_FUNC(Statement::execBatch)
         delete baton;
         return;
     }
+    baton->timings.end(PHASE_CONVERT);
+
+    // The rows of parameters; the packed buffers are charged by the worker
+    int64_t row_bytes = 0;
+    for (size_t i = 0; i < baton->buffer_size.size(); i++) {
+        row_bytes += (int64_t)baton->buffer_size[i];
+    }
+    baton->mem.setConnection(&obj->connection->mem);
+    if (!baton->mem.charge(MEM_BATCH, (int64_t)(baton->params.size() * sizeof(dbcapi_bind_data)) +
+                                      row_bytes * batch_size)) {
+        int error_code;
+        std::string error_msg;
+        std::string sql_state;
+        Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
+        getErrorMsg(JS_ERR_MEMORY_LIMIT, error_code, error_msg, sql_state);
+        callBack(error_code, &error_msg, &sql_state, args[cbfunc_arg], undef, callback_required);
+        delete baton;
+        return;
+    }
+    baton->mem.report(isolate);
 
     uv_work_t *req = new uv_work_t();
     req->data = baton;
@@ -336,13 +480,14 @@ NODE_API_FUNC(Statement::execBatch)
         baton->callback.Reset(isolate, callback);
 
         int status;
-        status = uv_queue_work(uv_default_loop(), req, executeBatchWork,
-                               (uv_after_work_cb)executeBatchAfter);
+        status = queueWork(req, executeBatchWork, (uv_after_work_cb)executeBatchAfter,
+                           workQueueOf(obj->connection));
         assert(status == 0);
         return;
     }
 
     executeBatchWork(req);
+    finishBatch(baton);
 
     int rows_affected = baton->rows_affected;
     bool err = baton->err;
@@ -365,6 +510,8 @@ void Statement::executeBatchAfter(uv_work_t *req)
     executeBatchBaton *baton = static_cast<executeBatchBaton*>(req->data);
     Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
 
+    finishBatch(baton);
+
     if (baton->err) {
         callBack(baton->error_code, &(baton->error_msg), &(baton->sql_state),
                  baton->callback, undef, baton->callback_required);
@@ -388,7 +535,9 @@ void Statement::executeBatchWork(uv_work_t *req)
 /********************************/
 {
     executeBatchBaton *baton = static_cast<executeBatchBaton*>(req->data);
+    baton->timings.end(PHASE_QUEUE);
     scoped_lock lock(*baton->obj_stmt->conn_mutex);
+    baton->timings.end(PHASE_LOCK);
 
     if (baton->obj->conn == NULL) {
         baton->err = true;
@@ -417,44 +566,29 @@ void Statement::executeBatchWork(uv_work_t *req)
         return;
     }
 
-    dbcapi_bind_data param;
+    const paramDescriptors &descs = baton->obj_stmt->param_descs;
     std::vector<dbcapi_bind_data*> params;
-    void* bufferSrc;
 
-    for (int i = 0; i < baton->row_param_count; i++) {
-        memset(&param, 0, sizeof(dbcapi_bind_data));
-
-        if (!api.dbcapi_describe_bind_param(baton->dbcapi_stmt_ptr, i, &param)) {
-            baton->err = true;
-            getErrorMsg(baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state);
-            return;
-        }
-
-        dbcapi_bind_data* paramNew = new dbcapi_bind_data();
-        memset(paramNew, 0, sizeof(dbcapi_bind_data));
-        params.push_back(paramNew);
-
-        params[i]->value.buffer_size = baton->buffer_size[i];
-        params[i]->value.type = baton->params[i]->value.type;
-        params[i]->direction = param.direction;
-
-        params[i]->value.buffer = new char[baton->batch_size * baton->buffer_size[i]];
-        for (int j = 0; j < baton->batch_size; j++) {
-            bufferSrc = baton->params[baton->row_param_count * j + i]->value.buffer;
-            if (bufferSrc != NULL) {
-                memcpy(params[i]->value.buffer + baton->buffer_size[i] * j, bufferSrc, baton->buffer_size[i]);
-            }
-        }
+    if (baton->row_param_count > descs.size()) {
+        baton->err = true;
+        getErrorMsg(JS_ERR_TOO_MANY_PARAMETERS, baton->error_code, baton->error_msg, baton->sql_state);
+        return;
+    }
 
-        params[i]->value.length = new size_t[baton->batch_size * sizeof(size_t)];
-        for (int j = 0; j < baton->batch_size; j++) {
-            params[i]->value.length[j] = *baton->params[baton->row_param_count * j + i]->value.length;
-        }
+    int64_t packed_bytes = 0;
+    for (int i = 0; i < baton->row_param_count; i++) {
+        packed_bytes += (int64_t)(baton->buffer_size[i] + sizeof(size_t) + sizeof(dbcapi_bool));
+    }
+    if (!baton->mem.charge(MEM_BATCH, packed_bytes * baton->batch_size)) {
+        baton->err = true;
+        getErrorMsg(JS_ERR_MEMORY_LIMIT, baton->error_code, baton->error_msg, baton->sql_state);
+        return;
+    }
 
-        params[i]->value.is_null = new dbcapi_bool[baton->batch_size * sizeof(dbcapi_bool)];
-        for (int j = 0; j < baton->batch_size; j++) {
-            params[i]->value.is_null[j] = *baton->params[baton->row_param_count * j + i]->value.is_null;
-        }
+    packBatchParameters(baton->params, baton->row_param_count, baton->batch_size,
+                        baton->buffer_size, params);
+    for (int i = 0; i < baton->row_param_count; i++) {
+        params[i]->direction = descs.params[i].direction;
 
         if (!api.dbcapi_bind_param(baton->dbcapi_stmt_ptr, i, params[i])) {
             baton->err = true;
@@ -463,8 +597,12 @@ void Statement::executeBatchWork(uv_work_t *req)
             return;
         }
     }
+    baton->timings.end(PHASE_BIND);
 
-    dbcapi_bool success_execute = api.dbcapi_set_batch_size(baton->dbcapi_stmt_ptr, baton->batch_size);
+    scopedQueryTimeout timeout(baton->dbcapi_stmt_ptr, baton->query_timeout,
+                               baton->obj_stmt->idleTimeout());
+    dbcapi_bool success_execute = timeout.ok &&
+                                  api.dbcapi_set_batch_size(baton->dbcapi_stmt_ptr, baton->batch_size);
     if (!success_execute) {
         baton->err = true;
         getErrorMsg(baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state);
@@ -473,6 +611,7 @@ void Statement::executeBatchWork(uv_work_t *req)
     }
 
     success_execute = api.dbcapi_execute(baton->dbcapi_stmt_ptr);
+    baton->timings.end(PHASE_EXECUTE);
     if (!success_execute) {
         baton->err = true;
         getErrorMsg(baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state);
@@ -481,9 +620,309 @@ void Statement::executeBatchWork(uv_work_t *req)
     }
 
     baton->rows_affected = api.dbcapi_affected_rows(baton->dbcapi_stmt_ptr);
+    if (isTracing(baton->obj)) {
+        baton->function_code = api.dbcapi_get_function_code(baton->dbcapi_stmt_ptr);
+    }
     clearParameters(params);
 }
 
+struct executeManyBaton : public executeBaton
+{
+    std::vector< std::vector<dbcapi_bind_data*> > param_sets;
+    // Number of rows of each parameter set when the result is not columnar
+    std::vector<size_t>			group_rows;
+
+    ~executeManyBaton()
+    {
+        for (size_t i = 0; i < param_sets.size(); i++) {
+            clearParameters(param_sets[i]);
+        }
+    }
+};
+
+static bool getExecuteManyResult(executeManyBaton *baton, Persistent<Value> &result)
+/*******************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope(isolate);
+
+    baton->mem.report(isolate);
+    if (baton->columnar != NULL) {
+        result.Reset(isolate, baton->columnar->toObject(isolate));
+        baton->mem.set(MEM_COLUMNAR, 0);
+        baton->mem.report(isolate);
+        return true;
+    }
+
+    Persistent<Value> rows;
+    bool converted = getResultSet(rows, baton->rows_affected, baton->col_names,
+                                  baton->string_vals, baton->num_vals, baton->int_vals,
+                                  baton->string_len, baton->col_types, baton->col_native_types);
+    baton->mem.set(MEM_FETCH, 0);
+    baton->mem.report(isolate);
+    if (!converted) {
+        return false;
+    }
+
+    // Split the rows of all executes into one Array per parameter set
+    Local<Value> all = Local<Value>::New(isolate, rows);
+    Local<Array> allRows = all->IsArray() ? Local<Array>::Cast(all) : Array::New(isolate);
+    Local<Array> groups = Array::New(isolate, (int)baton->group_rows.size());
+    uint32_t next = 0;
+    rows.Reset();
+
+    for (size_t i = 0; i < baton->group_rows.size(); i++) {
+        Local<Array> group = Array::New(isolate, (int)baton->group_rows[i]);
+        for (size_t j = 0; j < baton->group_rows[i] && next < allRows->Length(); j++) {
+            group->Set((uint32_t)j, allRows->Get(next++));
+        }
+        groups->Set((uint32_t)i, group);
+    }
+    result.Reset(isolate, groups);
+    return true;
+}
+
+NODE_API_FUNC(Statement::execMany)
+/*******************************/
+{
+    Isolate *isolate = args.GetIsolate();
+    HandleScope scope(isolate);
+    int cbfunc_arg = -1;
+    int timeout = -1;
+    bool bind_required = false;
+    const char *fun = "execMany(params[, options][, callback])";
+
+    args.GetReturnValue().SetUndefined();
+
+    if (!checkExecParameters(args, fun, bind_required, cbfunc_arg, timeout)) {
+        return;
+    }
+
+    bool invalid_arguments = !bind_required;
+    Handle<Array> param_sets;
+    if (bind_required) {
+        param_sets = Handle<Array>::Cast(args[0]);
+        for (uint32_t i = 0; i < param_sets->Length(); i++) {
+            if (!param_sets->Get(i)->IsArray()) {
+                invalid_arguments = true;
+                break;
+            }
+        }
+    }
+
+    if (invalid_arguments) {
+        char buffer[256];
+        memset(buffer, 0, sizeof(buffer));
+        sprintf(buffer, "Invalid parameter 1 for function '%s': expected an array of arrays.", fun);
+        std::string errText = buffer;
+        std::string sqlState = "HY000";
+        throwError(JS_ERR_INVALID_ARGUMENTS, errText, sqlState);
+        return;
+    }
+
+    bool columnar = false;
+    int options_arg = findOptionsArg(args, 0);
+    if (options_arg >= 0) {
+        Local<Value> value = args[options_arg]->ToObject()->Get(String::NewFromUtf8(isolate, "columnar"));
+        columnar = value->BooleanValue();
+    }
+
+    bool callback_required = (cbfunc_arg >= 0);
+    Statement *obj = ObjectWrap::Unwrap<Statement>(args.This());
+    if (!Statement::checkStatement(obj, args, cbfunc_arg, callback_required)) {
+        return;
+    }
+
+    executeManyBaton *baton = new executeManyBaton();
+    baton->obj = obj->connection;
+    baton->obj_stmt = obj;
+    baton->dbcapi_stmt_ptr = obj->dbcapi_stmt_ptr;
+    baton->callback_required = callback_required;
+    baton->query_timeout = timeout;
+    if (columnar) {
+        baton->columnar = new columnarResult();
+    }
+
+    baton->param_sets.resize(param_sets->Length());
+    for (uint32_t i = 0; i < param_sets->Length(); i++) {
+        std::vector<dbcapi_bind_data*> &params = baton->param_sets[i];
+        bool valid = getInputParameters(param_sets->Get(i), params, baton->error_code,
+                                        baton->error_msg, baton->sql_state);
+
+        // Parameter data cannot be sent in the middle of the executes
+        for (size_t j = 0; valid && j < params.size(); j++) {
+            if (params[j]->value.type == A_INVALID_TYPE) {
+                getErrorMsg(JS_ERR_BINDING_PARAMETERS, baton->error_code, baton->error_msg, baton->sql_state);
+                valid = false;
+            }
+        }
+        if (!valid) {
+            Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
+            callBack(baton->error_code, &baton->error_msg, &baton->sql_state, args[cbfunc_arg], undef, callback_required);
+            delete baton;
+            return;
+        }
+    }
+
+    uv_work_t *req = new uv_work_t();
+    req->data = baton;
+
+    if (callback_required) {
+        Local<Function> callback = Local<Function>::Cast(args[cbfunc_arg]);
+        baton->callback.Reset(isolate, callback);
+
+        int status;
+        status = queueWork(req, executeManyWork, (uv_after_work_cb)executeManyAfter,
+                           workQueueOf(obj->connection));
+        assert(status == 0);
+        return;
+    }
+
+    executeManyWork(req);
+
+    Persistent<Value> result;
+    bool success = !baton->err && getExecuteManyResult(baton, result);
+    if (!baton->err && !success) {
+        getErrorMsg(JS_ERR_RESULTSET, baton->error_code, baton->error_msg, baton->sql_state);
+    }
+    if (!success) {
+        throwError(baton->error_code, baton->error_msg, baton->sql_state);
+    }
+
+    delete baton;
+    delete req;
+
+    if (success) {
+        args.GetReturnValue().Set(result);
+    }
+    result.Reset();
+}
+
+void Statement::executeManyAfter(uv_work_t *req)
+/*********************************/
+{
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope(isolate);
+    executeManyBaton *baton = static_cast<executeManyBaton*>(req->data);
+    Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
+    Persistent<Value> result;
+
+    if (!baton->err && !getExecuteManyResult(baton, result)) {
+        baton->err = true;
+        getErrorMsg(JS_ERR_RESULTSET, baton->error_code, baton->error_msg, baton->sql_state);
+    }
+
+    if (baton->err) {
+        callBack(baton->error_code, &(baton->error_msg), &(baton->sql_state),
+                 baton->callback, undef, baton->callback_required);
+    } else {
+        callBack(0, NULL, NULL, baton->callback, result, baton->callback_required);
+    }
+    result.Reset();
+
+    delete baton;
+    delete req;
+}
+
+void Statement::executeManyWork(uv_work_t *req)
+/********************************/
+{
+    executeManyBaton *baton = static_cast<executeManyBaton*>(req->data);
+    scoped_lock lock(*baton->obj_stmt->conn_mutex);
+
+    if (baton->obj->conn == NULL) {
+        baton->err = true;
+        getErrorMsg(JS_ERR_NOT_CONNECTED, baton->error_code, baton->error_msg, baton->sql_state);
+        return;
+    }
+
+    if (baton->dbcapi_stmt_ptr == NULL) {
+        baton->err = true;
+        getErrorMsg(JS_ERR_INVALID_OBJECT, baton->error_code, baton->error_msg, baton->sql_state);
+        return;
+    }
+
+    if (api.dbcapi_num_cols(baton->dbcapi_stmt_ptr) < 1) {
+        baton->err = true;
+        getErrorMsg(JS_ERR_NO_RESULTSET_AVAILABLE, baton->error_code, baton->error_msg, baton->sql_state);
+        return;
+    }
+
+    const paramDescriptors &descs = baton->obj_stmt->param_descs;
+    // The cursor, column information and fetch buffers are reused by all executes
+    resultBinding binding;
+    baton->mem.setConnection(&baton->obj->mem);
+
+    scopedQueryTimeout timeout(baton->dbcapi_stmt_ptr, baton->query_timeout,
+                               baton->obj_stmt->idleTimeout());
+    if (!timeout.ok) {
+        baton->err = true;
+        getErrorMsg(baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state);
+        return;
+    }
+
+    for (size_t i = 0; i < baton->param_sets.size(); i++) {
+        bool sendParamData = false;
+
+        if (!api.dbcapi_reset(baton->dbcapi_stmt_ptr)) {
+            baton->err = true;
+            getErrorMsg(baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state);
+            return;
+        }
+
+        if (!checkParameterCount(baton->error_code, baton->error_msg, baton->sql_state,
+                                 baton->param_sets[i], descs)) {
+            baton->err = true;
+            return;
+        }
+
+        getBindParameters(baton->param_sets[i], baton->params, descs);
+
+        if (!bindParameters(baton->obj->conn, baton->dbcapi_stmt_ptr, baton->params, descs,
+                            baton->error_code, baton->error_msg, baton->sql_state, sendParamData)) {
+            baton->err = true;
+            return;
+        }
+
+        if (!api.dbcapi_execute(baton->dbcapi_stmt_ptr)) {
+            baton->err = true;
+            getErrorMsg(baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state);
+            return;
+        }
+
+        bool fetched;
+        if (baton->columnar != NULL) {
+            baton->columnar->groups.push_back((uint32_t)baton->columnar->num_rows);
+            fetched = baton->columnar->fetch(baton->dbcapi_stmt_ptr, &binding, &baton->mem);
+        } else {
+            size_t cells = baton->col_types.size();
+            fetched = fetchResultSet(baton->dbcapi_stmt_ptr, baton->rows_affected, baton->col_names,
+                                     baton->string_vals, baton->num_vals, baton->int_vals,
+                                     baton->string_len, baton->col_types, baton->col_native_types,
+                                     &binding, &baton->mem);
+            if (binding.num_cols > 0) {
+                baton->group_rows.push_back((baton->col_types.size() - cells) / binding.num_cols);
+            } else {
+                baton->group_rows.push_back(0);
+            }
+        }
+        if (!fetched) {
+            baton->err = true;
+            if (baton->mem.exceeded) {
+                getErrorMsg(JS_ERR_MEMORY_LIMIT, baton->error_code, baton->error_msg, baton->sql_state);
+            } else {
+                getErrorMsg(baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state);
+            }
+            return;
+        }
+        clearParameters(baton->params);
+    }
+
+    if (baton->columnar != NULL) {
+        baton->columnar->groups.push_back((uint32_t)baton->columnar->num_rows);
+    }
+}
+
 bool Statement::checkStatement(Statement *obj,
                                const FunctionCallbackInfo<Value> &args,
                                int cbfunc_arg,
@@ -517,11 +956,14 @@ struct executeQueryBaton {
     Connection 				*obj;
     Statement                           *obj_stmt;
     dbcapi_stmt 			*dbcapi_stmt_ptr;
+    bool                                use_arena;
+    int                                 query_timeout;
 
     std::vector<dbcapi_bind_data*> 	params;
     std::vector<dbcapi_bind_data*> 	provided_params;
 
     Persistent<Value> 		        resultSetObj;
+    Persistent<Object>                  stmtObj;
 
     executeQueryBaton()
     {
@@ -530,6 +972,8 @@ struct executeQueryBaton {
         obj = NULL;
         obj_stmt = NULL;
         dbcapi_stmt_ptr = NULL;
+        use_arena = false;
+        query_timeout = -1;
     }
 
     ~executeQueryBaton()
@@ -537,6 +981,7 @@ struct executeQueryBaton {
         //dbcapi_stmt_ptr will be freed by ResultSet
         callback.Reset();
         resultSetObj.Reset();
+        stmtObj.Reset();
         clearParameters(params);
         clearParameters(provided_params);
     }
@@ -550,6 +995,14 @@ void Statement::executeQueryAfter(uv_work_t *req)
     executeQueryBaton *baton = static_cast<executeQueryBaton*>(req->data);
     Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
 
+    if (baton->use_arena) {
+        baton->obj_stmt->params_busy = false;
+    } else if (!baton->err && !baton->obj_stmt->params_busy) {
+        storeParameters(baton->obj_stmt->params, baton->obj_stmt->params_capacity,
+                        baton->obj_stmt->param_descs, baton->params);
+        baton->obj_stmt->accountBindArena(isolate);
+    }
+
     if (baton->err) {
         // Error Message is already set in the executeQueryWork() function
         callBack(0, NULL, NULL, baton->callback, undef, baton->callback_required);
@@ -566,7 +1019,9 @@ void Statement::executeQueryAfter(uv_work_t *req)
         resultset->connection = baton->obj_stmt->connection;
         resultset->conn_mutex = baton->obj_stmt->conn_mutex;
         resultset->dbcapi_stmt_ptr = baton->dbcapi_stmt_ptr;
+        resultset->setOwner(isolate, baton->obj_stmt, Local<Object>::New(isolate, baton->stmtObj));
         resultset->getColumnInfos();
+        resultset->mem.report(isolate);
 
         callBack(0, NULL, NULL, baton->callback, resultSetObj, baton->callback_required);
     }
@@ -581,8 +1036,9 @@ void Statement::executeQueryWork(uv_work_t *req)
     executeQueryBaton *baton = static_cast<executeQueryBaton*>(req->data);
     scoped_lock lock(*baton->obj_stmt->conn_mutex);
 
-    baton->dbcapi_stmt_ptr = api.dbcapi_prepare(baton->obj_stmt->connection->conn,
-                                                baton->obj_stmt->sql.c_str());
+    // Each result set needs its own cursor; take one from the statement's
+    // pool rather than preparing the statement again.
+    baton->dbcapi_stmt_ptr = baton->obj_stmt->acquireCursor();
     if (baton->dbcapi_stmt_ptr == NULL) {
         baton->err = true;
         getErrorMsg(baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state);
@@ -590,19 +1046,31 @@ void Statement::executeQueryWork(uv_work_t *req)
     }
 
     bool sendParamData = false;
-    if (!bindParameters(baton->obj->conn, baton->dbcapi_stmt_ptr, baton->params,
-        baton->error_code, baton->error_msg, baton->sql_state, sendParamData)) {
+    bool bound = baton->use_arena ?
+        bindArenaParameters(baton->obj->conn, baton->dbcapi_stmt_ptr, baton->obj_stmt->params,
+                            baton->error_code, baton->error_msg, baton->sql_state) :
+        bindParameters(baton->obj->conn, baton->dbcapi_stmt_ptr, baton->params,
+                       baton->obj_stmt->param_descs, baton->error_code, baton->error_msg,
+                       baton->sql_state, sendParamData);
+    if (!bound) {
         baton->err = true;
+        baton->obj_stmt->releaseCursor(baton->dbcapi_stmt_ptr);
+        baton->dbcapi_stmt_ptr = NULL;
         return;
     }
 
-    dbcapi_bool success_execute = api.dbcapi_execute(baton->dbcapi_stmt_ptr);
+    dbcapi_bool success_execute;
+    {
+        scopedQueryTimeout timeout(baton->dbcapi_stmt_ptr, baton->query_timeout,
+                                   baton->obj_stmt->idleTimeout());
+        success_execute = timeout.ok && api.dbcapi_execute(baton->dbcapi_stmt_ptr);
+    }
 
-    if (success_execute) {
-        copyParameters(baton->obj_stmt->params, baton->params);
-    } else {
+    if (!success_execute) {
         baton->err = true;
         getErrorMsg(baton->obj->conn, baton->error_code, baton->error_msg, baton->sql_state);
+        baton->obj_stmt->releaseCursor(baton->dbcapi_stmt_ptr);
+        baton->dbcapi_stmt_ptr = NULL;
     }
 }
 
@@ -612,11 +1080,12 @@ NODE_API_FUNC(Statement::execQuery)
     Isolate *isolate = args.GetIsolate();
     HandleScope scope(isolate);
     int  cbfunc_arg = -1;
+    int  timeout = -1;
     bool bind_required = false;
 
     args.GetReturnValue().SetUndefined();
 
-    if (!checkExecParameters(args, "exec[ute]Query([params][, callback])", bind_required, cbfunc_arg)) {
+    if (!checkExecParameters(args, "exec[ute]Query([params][, options][, callback])", bind_required, cbfunc_arg, timeout)) {
         return;
     }
 
@@ -635,29 +1104,39 @@ NODE_API_FUNC(Statement::execQuery)
     baton->obj_stmt = obj;
     baton->dbcapi_stmt_ptr = obj->dbcapi_stmt_ptr;
     baton->callback_required = callback_required;
-
-    if (bind_required) {
-        if (!getInputParameters(args[0], baton->provided_params, baton->error_code, baton->error_msg, baton->sql_state) ||
-            !checkParameterCount(baton->error_code, baton->error_msg, baton->sql_state, baton->provided_params, baton->dbcapi_stmt_ptr)) {
-            Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
-            callBack(baton->error_code, &baton->error_msg, &baton->sql_state, args[cbfunc_arg], undef, callback_required);
-            delete baton;
-            return;
+    baton->query_timeout = timeout;
+
+    if (!obj->params_busy &&
+        setBindArenaValues(bind_required ? args[0] : Local<Value>(), obj->params,
+                           obj->params_capacity, obj->param_descs)) {
+        baton->use_arena = true;
+        obj->params_busy = true;
+        obj->accountBindArena(isolate);
+    } else {
+        if (bind_required) {
+            if (!getInputParameters(args[0], baton->provided_params, baton->error_code, baton->error_msg, baton->sql_state) ||
+                !checkParameterCount(baton->error_code, baton->error_msg, baton->sql_state, baton->provided_params, obj->param_descs)) {
+                Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
+                callBack(baton->error_code, &baton->error_msg, &baton->sql_state, args[cbfunc_arg], undef, callback_required);
+                delete baton;
+                return;
+            }
         }
-    }
 
-    getBindParameters(baton->provided_params, baton->params, baton->dbcapi_stmt_ptr);
+        getBindParameters(baton->provided_params, baton->params, obj->param_descs);
+    }
 
     uv_work_t *req = new uv_work_t();
     req->data = baton;
 
     if (callback_required) {
         baton->resultSetObj.Reset(isolate, resultSetObj);
+        baton->stmtObj.Reset(isolate, args.This());
         Local<Function> callback = Local<Function>::Cast(args[cbfunc_arg]);
         baton->callback.Reset(isolate, callback);
 
-        int status = uv_queue_work(uv_default_loop(), req, executeQueryWork,
-                                   (uv_after_work_cb)executeQueryAfter);
+        int status = queueWork(req, executeQueryWork, (uv_after_work_cb)executeQueryAfter,
+                               workQueueOf(obj->connection));
         assert(status == 0);
         _unused(status);
         return;
@@ -670,6 +1149,7 @@ NODE_API_FUNC(Statement::execQuery)
 
     executeQueryWork(req);
     resultset->dbcapi_stmt_ptr = baton->dbcapi_stmt_ptr;
+    resultset->setOwner(isolate, obj, args.This());
     bool err = baton->err;
     executeQueryAfter(req);
 
@@ -678,6 +1158,7 @@ NODE_API_FUNC(Statement::execQuery)
     }
 
     resultset->getColumnInfos();
+    resultset->mem.report(isolate);
     args.GetReturnValue().Set(resultSetObj);
 }
 
@@ -737,6 +1218,10 @@ void Statement::dropWork(uv_work_t *req)
     if (baton->obj->dbcapi_stmt_ptr != NULL) {
         api.dbcapi_free_stmt(baton->obj->dbcapi_stmt_ptr);
     }
+    // Cursors still held by open result sets are freed when they close
+    baton->obj->freeCursors();
+    // The descriptors reference memory owned by the statement handle
+    baton->obj->param_descs.clear();
 
     baton->obj->dbcapi_stmt_ptr = NULL;
     //baton->obj->connection = NULL;
@@ -778,8 +1263,8 @@ NODE_API_FUNC(Statement::drop)
         baton->callback.Reset(isolate, callback);
 
         int status;
-        status = uv_queue_work(uv_default_loop(), req, dropWork,
-                               (uv_after_work_cb)dropAfter);
+        status = queueWork(req, dropWork, (uv_after_work_cb)dropAfter,
+                           workQueueOf(obj->connection));
         assert(status == 0);
         return;
     }
@@ -797,40 +1282,34 @@ NODE_API_FUNC(Statement::getParameterInfo)
     HandleScope scope(isolate);
     Statement *obj = ObjectWrap::Unwrap<Statement>(args.This());
 
-    int num_params = api.dbcapi_num_params(obj->dbcapi_stmt_ptr);
+    int num_params = obj->param_descs.size();
     Local<Array> paramInfos = Array::New(isolate);
 
-    dbcapi_bind_data data;
-    dbcapi_bind_param_info info;
-
     args.GetReturnValue().SetUndefined();
 
     for (int i = 0; i < num_params; i++) {
-        if (api.dbcapi_get_bind_param_info(obj->dbcapi_stmt_ptr, i, &info) &&
-            api.dbcapi_describe_bind_param(obj->dbcapi_stmt_ptr, i, &data)) {
-            Local<Object> paramInfo = Object::New(isolate);
-            paramInfo->Set(String::NewFromUtf8(isolate, "name"),
-                           String::NewFromUtf8(isolate, info.name));
-            paramInfo->Set(String::NewFromUtf8(isolate, "direction"),
-                           Integer::New(isolate, info.direction));
-            paramInfo->Set(String::NewFromUtf8(isolate, "nativeType"),
-                           Integer::New(isolate, info.native_type));
-            paramInfo->Set(String::NewFromUtf8(isolate, "nativeTypeName"),
-                           String::NewFromUtf8(isolate, getNativeTypeName(info.native_type)));
-            paramInfo->Set(String::NewFromUtf8(isolate, "precision"),
-                           Integer::NewFromUnsigned(isolate, info.precision));
-            paramInfo->Set(String::NewFromUtf8(isolate, "scale"),
-                           Integer::NewFromUnsigned(isolate, info.scale));
-            paramInfo->Set(String::NewFromUtf8(isolate, "maxSize"),
-                           Integer::New(isolate, (int)info.max_size));
-            paramInfo->Set(String::NewFromUtf8(isolate, "type"),
-                           Integer::New(isolate, data.value.type));
-            paramInfo->Set(String::NewFromUtf8(isolate, "typeName"),
-                           String::NewFromUtf8(isolate, getTypeName(data.value.type)));
-            paramInfos->Set(i, paramInfo);
-        } else {
-            throwError(obj->connection->conn);
-        }
+        const dbcapi_bind_data &data = obj->param_descs.params[i];
+        const dbcapi_bind_param_info &info = obj->param_descs.infos[i];
+        Local<Object> paramInfo = Object::New(isolate);
+        paramInfo->Set(String::NewFromUtf8(isolate, "name"),
+                       String::NewFromUtf8(isolate, info.name));
+        paramInfo->Set(String::NewFromUtf8(isolate, "direction"),
+                       Integer::New(isolate, info.direction));
+        paramInfo->Set(String::NewFromUtf8(isolate, "nativeType"),
+                       Integer::New(isolate, info.native_type));
+        paramInfo->Set(String::NewFromUtf8(isolate, "nativeTypeName"),
+                       String::NewFromUtf8(isolate, getNativeTypeName(info.native_type)));
+        paramInfo->Set(String::NewFromUtf8(isolate, "precision"),
+                       Integer::NewFromUnsigned(isolate, info.precision));
+        paramInfo->Set(String::NewFromUtf8(isolate, "scale"),
+                       Integer::NewFromUnsigned(isolate, info.scale));
+        paramInfo->Set(String::NewFromUtf8(isolate, "maxSize"),
+                       Integer::New(isolate, (int)info.max_size));
+        paramInfo->Set(String::NewFromUtf8(isolate, "type"),
+                       Integer::New(isolate, data.value.type));
+        paramInfo->Set(String::NewFromUtf8(isolate, "typeName"),
+                       String::NewFromUtf8(isolate, getTypeName(data.value.type)));
+        paramInfos->Set(i, paramInfo);
     }
 
     args.GetReturnValue().Set(paramInfos);
@@ -843,7 +1322,8 @@ bool Statement::checkParameterIndex(Statement *obj,
 {
     if (args[0]->IsInt32()) {
         paramIndex = args[0]->Int32Value();
-        if (paramIndex >= 0 && paramIndex < (int)(obj->params.size())) {
+        if (paramIndex >= 0 && paramIndex < (int)(obj->params.size()) &&
+            paramIndex < obj->param_descs.size()) {
             return true;
         }
     }
@@ -874,7 +1354,7 @@ NODE_API_FUNC(Statement::getParameterValue)
     int paramIndex;
     if (checkParameterIndex(obj, args, paramIndex)) {
         dbcapi_data_value & value = obj->params[paramIndex].value;
-        setReturnValue(args, value, obj->param_infos[paramIndex].native_type);
+        setReturnValue(args, value, obj->param_descs.infos[paramIndex].native_type);
     }
 }
 
@@ -999,8 +1479,8 @@ NODE_API_FUNC(Statement::sendParameterData)
         baton->callback.Reset(isolate, callback);
 
         int status;
-        status = uv_queue_work(uv_default_loop(), req, sendParameterDataWork,
-            (uv_after_work_cb)sendParameterDataAfter);
+        status = queueWork(req, sendParameterDataWork,
+            (uv_after_work_cb)sendParameterDataAfter, workQueueOf(obj->connection));
         assert(status == 0);
 
         return;
@@ -0,0 +1,104 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include "hana_utils.h"
+
+StatementCache::StatementCache()
+/******************************/
+{
+    capacity = 0;
+    num_entries = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+StatementCache::~StatementCache()
+/*******************************/
+{
+    clear();
+}
+
+dbcapi_stmt *StatementCache::lookup(const std::string &sql, const paramDescriptors *&descs)
+/*********************************************************/
+{
+    if (!enabled()) {
+        return NULL;
+    }
+
+    std::unordered_map<std::string, entry_list::iterator>::iterator it = index.find(sql);
+    if (it == index.end()) {
+        misses++;
+        return NULL;
+    }
+
+    // Move to the front of the LRU list
+    entries.splice(entries.begin(), entries, it->second);
+    hits++;
+    descs = &it->second->descs;
+    return it->second->stmt;
+}
+
+bool StatementCache::insert(const std::string &sql, dbcapi_stmt *stmt,
+                            const paramDescriptors &descs)
+/********************************************************************/
+{
+    if (!enabled() || stmt == NULL || index.find(sql) != index.end()) {
+        return false;
+    }
+
+    evict(capacity - 1);
+
+    entry e;
+    e.sql = sql;
+    e.stmt = stmt;
+    e.descs = descs;
+    entries.push_front(e);
+    index[sql] = entries.begin();
+    num_entries = entries.size();
+    return true;
+}
+
+void StatementCache::remove(const std::string &sql)
+/*************************************************/
+{
+    std::unordered_map<std::string, entry_list::iterator>::iterator it = index.find(sql);
+    if (it == index.end()) {
+        return;
+    }
+    api.dbcapi_free_stmt(it->second->stmt);
+    entries.erase(it->second);
+    index.erase(it);
+    num_entries = entries.size();
+}
+
+void StatementCache::setCapacity(size_t new_capacity)
+/***************************************************/
+{
+    capacity = new_capacity;
+    evict(capacity);
+}
+
+void StatementCache::clear()
+/**************************/
+{
+    for (entry_list::iterator it = entries.begin(); it != entries.end(); ++it) {
+        api.dbcapi_free_stmt(it->stmt);
+    }
+    entries.clear();
+    index.clear();
+    num_entries = 0;
+}
+
+void StatementCache::evict(size_t max_entries)
+/********************************************/
+{
+    while (entries.size() > max_entries) {
+        entry &last = entries.back();
+        api.dbcapi_free_stmt(last.stmt);
+        index.erase(last.sql);
+        entries.pop_back();
+        evictions++;
+    }
+    num_entries = entries.size();
+}
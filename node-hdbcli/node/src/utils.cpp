@@ -50,6 +50,36 @@ void getErrorMsg( int           code,
         case JS_ERR_NO_FETCH_FIRST:
             errText = std::string("ResetSet not fetched");
             break;
+        case JS_ERR_NO_RESULTSET_AVAILABLE:
+            errText = std::string("The statement does not return a result set");
+            break;
+        case JS_ERR_POOL_CLOSED:
+            errText = std::string("Connection pool is closed");
+            break;
+        case JS_ERR_POOL_TIMEOUT:
+            errText = std::string("Timed out waiting for a pooled connection");
+            break;
+        case JS_ERR_POOL_EXISTS:
+            errText = std::string("A connection pool with this name already exists");
+            break;
+        case JS_ERR_POOL_NOT_FOUND:
+            errText = std::string("No connection pool with this name exists");
+            break;
+        case JS_ERR_WRITING_FILE:
+            errText = std::string("Can not write the file");
+            break;
+        case JS_ERR_MEMORY_LIMIT:
+            errText = std::string("The result exceeds the native memory limit");
+            break;
+        case JS_ERR_RESULT_TOO_LARGE:
+            errText = std::string("The result exceeds maxResultBytes");
+            break;
+        case JS_ERR_SPILL:
+            errText = std::string("Can not write the result to a temporary file");
+            break;
+        case JS_ERR_NOT_SUPPORTED:
+            errText = std::string("Not supported by the client library");
+            break;
         default:
             errText = std::string( "Unknown Error" );
     }
@@ -268,6 +298,133 @@ std::string getJSTypeName( unsigned int type )
     return typeName;
 }
 
+int findOptionsArg( const FunctionCallbackInfo<Value> &args, int firstIndex )
+/*************************************************************************/
+{
+    // An options object is accepted as the last argument, or just before a
+    // trailing callback function
+    int num_args = args.Length();
+
+    if (num_args > firstIndex && getJSType(args[num_args - 1]) == JS_OBJECT) {
+        return num_args - 1;
+    }
+    if (num_args - 1 > firstIndex && args[num_args - 1]->IsFunction() &&
+        getJSType(args[num_args - 2]) == JS_OBJECT) {
+        return num_args - 2;
+    }
+    return -1;
+}
+
+bool getQueryOptions( const FunctionCallbackInfo<Value> &args,
+                      int optionsArg,
+                      const char *function,
+                      int &timeout )
+/*************************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+
+    timeout = -1;
+    if (optionsArg < 0) {
+        return true;
+    }
+
+    Local<Object> options = args[optionsArg]->ToObject();
+    Local<Value> value = options->Get(String::NewFromUtf8(isolate, "timeout"));
+
+    if (value->IsUndefined() || value->IsNull()) {
+        return true;
+    }
+    if (!value->IsNumber() || value->NumberValue() < 0) {
+        throwErrorIP(optionsArg, function, "{ timeout: integer }",
+                     getJSTypeName(getJSType(value)).c_str());
+        return false;
+    }
+    if (api.dbcapi_set_query_timeout == NULL) {
+        throwError(JS_ERR_NOT_SUPPORTED);
+        return false;
+    }
+
+    timeout = value->Int32Value();
+    return true;
+}
+
+bool getResultLimitOptions( const FunctionCallbackInfo<Value> &args,
+                            int optionsArg,
+                            const char *function,
+                            resultLimit &limit )
+/*************************************************************************/
+{
+    Isolate *isolate = args.GetIsolate();
+
+    if (optionsArg < 0) {
+        return true;
+    }
+
+    Local<Object> options = args[optionsArg]->ToObject();
+    Local<Value> value = options->Get(String::NewFromUtf8(isolate, "maxResultBytes"));
+
+    if (!value->IsUndefined() && !value->IsNull()) {
+        if (!value->IsNumber() || value->NumberValue() < 0) {
+            throwErrorIP(optionsArg, function, "{ maxResultBytes: number }",
+                         getJSTypeName(getJSType(value)).c_str());
+            return false;
+        }
+        limit.max_bytes = (int64_t)value->NumberValue();
+    }
+
+    value = options->Get(String::NewFromUtf8(isolate, "resultPolicy"));
+    if (value->IsUndefined() || value->IsNull()) {
+        return true;
+    }
+    if (value->IsString()) {
+        String::Utf8Value policy(value);
+        if (strcmp(*policy, "error") == 0) {
+            limit.policy = RESULT_POLICY_ERROR;
+            return true;
+        } else if (strcmp(*policy, "truncate") == 0) {
+            limit.policy = RESULT_POLICY_TRUNCATE;
+            return true;
+        } else if (strcmp(*policy, "spill") == 0) {
+            limit.policy = RESULT_POLICY_SPILL;
+            return true;
+        }
+    }
+    throwErrorIP(optionsArg, function, "{ resultPolicy: 'error' | 'truncate' | 'spill' }",
+                 getJSTypeName(getJSType(value)).c_str());
+    return false;
+}
+
+bool setQueryTimeout( dbcapi_stmt *stmt, int timeout )
+/*************************************************************************/
+{
+    // Negative means "not specified", the handle keeps its current timeout
+    if (timeout < 0 || api.dbcapi_set_query_timeout == NULL) {
+        return true;
+    }
+    return api.dbcapi_set_query_timeout(stmt, timeout) != 0;
+}
+
+scopedQueryTimeout::scopedQueryTimeout( dbcapi_stmt *stmt_, int timeout_, int restore_to_ )
+/*****************************************************************************************/
+{
+    stmt = stmt_;
+    timeout = timeout_;
+    restore_to = restore_to_;
+    // The handle already has the timeout between executes
+    if (timeout == restore_to) {
+        timeout = -1;
+    }
+    ok = setQueryTimeout(stmt, timeout);
+}
+
+scopedQueryTimeout::~scopedQueryTimeout()
+/***************************************/
+{
+    if (ok && timeout >= 0 && restore_to >= 0) {
+        setQueryTimeout(stmt, restore_to);
+    }
+}
+
 bool checkParameters( const FunctionCallbackInfo<Value> &args,
                       const char *function,
                       int argCount,
@@ -576,24 +733,51 @@ void setReturnValue(const FunctionCallbackInfo<Value> &args,
     }
 }
 
-bool checkParameterCount( int &                             errCode,
-                          std::string &                     errText,
-                          std::string &                     sqlState,
-                          std::vector<dbcapi_bind_data*> &  providedParams,
-                          dbcapi_stmt *                     dbcapi_stmt_ptr )
+bool paramDescriptors::describe(dbcapi_stmt *stmt)
 /**********************************************************************/
 {
-    int inputParamCount = 0;
-    int numParams = api.dbcapi_num_params(dbcapi_stmt_ptr);
+    clear();
+
+    int numParams = api.dbcapi_num_params(stmt);
 
     for (int i = 0; i < numParams; i++) {
         dbcapi_bind_data param;
-        api.dbcapi_describe_bind_param(dbcapi_stmt_ptr, i, &param);
+        dbcapi_bind_param_info info;
+
+        memset(&param, 0, sizeof(dbcapi_bind_data));
+        memset(&info, 0, sizeof(dbcapi_bind_param_info));
+        if (!api.dbcapi_describe_bind_param(stmt, i, &param) ||
+            !api.dbcapi_get_bind_param_info(stmt, i, &info)) {
+            clear();
+            return false;
+        }
         if (param.direction == DD_INPUT || param.direction == DD_INPUT_OUTPUT) {
-            inputParamCount++;
+            num_inputs++;
         }
+        params.push_back(param);
+        infos.push_back(info);
     }
 
+    return true;
+}
+
+void paramDescriptors::clear()
+/**********************************************************************/
+{
+    params.clear();
+    infos.clear();
+    num_inputs = 0;
+}
+
+bool checkParameterCount( int &                             errCode,
+                          std::string &                     errText,
+                          std::string &                     sqlState,
+                          std::vector<dbcapi_bind_data*> &  providedParams,
+                          const paramDescriptors &          descs )
+/**********************************************************************/
+{
+    int inputParamCount = descs.num_inputs;
+
     if (inputParamCount < (int) providedParams.size()) {
         getErrorMsg(JS_ERR_TOO_MANY_PARAMETERS, errCode, errText, sqlState);
         return false;
@@ -738,16 +922,17 @@ bool getInputParameters( Handle<Value>                     arg,
 
 bool getBindParameters(std::vector<dbcapi_bind_data*> &    inputParams,
                        std::vector<dbcapi_bind_data*> &    params,
-                       dbcapi_stmt *                       stmt)
+                       const paramDescriptors &            descs)
  /**********************************************************************/
 {
-    int numParams = api.dbcapi_num_params(stmt);
+    int numParams = descs.size();
 
     params.clear();
 
     for (int i = 0; i < numParams; i++) {
-        dbcapi_bind_data* param = new dbcapi_bind_data();
-        api.dbcapi_describe_bind_param(stmt, i, param);
+        dbcapi_bind_data* param = new dbcapi_bind_data(descs.params[i]);
+        param->value.buffer = NULL;
+        param->value.buffer_size = 0;
         param->value.length = new size_t;
         *param->value.length = 0;
         param->value.is_null = new dbcapi_bool;
@@ -770,6 +955,12 @@ bool getBindParameters(std::vector<dbcapi_bind_data*> &    inputParams,
                 clearParameter(param, true);
             }
         } else {
+            if (param->direction == DD_OUTPUT) {
+                // The size is known from the descriptor, so allocate once here
+                // instead of growing the buffer in bindParameters.
+                param->value.buffer_size = descs.infos[i].max_size + 1;
+                param->value.buffer = new char[param->value.buffer_size];
+            }
             params.push_back(param);
         }
     }
@@ -813,6 +1004,44 @@ bool getBindParameters(Handle<Value>                    arg,
     return true;
 }
 
+// Used for execBatch
+void packBatchParameters(const std::vector<dbcapi_bind_data*> &  rows,
+                         int                                     row_param_count,
+                         int                                     batch_size,
+                         const std::vector<size_t> &             buffer_size,
+                         std::vector<dbcapi_bind_data*> &        params)
+/**********************************************************************/
+{
+    void* bufferSrc;
+
+    for (int i = 0; i < row_param_count; i++) {
+        dbcapi_bind_data* paramNew = new dbcapi_bind_data();
+        memset(paramNew, 0, sizeof(dbcapi_bind_data));
+        params.push_back(paramNew);
+
+        paramNew->value.buffer_size = buffer_size[i];
+        paramNew->value.type = rows[i]->value.type;
+
+        paramNew->value.buffer = new char[batch_size * buffer_size[i]];
+        for (int j = 0; j < batch_size; j++) {
+            bufferSrc = rows[row_param_count * j + i]->value.buffer;
+            if (bufferSrc != NULL) {
+                memcpy(paramNew->value.buffer + buffer_size[i] * j, bufferSrc, buffer_size[i]);
+            }
+        }
+
+        paramNew->value.length = new size_t[batch_size * sizeof(size_t)];
+        for (int j = 0; j < batch_size; j++) {
+            paramNew->value.length[j] = *rows[row_param_count * j + i]->value.length;
+        }
+
+        paramNew->value.is_null = new dbcapi_bool[batch_size * sizeof(dbcapi_bool)];
+        for (int j = 0; j < batch_size; j++) {
+            paramNew->value.is_null[j] = *rows[row_param_count * j + i]->value.is_null;
+        }
+    }
+}
+
 dbcapi_bind_data* getBindParameter( Local<Value> element )
 /**********************************************************************/
 {
@@ -912,6 +1141,7 @@ dbcapi_bind_data* getBindParameter( Local<Value> element )
 bool bindParameters(dbcapi_connection *                 conn,
                     dbcapi_stmt *                       stmt,
                     std::vector<dbcapi_bind_data*> &    params,
+                    const paramDescriptors &            descs,
                     int &                               errCode,
                     std::string &                       errText,
                     std::string &                       sqlState,
@@ -920,15 +1150,14 @@ bool bindParameters(dbcapi_connection *                 conn,
 {
     sendParamData = false;
 
-    for (int i = 0; i < (int)(params.size()); i++) {
-        dbcapi_bind_data param;
-        dbcapi_bind_param_info info;
+    if ((int)(params.size()) > descs.size()) {
+        getErrorMsg(JS_ERR_TOO_MANY_PARAMETERS, errCode, errText, sqlState);
+        return false;
+    }
 
-        if (!api.dbcapi_get_bind_param_info(stmt, i, &info) ||
-            !api.dbcapi_describe_bind_param(stmt, i, &param)) {
-            getErrorMsg(conn, errCode, errText, sqlState);
-            return false;
-        }
+    for (int i = 0; i < (int)(params.size()); i++) {
+        dbcapi_bind_data param = descs.params[i];
+        const dbcapi_bind_param_info &info = descs.infos[i];
 
         if (param.direction == DD_OUTPUT || param.direction == DD_INPUT_OUTPUT) {
             if (params[i]->value.buffer == NULL || info.max_size > params[i]->value.buffer_size) {
@@ -1003,54 +1232,6 @@ void clearParameters(std::vector<dbcapi_bind_data*> & params)
     params.clear();
 }
 
-void copyParameters(std::vector<dbcapi_bind_data> & paramsDest,
-                    std::vector<dbcapi_bind_data> & paramsSrc)
-/*************************************************************************/
-{
-    clearParameters(paramsDest);
-
-    for (size_t i = 0; i < paramsSrc.size(); i++) {
-        paramsDest.push_back(paramsSrc[i]);
-        if (paramsSrc[i].value.is_null != NULL) {
-            paramsDest[i].value.is_null = new dbcapi_bool;
-            *paramsDest[i].value.is_null = *paramsSrc[i].value.is_null;
-        }
-        if (paramsSrc[i].value.length != NULL) {
-            paramsDest[i].value.length = new size_t;
-            *paramsDest[i].value.length = *paramsSrc[i].value.length;
-        }
-        size_t size = paramsSrc[i].value.buffer_size;
-        if (size > 0) {
-            paramsDest[i].value.buffer = new char[size];
-            memcpy(paramsDest[i].value.buffer, paramsSrc[i].value.buffer, size);
-        }
-    }
-}
-
-void copyParameters(std::vector<dbcapi_bind_data> & paramsDest,
-                    std::vector<dbcapi_bind_data*> & paramsSrc)
-    /*************************************************************************/
-{
-    clearParameters(paramsDest);
-
-    for (size_t i = 0; i < paramsSrc.size(); i++) {
-        paramsDest.push_back(*paramsSrc[i]);
-        if (paramsSrc[i]->value.is_null != NULL) {
-            paramsDest[i].value.is_null = new dbcapi_bool;
-            *paramsDest[i].value.is_null = *paramsSrc[i]->value.is_null;
-        }
-        if (paramsSrc[i]->value.length != NULL) {
-            paramsDest[i].value.length = new size_t;
-            *paramsDest[i].value.length = *paramsSrc[i]->value.length;
-        }
-        size_t size = paramsSrc[i]->value.buffer_size;
-        if (size > 0) {
-            paramsDest[i].value.buffer = new char[size];
-            memcpy(paramsDest[i].value.buffer, paramsSrc[i]->value.buffer, size);
-        }
-    }
-}
-
 bool fillResult(executeBaton *baton, Persistent<Value> &ResultSet)
 /*************************************************************************/
 {
@@ -1058,23 +1239,54 @@ bool fillResult(executeBaton *baton, Persistent<Value> &ResultSet)
     HandleScope scope(isolate);
     Local<Value> undef = Local<Value>::New(isolate, Undefined(isolate));
 
+    // Let V8 see the fetched rows before the conversion allocates
+    baton->mem.report(isolate);
+
     if (baton->err) {
+        recordTimings(baton->obj, baton->timings);
+        traceExecute(baton, "exec");
         callBack(baton->error_code, &(baton->error_msg), &(baton->sql_state),
                  baton->callback, undef, baton->callback_required);
         return false;
     }
 
-    if (!getResultSet(ResultSet, baton->rows_affected, baton->col_names,
-        baton->string_vals, baton->num_vals, baton->int_vals,
-        baton->string_len, baton->col_types, baton->col_native_types)) {
+    baton->timings.begin();
+    bool converted = true;
+    if (baton->limit.spill != NULL) {
+        // Rows are converted when they are read from the file
+        spillFile *spill = baton->limit.spill;
+        baton->limit.spill = NULL;
+        spill->col_names.swap(baton->col_names);
+        spill->col_native_types.swap(baton->col_native_types);
+        ResultSet.Reset(isolate, SpilledResult::NewInstance(isolate, spill));
+    } else {
+        converted = getResultSet(ResultSet, baton->rows_affected, baton->col_names,
+            baton->string_vals, baton->num_vals, baton->int_vals,
+            baton->string_len, baton->col_types, baton->col_native_types);
+        if (converted && baton->limit.truncated) {
+            Local<Object> rows = Local<Value>::New(isolate, ResultSet)->ToObject();
+            rows->Set(String::NewFromUtf8(isolate, "truncated"), True(isolate));
+        }
+    }
+    baton->timings.end(PHASE_CONVERT);
+    // The conversion has freed the fetched values
+    baton->mem.set(MEM_FETCH, 0);
+    baton->mem.report(isolate);
+    // Recorded before the callback runs, so it sees its own operation
+    recordTimings(baton->obj, baton->timings);
+
+    if (!converted) {
+        baton->err = true;
         getErrorMsg(JS_ERR_RESULTSET, baton->error_code, baton->error_msg, baton->sql_state);
+        traceExecute(baton, "exec");
         callBack(baton->error_code, &(baton->error_msg), &(baton->sql_state),
                  baton->callback, undef, baton->callback_required);
         return false;
     }
+    traceExecute(baton, "exec");
     if (baton->callback_required) {
         // No result for DDL statements
-        int hasResult = api.dbcapi_get_function_code(baton->dbcapi_stmt_ptr) != 1;
+        int hasResult = baton->function_code != 1;
         callBack(baton->error_code, NULL, &(baton->sql_state),
             baton->callback, ResultSet, baton->callback_required, hasResult);
     }
@@ -1103,6 +1315,7 @@ bool getResultSet(Persistent<Value> &			Result,
     }
 
     if (num_cols > 0) {
+        convertProbe probe("getResultSet", num_cols);
         size_t count = 0;
         size_t count_int = 0, count_num = 0, count_string = 0;
         Local<Array> ResultSet = Array::New(isolate);
@@ -1209,6 +1422,7 @@ bool getResultSet(Persistent<Value> &			Result,
             }
             ResultSet->Set(num_rows - 1, curr_row);
         }
+        probe.rows = num_rows;
         Result.Reset(isolate, ResultSet);
     } else {
         Result.Reset(isolate, Local<Value>::New(isolate,
@@ -1223,8 +1437,6 @@ void clearValues(std::vector<dbcapi_data_value*> & values)
 {
 }
 
-#define DEFAULT_ROWSET_SIZE 10
-
 bool fetchResultSet( dbcapi_stmt *			dbcapi_stmt_ptr,
 		     int &				rows_affected,
 		     std::vector<char *> &		colNames,
@@ -1233,11 +1445,19 @@ bool fetchResultSet( dbcapi_stmt *			dbcapi_stmt_ptr,
 		     std::vector<int*> &		int_vals,
 		     std::vector<size_t*> &		string_len,
 		     std::vector<dbcapi_data_type> &	col_types,
-                     std::vector<dbcapi_native_type> &  col_native_types )
+                     std::vector<dbcapi_native_type> &  col_native_types,
+                     resultBinding *                    binding,
+                     memAccount *                       mem,
+                     resultLimit *                      limit )
 /*****************************************************************/
 {
     dbcapi_data_value		value;
     int				num_cols = 0;
+    resultBinding		local_binding;
+
+    if (binding == NULL) {
+        binding = &local_binding;
+    }
 
     rows_affected = api.dbcapi_affected_rows( dbcapi_stmt_ptr );
     num_cols = api.dbcapi_num_cols( dbcapi_stmt_ptr );
@@ -1248,34 +1468,42 @@ bool fetchResultSet( dbcapi_stmt *			dbcapi_stmt_ptr,
 
     rows_affected = -1;
     if (num_cols > 0) {
-        bool has_lob = false;
         int rowset_size = DEFAULT_ROWSET_SIZE;
-        dataValueCollection bind_cols;
 
-        for (int i = 0; i < num_cols; i++) {
-            dbcapi_column_info info;
-            api.dbcapi_get_column_info(dbcapi_stmt_ptr, i, &info);
-            size_t size = strlen(info.name) + 1;
-            char *name = new char[size];
-            memcpy(name, info.name, size);
-            colNames.push_back(name);
-            col_native_types.push_back(info.native_type);
-
-            if (info.native_type == DT_BLOB || info.native_type == DT_CLOB || info.native_type == DT_NCLOB) {
-                has_lob = true;
-            }
+        // Rows of later executes are appended to the same columns
+        if (binding->num_cols < 0) {
+            for (int i = 0; i < num_cols; i++) {
+                dbcapi_column_info info;
+                api.dbcapi_get_column_info(dbcapi_stmt_ptr, i, &info);
+                size_t size = strlen(info.name) + 1;
+                char *name = new char[size];
+                memcpy(name, info.name, size);
+                colNames.push_back(name);
+                if (mem != NULL) {
+                    mem->add(MEM_FETCH, (int64_t)(size + sizeof(char *)));
+                }
+                col_native_types.push_back(info.native_type);
 
-            if (!has_lob) {
-                dbcapi_data_value* bind_col = new dbcapi_data_value();
-                bind_col->buffer_size = info.max_size;
-                bind_col->buffer = new char[info.max_size * rowset_size];
-                bind_col->length = new size_t[rowset_size];
-                bind_col->is_null = new dbcapi_bool[rowset_size];
-                bind_col->type = info.type;
-                bind_cols.push_back(bind_col);
+                if (info.native_type == DT_BLOB || info.native_type == DT_CLOB || info.native_type == DT_NCLOB) {
+                    binding->has_lob = true;
+                }
+
+                if (!binding->has_lob) {
+                    dbcapi_data_value* bind_col = new dbcapi_data_value();
+                    bind_col->buffer_size = info.max_size;
+                    bind_col->buffer = new char[info.max_size * rowset_size];
+                    bind_col->length = new size_t[rowset_size];
+                    bind_col->is_null = new dbcapi_bool[rowset_size];
+                    bind_col->type = info.type;
+                    binding->bind_cols.push_back(bind_col);
+                }
             }
+            binding->num_cols = num_cols;
         }
 
+        bool has_lob = binding->has_lob;
+        dataValueCollection &bind_cols = binding->bind_cols;
+
         if (!has_lob) {
 
             if (!api.dbcapi_set_rowset_size(dbcapi_stmt_ptr, rowset_size)) {
@@ -1293,6 +1521,10 @@ bool fetchResultSet( dbcapi_stmt *			dbcapi_stmt_ptr,
         while (api.dbcapi_fetch_next(dbcapi_stmt_ptr)) {
 
             int fetched_rows = api.dbcapi_fetched_rows(dbcapi_stmt_ptr);
+            // Charged once per rowset; the cells of a rowset are counted below
+            int64_t string_bytes = 0;
+            size_t cells = col_types.size();
+            int counted_string = count_string, counted_num = count_num, counted_int = count_int;
 
             for (int row = 0; row < fetched_rows; row++) {
 
@@ -1324,6 +1556,7 @@ bool fetchResultSet( dbcapi_stmt *			dbcapi_stmt_ptr,
                             memcpy(val, value.buffer, *size);
                             string_vals.push_back(val);
                             string_len.push_back(size);
+                            string_bytes += *size;
                             count_string++;
                             break;
                         }
@@ -1336,6 +1569,7 @@ bool fetchResultSet( dbcapi_stmt *			dbcapi_stmt_ptr,
                             memcpy(val, (char *)value.buffer, *size);
                             string_vals.push_back(val);
                             string_len.push_back(size);
+                            string_bytes += *size;
                             count_string++;
                             break;
                         }
@@ -1427,6 +1661,55 @@ bool fetchResultSet( dbcapi_stmt *			dbcapi_stmt_ptr,
                     col_types.push_back(value.type);
                 }
             }
+
+            int64_t bytes = string_bytes +
+                (count_string - counted_string) * (int64_t)(sizeof(size_t) + 2 * sizeof(char *)) +
+                (count_num - counted_num) * (int64_t)(sizeof(double) + sizeof(double *)) +
+                (count_int - counted_int) * (int64_t)(sizeof(int) + sizeof(int *)) +
+                (int64_t)((col_types.size() - cells) * sizeof(dbcapi_data_type));
+            if (mem != NULL && !mem->charge(MEM_FETCH, bytes)) {
+                return false;
+            }
+
+            if (limit == NULL || limit->max_bytes <= 0) {
+                continue;
+            }
+            limit->bytes += bytes;
+            if (limit->bytes <= limit->max_bytes && limit->spill == NULL) {
+                continue;
+            }
+            if (limit->policy == RESULT_POLICY_ERROR) {
+                limit->exceeded = true;
+                return false;
+            }
+            if (limit->policy == RESULT_POLICY_TRUNCATE) {
+                // Keeps the rowset that went over the budget
+                limit->truncated = true;
+                return true;
+            }
+
+            // Once the result is spilled, every further rowset goes to the file
+            if (limit->spill == NULL) {
+                limit->spill = new spillFile();
+                if (!limit->spill->open(num_cols)) {
+                    limit->spill_failed = true;
+                    return false;
+                }
+            }
+            if (!limit->spill->append(string_vals, num_vals, int_vals, string_len, col_types)) {
+                limit->spill_failed = true;
+                return false;
+            }
+            if (mem != NULL) {
+                mem->add(MEM_FETCH, -limit->bytes);
+            }
+            limit->bytes = 0;
+            count_string = count_num = count_int = 0;
+        }
+
+        if (limit != NULL && limit->spill != NULL && !limit->spill->finish()) {
+            limit->spill_failed = true;
+            return false;
         }
     }
 
@@ -1980,4 +2263,187 @@ int fetchColumnInfos(dbcapi_stmt* dbcapi_stmt_ptr,
     }
 
     return num_cols;
-}
\ No newline at end of file
+}
+
+static char *reserveBindBuffer(dbcapi_bind_data &  param,
+                               size_t &            capacity,
+                               size_t              size)
+/*************************************************************************/
+{
+    if (param.value.buffer == NULL || capacity < size) {
+        size_t newCapacity = (capacity * 2 > size) ? capacity * 2 : size;
+        if (param.value.buffer != NULL) {
+            delete[] param.value.buffer;
+        }
+        param.value.buffer = new char[newCapacity];
+        capacity = newCapacity;
+    }
+    param.value.buffer_size = capacity;
+    return param.value.buffer;
+}
+
+void prepareBindArena(std::vector<dbcapi_bind_data> &  arena,
+                      std::vector<size_t> &            capacity,
+                      const paramDescriptors &         descs)
+/*************************************************************************/
+{
+    if (arena.size() == descs.params.size()) {
+        return;
+    }
+
+    clearParameters(arena);
+    capacity.assign(descs.params.size(), 0);
+
+    for (size_t i = 0; i < descs.params.size(); i++) {
+        dbcapi_bind_data param = descs.params[i];
+        param.value.buffer = NULL;
+        param.value.buffer_size = 0;
+        param.value.length = new size_t;
+        *param.value.length = 0;
+        param.value.is_null = new dbcapi_bool;
+        *param.value.is_null = false;
+        if (param.direction == DD_OUTPUT || param.direction == DD_INPUT_OUTPUT) {
+            reserveBindBuffer(param, capacity[i], descs.infos[i].max_size + 1);
+        }
+        arena.push_back(param);
+    }
+}
+
+static bool fitsBindArena(Local<Value> element, dbcapi_data_type type)
+/*************************************************************************/
+{
+    if (element->IsNull() || element->IsBoolean() || element->IsNumber() ||
+        Buffer::HasInstance(element)) {
+        return true;
+    }
+    // Strings for integer parameters need the conversion of getBindParameters;
+    // LOB descriptors and other objects use the regular binding path as well
+    return element->IsString() && type != A_VAL32;
+}
+
+bool setBindArenaValues(Handle<Value>                    arg,
+                        std::vector<dbcapi_bind_data> &  arena,
+                        std::vector<size_t> &            capacity,
+                        const paramDescriptors &         descs)
+/*************************************************************************/
+{
+    Handle<Array> bind_params;
+    unsigned int num_values = 0;
+    unsigned int next_value = 0;
+
+    if (!arg.IsEmpty() && arg->IsArray()) {
+        bind_params = Handle<Array>::Cast(arg);
+        num_values = bind_params->Length();
+    }
+
+    // Check all values before the first one is written, so the arena is
+    // left as it was when the regular binding path has to be used
+    for (size_t i = 0; i < descs.params.size(); i++) {
+        if (descs.params[i].direction == DD_OUTPUT) {
+            continue;
+        }
+        if (next_value >= num_values ||
+            !fitsBindArena(bind_params->Get(next_value++), descs.params[i].value.type)) {
+            return false;
+        }
+    }
+    if (next_value != num_values) {
+        return false;
+    }
+    next_value = 0;
+
+    prepareBindArena(arena, capacity, descs);
+
+    for (size_t i = 0; i < arena.size(); i++) {
+        dbcapi_bind_data &param = arena[i];
+        size_t min_size = 0;
+
+        *param.value.is_null = false;
+        *param.value.length = 0;
+
+        if (param.direction == DD_OUTPUT || param.direction == DD_INPUT_OUTPUT) {
+            min_size = descs.infos[i].max_size + 1;
+        }
+
+        if (param.direction == DD_OUTPUT) {
+            param.value.type = descs.params[i].value.type;
+            continue;
+        }
+
+        Local<Value> element = bind_params->Get(next_value++);
+
+        if (element->IsNull()) {
+            param.value.type = A_VAL32;
+            *param.value.is_null = true;
+            reserveBindBuffer(param, capacity[i], min_size > sizeof(int) ? min_size : sizeof(int));
+        } else if (element->IsBoolean() || element->IsInt32()) {
+            int value = element->IsBoolean() ? (element->BooleanValue() ? 1 : 0) : element->Int32Value();
+            char *buffer = reserveBindBuffer(param, capacity[i], min_size > sizeof(int) ? min_size : sizeof(int));
+            memcpy(buffer, &value, sizeof(int));
+            param.value.type = A_VAL32;
+            *param.value.length = sizeof(int);
+        } else if (element->IsNumber()) {
+            double value = element->NumberValue();
+            char *buffer = reserveBindBuffer(param, capacity[i], min_size > sizeof(double) ? min_size : sizeof(double));
+            memcpy(buffer, &value, sizeof(double));
+            param.value.type = A_DOUBLE;
+            *param.value.length = sizeof(double);
+        } else if (element->IsString()) {
+            Local<String> str = element->ToString();
+            size_t len = (size_t)str->Utf8Length();
+            char *buffer = reserveBindBuffer(param, capacity[i], min_size > len + 1 ? min_size : len + 1);
+            str->WriteUtf8(buffer, (int)len);
+            buffer[len] = '\0';
+            param.value.type = A_STRING;
+            *param.value.length = len;
+        } else {
+            size_t len = Buffer::Length(element);
+            char *buffer = reserveBindBuffer(param, capacity[i], min_size > len ? min_size : (len > 0 ? len : 1));
+            memcpy(buffer, Buffer::Data(element), len);
+            param.value.type = A_BINARY;
+            *param.value.length = len;
+        }
+    }
+
+    return true;
+}
+
+bool bindArenaParameters(dbcapi_connection *              conn,
+                         dbcapi_stmt *                    stmt,
+                         std::vector<dbcapi_bind_data> &  arena,
+                         int &                            errCode,
+                         std::string &                    errText,
+                         std::string &                    sqlState)
+/*************************************************************************/
+{
+    for (size_t i = 0; i < arena.size(); i++) {
+        if (!api.dbcapi_bind_param(stmt, (dbcapi_u32)i, &arena[i])) {
+            getErrorMsg(conn, errCode, errText, sqlState);
+            return false;
+        }
+    }
+    return true;
+}
+
+void storeParameters(std::vector<dbcapi_bind_data> &   arena,
+                     std::vector<size_t> &             capacity,
+                     const paramDescriptors &          descs,
+                     std::vector<dbcapi_bind_data*> &  params)
+/*************************************************************************/
+{
+    prepareBindArena(arena, capacity, descs);
+
+    for (size_t i = 0; i < params.size() && i < arena.size(); i++) {
+        dbcapi_bind_data &dest = arena[i];
+        const dbcapi_bind_data *src = params[i];
+
+        dest.value.type = src->value.type;
+        *dest.value.is_null = (src->value.is_null != NULL) ? *src->value.is_null : false;
+        *dest.value.length = (src->value.length != NULL) ? *src->value.length : 0;
+
+        size_t size = src->value.buffer_size;
+        if (size > 0 && src->value.buffer != NULL) {
+            memcpy(reserveBindBuffer(dest, capacity[i], size), src->value.buffer, size);
+        }
+    }
+}
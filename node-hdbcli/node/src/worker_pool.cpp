@@ -0,0 +1,323 @@
+// ***************************************************************************
+// Copyright (c) 2016 SAP SE or an SAP affiliate company. All rights reserved.
+// ***************************************************************************
+#include "hana_utils.h"
+
+WorkerPool dbPool;
+
+WorkQueue::WorkQueue()
+/********************/
+{
+    running = false;
+    max_wait_ms = 0;
+    completed = 0;
+}
+
+WorkerPool::WorkerPool()
+/**********************/
+{
+    minThreads = 4;
+    maxThreads = 64;
+    env_checked = false;
+    idle = 0;
+    busy = 0;
+    num_completed = 0;
+    num_started = 0;
+    total_wait_ms = 0;
+    max_wait_ms = 0;
+    uv_mutex_init(&mutex);
+    uv_cond_init(&work_cond);
+    uv_cond_init(&done_cond);
+    uv_key_create(&port_key);
+}
+
+bool WorkerPool::init(uv_loop_t *loop)
+/************************************/
+{
+    if( uv_key_get(&port_key) != NULL ) {
+	return true;
+    }
+
+    loopPort *port = new loopPort();
+    port->pool = this;
+    port->in_flight = 0;
+    port->referenced = false;
+    port->closing = false;
+    if( uv_async_init(loop, &port->async, completionCallback) != 0 ) {
+	delete port;
+	return false;
+    }
+    port->async.data = port;
+    // Only keep the loop alive while requests are in flight
+    uv_unref((uv_handle_t *)&port->async);
+    uv_key_set(&port_key, port);
+
+    scoped_lock lock(mutex);
+    if( !env_checked ) {
+	char *env = getenv("HANA_DB_THREADPOOL_SIZE");
+	if( env != NULL && atoi(env) > 0 ) {
+	    maxThreads = (unsigned)atoi(env);
+	    if( minThreads > maxThreads ) {
+		minThreads = maxThreads;
+	    }
+	}
+	env_checked = true;
+    }
+    return true;
+}
+
+void WorkerPool::shutdownLoop()
+/*****************************/
+{
+    loopPort *port = static_cast<loopPort *>(uv_key_get(&port_key));
+    if( port == NULL ) {
+	return;
+    }
+
+    // The loop does not run any more, so the requests it still has out are
+    // waited for here and their after callbacks, which free the batons,
+    // run on this thread. They may queue more work of their own.
+    uv_mutex_lock(&mutex);
+    port->closing = true;
+    while( port->in_flight > 0 ) {
+	if( port->completed.empty() ) {
+	    uv_cond_wait(&done_cond, &mutex);
+	    continue;
+	}
+	uv_mutex_unlock(&mutex);
+	drainCompleted(port);
+	uv_mutex_lock(&mutex);
+    }
+    uv_mutex_unlock(&mutex);
+
+    uv_key_set(&port_key, NULL);
+    uv_close((uv_handle_t *)&port->async, portClosed);
+}
+
+void WorkerPool::portClosed(uv_handle_t *handle)
+/**********************************************/
+{
+    // shutdownLoop has waited for every request of the port, so no worker
+    // references it any more
+    delete static_cast<loopPort *>(handle->data);
+}
+
+void WorkerPool::setMaxThreads(unsigned max_threads)
+/**************************************************/
+{
+    scoped_lock lock(mutex);
+    maxThreads = max_threads > 0 ? max_threads : 1;
+    if( minThreads > maxThreads ) {
+	minThreads = maxThreads;
+    }
+}
+
+void WorkerPool::reserveThreads(unsigned count)
+/*********************************************/
+{
+    scoped_lock lock(mutex);
+    if( count > maxThreads ) {
+	count = maxThreads;
+    }
+    while( threads.size() < count ) {
+	uv_thread_t tid;
+	if( uv_thread_create(&tid, workerMain, this) != 0 ) {
+	    break;
+	}
+	threads.push_back(tid);
+    }
+}
+
+void WorkerPool::growLocked()
+/***************************/
+{
+    unsigned target = openConnections;
+    if( target < minThreads ) {
+	target = minThreads;
+    }
+    if( target > maxThreads ) {
+	target = maxThreads;
+    }
+    if( pending.size() <= idle || threads.size() >= target ) {
+	return;
+    }
+
+    uv_thread_t tid;
+    if( uv_thread_create(&tid, workerMain, this) == 0 ) {
+	threads.push_back(tid);
+    }
+}
+
+int WorkerPool::queueWork(uv_work_t *req, uv_work_cb work, uv_after_work_cb after,
+			  WorkQueue *queue)
+/********************************************************************************/
+{
+    loopPort *port = static_cast<loopPort *>(uv_key_get(&port_key));
+    if( port == NULL || work == NULL ) {
+	return UV_EINVAL;
+    }
+
+    scoped_lock lock(mutex);
+    workRequest r;
+    r.req = req;
+    r.work = work;
+    r.after = after;
+    r.queue = queue;
+    r.port = port;
+    r.queued_at = uv_hrtime();
+
+    if( queue != NULL && queue->running ) {
+	// The thread running the connection's current request picks it up
+	queue->waiting.push_back(r);
+    } else {
+	pending.push_back(r);
+	growLocked();
+	if( threads.empty() ) {
+	    pending.pop_back();
+	    return UV_EAGAIN;
+	}
+	if( queue != NULL ) {
+	    queue->running = true;
+	}
+	uv_cond_signal(&work_cond);
+    }
+    port->in_flight++;
+    if( !port->referenced ) {
+	uv_ref((uv_handle_t *)&port->async);
+	port->referenced = true;
+    }
+    return 0;
+}
+
+void WorkerPool::recordWaitLocked(const workRequest &r)
+/*****************************************************/
+{
+    double wait_ms = (uv_hrtime() - r.queued_at) / 1e6;
+
+    busy++;
+    num_started++;
+    total_wait_ms += wait_ms;
+    if( wait_ms > max_wait_ms ) {
+	max_wait_ms = wait_ms;
+    }
+    if( r.queue != NULL && wait_ms > r.queue->max_wait_ms ) {
+	r.queue->max_wait_ms = wait_ms;
+    }
+}
+
+void WorkerPool::workerMain(void *arg)
+/************************************/
+{
+    WorkerPool *pool = static_cast<WorkerPool *>(arg);
+    workRequest r;
+    bool have_next = false;
+
+    for( ;; ) {
+	if( !have_next ) {
+	    scoped_lock lock(pool->mutex);
+	    pool->idle++;
+	    while( pool->pending.empty() ) {
+		uv_cond_wait(&pool->work_cond, &pool->mutex);
+	    }
+	    pool->idle--;
+	    r = pool->pending.front();
+	    pool->pending.pop_front();
+	    pool->recordWaitLocked(r);
+	}
+
+	r.work(r.req);
+
+	{
+	    scoped_lock lock(pool->mutex);
+	    pool->busy--;
+	    r.port->completed.push_back(r);
+	    if( r.port->closing ) {
+		// shutdownLoop is waiting on the loop's thread
+		uv_cond_broadcast(&pool->done_cond);
+	    } else {
+		// Sent under the lock: once shutdownLoop has seen closing, the
+		// handle may be closed and the port freed at any time
+		uv_async_send(&r.port->async);
+	    }
+	    have_next = false;
+
+	    WorkQueue *queue = r.queue;
+	    if( queue != NULL ) {
+		queue->completed++;
+		if( queue->waiting.empty() ) {
+		    queue->running = false;
+		} else {
+		    // Run the connection's next request on this thread
+		    // rather than going through the pool queue again
+		    r = queue->waiting.front();
+		    queue->waiting.pop_front();
+		    pool->recordWaitLocked(r);
+		    have_next = true;
+		}
+	    }
+	}
+    }
+}
+
+void WorkerPool::completionCallback(uv_async_t *handle)
+/*****************************************************/
+{
+    loopPort *port = static_cast<loopPort *>(handle->data);
+    port->pool->drainCompleted(port);
+}
+
+void WorkerPool::drainCompleted(loopPort *port)
+/*********************************************/
+{
+    std::deque<workRequest> done;
+    {
+	scoped_lock lock(mutex);
+	done.swap(port->completed);
+	port->in_flight -= done.size();
+	num_completed += done.size();
+    }
+
+    for( size_t i = 0; i < done.size(); i++ ) {
+	if( done[i].after != NULL ) {
+	    done[i].after(done[i].req, 0);
+	}
+    }
+
+    // After callbacks may have queued more work
+    scoped_lock lock(mutex);
+    if( port->in_flight == 0 && port->referenced && !port->closing ) {
+	uv_unref((uv_handle_t *)&port->async);
+	port->referenced = false;
+    }
+}
+
+void WorkerPool::getStats(stats &out)
+/***********************************/
+{
+    scoped_lock lock(mutex);
+    out.threads = (unsigned)threads.size();
+    out.max_threads = maxThreads;
+    out.busy = busy;
+    out.queued = pending.size();
+    out.completed = num_completed;
+    out.avg_wait_ms = num_started > 0 ? total_wait_ms / num_started : 0;
+    out.max_wait_ms = max_wait_ms;
+}
+
+void WorkerPool::getQueueStats(WorkQueue &queue, WorkQueue::stats &out)
+/*********************************************************************/
+{
+    scoped_lock lock(mutex);
+    out.length = queue.waiting.size() + (queue.running ? 1 : 0);
+    out.oldest_wait_ms = queue.waiting.empty() ? 0 :
+	(uv_hrtime() - queue.waiting.front().queued_at) / 1e6;
+    out.max_wait_ms = queue.max_wait_ms;
+    out.completed = queue.completed;
+}
+
+int queueWork(uv_work_t *req, uv_work_cb work, uv_after_work_cb after,
+	      WorkQueue *queue)
+/********************************************************************/
+{
+    return dbPool.queueWork(req, work, after, queue);
+}